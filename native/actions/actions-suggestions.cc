@@ -16,6 +16,7 @@
 
 #include "actions/actions-suggestions.h"
 
+#include <limits>
 #include <memory>
 #include <vector>
 
@@ -36,6 +37,7 @@
 #endif
 #include "utils/normalization.h"
 #include "utils/optional.h"
+#include "utils/stage-timings.h"
 #include "utils/strings/split.h"
 #include "utils/strings/stringpiece.h"
 #include "utils/strings/utf8.h"
@@ -68,6 +70,17 @@ T ValueOrDefault(const flatbuffers::Table* values, const int32 field_offset,
   return values->GetField<T>(field_offset, default_value);
 }
 
+// Returns the number of tokens of each message.
+std::vector<int> CountTokensPerMessage(
+    const std::vector<std::vector<Token>>& tokens) {
+  std::vector<int> num_tokens_per_message;
+  num_tokens_per_message.reserve(tokens.size());
+  for (const std::vector<Token>& message_tokens : tokens) {
+    num_tokens_per_message.push_back(message_tokens.size());
+  }
+  return num_tokens_per_message;
+}
+
 // Returns number of (tail) messages of a conversation to consider.
 int NumMessagesToConsider(const Conversation& conversation,
                           const int max_conversation_history_length) {
@@ -282,6 +295,11 @@ bool ActionsSuggestions::ValidateAndInitialize() {
       TC3_LOG(ERROR) << "Could not initialize model executor.";
       return false;
     }
+    const TfLiteModelExecutor* model_executor = model_executor_.get();
+    interpreter_pool_ = std::make_unique<ObjectPool<tflite::Interpreter>>(
+        ObjectPool<tflite::Interpreter>::kDefaultMaxIdle,
+        [model_executor]() { return model_executor->CreateInterpreter(); });
+    interpreter_pool_->Warmup(1);
   }
 
   // Gather annotation entities for the rules.
@@ -349,6 +367,12 @@ bool ActionsSuggestions::ValidateAndInitialize() {
       TC3_LOG(ERROR) << "Could not precompile lua actions snippet.";
       return false;
     }
+    lua_actions_pool_ = std::make_unique<ObjectPool<LuaActionsSuggestions>>(
+        ObjectPool<LuaActionsSuggestions>::kDefaultMaxIdle, [this]() {
+          return LuaActionsSuggestions::CreateLuaActionsSuggestions(
+              lua_bytecode_);
+        });
+    lua_actions_pool_->Warmup(1);
   }
 #endif  // TC3_DISABLE_LUA
 
@@ -481,13 +505,38 @@ std::vector<std::vector<Token>> ActionsSuggestions::Tokenize(
   return tokens;
 }
 
+ActionsSuggestions::MessageTokenEmbedder
+ActionsSuggestions::TokenFeatureEmbedder(
+    const std::vector<std::vector<Token>>& tokens) const {
+  return [this, &tokens](int message_index, int begin, int end,
+                         std::vector<float>* embeddings) {
+    for (int pos = begin; pos < end; pos++) {
+      if (!feature_processor_->AppendTokenFeatures(
+              tokens[message_index][pos], embedding_executor_.get(),
+              embeddings)) {
+        return false;
+      }
+    }
+    return true;
+  };
+}
+
 bool ActionsSuggestions::EmbedTokensPerMessage(
     const std::vector<std::vector<Token>>& tokens,
     std::vector<float>* embeddings, int* max_num_tokens_per_message) const {
-  const int num_messages = tokens.size();
+  return EmbedMessageTokens(CountTokensPerMessage(tokens),
+                            TokenFeatureEmbedder(tokens), embeddings,
+                            max_num_tokens_per_message);
+}
+
+bool ActionsSuggestions::EmbedMessageTokens(
+    const std::vector<int>& num_tokens_per_message,
+    const MessageTokenEmbedder& embed_tokens, std::vector<float>* embeddings,
+    int* max_num_tokens_per_message) const {
+  const int num_messages = num_tokens_per_message.size();
   *max_num_tokens_per_message = 0;
   for (int i = 0; i < num_messages; i++) {
-    const int num_message_tokens = tokens[i].size();
+    const int num_message_tokens = num_tokens_per_message[i];
     if (num_message_tokens > *max_num_tokens_per_message) {
       *max_num_tokens_per_message = num_message_tokens;
     }
@@ -511,16 +560,15 @@ bool ActionsSuggestions::EmbedTokensPerMessage(
   // beginning of a message are dropped if they don't fit in the limit.
   for (int i = 0; i < num_messages; i++) {
     const int start =
-        std::max<int>(tokens[i].size() - *max_num_tokens_per_message, 0);
-    for (int pos = start; pos < tokens[i].size(); pos++) {
-      if (!feature_processor_->AppendTokenFeatures(
-              tokens[i][pos], embedding_executor_.get(), embeddings)) {
-        TC3_LOG(ERROR) << "Could not run token feature extractor.";
-        return false;
-      }
+        std::max<int>(num_tokens_per_message[i] - *max_num_tokens_per_message,
+                      0);
+    if (!embed_tokens(i, start, num_tokens_per_message[i], embeddings)) {
+      TC3_LOG(ERROR) << "Could not run token feature extractor.";
+      return false;
     }
     // Add padding.
-    for (int k = tokens[i].size(); k < *max_num_tokens_per_message; k++) {
+    for (int k = num_tokens_per_message[i]; k < *max_num_tokens_per_message;
+         k++) {
       embeddings->insert(embeddings->end(), embedded_padding_token_.begin(),
                          embedded_padding_token_.end());
     }
@@ -532,7 +580,16 @@ bool ActionsSuggestions::EmbedTokensPerMessage(
 bool ActionsSuggestions::EmbedAndFlattenTokens(
     const std::vector<std::vector<Token>>& tokens,
     std::vector<float>* embeddings, int* total_token_count) const {
-  const int num_messages = tokens.size();
+  return EmbedAndFlattenMessageTokens(CountTokensPerMessage(tokens),
+                                      TokenFeatureEmbedder(tokens), embeddings,
+                                      total_token_count);
+}
+
+bool ActionsSuggestions::EmbedAndFlattenMessageTokens(
+    const std::vector<int>& num_tokens_per_message,
+    const MessageTokenEmbedder& embed_tokens, std::vector<float>* embeddings,
+    int* total_token_count) const {
+  const int num_messages = num_tokens_per_message.size();
   int start_message = 0;
   int message_token_offset = 0;
 
@@ -545,7 +602,8 @@ bool ActionsSuggestions::EmbedAndFlattenTokens(
     start_message = num_messages - 1;
     for (; start_message >= 0; start_message--) {
       // Tokens of the message + start and end token.
-      const int num_message_tokens = tokens[start_message].size() + 2;
+      const int num_message_tokens =
+          num_tokens_per_message[start_message] + 2;
       total_tokens += num_message_tokens;
 
       // Check whether we exhausted the budget.
@@ -566,11 +624,10 @@ bool ActionsSuggestions::EmbedAndFlattenTokens(
                          embedded_start_token_.end());
     }
 
-    for (int pos = std::max(0, message_token_offset - 1);
-         pos < tokens[i].size(); pos++) {
-      ++(*total_token_count);
-      if (!feature_processor_->AppendTokenFeatures(
-              tokens[i][pos], embedding_executor_.get(), embeddings)) {
+    const int start = std::max(0, message_token_offset - 1);
+    if (start < num_tokens_per_message[i]) {
+      *total_token_count += num_tokens_per_message[i] - start;
+      if (!embed_tokens(i, start, num_tokens_per_message[i], embeddings)) {
         TC3_LOG(ERROR) << "Could not run token feature extractor.";
         return false;
       }
@@ -643,10 +700,10 @@ bool ActionsSuggestions::AllocateInput(const int conversation_length,
 bool ActionsSuggestions::SetupModelInput(
     const std::vector<std::string>& context, const std::vector<int>& user_ids,
     const std::vector<float>& time_diffs, const int num_suggestions,
-    const ActionSuggestionOptions& options,
-    tflite::Interpreter* interpreter) const {
+    const ActionSuggestionOptions& options, tflite::Interpreter* interpreter,
+    ConversationSession* session) const {
   // Compute token embeddings.
-  std::vector<std::vector<Token>> tokens;
+  std::vector<int> num_tokens_per_message;
   std::vector<float> token_embeddings;
   std::vector<float> flattened_token_embeddings;
   int max_tokens = 0;
@@ -659,17 +716,40 @@ bool ActionsSuggestions::SetupModelInput(
       return false;
     }
 
-    // Tokenize the messages in the conversation.
-    tokens = Tokenize(context);
+    // Tokenize the messages in the conversation, or reuse the tokens and
+    // embeddings cached by the session.
+    std::vector<std::vector<Token>> tokens;
+    MessageTokenEmbedder embed_tokens;
+    if (session != nullptr) {
+      const int first_message =
+          session->cached_messages_.size() - context.size();
+      for (int i = 0; i < context.size(); i++) {
+        num_tokens_per_message.push_back(
+            session->GetTokens(first_message + i).size());
+      }
+      embed_tokens = [session, first_message](int message_index, int begin,
+                                              int end,
+                                              std::vector<float>* embeddings) {
+        return session->AppendTokenEmbeddings(first_message + message_index,
+                                              begin, end, embeddings);
+      };
+    } else {
+      tokens = Tokenize(context);
+      num_tokens_per_message = CountTokensPerMessage(tokens);
+      embed_tokens = TokenFeatureEmbedder(tokens);
+    }
+
     if (model_->tflite_model_spec()->input_token_embeddings() >= 0) {
-      if (!EmbedTokensPerMessage(tokens, &token_embeddings, &max_tokens)) {
+      if (!EmbedMessageTokens(num_tokens_per_message, embed_tokens,
+                              &token_embeddings, &max_tokens)) {
         TC3_LOG(ERROR) << "Could not extract token features.";
         return false;
       }
     }
     if (model_->tflite_model_spec()->input_flattened_token_embeddings() >= 0) {
-      if (!EmbedAndFlattenTokens(tokens, &flattened_token_embeddings,
-                                 &total_token_count)) {
+      if (!EmbedAndFlattenMessageTokens(num_tokens_per_message, embed_tokens,
+                                        &flattened_token_embeddings,
+                                        &total_token_count)) {
         TC3_LOG(ERROR) << "Could not extract token features.";
         return false;
       }
@@ -722,10 +802,6 @@ bool ActionsSuggestions::SetupModelInput(
         interpreter);
   }
   if (model_->tflite_model_spec()->input_num_tokens() >= 0) {
-    std::vector<int> num_tokens_per_message(tokens.size());
-    for (int i = 0; i < tokens.size(); i++) {
-      num_tokens_per_message[i] = tokens[i].size();
-    }
     model_executor_->SetInput<int>(
         model_->tflite_model_spec()->input_num_tokens(), num_tokens_per_message,
         interpreter);
@@ -977,15 +1053,44 @@ bool ActionsSuggestions::ReadModelOutput(
   return true;
 }
 
+bool ActionsSuggestions::IsSensitiveConversation(
+    const Conversation& conversation, const int num_messages,
+    ConversationSession* session) const {
+  if (session == nullptr ||
+      !sensitive_model_->EvaluatesMessagesIndependently()) {
+    return sensitive_model_->EvalConversation(conversation, num_messages).first;
+  }
+
+  // Same as EvalConversation(), with the results cached per message.
+  for (int i = 1; i <= num_messages; i++) {
+    const int message_index = conversation.messages.size() - i;
+    ConversationSession::CachedMessage* cached_message =
+        &session->cached_messages_[message_index];
+    if (!cached_message->has_sensitive_topic_result) {
+      cached_message->is_sensitive =
+          sensitive_model_
+              ->Eval(UTF8ToUnicodeText(conversation.messages[message_index].text,
+                                       /*do_copy=*/false))
+              .first;
+      cached_message->has_sensitive_topic_result = true;
+    }
+    if (cached_message->is_sensitive) {
+      return true;
+    }
+  }
+  return false;
+}
+
 bool ActionsSuggestions::SuggestActionsFromModel(
     const Conversation& conversation, const int num_messages,
     const ActionSuggestionOptions& options,
     ActionsSuggestionsResponse* response,
-    std::unique_ptr<tflite::Interpreter>* interpreter) const {
+    PooledObject<tflite::Interpreter>* interpreter,
+    ConversationSession* session) const {
   TC3_CHECK_LE(num_messages, conversation.messages.size());
 
   if (sensitive_model_ != nullptr &&
-      sensitive_model_->EvalConversation(conversation, num_messages).first) {
+      IsSensitiveConversation(conversation, num_messages, session)) {
     response->is_sensitive = true;
     return true;
   }
@@ -993,7 +1098,7 @@ bool ActionsSuggestions::SuggestActionsFromModel(
   if (!model_executor_) {
     return true;
   }
-  *interpreter = model_executor_->CreateInterpreter();
+  interpreter->Reset(interpreter_pool_.get());
 
   if (!*interpreter) {
     TC3_LOG(ERROR) << "Could not build TensorFlow Lite interpreter for the "
@@ -1032,11 +1137,18 @@ bool ActionsSuggestions::SuggestActionsFromModel(
 
   if (!SetupModelInput(context, user_ids, time_diffs,
                        /*num_suggestions=*/model_->num_smart_replies(), options,
-                       interpreter->get())) {
+                       interpreter->get(), session)) {
     TC3_LOG(ERROR) << "Failed to setup input for TensorFlow Lite model.";
     return false;
   }
 
+  // A pooled interpreter might still hold the state of the last request.
+  if ((*interpreter)->ResetVariableTensors() != kTfLiteOk) {
+    TC3_LOG(ERROR) << "Failed to reset TensorFlow Lite interpreter state.";
+    return false;
+  }
+
+  ScopedStage::CountModelInvocation();
   if ((*interpreter)->Invoke() != kTfLiteOk) {
     TC3_LOG(ERROR) << "Failed to invoke TensorFlow Lite interpreter.";
     return false;
@@ -1071,12 +1183,7 @@ AnnotationOptions ActionsSuggestions::AnnotationOptionsForMessage(
   return options;
 }
 
-// Run annotator on the messages of a conversation.
-Conversation ActionsSuggestions::AnnotateConversation(
-    const Conversation& conversation, const Annotator* annotator) const {
-  if (annotator == nullptr) {
-    return conversation;
-  }
+int ActionsSuggestions::NumMessagesToAnnotate() const {
   const int num_messages_grammar =
       ((model_->rules() && model_->rules()->grammar_rules() &&
         model_->rules()
@@ -1093,7 +1200,16 @@ Conversation ActionsSuggestions::AnnotateConversation(
                       model_->annotation_actions_spec()
                           ->max_history_from_last_person())
            : 0);
-  const int num_messages = std::max(num_messages_grammar, num_messages_mapping);
+  return std::max(num_messages_grammar, num_messages_mapping);
+}
+
+// Run annotator on the messages of a conversation.
+Conversation ActionsSuggestions::AnnotateConversation(
+    const Conversation& conversation, const Annotator* annotator) const {
+  if (annotator == nullptr) {
+    return conversation;
+  }
+  const int num_messages = NumMessagesToAnnotate();
   if (num_messages == 0) {
     // No annotations are used.
     return conversation;
@@ -1112,6 +1228,43 @@ Conversation ActionsSuggestions::AnnotateConversation(
   return annotated_conversation;
 }
 
+void ActionsSuggestions::AnnotateSessionConversation(
+    const Annotator* annotator, ConversationSession* session) const {
+  Conversation* conversation = &session->annotated_conversation_;
+  const int num_messages = conversation->messages.size();
+
+  // Annotations of another annotator can't be reused.
+  const bool annotator_changed = annotator != session->annotator_;
+  const int first_message_to_check =
+      annotator_changed ? 0 : session->first_annotated_message_;
+  session->annotator_ = annotator;
+
+  // Like AnnotateConversation(), only annotate the most recent messages, and
+  // drop the annotations of the messages that are not recent anymore.
+  const int first_message_to_annotate =
+      annotator == nullptr
+          ? num_messages
+          : std::max(0, num_messages - NumMessagesToAnnotate());
+  for (int i = first_message_to_check; i < num_messages; i++) {
+    ConversationMessage* message = &conversation->messages[i];
+    ConversationSession::CachedMessage* cached_message =
+        &session->cached_messages_[i];
+    if (cached_message->is_annotated &&
+        (annotator_changed || i < first_message_to_annotate)) {
+      message->annotations.clear();
+      cached_message->is_annotated = false;
+    }
+    if (i >= first_message_to_annotate && !cached_message->is_annotated &&
+        message->annotations.empty()) {
+      message->annotations = annotator->Annotate(
+          message->text, AnnotationOptionsForMessage(*message));
+      ConvertDatetimeToTime(&message->annotations);
+      cached_message->is_annotated = true;
+    }
+  }
+  session->first_annotated_message_ = first_message_to_annotate;
+}
+
 void ActionsSuggestions::SuggestActionsFromAnnotations(
     const Conversation& conversation,
     std::vector<ActionSuggestion>* actions) const {
@@ -1277,14 +1430,14 @@ bool ActionsSuggestions::SuggestActionsFromLua(
     return true;
   }
 
-  auto lua_actions = LuaActionsSuggestions::CreateLuaActionsSuggestions(
-      lua_bytecode_, conversation, model_executor, model_->tflite_model_spec(),
-      interpreter, entity_data_schema_, annotation_entity_data_schema);
-  if (lua_actions == nullptr) {
+  PooledObject<LuaActionsSuggestions> lua_actions(lua_actions_pool_.get());
+  if (!lua_actions) {
     TC3_LOG(ERROR) << "Could not create lua actions.";
     return false;
   }
-  return lua_actions->SuggestActions(actions);
+  return lua_actions->SuggestActions(
+      conversation, model_executor, model_->tflite_model_spec(), interpreter,
+      entity_data_schema_, annotation_entity_data_schema, actions);
 }
 #else
 bool ActionsSuggestions::SuggestActionsFromLua(
@@ -1299,14 +1452,25 @@ bool ActionsSuggestions::SuggestActionsFromLua(
 bool ActionsSuggestions::GatherActionsSuggestions(
     const Conversation& conversation, const Annotator* annotator,
     const ActionSuggestionOptions& options,
-    ActionsSuggestionsResponse* response) const {
+    ActionsSuggestionsResponse* response, ConversationSession* session) const {
   if (conversation.messages.empty()) {
     return true;
   }
 
   // Run annotator against messages.
-  const Conversation annotated_conversation =
-      AnnotateConversation(conversation, annotator);
+  Conversation annotated_conversation_copy;
+  {
+    ScopedStage stage(options.stage_timings, "annotation");
+    if (session == nullptr) {
+      annotated_conversation_copy =
+          AnnotateConversation(conversation, annotator);
+    } else {
+      AnnotateSessionConversation(annotator, session);
+    }
+  }
+  const Conversation& annotated_conversation =
+      session == nullptr ? annotated_conversation_copy
+                         : session->annotated_conversation_;
 
   const int num_messages = NumMessagesToConsider(
       annotated_conversation, model_->max_conversation_history_length());
@@ -1316,13 +1480,19 @@ bool ActionsSuggestions::GatherActionsSuggestions(
     return false;
   }
 
-  SuggestActionsFromAnnotations(annotated_conversation, &response->actions);
+  {
+    ScopedStage stage(options.stage_timings, "annotation_actions",
+                      &response->actions);
+    SuggestActionsFromAnnotations(annotated_conversation, &response->actions);
+  }
 
-  if (grammar_actions_ != nullptr &&
-      !grammar_actions_->SuggestActions(annotated_conversation,
-                                        &response->actions)) {
-    TC3_LOG(ERROR) << "Could not suggest actions from grammar rules.";
-    return false;
+  if (grammar_actions_ != nullptr) {
+    ScopedStage stage(options.stage_timings, "grammar", &response->actions);
+    if (!grammar_actions_->SuggestActions(annotated_conversation,
+                                          &response->actions)) {
+      TC3_LOG(ERROR) << "Could not suggest actions from grammar rules.";
+      return false;
+    }
   }
 
   int input_text_length = 0;
@@ -1362,6 +1532,7 @@ bool ActionsSuggestions::GatherActionsSuggestions(
 
   std::vector<const UniLib::RegexPattern*> post_check_rules;
   if (preconditions_.suppress_on_low_confidence_input) {
+    ScopedStage stage(options.stage_timings, "low_confidence_check");
     if (regex_actions_->IsLowConfidenceInput(annotated_conversation,
                                              num_messages, &post_check_rules)) {
       response->output_filtered_low_confidence = true;
@@ -1369,11 +1540,14 @@ bool ActionsSuggestions::GatherActionsSuggestions(
     }
   }
 
-  std::unique_ptr<tflite::Interpreter> interpreter;
-  if (!SuggestActionsFromModel(annotated_conversation, num_messages, options,
-                               response, &interpreter)) {
-    TC3_LOG(ERROR) << "Could not run model.";
-    return false;
+  PooledObject<tflite::Interpreter> interpreter;
+  {
+    ScopedStage stage(options.stage_timings, "model", &response->actions);
+    if (!SuggestActionsFromModel(annotated_conversation, num_messages, options,
+                                 response, &interpreter, session)) {
+      TC3_LOG(ERROR) << "Could not run model.";
+      return false;
+    }
   }
 
   // SuggestActionsFromModel also detects if the conversation is sensitive,
@@ -1384,6 +1558,8 @@ bool ActionsSuggestions::GatherActionsSuggestions(
   }
 
   if (conversation_intent_detection_) {
+    ScopedStage stage(options.stage_timings, "conversation_intent_detection",
+                      &response->actions);
     // TODO(zbin): Ensure the deduplication/ranking logic in ranker.cc works.
     auto actions = SuggestActionsFromConversationIntentDetection(
         annotated_conversation, options, &response->actions);
@@ -1394,26 +1570,34 @@ bool ActionsSuggestions::GatherActionsSuggestions(
     }
   }
 
-  if (!SuggestActionsFromLua(
-          annotated_conversation, model_executor_.get(), interpreter.get(),
-          annotator != nullptr ? annotator->entity_data_schema() : nullptr,
-          &response->actions)) {
-    TC3_LOG(ERROR) << "Could not suggest actions from script.";
-    return false;
+  {
+    ScopedStage stage(options.stage_timings, "lua", &response->actions);
+    if (!SuggestActionsFromLua(
+            annotated_conversation, model_executor_.get(), interpreter.get(),
+            annotator != nullptr ? annotator->entity_data_schema() : nullptr,
+            &response->actions)) {
+      TC3_LOG(ERROR) << "Could not suggest actions from script.";
+      return false;
+    }
   }
 
-  if (!regex_actions_->SuggestActions(annotated_conversation,
-                                      entity_data_builder_.get(),
-                                      &response->actions)) {
-    TC3_LOG(ERROR) << "Could not suggest actions from regex rules.";
-    return false;
+  {
+    ScopedStage stage(options.stage_timings, "regex", &response->actions);
+    if (!regex_actions_->SuggestActions(annotated_conversation,
+                                        entity_data_builder_.get(),
+                                        &response->actions)) {
+      TC3_LOG(ERROR) << "Could not suggest actions from regex rules.";
+      return false;
+    }
   }
 
-  if (preconditions_.suppress_on_low_confidence_input &&
-      !regex_actions_->FilterConfidenceOutput(post_check_rules,
-                                              &response->actions)) {
-    TC3_LOG(ERROR) << "Could not post-check actions.";
-    return false;
+  if (preconditions_.suppress_on_low_confidence_input) {
+    ScopedStage stage(options.stage_timings, "low_confidence_filter");
+    if (!regex_actions_->FilterConfidenceOutput(post_check_rules,
+                                                &response->actions)) {
+      TC3_LOG(ERROR) << "Could not post-check actions.";
+      return false;
+    }
   }
 
   return true;
@@ -1466,6 +1650,122 @@ ActionsSuggestionsResponse ActionsSuggestions::SuggestActions(
   return SuggestActions(conversation, /*annotator=*/nullptr, options);
 }
 
+std::unique_ptr<ConversationSession>
+ActionsSuggestions::CreateConversationSession() const {
+  return std::unique_ptr<ConversationSession>(new ConversationSession(this));
+}
+
+ActionsSuggestionsResponse ActionsSuggestions::SuggestActionsInSession(
+    ConversationSession* session, const Annotator* annotator,
+    const ActionSuggestionOptions& options) const {
+  ActionsSuggestionsResponse response;
+  if (!GatherActionsSuggestions(session->conversation_, annotator, options,
+                                &response, session)) {
+    TC3_LOG(ERROR) << "Could not gather actions suggestions.";
+    response.actions.clear();
+  } else if (!ranker_->RankActions(session->conversation_, &response,
+                                   entity_data_schema_,
+                                   annotator != nullptr
+                                       ? annotator->entity_data_schema()
+                                       : nullptr)) {
+    TC3_LOG(ERROR) << "Could not rank actions.";
+    response.actions.clear();
+  }
+  return response;
+}
+
+bool ConversationSession::AddMessage(const ConversationMessage& message) {
+  // Same checks as in ActionsSuggestions::SuggestActions().
+  if (!conversation_.messages.empty() &&
+      message.reference_time_ms_utc <
+          conversation_.messages.back().reference_time_ms_utc) {
+    TC3_LOG(ERROR) << "Messages are not sorted most recent last.";
+    return false;
+  }
+  if (message.text.size() > std::numeric_limits<int>::max()) {
+    TC3_LOG(ERROR) << "Rejecting too long input: " << message.text.size();
+    return false;
+  }
+  if (!actions_suggestions_->unilib_->IsValidUtf8(UTF8ToUnicodeText(
+          message.text.data(), message.text.size(), /*do_copy=*/false))) {
+    TC3_LOG(ERROR) << "Not valid utf8 provided.";
+    return false;
+  }
+
+  conversation_.messages.push_back(message);
+  annotated_conversation_.messages.push_back(message);
+  cached_messages_.emplace_back();
+  ReleaseOldMessages();
+  return true;
+}
+
+ActionsSuggestionsResponse ConversationSession::SuggestActions(
+    const Annotator* annotator, const ActionSuggestionOptions& options) {
+  return actions_suggestions_->SuggestActionsInSession(this, annotator,
+                                                       options);
+}
+
+const std::vector<Token>& ConversationSession::GetTokens(int message_index) {
+  CachedMessage* cached_message = &cached_messages_[message_index];
+  if (!cached_message->is_tokenized) {
+    cached_message->tokens =
+        actions_suggestions_->feature_processor_->tokenizer()->Tokenize(
+            conversation_.messages[message_index].text);
+    cached_message->first_embedded_token = cached_message->tokens.size();
+    cached_message->is_tokenized = true;
+  }
+  return cached_message->tokens;
+}
+
+bool ConversationSession::AppendTokenEmbeddings(
+    int message_index, int begin, int end, std::vector<float>* embeddings) {
+  const std::vector<Token>& tokens = GetTokens(message_index);
+  CachedMessage* cached_message = &cached_messages_[message_index];
+  if (begin < cached_message->first_embedded_token) {
+    std::vector<float> token_embeddings;
+    for (int pos = begin; pos < cached_message->first_embedded_token; pos++) {
+      if (!actions_suggestions_->feature_processor_->AppendTokenFeatures(
+              tokens[pos], actions_suggestions_->embedding_executor_.get(),
+              &token_embeddings)) {
+        return false;
+      }
+    }
+    token_embeddings.insert(token_embeddings.end(),
+                            cached_message->token_embeddings.begin(),
+                            cached_message->token_embeddings.end());
+    cached_message->token_embeddings = std::move(token_embeddings);
+    cached_message->first_embedded_token = begin;
+  }
+
+  const int embedding_size = actions_suggestions_->token_embedding_size_;
+  const int offset = begin - cached_message->first_embedded_token;
+  embeddings->insert(
+      embeddings->end(),
+      cached_message->token_embeddings.begin() + offset * embedding_size,
+      cached_message->token_embeddings.begin() +
+          (offset + end - begin) * embedding_size);
+  return true;
+}
+
+void ConversationSession::ReleaseOldMessages() {
+  const int max_conversation_history_length =
+      actions_suggestions_->model_->max_conversation_history_length();
+  if (max_conversation_history_length < 0) {
+    return;
+  }
+  const int first_recent_message =
+      static_cast<int>(cached_messages_.size()) -
+      max_conversation_history_length;
+  for (; first_cached_message_ < first_recent_message;
+       first_cached_message_++) {
+    CachedMessage* cached_message = &cached_messages_[first_cached_message_];
+    cached_message->is_tokenized = false;
+    cached_message->tokens = {};
+    cached_message->first_embedded_token = 0;
+    cached_message->token_embeddings = {};
+  }
+}
+
 const ActionsModel* ActionsSuggestions::model() const { return model_; }
 const reflection::Schema* ActionsSuggestions::entity_data_schema() const {
   return entity_data_schema_;
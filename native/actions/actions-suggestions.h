@@ -17,6 +17,7 @@
 #ifndef LIBTEXTCLASSIFIER_ACTIONS_ACTIONS_SUGGESTIONS_H_
 #define LIBTEXTCLASSIFIER_ACTIONS_ACTIONS_SUGGESTIONS_H_
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -28,6 +29,9 @@
 #include "actions/conversation_intent_detection/conversation-intent-detection.h"
 #include "actions/feature-processor.h"
 #include "actions/grammar-actions.h"
+#if !defined(TC3_DISABLE_LUA)
+#include "actions/lua-actions.h"
+#endif
 #include "actions/ranker.h"
 #include "actions/regex-actions.h"
 #include "actions/sensitive-classifier-base.h"
@@ -35,6 +39,7 @@
 #include "annotator/annotator.h"
 #include "annotator/model-executor.h"
 #include "annotator/types.h"
+#include "utils/container/object-pool.h"
 #include "utils/flatbuffers/flatbuffers.h"
 #include "utils/flatbuffers/mutable.h"
 #include "utils/i18n/locale.h"
@@ -46,6 +51,8 @@
 
 namespace libtextclassifier3 {
 
+class ConversationSession;
+
 // Class for predicting actions following a conversation.
 class ActionsSuggestions {
  public:
@@ -105,6 +112,10 @@ class ActionsSuggestions {
       const Conversation& conversation, const Annotator* annotator,
       const ActionSuggestionOptions& options = ActionSuggestionOptions()) const;
 
+  // Starts an empty conversation to which messages are added one at a time,
+  // see ConversationSession. The session must not outlive this object.
+  std::unique_ptr<ConversationSession> CreateConversationSession() const;
+
   bool InitializeConversationIntentDetection(
       const std::string& serialized_config);
 
@@ -145,6 +156,14 @@ class ActionsSuggestions {
   int token_embedding_size_;
 
  private:
+  friend class ConversationSession;
+
+  // Appends the embeddings of the tokens [begin, end) of the message at the
+  // given index.
+  using MessageTokenEmbedder =
+      std::function<bool(int message_index, int begin, int end,
+                         std::vector<float>* embeddings)>;
+
   // Checks that model contains all required fields, and initializes internal
   // datastructures.
   bool ValidateAndInitialize();
@@ -160,16 +179,35 @@ class ActionsSuggestions {
   std::vector<std::vector<Token>> Tokenize(
       const std::vector<std::string>& context) const;
 
+  // Returns an embedder that runs the feature extractor on the given tokens.
+  MessageTokenEmbedder TokenFeatureEmbedder(
+      const std::vector<std::vector<Token>>& tokens) const;
+
+  // Same as EmbedTokensPerMessage() and EmbedAndFlattenTokens(), but only
+  // need the number of tokens per message, and get the token embeddings from
+  // `embed_tokens`.
+  bool EmbedMessageTokens(const std::vector<int>& num_tokens_per_message,
+                          const MessageTokenEmbedder& embed_tokens,
+                          std::vector<float>* embeddings,
+                          int* max_num_tokens_per_message) const;
+  bool EmbedAndFlattenMessageTokens(
+      const std::vector<int>& num_tokens_per_message,
+      const MessageTokenEmbedder& embed_tokens, std::vector<float>* embeddings,
+      int* total_token_count) const;
+
   bool AllocateInput(const int conversation_length, const int max_tokens,
                      const int total_token_count,
                      tflite::Interpreter* interpreter) const;
 
+  // If a session is given, `context` are its last messages, and their tokens
+  // and token embeddings are taken from the session.
   bool SetupModelInput(const std::vector<std::string>& context,
                        const std::vector<int>& user_ids,
                        const std::vector<float>& time_diffs,
                        const int num_suggestions,
                        const ActionSuggestionOptions& options,
-                       tflite::Interpreter* interpreter) const;
+                       tflite::Interpreter* interpreter,
+                       ConversationSession* session = nullptr) const;
 
   void FillSuggestionFromSpecWithEntityData(const ActionSuggestionSpec* spec,
                                             ActionSuggestion* suggestion) const;
@@ -188,11 +226,17 @@ class ActionsSuggestions {
                        const ActionSuggestionOptions& options,
                        ActionsSuggestionsResponse* response) const;
 
+  // Checks the last `num_messages` messages with the sensitive topic model.
+  bool IsSensitiveConversation(const Conversation& conversation,
+                               const int num_messages,
+                               ConversationSession* session) const;
+
   bool SuggestActionsFromModel(
       const Conversation& conversation, const int num_messages,
       const ActionSuggestionOptions& options,
       ActionsSuggestionsResponse* response,
-      std::unique_ptr<tflite::Interpreter>* interpreter) const;
+      PooledObject<tflite::Interpreter>* interpreter,
+      ConversationSession* session = nullptr) const;
 
   Status SuggestActionsFromConversationIntentDetection(
       const Conversation& conversation, const ActionSuggestionOptions& options,
@@ -210,10 +254,18 @@ class ActionsSuggestions {
       const int message_index, const ActionSuggestionAnnotation& annotation,
       std::vector<ActionSuggestion>* actions) const;
 
+  // Number of most recent messages whose annotations are used.
+  int NumMessagesToAnnotate() const;
+
   // Run annotator on the messages of a conversation.
   Conversation AnnotateConversation(const Conversation& conversation,
                                     const Annotator* annotator) const;
 
+  // Same as AnnotateConversation(), but annotates the messages of the session
+  // in place, and each of them only once.
+  void AnnotateSessionConversation(const Annotator* annotator,
+                                   ConversationSession* session) const;
+
   // Deduplicates equivalent annotations - annotations that have the same type
   // and same span text.
   // Returns the indices of the deduplicated annotations.
@@ -230,13 +282,21 @@ class ActionsSuggestions {
   bool GatherActionsSuggestions(const Conversation& conversation,
                                 const Annotator* annotator,
                                 const ActionSuggestionOptions& options,
-                                ActionsSuggestionsResponse* response) const;
+                                ActionsSuggestionsResponse* response,
+                                ConversationSession* session = nullptr) const;
+
+  ActionsSuggestionsResponse SuggestActionsInSession(
+      ConversationSession* session, const Annotator* annotator,
+      const ActionSuggestionOptions& options) const;
 
   std::unique_ptr<libtextclassifier3::ScopedMmap> mmap_;
 
   // Tensorflow Lite models.
   std::unique_ptr<const TfLiteModelExecutor> model_executor_;
 
+  // Interpreters for the model, shared between requests.
+  std::unique_ptr<ObjectPool<tflite::Interpreter>> interpreter_pool_;
+
   // Regex rules model.
   std::unique_ptr<RegexActions> regex_actions_;
 
@@ -258,6 +318,10 @@ class ActionsSuggestions {
   std::unique_ptr<ActionsSuggestionsRanker> ranker_;
 
   std::string lua_bytecode_;
+#if !defined(TC3_DISABLE_LUA)
+  // Lua states with the actions snippet loaded, shared between requests.
+  std::unique_ptr<ObjectPool<LuaActionsSuggestions>> lua_actions_pool_;
+#endif
 
   // Triggering preconditions. These parameters can be backed by the model and
   // (partially) be provided by flags.
@@ -273,6 +337,78 @@ class ActionsSuggestions {
       conversation_intent_detection_;
 };
 
+// A conversation that grows one message at a time, for clients that suggest
+// actions after every new message. The session caches the per-message work
+// (tokens, token embeddings, annotations and sensitive topic results), so that
+// suggesting actions after a new message only processes the text of that
+// message, instead of the whole conversation again.
+// The suggestions are the same as the ones of ActionsSuggestions for the whole
+// conversation.
+// NOTE: A session is not thread-safe.
+class ConversationSession {
+ public:
+  // Appends a message to the conversation. Returns false, and leaves the
+  // session unchanged, if the message is not valid UTF-8 or older than the
+  // last message.
+  bool AddMessage(const ConversationMessage& message);
+
+  ActionsSuggestionsResponse SuggestActions(
+      const Annotator* annotator = nullptr,
+      const ActionSuggestionOptions& options = ActionSuggestionOptions());
+
+  const Conversation& conversation() const { return conversation_; }
+
+ private:
+  friend class ActionsSuggestions;
+
+  explicit ConversationSession(const ActionsSuggestions* actions_suggestions)
+      : actions_suggestions_(actions_suggestions) {}
+
+  struct CachedMessage {
+    bool is_tokenized = false;
+    std::vector<Token> tokens;
+
+    // Embeddings of the tokens from `first_embedded_token` to the end. Only
+    // the last tokens of long messages are used, so the embeddings are
+    // extended towards the beginning only when needed.
+    int first_embedded_token = 0;
+    std::vector<float> token_embeddings;
+
+    // Whether the annotations of the message were computed by the session.
+    bool is_annotated = false;
+
+    bool has_sensitive_topic_result = false;
+    bool is_sensitive = false;
+  };
+
+  // Returns the tokens of the message, tokenizing it on first use.
+  const std::vector<Token>& GetTokens(int message_index);
+
+  // Appends the embeddings of the tokens [begin, end) of the message,
+  // embedding them on first use.
+  bool AppendTokenEmbeddings(int message_index, int begin, int end,
+                             std::vector<float>* embeddings);
+
+  // Drops the cached tokens and embeddings of the messages that are out of
+  // the model's conversation history.
+  void ReleaseOldMessages();
+
+  const ActionsSuggestions* actions_suggestions_;
+
+  // The messages as given, and with the annotations computed by the session.
+  Conversation conversation_;
+  Conversation annotated_conversation_;
+  std::vector<CachedMessage> cached_messages_;
+
+  // The annotator that computed the annotations, and the first message that
+  // may have annotations computed by the session.
+  const Annotator* annotator_ = nullptr;
+  int first_annotated_message_ = 0;
+
+  // The first message whose tokens and embeddings are still kept.
+  int first_cached_message_ = 0;
+};
+
 // Interprets the buffer as a Model flatbuffer and returns it for reading.
 const ActionsModel* ViewActionsModel(const void* buffer, int size);
 
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "actions/actions-suggestions.h"
+#include "actions/types.h"
+#include "annotator/annotator.h"
+#include "utils/base/logging.h"
+#include "utils/jvm-test-utils.h"
+#include "utils/testing/benchmark-utils.h"
+#include "benchmark/benchmark.h"
+
+namespace libtextclassifier3 {
+namespace {
+
+const ActionsSuggestions& GetActionsSuggestions() {
+  static const ActionsSuggestions* actions_suggestions = []() {
+    std::unique_ptr<ActionsSuggestions> actions_suggestions =
+        ActionsSuggestions::FromPath(
+            GetBenchmarkDataPath("models/actions_suggestions.en.model"),
+            CreateUniLibForTesting(),
+            /*triggering_preconditions_overlay=*/"");
+    TC3_CHECK(actions_suggestions != nullptr);
+    return actions_suggestions.release();
+  }();
+  return *actions_suggestions;
+}
+
+const Annotator& GetAnnotator() {
+  static const Annotator* annotator = []() {
+    std::unique_ptr<Annotator> annotator = Annotator::FromPath(
+        GetBenchmarkDataPath("models/textclassifier.en.model"),
+        CreateUniLibForTesting(), CreateCalendarLibForTesting());
+    TC3_CHECK(annotator != nullptr);
+    return annotator.release();
+  }();
+  return *annotator;
+}
+
+Conversation MakeConversation(const int num_messages) {
+  Conversation conversation;
+  int64 time_ms_utc = 1570000000000;
+  for (const auto& user_text : GenerateChatMessages(num_messages)) {
+    ConversationMessage message;
+    message.user_id = user_text.first;
+    message.text = user_text.second;
+    message.reference_time_ms_utc = time_ms_utc;
+    message.reference_timezone = "Europe/Zurich";
+    message.detected_text_language_tags = "en";
+    conversation.messages.push_back(std::move(message));
+    time_ms_utc += 60 * 1000;
+  }
+  return conversation;
+}
+
+// Arguments: number of messages in the conversation.
+void BM_SuggestActions(benchmark::State& state) {
+  const ActionsSuggestions& actions_suggestions = GetActionsSuggestions();
+  const Conversation conversation = MakeConversation(state.range(0));
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(actions_suggestions.SuggestActions(conversation));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SuggestActions)->DenseRange(1, 9, /*step=*/4)->Arg(20);
+BENCHMARK(BM_SuggestActions)->Arg(5)->Apply(ReportLatencyPercentiles);
+
+// Same as above, with the messages annotated by the annotator.
+void BM_SuggestActionsWithAnnotator(benchmark::State& state) {
+  const ActionsSuggestions& actions_suggestions = GetActionsSuggestions();
+  const Annotator& annotator = GetAnnotator();
+  const Conversation conversation = MakeConversation(state.range(0));
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        actions_suggestions.SuggestActions(conversation, &annotator));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SuggestActionsWithAnnotator)->DenseRange(1, 9, /*step=*/4);
+BENCHMARK(BM_SuggestActionsWithAnnotator)
+    ->Arg(5)
+    ->Apply(ReportLatencyPercentiles);
+
+}  // namespace
+}  // namespace libtextclassifier3
@@ -808,6 +808,57 @@ TEST_F(ActionsSuggestionsTest, SuggestsActionsWithLongerConversation) {
   EXPECT_EQ(response.actions[0].score, 1.0);
 }
 
+TEST_F(ActionsSuggestionsTest, ConversationSessionMatchesSuggestActions) {
+  std::unique_ptr<ActionsSuggestions> actions_suggestions =
+      LoadTestModel(kModelFileName);
+  std::unique_ptr<ConversationSession> session =
+      actions_suggestions->CreateConversationSession();
+
+  const std::vector<ConversationMessage> messages = {
+      {/*user_id=*/ActionsSuggestions::kLocalUserId, "hi, how are you?",
+       /*reference_time_ms_utc=*/10000,
+       /*reference_timezone=*/"Europe/Zurich",
+       /*annotations=*/{}, /*locales=*/"en"},
+      {/*user_id=*/1, "good! are you at home?",
+       /*reference_time_ms_utc=*/15000,
+       /*reference_timezone=*/"Europe/Zurich",
+       /*annotations=*/{}, /*locales=*/"en"},
+      {/*user_id=*/1, "Where are you?",
+       /*reference_time_ms_utc=*/20000,
+       /*reference_timezone=*/"Europe/Zurich",
+       /*annotations=*/{}, /*locales=*/"en"}};
+  Conversation conversation;
+  for (const ConversationMessage& message : messages) {
+    ASSERT_TRUE(session->AddMessage(message));
+    conversation.messages.push_back(message);
+
+    const ActionsSuggestionsResponse expected_response =
+        actions_suggestions->SuggestActions(conversation);
+    const ActionsSuggestionsResponse response = session->SuggestActions();
+    EXPECT_EQ(response.is_sensitive, expected_response.is_sensitive);
+    ASSERT_EQ(response.actions.size(), expected_response.actions.size());
+    for (int i = 0; i < response.actions.size(); i++) {
+      EXPECT_EQ(response.actions[i].type, expected_response.actions[i].type);
+      EXPECT_EQ(response.actions[i].response_text,
+                expected_response.actions[i].response_text);
+      EXPECT_THAT(response.actions[i].score,
+                  FloatEq(expected_response.actions[i].score));
+    }
+  }
+
+  // Messages older than the last one and invalid UTF-8 are rejected.
+  EXPECT_FALSE(session->AddMessage(
+      {/*user_id=*/1, "Where are you?", /*reference_time_ms_utc=*/0,
+       /*reference_timezone=*/"Europe/Zurich",
+       /*annotations=*/{}, /*locales=*/"en"}));
+  EXPECT_FALSE(session->AddMessage(
+      {/*user_id=*/1, "Where are you?\xf0\x9f",
+       /*reference_time_ms_utc=*/30000,
+       /*reference_timezone=*/"Europe/Zurich",
+       /*annotations=*/{}, /*locales=*/"en"}));
+  EXPECT_THAT(session->conversation().messages, SizeIs(3));
+}
+
 TEST_F(ActionsSuggestionsTest, SuggestsActionsFromTF2MultiTaskModel) {
   std::unique_ptr<ActionsSuggestions> actions_suggestions =
       LoadTestModel(kMultiTaskTF2TestModelFileName);
@@ -21,6 +21,7 @@
 #include "annotator/types.h"
 #include "utils/base/arena.h"
 #include "utils/base/statusor.h"
+#include "utils/memory/arena-pool.h"
 #include "utils/utf8/unicodetext.h"
 
 namespace libtextclassifier3 {
@@ -34,7 +35,8 @@ GrammarActions::GrammarActions(
       tokenizer_(CreateTokenizer(grammar_rules->tokenizer_options(), unilib)),
       entity_data_builder_(entity_data_builder),
       analyzer_(unilib, grammar_rules->rules(), tokenizer_.get()),
-      smart_reply_action_type_(smart_reply_action_type) {}
+      smart_reply_action_type_(smart_reply_action_type),
+      arena_pool_(new ArenaPool(/*block_size=*/16 << 10)) {}
 
 bool GrammarActions::InstantiateActionsFromMatch(
     const grammar::TextContext& text_context, const int message_index,
@@ -147,9 +149,9 @@ bool GrammarActions::SuggestActions(
       locales);
   text.annotations = conversation.messages.back().annotations;
 
-  UnsafeArena arena(/*block_size=*/16 << 10);
+  ArenaPool::ScopedArena arena(arena_pool_.get());
   StatusOr<std::vector<grammar::EvaluatedDerivation>> evaluated_derivations =
-      analyzer_.Parse(text, &arena);
+      analyzer_.Parse(text, arena.get());
   // TODO(b/171294882): Return the status here and below.
   if (!evaluated_derivations.ok()) {
     TC3_LOG(ERROR) << "Could not run grammar analyzer: "
@@ -27,6 +27,7 @@
 #include "utils/grammar/evaluated-derivation.h"
 #include "utils/grammar/text-context.h"
 #include "utils/i18n/locale.h"
+#include "utils/memory/arena-pool.h"
 #include "utils/tokenizer.h"
 #include "utils/utf8/unilib.h"
 
@@ -57,6 +58,9 @@ class GrammarActions {
   const MutableFlatbufferBuilder* entity_data_builder_;
   const grammar::Analyzer analyzer_;
   const std::string smart_reply_action_type_;
+
+  // Arenas for the parses, reused between calls.
+  const std::unique_ptr<ArenaPool> arena_pool_;
 };
 
 }  // namespace libtextclassifier3
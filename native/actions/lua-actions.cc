@@ -59,11 +59,26 @@ LuaActionsSuggestions::CreateLuaActionsSuggestions(
     const tflite::Interpreter* interpreter,
     const reflection::Schema* actions_entity_data_schema,
     const reflection::Schema* annotations_entity_data_schema) {
+  std::unique_ptr<LuaActionsSuggestions> lua_actions =
+      CreateLuaActionsSuggestions(snippet);
+  if (lua_actions == nullptr) {
+    return nullptr;
+  }
+  lua_actions->conversation_ = &conversation;
+  lua_actions->model_executor_ = model_executor;
+  lua_actions->model_spec_ = model_spec;
+  lua_actions->interpreter_ = interpreter;
+  lua_actions->actions_entity_data_schema_ = actions_entity_data_schema;
+  lua_actions->annotations_entity_data_schema_ =
+      annotations_entity_data_schema;
+  return lua_actions;
+}
+
+std::unique_ptr<LuaActionsSuggestions>
+LuaActionsSuggestions::CreateLuaActionsSuggestions(const std::string& snippet) {
   auto lua_actions =
-      std::unique_ptr<LuaActionsSuggestions>(new LuaActionsSuggestions(
-          snippet, conversation, model_executor, model_spec, interpreter,
-          actions_entity_data_schema, annotations_entity_data_schema));
-  if (!lua_actions->Initialize()) {
+      std::unique_ptr<LuaActionsSuggestions>(new LuaActionsSuggestions());
+  if (!lua_actions->Initialize(snippet)) {
     TC3_LOG(ERROR)
         << "Could not initialize lua environment for actions suggestions.";
     return nullptr;
@@ -71,98 +86,119 @@ LuaActionsSuggestions::CreateLuaActionsSuggestions(
   return lua_actions;
 }
 
-LuaActionsSuggestions::LuaActionsSuggestions(
-    const std::string& snippet, const Conversation& conversation,
-    const TfLiteModelExecutor* model_executor,
-    const TensorflowLiteModelSpec* model_spec,
-    const tflite::Interpreter* interpreter,
-    const reflection::Schema* actions_entity_data_schema,
-    const reflection::Schema* annotations_entity_data_schema)
-    : snippet_(snippet),
-      conversation_(conversation),
-      actions_scores_(
-          model_spec == nullptr
-              ? TensorView<float>::Invalid()
-              : GetTensorViewForOutput(model_executor, interpreter,
-                                       model_spec->output_actions_scores())),
-      smart_reply_scores_(
-          model_spec == nullptr
-              ? TensorView<float>::Invalid()
-              : GetTensorViewForOutput(model_executor, interpreter,
-                                       model_spec->output_replies_scores())),
-      sensitivity_score_(model_spec == nullptr
-                             ? TensorView<float>::Invalid()
-                             : GetTensorViewForOutput(
-                                   model_executor, interpreter,
-                                   model_spec->output_sensitive_topic_score())),
-      triggering_score_(
-          model_spec == nullptr
-              ? TensorView<float>::Invalid()
-              : GetTensorViewForOutput(model_executor, interpreter,
-                                       model_spec->output_triggering_score())),
-      smart_replies_(model_spec == nullptr ? std::vector<std::string>{}
-                                           : GetStringTensorForOutput(
-                                                 model_executor, interpreter,
-                                                 model_spec->output_replies())),
-      actions_entity_data_schema_(actions_entity_data_schema),
-      annotations_entity_data_schema_(annotations_entity_data_schema) {}
-
-bool LuaActionsSuggestions::Initialize() {
-  return RunProtected([this] {
-           LoadDefaultLibraries();
-
-           // Expose conversation message stream.
-           PushConversation(&conversation_.messages,
-                            annotations_entity_data_schema_);
-           lua_setglobal(state_, "messages");
-
-           // Expose ML model output.
-           lua_newtable(state_);
-
-           PushTensor(&actions_scores_);
-           lua_setfield(state_, /*idx=*/-2, "actions_scores");
-
-           PushTensor(&smart_reply_scores_);
-           lua_setfield(state_, /*idx=*/-2, "reply_scores");
-
-           PushTensor(&sensitivity_score_);
-           lua_setfield(state_, /*idx=*/-2, "sensitivity");
-
-           PushTensor(&triggering_score_);
-           lua_setfield(state_, /*idx=*/-2, "triggering_score");
-
-           PushVectorIterator(&smart_replies_);
-           lua_setfield(state_, /*idx=*/-2, "reply");
-
-           lua_setglobal(state_, "model");
-
-           return LUA_OK;
-         }) == LUA_OK;
+bool LuaActionsSuggestions::Initialize(const std::string& snippet) {
+  if (RunProtected([this] {
+        LoadDefaultLibraries();
+        return LUA_OK;
+      }) != LUA_OK) {
+    return false;
+  }
+  snippet_ = LoadSnippet(snippet);
+  return snippet_ != LUA_NOREF;
 }
 
 bool LuaActionsSuggestions::SuggestActions(
     std::vector<ActionSuggestion>* actions) {
-  if (luaL_loadbuffer(state_, snippet_.data(), snippet_.size(),
-                      /*name=*/nullptr) != LUA_OK) {
-    TC3_LOG(ERROR) << "Could not load actions suggestions snippet.";
+  if (conversation_ == nullptr) {
+    TC3_LOG(ERROR) << "Actions suggestions were not created for a request.";
     return false;
   }
+  return SuggestActions(*conversation_, model_executor_, model_spec_,
+                        interpreter_, actions_entity_data_schema_,
+                        annotations_entity_data_schema_, actions);
+}
 
-  if (lua_pcall(state_, /*nargs=*/0, /*nargs=*/1, /*errfunc=*/0) != LUA_OK) {
-    TC3_LOG(ERROR) << "Could not run actions suggestions snippet.";
-    return false;
-  }
+bool LuaActionsSuggestions::SuggestActions(
+    const Conversation& conversation, const TfLiteModelExecutor* model_executor,
+    const TensorflowLiteModelSpec* model_spec,
+    const tflite::Interpreter* interpreter,
+    const reflection::Schema* actions_entity_data_schema,
+    const reflection::Schema* annotations_entity_data_schema,
+    std::vector<ActionSuggestion>* actions) {
+  // The model outputs need to stay alive until the snippet has run.
+  const TensorView<float> actions_scores =
+      model_spec == nullptr
+          ? TensorView<float>::Invalid()
+          : GetTensorViewForOutput(model_executor, interpreter,
+                                   model_spec->output_actions_scores());
+  const TensorView<float> smart_reply_scores =
+      model_spec == nullptr
+          ? TensorView<float>::Invalid()
+          : GetTensorViewForOutput(model_executor, interpreter,
+                                   model_spec->output_replies_scores());
+  const TensorView<float> sensitivity_score =
+      model_spec == nullptr
+          ? TensorView<float>::Invalid()
+          : GetTensorViewForOutput(model_executor, interpreter,
+                                   model_spec->output_sensitive_topic_score());
+  const TensorView<float> triggering_score =
+      model_spec == nullptr
+          ? TensorView<float>::Invalid()
+          : GetTensorViewForOutput(model_executor, interpreter,
+                                   model_spec->output_triggering_score());
+  const std::vector<std::string> smart_replies =
+      model_spec == nullptr
+          ? std::vector<std::string>{}
+          : GetStringTensorForOutput(model_executor, interpreter,
+                                     model_spec->output_replies());
+
+  // Drop anything a previous failed run might have left on the stack.
+  lua_settop(state_, 0);
 
   if (RunProtected(
-          [this, actions] {
-            return ReadActions(actions_entity_data_schema_,
-                               annotations_entity_data_schema_, actions);
+          [&] {
+            PushSnippetWithFreshEnvironment(snippet_);
+
+            // Expose conversation message stream.
+            PushConversation(&conversation.messages,
+                             annotations_entity_data_schema);
+            lua_setfield(state_, /*idx=*/-2, "messages");
+
+            // Expose ML model output.
+            lua_newtable(state_);
+
+            PushTensor(&actions_scores);
+            lua_setfield(state_, /*idx=*/-2, "actions_scores");
+
+            PushTensor(&smart_reply_scores);
+            lua_setfield(state_, /*idx=*/-2, "reply_scores");
+
+            PushTensor(&sensitivity_score);
+            lua_setfield(state_, /*idx=*/-2, "sensitivity");
+
+            PushTensor(&triggering_score);
+            lua_setfield(state_, /*idx=*/-2, "triggering_score");
+
+            PushVectorIterator(&smart_replies);
+            lua_setfield(state_, /*idx=*/-2, "reply");
+
+            lua_setfield(state_, /*idx=*/-2, "model");
+
+            lua_pop(state_, 1);  // Pop environment.
+            return 1;            // The snippet.
           },
-          /*num_args=*/1) != LUA_OK) {
-    TC3_LOG(ERROR) << "Could not read lua result.";
+          /*num_args=*/0, /*num_results=*/1) != LUA_OK) {
+    TC3_LOG(ERROR) << "Could not set up actions suggestions snippet.";
     return false;
   }
-  return true;
+
+  bool success = true;
+  if (lua_pcall(state_, /*nargs=*/0, /*nargs=*/1, /*errfunc=*/0) != LUA_OK) {
+    TC3_LOG(ERROR) << "Could not run actions suggestions snippet.";
+    success = false;
+  } else if (RunProtected(
+                 [this, actions_entity_data_schema,
+                  annotations_entity_data_schema, actions] {
+                   return ReadActions(actions_entity_data_schema,
+                                      annotations_entity_data_schema, actions);
+                 },
+                 /*num_args=*/1) != LUA_OK) {
+    TC3_LOG(ERROR) << "Could not read lua result.";
+    success = false;
+  }
+
+  ResetSnippetEnvironment(snippet_);
+  return success;
 }
 
 }  // namespace libtextclassifier3
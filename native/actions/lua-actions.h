@@ -28,6 +28,7 @@ namespace libtextclassifier3 {
 // Lua backed actions suggestions.
 class LuaActionsSuggestions : public LuaEnvironment {
  public:
+  // Creates the actions suggestions for a single request.
   static std::unique_ptr<LuaActionsSuggestions> CreateLuaActionsSuggestions(
       const std::string& snippet, const Conversation& conversation,
       const TfLiteModelExecutor* model_executor,
@@ -36,18 +37,29 @@ class LuaActionsSuggestions : public LuaEnvironment {
       const reflection::Schema* actions_entity_data_schema,
       const reflection::Schema* annotations_entity_data_schema);
 
+  // Creates actions suggestions that are not bound to a request. The default
+  // libraries and the snippet are loaded once, the instance can then suggest
+  // actions for many requests, one at a time.
+  static std::unique_ptr<LuaActionsSuggestions> CreateLuaActionsSuggestions(
+      const std::string& snippet);
+
+  // Suggests actions for the request the instance was created for.
   bool SuggestActions(std::vector<ActionSuggestion>* actions);
 
+  // Suggests actions for a request. Every call runs the snippet with a fresh
+  // global environment, so no state is carried over between requests.
+  bool SuggestActions(const Conversation& conversation,
+                      const TfLiteModelExecutor* model_executor,
+                      const TensorflowLiteModelSpec* model_spec,
+                      const tflite::Interpreter* interpreter,
+                      const reflection::Schema* actions_entity_data_schema,
+                      const reflection::Schema* annotations_entity_data_schema,
+                      std::vector<ActionSuggestion>* actions);
+
  private:
-  LuaActionsSuggestions(
-      const std::string& snippet, const Conversation& conversation,
-      const TfLiteModelExecutor* model_executor,
-      const TensorflowLiteModelSpec* model_spec,
-      const tflite::Interpreter* interpreter,
-      const reflection::Schema* actions_entity_data_schema,
-      const reflection::Schema* annotations_entity_data_schema);
+  LuaActionsSuggestions() {}
 
-  bool Initialize();
+  bool Initialize(const std::string& snippet);
 
   template <typename T>
   void PushTensor(const TensorView<T>* tensor) const {
@@ -58,15 +70,16 @@ class LuaActionsSuggestions : public LuaEnvironment {
                  });
   }
 
-  const std::string& snippet_;
-  const Conversation& conversation_;
-  TensorView<float> actions_scores_;
-  TensorView<float> smart_reply_scores_;
-  TensorView<float> sensitivity_score_;
-  TensorView<float> triggering_score_;
-  const std::vector<std::string> smart_replies_;
-  const reflection::Schema* actions_entity_data_schema_;
-  const reflection::Schema* annotations_entity_data_schema_;
+  // Registry reference of the loaded snippet.
+  int snippet_ = LUA_NOREF;
+
+  // The request the instance was created for, if any.
+  const Conversation* conversation_ = nullptr;
+  const TfLiteModelExecutor* model_executor_ = nullptr;
+  const TensorflowLiteModelSpec* model_spec_ = nullptr;
+  const tflite::Interpreter* interpreter_ = nullptr;
+  const reflection::Schema* actions_entity_data_schema_ = nullptr;
+  const reflection::Schema* annotations_entity_data_schema_ = nullptr;
 };
 
 }  // namespace libtextclassifier3
@@ -36,35 +36,41 @@ ActionsSuggestionsLuaRanker::Create(
     const reflection::Schema* entity_data_schema,
     const reflection::Schema* annotations_entity_data_schema,
     ActionsSuggestionsResponse* response) {
+  std::unique_ptr<ActionsSuggestionsLuaRanker> ranker = Create(ranker_code);
+  if (ranker == nullptr) {
+    return nullptr;
+  }
+  ranker->conversation_ = &conversation;
+  ranker->actions_entity_data_schema_ = entity_data_schema;
+  ranker->annotations_entity_data_schema_ = annotations_entity_data_schema;
+  ranker->response_ = response;
+  return ranker;
+}
+
+std::unique_ptr<ActionsSuggestionsLuaRanker>
+ActionsSuggestionsLuaRanker::Create(const std::string& ranker_code) {
   auto ranker = std::unique_ptr<ActionsSuggestionsLuaRanker>(
-      new ActionsSuggestionsLuaRanker(
-          conversation, ranker_code, entity_data_schema,
-          annotations_entity_data_schema, response));
-  if (!ranker->Initialize()) {
+      new ActionsSuggestionsLuaRanker());
+  if (!ranker->Initialize(ranker_code)) {
     TC3_LOG(ERROR) << "Could not initialize lua environment for ranker.";
     return nullptr;
   }
   return ranker;
 }
 
-bool ActionsSuggestionsLuaRanker::Initialize() {
-  return RunProtected([this] {
-           LoadDefaultLibraries();
-
-           // Expose generated actions.
-           PushActions(&response_->actions, actions_entity_data_schema_,
-                       annotations_entity_data_schema_);
-           lua_setglobal(state_, "actions");
-
-           // Expose conversation message stream.
-           PushConversation(&conversation_.messages,
-                            annotations_entity_data_schema_);
-           lua_setglobal(state_, "messages");
-           return LUA_OK;
-         }) == LUA_OK;
+bool ActionsSuggestionsLuaRanker::Initialize(const std::string& ranker_code) {
+  if (RunProtected([this] {
+        LoadDefaultLibraries();
+        return LUA_OK;
+      }) != LUA_OK) {
+    return false;
+  }
+  ranker_ = LoadSnippet(ranker_code);
+  return ranker_ != LUA_NOREF;
 }
 
-int ActionsSuggestionsLuaRanker::ReadActionsRanking() {
+int ActionsSuggestionsLuaRanker::ReadActionsRanking(
+    ActionsSuggestionsResponse* response) {
   if (lua_type(state_, /*idx=*/-1) != LUA_TTABLE) {
     TC3_LOG(ERROR) << "Expected actions table, got: "
                    << lua_type(state_, /*idx=*/-1);
@@ -77,41 +83,73 @@ int ActionsSuggestionsLuaRanker::ReadActionsRanking() {
   while (Next(/*index=*/-2)) {
     const int action_id = Read<int>(/*index=*/-1) - 1;
     lua_pop(state_, 1);
-    if (action_id < 0 || action_id >= response_->actions.size()) {
+    if (action_id < 0 || action_id >= response->actions.size()) {
       TC3_LOG(ERROR) << "Invalid action index: " << action_id;
       lua_error(state_);
       return LUA_ERRRUN;
     }
-    ranked_actions.push_back(response_->actions[action_id]);
+    ranked_actions.push_back(response->actions[action_id]);
   }
   lua_pop(state_, 1);
-  response_->actions = ranked_actions;
+  response->actions = ranked_actions;
   return LUA_OK;
 }
 
 bool ActionsSuggestionsLuaRanker::RankActions() {
-  if (response_->actions.empty()) {
+  if (conversation_ == nullptr || response_ == nullptr) {
+    TC3_LOG(ERROR) << "Ranker was not created for a request.";
+    return false;
+  }
+  return RankActions(*conversation_, actions_entity_data_schema_,
+                     annotations_entity_data_schema_, response_);
+}
+
+bool ActionsSuggestionsLuaRanker::RankActions(
+    const Conversation& conversation,
+    const reflection::Schema* actions_entity_data_schema,
+    const reflection::Schema* annotations_entity_data_schema,
+    ActionsSuggestionsResponse* response) {
+  if (response->actions.empty()) {
     // Nothing to do.
     return true;
   }
 
-  if (luaL_loadbuffer(state_, ranker_code_.data(), ranker_code_.size(),
-                      /*name=*/nullptr) != LUA_OK) {
-    TC3_LOG(ERROR) << "Could not load compiled ranking snippet.";
+  // Drop anything a previous failed run might have left on the stack.
+  lua_settop(state_, 0);
+
+  // Set up the snippet with the generated actions and the conversation
+  // message stream exposed in its environment.
+  if (RunProtected(
+          [this, &conversation, actions_entity_data_schema,
+           annotations_entity_data_schema, response] {
+            PushSnippetWithFreshEnvironment(ranker_);
+            PushActions(&response->actions, actions_entity_data_schema,
+                        annotations_entity_data_schema);
+            lua_setfield(state_, /*idx=*/-2, "actions");
+            PushConversation(&conversation.messages,
+                             annotations_entity_data_schema);
+            lua_setfield(state_, /*idx=*/-2, "messages");
+            lua_pop(state_, 1);  // Pop environment.
+            return 1;            // The snippet.
+          },
+          /*num_args=*/0, /*num_results=*/1) != LUA_OK) {
+    TC3_LOG(ERROR) << "Could not set up ranking snippet.";
     return false;
   }
 
+  bool success = true;
   if (lua_pcall(state_, /*nargs=*/0, /*nresults=*/1, /*errfunc=*/0) != LUA_OK) {
     TC3_LOG(ERROR) << "Could not run ranking snippet.";
-    return false;
-  }
-
-  if (RunProtected([this] { return ReadActionsRanking(); }, /*num_args=*/1) !=
-      LUA_OK) {
+    success = false;
+  } else if (RunProtected(
+                 [this, response] { return ReadActionsRanking(response); },
+                 /*num_args=*/1) != LUA_OK) {
     TC3_LOG(ERROR) << "Could not read lua result.";
-    return false;
+    success = false;
   }
-  return true;
+
+  ResetSnippetEnvironment(ranker_);
+  return success;
 }
 
 }  // namespace libtextclassifier3
@@ -28,36 +28,45 @@ namespace libtextclassifier3 {
 // Lua backed action suggestion ranking.
 class ActionsSuggestionsLuaRanker : public LuaEnvironment {
  public:
+  // Creates a ranker for a single request.
   static std::unique_ptr<ActionsSuggestionsLuaRanker> Create(
       const Conversation& conversation, const std::string& ranker_code,
       const reflection::Schema* entity_data_schema,
       const reflection::Schema* annotations_entity_data_schema,
       ActionsSuggestionsResponse* response);
 
+  // Creates a ranker that is not bound to a request. The default libraries and
+  // the ranking snippet are loaded once, the ranker can then rank the actions
+  // of many requests, one at a time.
+  static std::unique_ptr<ActionsSuggestionsLuaRanker> Create(
+      const std::string& ranker_code);
+
+  // Ranks the actions of the request the ranker was created for.
   bool RankActions();
 
+  // Ranks the actions of a request. Every call runs the snippet with a fresh
+  // global environment, so no state is carried over between requests.
+  bool RankActions(const Conversation& conversation,
+                   const reflection::Schema* actions_entity_data_schema,
+                   const reflection::Schema* annotations_entity_data_schema,
+                   ActionsSuggestionsResponse* response);
+
  private:
-  explicit ActionsSuggestionsLuaRanker(
-      const Conversation& conversation, const std::string& ranker_code,
-      const reflection::Schema* actions_entity_data_schema,
-      const reflection::Schema* annotations_entity_data_schema,
-      ActionsSuggestionsResponse* response)
-      : conversation_(conversation),
-        ranker_code_(ranker_code),
-        actions_entity_data_schema_(actions_entity_data_schema),
-        annotations_entity_data_schema_(annotations_entity_data_schema),
-        response_(response) {}
+  ActionsSuggestionsLuaRanker() {}
 
-  bool Initialize();
+  bool Initialize(const std::string& ranker_code);
 
   // Reads ranking results from the lua stack.
-  int ReadActionsRanking();
+  int ReadActionsRanking(ActionsSuggestionsResponse* response);
+
+  // Registry reference of the loaded ranking snippet.
+  int ranker_ = LUA_NOREF;
 
-  const Conversation& conversation_;
-  const std::string& ranker_code_;
-  const reflection::Schema* actions_entity_data_schema_;
-  const reflection::Schema* annotations_entity_data_schema_;
-  ActionsSuggestionsResponse* response_;
+  // The request the ranker was created for, if any.
+  const Conversation* conversation_ = nullptr;
+  const reflection::Schema* actions_entity_data_schema_ = nullptr;
+  const reflection::Schema* annotations_entity_data_schema_ = nullptr;
+  ActionsSuggestionsResponse* response_ = nullptr;
 };
 
 }  // namespace libtextclassifier3
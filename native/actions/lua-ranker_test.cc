@@ -16,6 +16,7 @@
 
 #include "actions/lua-ranker.h"
 
+#include <memory>
 #include <string>
 
 #include "actions/types.h"
@@ -265,5 +266,73 @@ TEST(LuaRankingTest, HandlesEntityData) {
               testing::ElementsAreArray({IsActionType("test")}));
 }
 
+TEST(LuaRankingTest, ReusesRankerAcrossRequests) {
+  const std::string test_snippet = R"(
+    -- Globals set by a request must not be visible to the next one.
+    if seen_request ~= nil then
+      return {}
+    end
+    seen_request = true
+    local result = {}
+    for i, action in pairs(actions) do
+      if action.type == messages[#messages].text then
+        table.insert(result, i)
+      end
+    end
+    return result
+  )";
+  std::unique_ptr<ActionsSuggestionsLuaRanker> ranker =
+      ActionsSuggestionsLuaRanker::Create(test_snippet);
+  ASSERT_TRUE(ranker != nullptr);
+
+  for (const std::string& type : {"share_location", "add_to_collection"}) {
+    const Conversation conversation = {{{/*user_id=*/1, type}}};
+    ActionsSuggestionsResponse response;
+    response.actions = {
+        {/*response_text=*/"", /*type=*/"share_location", /*score=*/0.5},
+        {/*response_text=*/"", /*type=*/"add_to_collection", /*score=*/0.1}};
+
+    EXPECT_TRUE(ranker->RankActions(
+        conversation, /*actions_entity_data_schema=*/nullptr,
+        /*annotations_entity_data_schema=*/nullptr, &response));
+    EXPECT_THAT(response.actions,
+                testing::ElementsAreArray({IsActionType(type)}));
+  }
+}
+
+TEST(LuaRankingTest, RestoresSharedGlobalsAcrossRequests) {
+  const std::string test_snippet = R"(
+    -- Writes to the shared globals must not be visible to the next request.
+    if _G.leak ~= nil or rawget(_G, "raw_leak") ~= nil or
+       string.leak ~= nil then
+      return {}
+    end
+    _G.leak = true
+    rawset(_G, "raw_leak", true)
+    string.leak = true
+    local result = {}
+    for i, action in pairs(actions) do
+      table.insert(result, i)
+    end
+    return result
+  )";
+  std::unique_ptr<ActionsSuggestionsLuaRanker> ranker =
+      ActionsSuggestionsLuaRanker::Create(test_snippet);
+  ASSERT_TRUE(ranker != nullptr);
+
+  for (int request = 0; request < 2; request++) {
+    const Conversation conversation = {{{/*user_id=*/1, "hello"}}};
+    ActionsSuggestionsResponse response;
+    response.actions = {
+        {/*response_text=*/"", /*type=*/"share_location", /*score=*/0.5}};
+
+    EXPECT_TRUE(ranker->RankActions(
+        conversation, /*actions_entity_data_schema=*/nullptr,
+        /*annotations_entity_data_schema=*/nullptr, &response));
+    EXPECT_THAT(response.actions,
+                testing::ElementsAreArray({IsActionType("share_location")}));
+  }
+}
+
 }  // namespace
 }  // namespace libtextclassifier3
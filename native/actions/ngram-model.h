@@ -44,6 +44,8 @@ class NGramSensitiveModel : public SensitiveTopicModelBase {
   std::pair<bool, float> EvalConversation(const Conversation& conversation,
                                           int num_messages) const override;
 
+  bool EvaluatesMessagesIndependently() const override { return true; }
+
   // Exposed for testing only.
   static uint64 GetNumSkipGrams(int num_tokens, int max_ngram_length,
                                 int max_skips);
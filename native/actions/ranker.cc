@@ -17,6 +17,7 @@
 #include "actions/ranker.h"
 
 #include <functional>
+#include <memory>
 #include <set>
 #include <vector>
 
@@ -229,6 +230,13 @@ bool ActionsSuggestionsRanker::InitializeAndValidate(
       TC3_LOG(ERROR) << "Could not precompile lua ranking snippet.";
       return false;
     }
+    lua_ranker_pool_ =
+        std::make_unique<ObjectPool<ActionsSuggestionsLuaRanker>>(
+            ObjectPool<ActionsSuggestionsLuaRanker>::kDefaultMaxIdle,
+            [this]() {
+              return ActionsSuggestionsLuaRanker::Create(lua_bytecode_);
+            });
+    lua_ranker_pool_->Warmup(1);
   }
 #endif
 
@@ -345,10 +353,11 @@ bool ActionsSuggestionsRanker::RankActions(
 #if !defined(TC3_DISABLE_LUA)
   // Run lua ranking snippet, if provided.
   if (!lua_bytecode_.empty()) {
-    auto lua_ranker = ActionsSuggestionsLuaRanker::Create(
-        conversation, lua_bytecode_, entity_data_schema,
-        annotations_entity_data_schema, response);
-    if (lua_ranker == nullptr || !lua_ranker->RankActions()) {
+    PooledObject<ActionsSuggestionsLuaRanker> lua_ranker(
+        lua_ranker_pool_.get());
+    if (!lua_ranker ||
+        !lua_ranker->RankActions(conversation, entity_data_schema,
+                                 annotations_entity_data_schema, response)) {
       TC3_LOG(ERROR) << "Could not run lua ranking snippet.";
       return false;
     }
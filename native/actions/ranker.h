@@ -20,7 +20,11 @@
 #include <memory>
 
 #include "actions/actions_model_generated.h"
+#if !defined(TC3_DISABLE_LUA)
+#include "actions/lua-ranker.h"
+#endif
 #include "actions/types.h"
+#include "utils/container/object-pool.h"
 #include "utils/zlib/zlib.h"
 #include "flatbuffers/reflection.h"
 
@@ -50,6 +54,11 @@ class ActionsSuggestionsRanker {
   const RankingOptions* const options_;
   std::string lua_bytecode_;
   std::string smart_reply_action_type_;
+
+#if !defined(TC3_DISABLE_LUA)
+  // Lua states with the ranking snippet loaded, shared between requests.
+  std::unique_ptr<ObjectPool<ActionsSuggestionsLuaRanker>> lua_ranker_pool_;
+#endif
 };
 
 }  // namespace libtextclassifier3
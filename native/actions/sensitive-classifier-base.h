@@ -32,6 +32,10 @@ class SensitiveTopicModelBase {
   virtual std::pair<bool, float> EvalConversation(
       const Conversation& conversation, int num_messages) const = 0;
 
+  // Whether EvalConversation() is positive exactly when Eval() is positive for
+  // any of the messages, so that the results can be cached per message.
+  virtual bool EvaluatesMessagesIndependently() const { return false; }
+
   virtual ~SensitiveTopicModelBase() {}
 };
 }  // namespace libtextclassifier3
@@ -20,6 +20,7 @@
 
 #include "actions/actions_model_generated.h"
 #include "actions/types.h"
+#include "utils/stage-timings.h"
 
 namespace libtextclassifier3 {
 namespace {
@@ -96,6 +97,7 @@ std::pair<bool, float> TFLiteSensitiveModel::EvalConversation(
         interpreter.get());
   }
 
+  ScopedStage::CountModelInvocation();
   if (interpreter->Invoke() != kTfLiteOk) {
     // TODO(mgubin): Report a error about invoke.
     return std::make_pair(false, 0.0f);
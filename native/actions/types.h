@@ -25,6 +25,7 @@
 #include "actions/actions-entity-data_generated.h"
 #include "annotator/types.h"
 #include "utils/flatbuffers/flatbuffers.h"
+#include "utils/stage-timings.h"
 
 namespace libtextclassifier3 {
 
@@ -96,6 +97,10 @@ struct ActionSuggestion {
 struct ActionSuggestionOptions {
   static ActionSuggestionOptions Default() { return ActionSuggestionOptions(); }
   std::unordered_map<std::string, Variant> model_parameters;
+
+  // If not null, the stages of the call are recorded into it. Only takes
+  // effect if the library is built with TC3_STAGE_TIMINGS defined.
+  StageTimings* stage_timings = nullptr;
 };
 
 // Actions suggestions result containing meta - information and the suggested
@@ -19,6 +19,7 @@
 #include <algorithm>
 #include <cmath>
 #include <cstddef>
+#include <functional>
 #include <iterator>
 #include <limits>
 #include <numeric>
@@ -35,6 +36,7 @@
 #include "annotator/types.h"
 #include "utils/base/logging.h"
 #include "utils/base/status.h"
+#include "utils/base/status_macros.h"
 #include "utils/base/statusor.h"
 #include "utils/calendar/calendar.h"
 #include "utils/checksum.h"
@@ -45,16 +47,25 @@
 #include "utils/normalization.h"
 #include "utils/optional.h"
 #include "utils/regex-match.h"
+#include "utils/stage-timings.h"
 #include "utils/strings/append.h"
 #include "utils/strings/numbers.h"
 #include "utils/strings/split.h"
+#include "utils/tokenizer.h"
 #include "utils/utf8/unicodetext.h"
 #include "utils/utf8/unilib-common.h"
 #include "utils/zlib/zlib_regex.h"
 
 namespace libtextclassifier3 {
 
-using SortedIntSet = std::set<int, std::function<bool(int, int)>>;
+namespace {
+// Maximum number of candidates that are classified with the model to resolve
+// a single conflict.
+constexpr int kMaxConflictClassifications = 20;
+
+constexpr int kNumAnnotatedSpanSources =
+    static_cast<int>(AnnotatedSpan::Source::PERSON_NAME) + 1;
+}  // namespace
 
 const std::string& Annotator::kPhoneCollection =
     *[]() { return new std::string("phone"); }();
@@ -117,6 +128,13 @@ bool IsValidSpanInput(const UnicodeText& context, const CodepointSpan& span) {
           span.second <= context.size_codepoints());
 }
 
+std::unique_ptr<InterpreterPool> CreateInterpreterPool(
+    const ModelExecutor* executor) {
+  return std::make_unique<InterpreterPool>(
+      InterpreterPool::kDefaultMaxIdle,
+      [executor]() { return executor->CreateInterpreter(); });
+}
+
 std::unordered_set<char32> FlatbuffersIntVectorToChar32UnorderedSet(
     const flatbuffers::Vector<int32_t>* ints) {
   if (ints == nullptr) {
@@ -131,10 +149,23 @@ std::unordered_set<char32> FlatbuffersIntVectorToChar32UnorderedSet(
 
 }  // namespace
 
+InterpreterManager::~InterpreterManager() {
+  if (selection_pool_ != nullptr) {
+    selection_pool_->Release(std::move(selection_interpreter_));
+  }
+  if (classification_pool_ != nullptr) {
+    classification_pool_->Release(std::move(classification_interpreter_));
+  }
+}
+
 tflite::Interpreter* InterpreterManager::SelectionInterpreter() {
   if (!selection_interpreter_) {
-    TC3_CHECK(selection_executor_);
-    selection_interpreter_ = selection_executor_->CreateInterpreter();
+    if (selection_pool_ != nullptr) {
+      selection_interpreter_ = selection_pool_->Acquire();
+    } else {
+      TC3_CHECK(selection_executor_);
+      selection_interpreter_ = selection_executor_->CreateInterpreter();
+    }
     if (!selection_interpreter_) {
       TC3_LOG(ERROR) << "Could not build TFLite interpreter.";
     }
@@ -144,8 +175,13 @@ tflite::Interpreter* InterpreterManager::SelectionInterpreter() {
 
 tflite::Interpreter* InterpreterManager::ClassificationInterpreter() {
   if (!classification_interpreter_) {
-    TC3_CHECK(classification_executor_);
-    classification_interpreter_ = classification_executor_->CreateInterpreter();
+    if (classification_pool_ != nullptr) {
+      classification_interpreter_ = classification_pool_->Acquire();
+    } else {
+      TC3_CHECK(classification_executor_);
+      classification_interpreter_ =
+          classification_executor_->CreateInterpreter();
+    }
     if (!classification_interpreter_) {
       TC3_LOG(ERROR) << "Could not build TFLite interpreter.";
     }
@@ -338,6 +374,8 @@ void Annotator::ValidateAndInitialize(const Model* model, const UniLib* unilib,
       TC3_LOG(ERROR) << "Could not initialize selection executor.";
       return;
     }
+    selection_interpreter_pool_ =
+        CreateInterpreterPool(selection_executor_.get());
     selection_feature_processor_.reset(
         new FeatureProcessor(model_->selection_feature_options(), unilib_));
   }
@@ -373,6 +411,8 @@ void Annotator::ValidateAndInitialize(const Model* model, const UniLib* unilib,
       TC3_LOG(ERROR) << "Could not initialize classification executor.";
       return;
     }
+    classification_interpreter_pool_ =
+        CreateInterpreterPool(classification_executor_.get());
 
     classification_feature_processor_.reset(new FeatureProcessor(
         model_->classification_feature_options(), unilib_));
@@ -558,12 +598,15 @@ bool Annotator::InitializeRegexModel(ZlibDecompressor* decompressor) {
 
   // Initialize pattern recognizers.
   int regex_pattern_id = 0;
+  std::vector<std::string> regex_pattern_texts;
   for (const auto regex_pattern : *model_->regex_model()->patterns()) {
+    regex_pattern_texts.emplace_back();
     std::unique_ptr<UniLib::RegexPattern> compiled_pattern =
         UncompressMakeRegexPattern(
             *unilib_, regex_pattern->pattern(),
             regex_pattern->compressed_pattern(),
-            model_->regex_model()->lazy_regex_compilation(), decompressor);
+            model_->regex_model()->lazy_regex_compilation(), decompressor,
+            &regex_pattern_texts.back());
     if (!compiled_pattern) {
       TC3_LOG(INFO) << "Failed to load regex pattern";
       return false;
@@ -585,6 +628,12 @@ bool Annotator::InitializeRegexModel(ZlibDecompressor* decompressor) {
     ++regex_pattern_id;
   }
 
+  std::unique_ptr<RegexPrefilter> regex_prefilter(
+      new RegexPrefilter(regex_pattern_texts));
+  if (regex_prefilter->num_filtered_patterns() > 0) {
+    regex_prefilter_ = std::move(regex_prefilter);
+  }
+
   return true;
 }
 
@@ -643,6 +692,39 @@ bool Annotator::SetLangId(const libtextclassifier3::mobile::lang_id::LangId* lan
   return true;
 }
 
+bool Annotator::EnableTokenEmbeddingCache(int max_num_entries) {
+  if (selection_feature_processor_ == nullptr &&
+      classification_feature_processor_ == nullptr) {
+    TC3_LOG(ERROR) << "No feature processors to enable the cache for.";
+    return false;
+  }
+  if (selection_feature_processor_ != nullptr) {
+    selection_feature_processor_->EnableTokenEmbeddingCache(max_num_entries);
+  }
+  if (classification_feature_processor_ != nullptr) {
+    classification_feature_processor_->EnableTokenEmbeddingCache(
+        max_num_entries);
+  }
+  return true;
+}
+
+TokenEmbeddingCache::Stats Annotator::GetTokenEmbeddingCacheStats() const {
+  TokenEmbeddingCache::Stats stats;
+  for (const FeatureProcessor* feature_processor :
+       {selection_feature_processor_.get(),
+        classification_feature_processor_.get()}) {
+    if (feature_processor == nullptr ||
+        feature_processor->token_embedding_cache() == nullptr) {
+      continue;
+    }
+    const TokenEmbeddingCache::Stats processor_stats =
+        feature_processor->token_embedding_cache()->GetStats();
+    stats.hits += processor_stats.hits;
+    stats.misses += processor_stats.misses;
+  }
+  return stats;
+}
+
 bool Annotator::InitializePersonNameEngineFromUnownedBuffer(const void* buffer,
                                                             int size) {
   const PersonNameModel* person_name_model =
@@ -780,8 +862,8 @@ float Annotator::GetPriorityScore(
 }
 
 bool Annotator::VerifyRegexMatchCandidate(
-    const std::string& context, const VerificationOptions* verification_options,
-    const std::string& match, const UniLib::RegexMatcher* matcher) const {
+    StringPiece context, const VerificationOptions* verification_options,
+    StringPiece match, const UniLib::RegexMatcher* matcher) const {
   if (verification_options == nullptr) {
     return true;
   }
@@ -875,8 +957,8 @@ CodepointSpan Annotator::SuggestSelection(
   // As we process a single string of context, the candidates will only
   // contain one vector of AnnotatedSpan.
   candidates.annotated_spans.resize(1);
-  InterpreterManager interpreter_manager(selection_executor_.get(),
-                                         classification_executor_.get());
+  InterpreterManager interpreter_manager(
+      selection_interpreter_pool_.get(), classification_interpreter_pool_.get());
   std::vector<Token> tokens;
   if (!ModelSuggestSelection(context_unicode, click_indices,
                              detected_text_language_tags, &interpreter_manager,
@@ -1057,13 +1139,14 @@ bool Annotator::ResolveConflicts(
     std::vector<int>* result) const {
   result->clear();
   result->reserve(candidates.size());
+  std::vector<int> candidate_indices;
   for (int i = 0; i < candidates.size();) {
     int first_non_overlapping =
         FirstNonOverlappingSpanIndex(candidates, /*start_index=*/i);
 
     const bool conflict_found = first_non_overlapping != (i + 1);
     if (conflict_found) {
-      std::vector<int> candidate_indices;
+      candidate_indices.clear();
       if (!ResolveConflict(context, cached_tokens, candidates,
                            detected_text_language_tags, i,
                            first_non_overlapping, options, interpreter_manager,
@@ -1089,6 +1172,8 @@ namespace {
 //  annotation for a given span.
 //  - In RAW usecase, certain annotations are allowed to overlap (e.g. datetime
 //  and duration), while others not (e.g. duration and number).
+// A source that doesn't conflict with itself must not conflict with any other
+// source, as the chosen spans are only tracked for self-conflicting sources.
 bool DoSourcesConflict(AnnotationUsecase annotation_usecase,
                        const AnnotatedSpan::Source source1,
                        const AnnotatedSpan::Source source2) {
@@ -1136,17 +1221,28 @@ bool Annotator::ResolveConflict(
     int end_index, const BaseOptions& options,
     InterpreterManager* interpreter_manager,
     std::vector<int>* chosen_indices) const {
-  std::vector<int> conflicting_indices;
-  std::unordered_map<int, std::pair<float, int>> scores_lengths;
+  const int num_conflicting = end_index - start_index;
+
+  // Priority scores and lengths of the candidates, indexed relative to
+  // 'start_index'.
+  std::vector<std::pair<float, int>> scores_lengths(num_conflicting, {0.0, 0});
+  int num_classified = 0;
   for (int i = start_index; i < end_index; ++i) {
-    conflicting_indices.push_back(i);
     if (!candidates[i].classification.empty()) {
-      scores_lengths[i] = {
+      scores_lengths[i - start_index] = {
           GetPriorityScore(candidates[i].classification),
           candidates[i].span.second - candidates[i].span.first};
       continue;
     }
 
+    // Dense inputs can produce very large conflict groups, limit the number
+    // of classifications. The remaining candidates are ranked last, as if the
+    // model didn't classify them.
+    if (num_classified >= kMaxConflictClassifications) {
+      continue;
+    }
+    ++num_classified;
+
     // OPTIMIZATION: So that we don't have to classify all the ML model
     // spans apriori, we wait until we get here, when they conflict with
     // something and we need the actual classification scores. So if the
@@ -1161,52 +1257,64 @@ bool Annotator::ResolveConflict(
     }
 
     if (!classification.empty()) {
-      scores_lengths[i] = {
+      scores_lengths[i - start_index] = {
           GetPriorityScore(classification),
           candidates[i].span.second - candidates[i].span.first};
     }
   }
 
-  std::sort(
-      conflicting_indices.begin(), conflicting_indices.end(),
-      [this, &scores_lengths, candidates, conflicting_indices](int i, int j) {
-        if (scores_lengths[i].first == scores_lengths[j].first &&
-            prioritize_longest_annotation_) {
-          return scores_lengths[i].second > scores_lengths[j].second;
-        }
-        return scores_lengths[i].first > scores_lengths[j].first;
-      });
+  std::vector<int> conflicting_indices(num_conflicting);
+  for (int i = 0; i < num_conflicting; ++i) {
+    conflicting_indices[i] = i;
+  }
+  std::stable_sort(conflicting_indices.begin(), conflicting_indices.end(),
+                   [this, &scores_lengths](int i, int j) {
+                     if (scores_lengths[i].first == scores_lengths[j].first &&
+                         prioritize_longest_annotation_) {
+                       return scores_lengths[i].second >
+                              scores_lengths[j].second;
+                     }
+                     return scores_lengths[i].first > scores_lengths[j].first;
+                   });
 
-  // Here we keep a set of indices that were chosen, per-source, to enable
-  // effective computation.
-  std::unordered_map<AnnotatedSpan::Source, SortedIntSet>
-      chosen_indices_for_source_map;
+  const bool needs_conflict_resolution =
+      options.annotation_usecase ==
+          AnnotationUsecase_ANNOTATION_USECASE_SMART ||
+      (options.annotation_usecase ==
+           AnnotationUsecase_ANNOTATION_USECASE_RAW &&
+       do_conflict_resolution_in_raw_mode_);
+
+  // Here we keep the spans that were chosen, per-source, to enable effective
+  // computation. Only the sources that conflict with themselves are tracked,
+  // so the chosen spans of a source never overlap.
+  DisjointSpanSet chosen_spans_for_source[kNumAnnotatedSpanSources];
+  bool source_conflicts[kNumAnnotatedSpanSources][kNumAnnotatedSpanSources];
+  for (int i = 0; i < kNumAnnotatedSpanSources; ++i) {
+    for (int j = 0; j < kNumAnnotatedSpanSources; ++j) {
+      source_conflicts[i][j] =
+          needs_conflict_resolution &&
+          DoSourcesConflict(options.annotation_usecase,
+                            static_cast<AnnotatedSpan::Source>(i),
+                            static_cast<AnnotatedSpan::Source>(j));
+    }
+  }
 
   // Greedily place the candidates if they don't conflict with the already
   // placed ones.
-  for (int i = 0; i < conflicting_indices.size(); ++i) {
-    const int considered_candidate = conflicting_indices[i];
+  chosen_indices->reserve(chosen_indices->size() + num_conflicting);
+  for (const int conflicting_index : conflicting_indices) {
+    const int considered_candidate = start_index + conflicting_index;
+    const CodepointSpan& span = candidates[considered_candidate].span;
+    const int source =
+        static_cast<int>(candidates[considered_candidate].source);
 
     // See if there is a conflict between the candidate and all already placed
     // candidates.
     bool conflict = false;
-    SortedIntSet* chosen_indices_for_source_ptr = nullptr;
-    for (auto& source_set_pair : chosen_indices_for_source_map) {
-      if (source_set_pair.first == candidates[considered_candidate].source) {
-        chosen_indices_for_source_ptr = &source_set_pair.second;
-      }
-
-      const bool needs_conflict_resolution =
-          options.annotation_usecase ==
-              AnnotationUsecase_ANNOTATION_USECASE_SMART ||
-          (options.annotation_usecase ==
-               AnnotationUsecase_ANNOTATION_USECASE_RAW &&
-           do_conflict_resolution_in_raw_mode_);
-      if (needs_conflict_resolution &&
-          DoSourcesConflict(options.annotation_usecase, source_set_pair.first,
-                            candidates[considered_candidate].source) &&
-          DoesCandidateConflict(considered_candidate, candidates,
-                                source_set_pair.second)) {
+    for (int other_source = 0; other_source < kNumAnnotatedSpanSources;
+         ++other_source) {
+      if (source_conflicts[source][other_source] &&
+          chosen_spans_for_source[other_source].Overlaps(span)) {
         conflict = true;
         break;
       }
@@ -1217,22 +1325,11 @@ bool Annotator::ResolveConflict(
       continue;
     }
 
-    // If the set of indices for the current source doesn't exist yet,
-    // initialize it.
-    if (chosen_indices_for_source_ptr == nullptr) {
-      SortedIntSet new_set([&candidates](int a, int b) {
-        return candidates[a].span.first < candidates[b].span.first;
-      });
-      chosen_indices_for_source_map[candidates[considered_candidate].source] =
-          std::move(new_set);
-      chosen_indices_for_source_ptr =
-          &chosen_indices_for_source_map[candidates[considered_candidate]
-                                             .source];
-    }
-
     // Place the candidate to the output and to the per-source conflict set.
     chosen_indices->push_back(considered_candidate);
-    chosen_indices_for_source_ptr->insert(considered_candidate);
+    if (source_conflicts[source][source]) {
+      chosen_spans_for_source[source].Insert(span);
+    }
   }
 
   std::sort(chosen_indices->begin(), chosen_indices->end());
@@ -1621,8 +1718,17 @@ bool Annotator::RegexClassifyText(
   const UnicodeText selection_text_unicode(
       UTF8ToUnicodeText(selection_text, /*do_copy=*/false));
 
+  std::vector<bool> is_candidate_pattern;
+  if (regex_prefilter_ != nullptr && !classification_regex_patterns_.empty()) {
+    is_candidate_pattern =
+        regex_prefilter_->FindCandidatePatterns(selection_text_unicode);
+  }
+
   // Check whether any of the regular expressions match.
   for (const int pattern_id : classification_regex_patterns_) {
+    if (!is_candidate_pattern.empty() && !is_candidate_pattern[pattern_id]) {
+      continue;
+    }
     const CompiledRegexPattern& regex_pattern = regex_patterns_[pattern_id];
     const std::unique_ptr<UniLib::RegexMatcher> matcher =
         regex_pattern.pattern->Matcher(selection_text_unicode);
@@ -1771,52 +1877,64 @@ std::vector<ClassificationResult> Annotator::ClassifyText(
 
   // Try the knowledge engine.
   // TODO(b/126579108): Propagate error status.
-  ClassificationResult knowledge_result;
-  if (knowledge_engine_ &&
-      knowledge_engine_
-          ->ClassifyText(context, selection_indices, options.annotation_usecase,
-                         options.location_context, Permissions(),
-                         &knowledge_result)
-          .ok()) {
-    candidates.push_back({selection_indices, {knowledge_result}});
-    candidates.back().source = AnnotatedSpan::Source::KNOWLEDGE;
+  if (knowledge_engine_) {
+    ScopedStage stage(options.stage_timings, "knowledge", &candidates);
+    ClassificationResult knowledge_result;
+    if (knowledge_engine_
+            ->ClassifyText(context, selection_indices,
+                           options.annotation_usecase, options.location_context,
+                           Permissions(), &knowledge_result)
+            .ok()) {
+      candidates.push_back({selection_indices, {knowledge_result}});
+      candidates.back().source = AnnotatedSpan::Source::KNOWLEDGE;
+    }
   }
 
   AddContactMetadataToKnowledgeClassificationResults(&candidates);
 
   // Try the contact engine.
   // TODO(b/126579108): Propagate error status.
-  ClassificationResult contact_result;
-  if (contact_engine_ && contact_engine_->ClassifyText(
-                             context, selection_indices, &contact_result)) {
-    candidates.push_back({selection_indices, {contact_result}});
+  if (contact_engine_) {
+    ScopedStage stage(options.stage_timings, "contact", &candidates);
+    ClassificationResult contact_result;
+    if (contact_engine_->ClassifyText(context, selection_indices,
+                                      &contact_result)) {
+      candidates.push_back({selection_indices, {contact_result}});
+    }
   }
 
   // Try the person name engine.
-  ClassificationResult person_name_result;
-  if (person_name_engine_ &&
-      person_name_engine_->ClassifyText(context, selection_indices,
-                                        &person_name_result)) {
-    candidates.push_back({selection_indices, {person_name_result}});
-    candidates.back().source = AnnotatedSpan::Source::PERSON_NAME;
+  if (person_name_engine_) {
+    ScopedStage stage(options.stage_timings, "person_name", &candidates);
+    ClassificationResult person_name_result;
+    if (person_name_engine_->ClassifyText(context, selection_indices,
+                                          &person_name_result)) {
+      candidates.push_back({selection_indices, {person_name_result}});
+      candidates.back().source = AnnotatedSpan::Source::PERSON_NAME;
+    }
   }
 
   // Try the installed app engine.
   // TODO(b/126579108): Propagate error status.
-  ClassificationResult installed_app_result;
-  if (installed_app_engine_ &&
-      installed_app_engine_->ClassifyText(context, selection_indices,
-                                          &installed_app_result)) {
-    candidates.push_back({selection_indices, {installed_app_result}});
+  if (installed_app_engine_) {
+    ScopedStage stage(options.stage_timings, "installed_app", &candidates);
+    ClassificationResult installed_app_result;
+    if (installed_app_engine_->ClassifyText(context, selection_indices,
+                                            &installed_app_result)) {
+      candidates.push_back({selection_indices, {installed_app_result}});
+    }
   }
 
   // Try the regular expression models.
-  std::vector<ClassificationResult> regex_results;
-  if (!RegexClassifyText(context, selection_indices, &regex_results)) {
-    return {};
-  }
-  for (const ClassificationResult& result : regex_results) {
-    candidates.push_back({selection_indices, {result}});
+  {
+    ScopedStage stage(options.stage_timings, "regex", &candidates);
+    std::vector<ClassificationResult> regex_results;
+    if (!RegexClassifyText(context, selection_indices, &regex_results)) {
+      return {};
+    }
+    for (const ClassificationResult& result : regex_results) {
+      candidates.push_back({selection_indices, {result}});
+    }
   }
 
   // Try the date model.
@@ -1825,70 +1943,87 @@ std::vector<ClassificationResult> Annotator::ClassifyText(
   // more interpretations. They are inserted in the candidates as a single
   // AnnotatedSpan, so that they get treated together by the conflict resolution
   // algorithm.
-  std::vector<ClassificationResult> datetime_results;
-  if (!DatetimeClassifyText(context, selection_indices, options,
-                            &datetime_results)) {
-    return {};
-  }
-  if (!datetime_results.empty()) {
-    candidates.push_back({selection_indices, std::move(datetime_results)});
-    candidates.back().source = AnnotatedSpan::Source::DATETIME;
+  {
+    ScopedStage stage(options.stage_timings, "datetime", &candidates);
+    std::vector<ClassificationResult> datetime_results;
+    if (!DatetimeClassifyText(context, selection_indices, options,
+                              &datetime_results)) {
+      return {};
+    }
+    if (!datetime_results.empty()) {
+      candidates.push_back({selection_indices, std::move(datetime_results)});
+      candidates.back().source = AnnotatedSpan::Source::DATETIME;
+    }
   }
 
   // Try the number annotator.
   // TODO(b/126579108): Propagate error status.
-  ClassificationResult number_annotator_result;
-  if (number_annotator_ &&
-      number_annotator_->ClassifyText(context_unicode, selection_indices,
-                                      options.annotation_usecase,
-                                      &number_annotator_result)) {
-    candidates.push_back({selection_indices, {number_annotator_result}});
+  if (number_annotator_) {
+    ScopedStage stage(options.stage_timings, "number", &candidates);
+    ClassificationResult number_annotator_result;
+    if (number_annotator_->ClassifyText(context_unicode, selection_indices,
+                                        options.annotation_usecase,
+                                        &number_annotator_result)) {
+      candidates.push_back({selection_indices, {number_annotator_result}});
+    }
   }
 
   // Try the duration annotator.
-  ClassificationResult duration_annotator_result;
-  if (duration_annotator_ &&
-      duration_annotator_->ClassifyText(context_unicode, selection_indices,
-                                        options.annotation_usecase,
-                                        &duration_annotator_result)) {
-    candidates.push_back({selection_indices, {duration_annotator_result}});
-    candidates.back().source = AnnotatedSpan::Source::DURATION;
+  if (duration_annotator_) {
+    ScopedStage stage(options.stage_timings, "duration", &candidates);
+    ClassificationResult duration_annotator_result;
+    if (duration_annotator_->ClassifyText(context_unicode, selection_indices,
+                                          options.annotation_usecase,
+                                          &duration_annotator_result)) {
+      candidates.push_back({selection_indices, {duration_annotator_result}});
+      candidates.back().source = AnnotatedSpan::Source::DURATION;
+    }
   }
 
   // Try the translate annotator.
-  ClassificationResult translate_annotator_result;
-  if (translate_annotator_ &&
-      translate_annotator_->ClassifyText(context_unicode, selection_indices,
-                                         options.user_familiar_language_tags,
-                                         &translate_annotator_result)) {
-    candidates.push_back({selection_indices, {translate_annotator_result}});
+  if (translate_annotator_) {
+    ScopedStage stage(options.stage_timings, "translate", &candidates);
+    ClassificationResult translate_annotator_result;
+    if (translate_annotator_->ClassifyText(
+            context_unicode, selection_indices,
+            options.user_familiar_language_tags, &translate_annotator_result)) {
+      candidates.push_back({selection_indices, {translate_annotator_result}});
+    }
   }
 
   // Try the grammar model.
-  ClassificationResult grammar_annotator_result;
-  if (grammar_annotator_ && grammar_annotator_->ClassifyText(
-                                detected_text_language_tags, context_unicode,
-                                selection_indices, &grammar_annotator_result)) {
-    candidates.push_back({selection_indices, {grammar_annotator_result}});
+  if (grammar_annotator_) {
+    ScopedStage stage(options.stage_timings, "grammar", &candidates);
+    ClassificationResult grammar_annotator_result;
+    if (grammar_annotator_->ClassifyText(detected_text_language_tags,
+                                         context_unicode, selection_indices,
+                                         &grammar_annotator_result)) {
+      candidates.push_back({selection_indices, {grammar_annotator_result}});
+    }
   }
 
-  ClassificationResult pod_ner_annotator_result;
-  if (pod_ner_annotator_ && options.use_pod_ner &&
-      pod_ner_annotator_->ClassifyText(context_unicode, selection_indices,
-                                       &pod_ner_annotator_result)) {
-    candidates.push_back({selection_indices, {pod_ner_annotator_result}});
+  if (pod_ner_annotator_ && options.use_pod_ner) {
+    ScopedStage stage(options.stage_timings, "pod_ner", &candidates);
+    ClassificationResult pod_ner_annotator_result;
+    if (pod_ner_annotator_->ClassifyText(context_unicode, selection_indices,
+                                         &pod_ner_annotator_result)) {
+      candidates.push_back({selection_indices, {pod_ner_annotator_result}});
+    }
   }
 
-  ClassificationResult vocab_annotator_result;
-  if (vocab_annotator_ && options.use_vocab_annotator &&
-      vocab_annotator_->ClassifyText(
-          context_unicode, selection_indices, detected_text_language_tags,
-          options.trigger_dictionary_on_beginner_words,
-          &vocab_annotator_result)) {
-    candidates.push_back({selection_indices, {vocab_annotator_result}});
+  if (vocab_annotator_ && options.use_vocab_annotator) {
+    ScopedStage stage(options.stage_timings, "vocab", &candidates);
+    ClassificationResult vocab_annotator_result;
+    if (vocab_annotator_->ClassifyText(
+            context_unicode, selection_indices, detected_text_language_tags,
+            options.trigger_dictionary_on_beginner_words,
+            &vocab_annotator_result)) {
+      candidates.push_back({selection_indices, {vocab_annotator_result}});
+    }
   }
 
   if (experimental_annotator_) {
+    ScopedStage stage(options.stage_timings, "experimental", &candidates);
     experimental_annotator_->ClassifyText(context_unicode, selection_indices,
                                           candidates);
   }
@@ -1898,26 +2033,33 @@ std::vector<ClassificationResult> Annotator::ClassifyText(
   // The output of the model is considered as an exclusive 1-of-N choice. That's
   // why it's inserted as only 1 AnnotatedSpan into candidates, as opposed to 1
   // span for each candidate, like e.g. the regex model.
-  InterpreterManager interpreter_manager(selection_executor_.get(),
-                                         classification_executor_.get());
-  std::vector<ClassificationResult> model_results;
+  InterpreterManager interpreter_manager(
+      selection_interpreter_pool_.get(), classification_interpreter_pool_.get());
   std::vector<Token> tokens;
-  if (!ModelClassifyText(
-          context, /*cached_tokens=*/{}, detected_text_language_tags,
-          selection_indices, options, &interpreter_manager,
-          /*embedding_cache=*/nullptr, &model_results, &tokens)) {
-    return {};
-  }
-  if (!model_results.empty()) {
-    candidates.push_back({selection_indices, std::move(model_results)});
+  {
+    ScopedStage stage(options.stage_timings, "model", &candidates);
+    std::vector<ClassificationResult> model_results;
+    if (!ModelClassifyText(
+            context, /*cached_tokens=*/{}, detected_text_language_tags,
+            selection_indices, options, &interpreter_manager,
+            /*embedding_cache=*/nullptr, &model_results, &tokens)) {
+      return {};
+    }
+    if (!model_results.empty()) {
+      candidates.push_back({selection_indices, std::move(model_results)});
+    }
   }
 
   std::vector<int> candidate_indices;
-  if (!ResolveConflicts(candidates, context, tokens,
-                        detected_text_language_tags, options,
-                        &interpreter_manager, &candidate_indices)) {
-    TC3_LOG(ERROR) << "Couldn't resolve conflicts.";
-    return {};
+  {
+    ScopedStage stage(options.stage_timings, "conflict_resolution",
+                      &candidate_indices);
+    if (!ResolveConflicts(candidates, context, tokens,
+                          detected_text_language_tags, options,
+                          &interpreter_manager, &candidate_indices)) {
+      TC3_LOG(ERROR) << "Couldn't resolve conflicts.";
+      return {};
+    }
   }
 
   std::vector<ClassificationResult> results;
@@ -1946,6 +2088,42 @@ bool Annotator::ModelAnnotate(
     const std::vector<Locale>& detected_text_language_tags,
     const AnnotationOptions& options, InterpreterManager* interpreter_manager,
     std::vector<Token>* tokens, std::vector<AnnotatedSpan>* result) const {
+  std::vector<std::vector<Token>> batch_tokens(1);
+  std::vector<std::vector<AnnotatedSpan>> batch_results(1);
+  if (!ModelAnnotate({&context}, detected_text_language_tags, options,
+                     interpreter_manager, &batch_tokens, &batch_results)) {
+    return false;
+  }
+  if (tokens->empty()) {
+    *tokens = std::move(batch_tokens[0]);
+  } else {
+    tokens->insert(tokens->end(), batch_tokens[0].begin(),
+                   batch_tokens[0].end());
+  }
+  result->insert(result->end(),
+                 std::make_move_iterator(batch_results[0].begin()),
+                 std::make_move_iterator(batch_results[0].end()));
+  return true;
+}
+
+namespace {
+// State of the ML model annotation of one line of one context.
+struct ModelAnnotationLine {
+  int context_index;
+  UnicodeTextRange line;
+  std::string line_str;
+  std::vector<Token> tokens;
+  std::unique_ptr<CachedFeatures> cached_features;
+  TokenSpan inference_span;
+};
+}  // namespace
+
+bool Annotator::ModelAnnotate(
+    const std::vector<const std::string*>& contexts,
+    const std::vector<Locale>& detected_text_language_tags,
+    const AnnotationOptions& options, InterpreterManager* interpreter_manager,
+    std::vector<std::vector<Token>>* tokens,
+    std::vector<std::vector<AnnotatedSpan>>* results) const {
   if (model_->triggering_options() == nullptr ||
       !(model_->triggering_options()->enabled_modes() & ModeFlag_ANNOTATION)) {
     return true;
@@ -1957,15 +2135,106 @@ bool Annotator::ModelAnnotate(
     return true;
   }
 
-  const UnicodeText context_unicode = UTF8ToUnicodeText(context,
-                                                        /*do_copy=*/false);
-  std::vector<UnicodeTextRange> lines;
-  if (!selection_feature_processor_->GetOptions()->only_use_line_with_click()) {
-    lines.push_back({context_unicode.begin(), context_unicode.end()});
+  std::vector<UnicodeText> contexts_unicode;
+  contexts_unicode.reserve(contexts.size());
+  for (const std::string* context : contexts) {
+    contexts_unicode.push_back(UTF8ToUnicodeText(*context, /*do_copy=*/false));
+  }
+
+  // Tokenize all the lines and extract their features.
+  std::vector<ModelAnnotationLine> lines;
+  for (int context_index = 0; context_index < contexts.size();
+       ++context_index) {
+    const UnicodeText& context_unicode = contexts_unicode[context_index];
+    std::vector<UnicodeTextRange> context_lines;
+    if (!selection_feature_processor_->GetOptions()
+             ->only_use_line_with_click()) {
+      context_lines.push_back({context_unicode.begin(), context_unicode.end()});
+    } else {
+      context_lines = selection_feature_processor_->SplitContext(
+          context_unicode, selection_feature_processor_->GetOptions()
+                               ->use_pipe_character_for_newline());
+    }
+
+    for (const UnicodeTextRange& line : context_lines) {
+      ModelAnnotationLine annotation_line;
+      annotation_line.context_index = context_index;
+      annotation_line.line = line;
+      annotation_line.line_str =
+          UnicodeText::UTF8Substring(line.first, line.second);
+
+      annotation_line.tokens =
+          selection_feature_processor_->Tokenize(annotation_line.line_str);
+
+      selection_feature_processor_->RetokenizeAndFindClick(
+          annotation_line.line_str, {0, std::distance(line.first, line.second)},
+          selection_feature_processor_->GetOptions()
+              ->only_use_line_with_click(),
+          &annotation_line.tokens,
+          /*click_pos=*/nullptr);
+      const TokenSpan full_line_span = {
+          0, static_cast<TokenIndex>(annotation_line.tokens.size())};
+
+      // TODO(zilka): Add support for greater granularity of this check.
+      if (!selection_feature_processor_->HasEnoughSupportedCodepoints(
+              annotation_line.tokens, full_line_span)) {
+        continue;
+      }
+
+      if (!selection_feature_processor_->ExtractFeatures(
+              annotation_line.tokens, full_line_span,
+              /*selection_span_for_feature=*/{kInvalidIndex, kInvalidIndex},
+              embedding_executor_.get(),
+              /*embedding_cache=*/nullptr,
+              selection_feature_processor_->EmbeddingSize() +
+                  selection_feature_processor_->DenseFeaturesCount(),
+              &annotation_line.cached_features)) {
+        TC3_LOG(ERROR) << "Could not extract features.";
+        return false;
+      }
+      annotation_line.inference_span = ChunkInferenceSpan(
+          annotation_line.tokens.size(), /*span_of_interest=*/full_line_span);
+      lines.push_back(std::move(annotation_line));
+    }
+  }
+
+  // Score the chunk candidates of all the lines. For the bounds-sensitive
+  // model, the candidates of all the lines are scored in shared batches.
+  std::vector<std::vector<ScoredChunk>> scored_chunks(lines.size());
+  if (UsesBoundsSensitiveSelectionFeatures()) {
+    std::vector<ChunkCandidate> candidates;
+    std::vector<TokenSpan> candidate_spans;
+    for (int i = 0; i < lines.size(); ++i) {
+      candidate_spans.clear();
+      BoundsSensitiveChunkCandidates(
+          /*span_of_interest=*/{0, static_cast<TokenIndex>(
+                                       lines[i].tokens.size())},
+          lines[i].inference_span, &scored_chunks[i], &candidate_spans);
+      for (const TokenSpan& candidate_span : candidate_spans) {
+        candidates.push_back(ChunkCandidate{candidate_span,
+                                            lines[i].cached_features.get(),
+                                            &scored_chunks[i]});
+      }
+    }
+    if (!candidates.empty() &&
+        !ScoreChunkCandidates(candidates,
+                              interpreter_manager->SelectionInterpreter())) {
+      TC3_LOG(ERROR) << "Could not chunk.";
+      return false;
+    }
   } else {
-    lines = selection_feature_processor_->SplitContext(
-        context_unicode, selection_feature_processor_->GetOptions()
-                             ->use_pipe_character_for_newline());
+    for (int i = 0; i < lines.size(); ++i) {
+      if (!ModelClickContextScoreChunks(
+              lines[i].tokens.size(),
+              /*span_of_interest=*/
+              {0, static_cast<TokenIndex>(lines[i].tokens.size())},
+              *lines[i].cached_features,
+              interpreter_manager->SelectionInterpreter(),
+              &scored_chunks[i])) {
+        TC3_LOG(ERROR) << "Could not chunk.";
+        return false;
+      }
+    }
   }
 
   const float min_annotate_confidence =
@@ -1973,48 +2242,20 @@ bool Annotator::ModelAnnotate(
            ? model_->triggering_options()->min_annotate_confidence()
            : 0.f);
 
-  for (const UnicodeTextRange& line : lines) {
+  for (int line_index = 0; line_index < lines.size(); ++line_index) {
+    ModelAnnotationLine& annotation_line = lines[line_index];
+    const UnicodeTextRange& line = annotation_line.line;
+    const std::string& line_str = annotation_line.line_str;
+    std::vector<Token>& line_tokens = annotation_line.tokens;
+    const UnicodeText& context_unicode =
+        contexts_unicode[annotation_line.context_index];
+    std::vector<AnnotatedSpan>* result =
+        &(*results)[annotation_line.context_index];
     FeatureProcessor::EmbeddingCache embedding_cache;
-    const std::string line_str =
-        UnicodeText::UTF8Substring(line.first, line.second);
-
-    std::vector<Token> line_tokens;
-    line_tokens = selection_feature_processor_->Tokenize(line_str);
-
-    selection_feature_processor_->RetokenizeAndFindClick(
-        line_str, {0, std::distance(line.first, line.second)},
-        selection_feature_processor_->GetOptions()->only_use_line_with_click(),
-        &line_tokens,
-        /*click_pos=*/nullptr);
-    const TokenSpan full_line_span = {
-        0, static_cast<TokenIndex>(line_tokens.size())};
-
-    // TODO(zilka): Add support for greater granularity of this check.
-    if (!selection_feature_processor_->HasEnoughSupportedCodepoints(
-            line_tokens, full_line_span)) {
-      continue;
-    }
-
-    std::unique_ptr<CachedFeatures> cached_features;
-    if (!selection_feature_processor_->ExtractFeatures(
-            line_tokens, full_line_span,
-            /*selection_span_for_feature=*/{kInvalidIndex, kInvalidIndex},
-            embedding_executor_.get(),
-            /*embedding_cache=*/nullptr,
-            selection_feature_processor_->EmbeddingSize() +
-                selection_feature_processor_->DenseFeaturesCount(),
-            &cached_features)) {
-      TC3_LOG(ERROR) << "Could not extract features.";
-      return false;
-    }
 
     std::vector<TokenSpan> local_chunks;
-    if (!ModelChunk(line_tokens.size(), /*span_of_interest=*/full_line_span,
-                    interpreter_manager->SelectionInterpreter(),
-                    *cached_features, &local_chunks)) {
-      TC3_LOG(ERROR) << "Could not chunk.";
-      return false;
-    }
+    SelectNonOverlappingChunks(annotation_line.inference_span,
+                               &scored_chunks[line_index], &local_chunks);
 
     const int offset = std::distance(context_unicode.begin(), line.first);
     UnicodeText line_unicode;
@@ -2096,11 +2337,14 @@ bool Annotator::ModelAnnotate(
     // If we are going line-by-line, we need to insert the tokens for each line.
     // But if not, we can optimize and just std::move the current line vector to
     // the output.
+    std::vector<Token>* context_tokens =
+        &(*tokens)[annotation_line.context_index];
     if (selection_feature_processor_->GetOptions()
             ->only_use_line_with_click()) {
-      tokens->insert(tokens->end(), line_tokens.begin(), line_tokens.end());
+      context_tokens->insert(context_tokens->end(), line_tokens.begin(),
+                             line_tokens.end());
     } else {
-      *tokens = std::move(line_tokens);
+      *context_tokens = std::move(line_tokens);
     }
   }
   return true;
@@ -2155,159 +2399,301 @@ void Annotator::AddContactMetadataToKnowledgeClassificationResults(
   }
 }
 
-Status Annotator::AnnotateSingleInput(
-    const std::string& context, const AnnotationOptions& options,
-    std::vector<AnnotatedSpan>* candidates) const {
+Status Annotator::PrepareAnnotation(
+    const AnnotationOptions& options,
+    std::vector<Locale>* detected_text_language_tags) const {
   if (!(model_->enabled_modes() & ModeFlag_ANNOTATION)) {
     return Status(StatusCode::UNAVAILABLE, "Model annotation was not enabled.");
   }
 
-  const UnicodeText context_unicode =
-      UTF8ToUnicodeText(context, /*do_copy=*/false);
-
-  std::vector<Locale> detected_text_language_tags;
   if (!ParseLocales(options.detected_text_language_tags,
-                    &detected_text_language_tags)) {
+                    detected_text_language_tags)) {
     TC3_LOG(WARNING)
         << "Failed to parse the detected_text_language_tags in options: "
         << options.detected_text_language_tags;
   }
-  if (!Locale::IsAnyLocaleSupported(detected_text_language_tags,
+  if (!Locale::IsAnyLocaleSupported(*detected_text_language_tags,
                                     model_triggering_locales_,
                                     /*default_value=*/true)) {
     return Status(
         StatusCode::UNAVAILABLE,
         "The detected language tags are not in the supported locales.");
   }
+  return Status::OK;
+}
+
+bool Annotator::ModelAnnotationsEnabled(
+    const AnnotationOptions& options) const {
+  const EnabledEntityTypes is_entity_type_enabled(options.entity_types);
+  const bool is_raw_usecase =
+      options.annotation_usecase == AnnotationUsecase_ANNOTATION_USECASE_RAW;
+  return !is_raw_usecase || IsAnyModelEntityTypeEnabled(is_entity_type_enabled);
+}
 
-  InterpreterManager interpreter_manager(selection_executor_.get(),
-                                         classification_executor_.get());
+Status Annotator::AnnotateSingleInput(
+    const std::string& context, const AnnotationOptions& options,
+    const std::vector<Locale>& detected_text_language_tags,
+    InterpreterManager* interpreter_manager, std::vector<Token>* model_tokens,
+    std::vector<AnnotatedSpan>* model_annotations,
+    std::vector<AnnotatedSpan>* candidates) const {
+  const UnicodeText context_unicode =
+      UTF8ToUnicodeText(context, /*do_copy=*/false);
+
+  // The annotators below that tokenize the whole context share the
+  // tokenizations, so that each distinct tokenizer runs only once.
+  TokenizationCache tokenization_cache(context_unicode);
 
   const EnabledEntityTypes is_entity_type_enabled(options.entity_types);
   const bool is_raw_usecase =
       options.annotation_usecase == AnnotationUsecase_ANNOTATION_USECASE_RAW;
 
-  // Annotate with the selection model.
-  const bool model_annotations_enabled =
-      !is_raw_usecase || IsAnyModelEntityTypeEnabled(is_entity_type_enabled);
+  // Each sub-annotator writes its candidates to its own vector, so that the
+  // sub-annotators can run concurrently. The vectors are merged in this fixed
+  // order afterwards, which keeps the result independent of the scheduling.
+  enum SubAnnotatorSlot {
+    kModelSlot = 0,
+    kRegexSlot,
+    kDatetimeSlot,
+    kContactSlot,
+    kInstalledAppSlot,
+    kNumberSlot,
+    kDurationSlot,
+    kPersonNameSlot,
+    kGrammarSlot,
+    kPodNerSlot,
+    kVocabSlot,
+    kExperimentalSlot,
+    kNumSlots
+  };
+  std::vector<AnnotatedSpan> slot_candidates[kNumSlots];
+  std::vector<std::function<Status()>> sub_annotators;
+
+  // Annotate with the selection model, followed by the annotators that depend
+  // on its tokens.
   std::vector<Token> tokens;
-  if (model_annotations_enabled &&
-      !ModelAnnotate(context, detected_text_language_tags, options,
-                     &interpreter_manager, &tokens, candidates)) {
-    return Status(StatusCode::INTERNAL, "Couldn't run ModelAnnotate.");
-  } else if (!model_annotations_enabled) {
-    // If the ML model didn't run, we need to tokenize to support the other
-    // annotators that depend on the tokens.
-    // Optimization could be made to only do this when an annotator that uses
-    // the tokens is enabled, but it's unclear if the added complexity is worth
-    // it.
-    if (selection_feature_processor_ != nullptr) {
-      tokens = selection_feature_processor_->Tokenize(context_unicode);
+  sub_annotators.push_back([&]() -> Status {
+    const bool model_annotations_enabled = ModelAnnotationsEnabled(options);
+    if (model_annotations_enabled && model_annotations != nullptr) {
+      tokens = std::move(*model_tokens);
+      slot_candidates[kModelSlot] = std::move(*model_annotations);
+    } else if (model_annotations_enabled) {
+      ScopedStage stage(options.stage_timings, "model",
+                        &slot_candidates[kModelSlot]);
+      if (!ModelAnnotate(context, detected_text_language_tags, options,
+                         interpreter_manager, &tokens,
+                         &slot_candidates[kModelSlot])) {
+        return Status(StatusCode::INTERNAL, "Couldn't run ModelAnnotate.");
+      }
+    } else {
+      // If the ML model didn't run, we need to tokenize to support the other
+      // annotators that depend on the tokens.
+      // Optimization could be made to only do this when an annotator that uses
+      // the tokens is enabled, but it's unclear if the added complexity is
+      // worth it.
+      if (selection_feature_processor_ != nullptr) {
+        ScopedStage stage(options.stage_timings, "tokenization", &tokens);
+        tokens = tokenization_cache.Tokenize(
+            selection_feature_processor_->tokenizer());
+      }
+    }
+
+    // Annotate with the contact engine.
+    const bool contact_annotations_enabled =
+        !is_raw_usecase || is_entity_type_enabled(Collections::Contact());
+    if (contact_annotations_enabled && contact_engine_) {
+      ScopedStage stage(options.stage_timings, "contact",
+                        &slot_candidates[kContactSlot]);
+      if (!contact_engine_->Chunk(context_unicode, tokens,
+                                  &slot_candidates[kContactSlot])) {
+        return Status(StatusCode::INTERNAL,
+                      "Couldn't run contact engine Chunk.");
+      }
+    }
+
+    // Annotate with the installed app engine.
+    const bool app_annotations_enabled =
+        !is_raw_usecase || is_entity_type_enabled(Collections::App());
+    if (app_annotations_enabled && installed_app_engine_) {
+      ScopedStage stage(options.stage_timings, "installed_app",
+                        &slot_candidates[kInstalledAppSlot]);
+      if (!installed_app_engine_->Chunk(context_unicode, tokens,
+                                        &slot_candidates[kInstalledAppSlot])) {
+        return Status(StatusCode::INTERNAL,
+                      "Couldn't run installed app engine Chunk.");
+      }
     }
-  }
+
+    // Annotate with the duration annotator.
+    const bool duration_annotations_enabled =
+        !is_raw_usecase || is_entity_type_enabled(Collections::Duration());
+    if (duration_annotations_enabled && duration_annotator_ != nullptr) {
+      ScopedStage stage(options.stage_timings, "duration",
+                        &slot_candidates[kDurationSlot]);
+      if (!duration_annotator_->FindAll(context_unicode, tokens,
+                                        options.annotation_usecase,
+                                        &slot_candidates[kDurationSlot])) {
+        return Status(StatusCode::INTERNAL,
+                      "Couldn't run duration annotator FindAll.");
+      }
+    }
+
+    // Annotate with the person name engine.
+    const bool person_annotations_enabled =
+        !is_raw_usecase || is_entity_type_enabled(Collections::PersonName());
+    if (person_annotations_enabled && person_name_engine_) {
+      ScopedStage stage(options.stage_timings, "person_name",
+                        &slot_candidates[kPersonNameSlot]);
+      if (!person_name_engine_->Chunk(context_unicode, tokens,
+                                      &slot_candidates[kPersonNameSlot])) {
+        return Status(StatusCode::INTERNAL,
+                      "Couldn't run person name engine Chunk.");
+      }
+    }
+    return Status::OK;
+  });
 
   // Annotate with the regular expression models.
   const bool regex_annotations_enabled =
       !is_raw_usecase || IsAnyRegexEntityTypeEnabled(is_entity_type_enabled);
-  if (regex_annotations_enabled &&
-      !RegexChunk(
-          UTF8ToUnicodeText(context, /*do_copy=*/false),
-          annotation_regex_patterns_, options.is_serialized_entity_data_enabled,
-          is_entity_type_enabled, options.annotation_usecase, candidates)) {
-    return Status(StatusCode::INTERNAL, "Couldn't run RegexChunk.");
+  if (regex_annotations_enabled) {
+    sub_annotators.push_back([&]() -> Status {
+      ScopedStage stage(options.stage_timings, "regex",
+                        &slot_candidates[kRegexSlot]);
+      if (!RegexChunk(context_unicode, annotation_regex_patterns_,
+                      options.is_serialized_entity_data_enabled,
+                      is_entity_type_enabled, options.annotation_usecase,
+                      &slot_candidates[kRegexSlot])) {
+        return Status(StatusCode::INTERNAL, "Couldn't run RegexChunk.");
+      }
+      return Status::OK;
+    });
   }
 
   // Annotate with the datetime model.
   // NOTE: Datetime can be disabled even in the SMART usecase, because it's been
   // relatively slow for some clients.
-  if ((is_entity_type_enabled(Collections::Date()) ||
-       is_entity_type_enabled(Collections::DateTime())) &&
-      !DatetimeChunk(UTF8ToUnicodeText(context, /*do_copy=*/false),
-                     options.reference_time_ms_utc, options.reference_timezone,
-                     options.locales, ModeFlag_ANNOTATION,
-                     options.annotation_usecase,
-                     options.is_serialized_entity_data_enabled, candidates)) {
-    return Status(StatusCode::INTERNAL, "Couldn't run DatetimeChunk.");
-  }
-
-  // Annotate with the contact engine.
-  const bool contact_annotations_enabled =
-      !is_raw_usecase || is_entity_type_enabled(Collections::Contact());
-  if (contact_annotations_enabled && contact_engine_ &&
-      !contact_engine_->Chunk(context_unicode, tokens, candidates)) {
-    return Status(StatusCode::INTERNAL, "Couldn't run contact engine Chunk.");
-  }
-
-  // Annotate with the installed app engine.
-  const bool app_annotations_enabled =
-      !is_raw_usecase || is_entity_type_enabled(Collections::App());
-  if (app_annotations_enabled && installed_app_engine_ &&
-      !installed_app_engine_->Chunk(context_unicode, tokens, candidates)) {
-    return Status(StatusCode::INTERNAL,
-                  "Couldn't run installed app engine Chunk.");
+  if (is_entity_type_enabled(Collections::Date()) ||
+      is_entity_type_enabled(Collections::DateTime())) {
+    sub_annotators.push_back([&]() -> Status {
+      ScopedStage stage(options.stage_timings, "datetime",
+                        &slot_candidates[kDatetimeSlot]);
+      if (!DatetimeChunk(context_unicode, options.reference_time_ms_utc,
+                         options.reference_timezone, options.locales,
+                         ModeFlag_ANNOTATION, options.annotation_usecase,
+                         options.is_serialized_entity_data_enabled,
+                         &slot_candidates[kDatetimeSlot])) {
+        return Status(StatusCode::INTERNAL, "Couldn't run DatetimeChunk.");
+      }
+      return Status::OK;
+    });
   }
 
   // Annotate with the number annotator.
   const bool number_annotations_enabled =
       !is_raw_usecase || (is_entity_type_enabled(Collections::Number()) ||
                           is_entity_type_enabled(Collections::Percentage()));
-  if (number_annotations_enabled && number_annotator_ != nullptr &&
-      !number_annotator_->FindAll(context_unicode, options.annotation_usecase,
-                                  candidates)) {
-    return Status(StatusCode::INTERNAL,
-                  "Couldn't run number annotator FindAll.");
-  }
-
-  // Annotate with the duration annotator.
-  const bool duration_annotations_enabled =
-      !is_raw_usecase || is_entity_type_enabled(Collections::Duration());
-  if (duration_annotations_enabled && duration_annotator_ != nullptr &&
-      !duration_annotator_->FindAll(context_unicode, tokens,
-                                    options.annotation_usecase, candidates)) {
-    return Status(StatusCode::INTERNAL,
-                  "Couldn't run duration annotator FindAll.");
-  }
-
-  // Annotate with the person name engine.
-  const bool person_annotations_enabled =
-      !is_raw_usecase || is_entity_type_enabled(Collections::PersonName());
-  if (person_annotations_enabled && person_name_engine_ &&
-      !person_name_engine_->Chunk(context_unicode, tokens, candidates)) {
-    return Status(StatusCode::INTERNAL,
-                  "Couldn't run person name engine Chunk.");
+  if (number_annotations_enabled && number_annotator_ != nullptr) {
+    sub_annotators.push_back([&]() -> Status {
+      ScopedStage stage(options.stage_timings, "number",
+                        &slot_candidates[kNumberSlot]);
+      if (!number_annotator_->FindAll(context_unicode,
+                                      options.annotation_usecase,
+                                      &tokenization_cache,
+                                      &slot_candidates[kNumberSlot])) {
+        return Status(StatusCode::INTERNAL,
+                      "Couldn't run number annotator FindAll.");
+      }
+      return Status::OK;
+    });
   }
 
   // Annotate with the grammar annotators.
-  if (grammar_annotator_ != nullptr &&
-      !grammar_annotator_->Annotate(detected_text_language_tags,
-                                    context_unicode, candidates)) {
-    return Status(StatusCode::INTERNAL, "Couldn't run grammar annotators.");
+  if (grammar_annotator_ != nullptr) {
+    sub_annotators.push_back([&]() -> Status {
+      ScopedStage stage(options.stage_timings, "grammar",
+                        &slot_candidates[kGrammarSlot]);
+      if (!grammar_annotator_->Annotate(detected_text_language_tags,
+                                        context_unicode, &tokenization_cache,
+                                        &slot_candidates[kGrammarSlot])) {
+        return Status(StatusCode::INTERNAL,
+                      "Couldn't run grammar annotators.");
+      }
+      return Status::OK;
+    });
   }
 
   // Annotate with the POD NER annotator.
   const bool pod_ner_annotations_enabled =
       !is_raw_usecase || IsAnyPodNerEntityTypeEnabled(is_entity_type_enabled);
   if (pod_ner_annotations_enabled && pod_ner_annotator_ != nullptr &&
-      options.use_pod_ner &&
-      !pod_ner_annotator_->Annotate(context_unicode, candidates)) {
-    return Status(StatusCode::INTERNAL, "Couldn't run POD NER annotator.");
+      options.use_pod_ner) {
+    sub_annotators.push_back([&]() -> Status {
+      ScopedStage stage(options.stage_timings, "pod_ner",
+                        &slot_candidates[kPodNerSlot]);
+      if (!pod_ner_annotator_->Annotate(context_unicode,
+                                        &slot_candidates[kPodNerSlot],
+                                        task_runner_)) {
+        return Status(StatusCode::INTERNAL, "Couldn't run POD NER annotator.");
+      }
+      return Status::OK;
+    });
   }
 
   // Annotate with the vocab annotator.
   const bool vocab_annotations_enabled =
       !is_raw_usecase || is_entity_type_enabled(Collections::Dictionary());
   if (vocab_annotations_enabled && vocab_annotator_ != nullptr &&
-      options.use_vocab_annotator &&
-      !vocab_annotator_->Annotate(context_unicode, detected_text_language_tags,
-                                  options.trigger_dictionary_on_beginner_words,
-                                  candidates)) {
-    return Status(StatusCode::INTERNAL, "Couldn't run vocab annotator.");
+      options.use_vocab_annotator) {
+    sub_annotators.push_back([&]() -> Status {
+      ScopedStage stage(options.stage_timings, "vocab",
+                        &slot_candidates[kVocabSlot]);
+      if (!vocab_annotator_->Annotate(
+              context_unicode, detected_text_language_tags,
+              options.trigger_dictionary_on_beginner_words,
+              &tokenization_cache, &slot_candidates[kVocabSlot])) {
+        return Status(StatusCode::INTERNAL, "Couldn't run vocab annotator.");
+      }
+      return Status::OK;
+    });
   }
 
   // Annotate with the experimental annotator.
-  if (experimental_annotator_ != nullptr &&
-      !experimental_annotator_->Annotate(context_unicode, candidates)) {
-    return Status(StatusCode::INTERNAL, "Couldn't run experimental annotator.");
+  if (experimental_annotator_ != nullptr) {
+    sub_annotators.push_back([&]() -> Status {
+      ScopedStage stage(options.stage_timings, "experimental",
+                        &slot_candidates[kExperimentalSlot]);
+      if (!experimental_annotator_->Annotate(
+              context_unicode, &slot_candidates[kExperimentalSlot])) {
+        return Status(StatusCode::INTERNAL,
+                      "Couldn't run experimental annotator.");
+      }
+      return Status::OK;
+    });
+  }
+
+  if (task_runner_ != nullptr && sub_annotators.size() > 1) {
+    std::vector<Status> statuses(sub_annotators.size());
+    std::vector<std::function<void()>> tasks;
+    tasks.reserve(sub_annotators.size());
+    for (int i = 0; i < sub_annotators.size(); i++) {
+      tasks.push_back([&sub_annotators, &statuses, i]() {
+        statuses[i] = sub_annotators[i]();
+      });
+    }
+    task_runner_->RunAll(tasks);
+    for (const Status& status : statuses) {
+      TC3_RETURN_IF_ERROR(status);
+    }
+  } else {
+    for (const std::function<Status()>& sub_annotator : sub_annotators) {
+      TC3_RETURN_IF_ERROR(sub_annotator());
+    }
+  }
+
+  for (std::vector<AnnotatedSpan>& candidates_of_slot : slot_candidates) {
+    candidates->insert(candidates->end(),
+                       std::make_move_iterator(candidates_of_slot.begin()),
+                       std::make_move_iterator(candidates_of_slot.end()));
   }
 
   // Sort candidates according to their position in the input, so that the next
@@ -2331,10 +2717,14 @@ Status Annotator::AnnotateSingleInput(
             });
 
   std::vector<int> candidate_indices;
-  if (!ResolveConflicts(*candidates, context, tokens,
-                        detected_text_language_tags, options,
-                        &interpreter_manager, &candidate_indices)) {
-    return Status(StatusCode::INTERNAL, "Couldn't resolve conflicts.");
+  {
+    ScopedStage stage(options.stage_timings, "conflict_resolution",
+                      &candidate_indices);
+    if (!ResolveConflicts(*candidates, context, tokens,
+                          detected_text_language_tags, options,
+                          interpreter_manager, &candidate_indices)) {
+      return Status(StatusCode::INTERNAL, "Couldn't resolve conflicts.");
+    }
   }
 
   // Remove candidates that overlap exactly and have the same collection.
@@ -2423,6 +2813,20 @@ StatusOr<Annotations> Annotator::AnnotateStructuredInput(
     return annotation_candidates;
   }
 
+  if (text_to_annotate.empty()) {
+    return annotation_candidates;
+  }
+
+  // The options are shared by all the fragments, and so are the interpreters.
+  std::vector<Locale> detected_text_language_tags;
+  const Status prepare_status =
+      PrepareAnnotation(options, &detected_text_language_tags);
+  if (!prepare_status.ok()) {
+    return prepare_status;
+  }
+  InterpreterManager interpreter_manager(
+      selection_interpreter_pool_.get(), classification_interpreter_pool_.get());
+
   // Other annotators run on each fragment independently.
   for (int i = 0; i < text_to_annotate.size(); ++i) {
     AnnotationOptions annotation_options = options;
@@ -2438,9 +2842,11 @@ StatusOr<Annotations> Annotator::AnnotateStructuredInput(
     AddContactMetadataToKnowledgeClassificationResults(
         &annotation_candidates.annotated_spans[i]);
 
-    Status annotation_status =
-        AnnotateSingleInput(text_to_annotate[i], annotation_options,
-                            &annotation_candidates.annotated_spans[i]);
+    Status annotation_status = AnnotateSingleInput(
+        text_to_annotate[i], annotation_options, detected_text_language_tags,
+        &interpreter_manager, /*model_tokens=*/nullptr,
+        /*model_annotations=*/nullptr,
+        &annotation_candidates.annotated_spans[i]);
     if (!annotation_status.ok()) {
       return annotation_status;
     }
@@ -2474,6 +2880,173 @@ std::vector<AnnotatedSpan> Annotator::Annotate(
   return annotations.ValueOrDie().annotated_spans[0];
 }
 
+StatusOr<std::vector<std::vector<AnnotatedSpan>>> Annotator::AnnotateBatch(
+    const std::vector<std::string>& texts, const AnnotationOptions& options,
+    TaskRunner* task_runner) const {
+  if (!initialized_) {
+    return Status(StatusCode::FAILED_PRECONDITION, "Not initialized.");
+  }
+
+  std::vector<std::vector<AnnotatedSpan>> results(texts.size());
+  std::vector<int> text_indices;
+  text_indices.reserve(texts.size());
+  for (int i = 0; i < texts.size(); ++i) {
+    if (texts[i].size() > std::numeric_limits<int>::max()) {
+      TC3_LOG(ERROR) << "Rejecting too long input.";
+      continue;
+    }
+    if (!unilib_->IsValidUtf8(
+            UTF8ToUnicodeText(texts[i], /*do_copy=*/false))) {
+      TC3_LOG(ERROR) << "Rejecting input, invalid UTF8.";
+      continue;
+    }
+    text_indices.push_back(i);
+  }
+  if (text_indices.empty()) {
+    return results;
+  }
+
+  // Same as in AnnotateStructuredInput(), requests only for knowledge entities
+  // skip all the other annotators.
+  const bool knowledge_only =
+      options.annotation_usecase == ANNOTATION_USECASE_RAW &&
+      options.entity_types.size() == 1 &&
+      *options.entity_types.begin() == Collections::Entity();
+  std::vector<Locale> detected_text_language_tags;
+  if (!knowledge_only) {
+    const Status prepare_status =
+        PrepareAnnotation(options, &detected_text_language_tags);
+    if (!prepare_status.ok()) {
+      return prepare_status;
+    }
+  }
+
+  const int num_shards =
+      task_runner == nullptr
+          ? 1
+          : std::max(1, std::min(task_runner->NumWorkers(),
+                                 static_cast<int>(text_indices.size())));
+  if (num_shards == 1) {
+    const Status status =
+        AnnotateBatchShard(texts, text_indices, options,
+                           detected_text_language_tags, &results);
+    if (!status.ok()) {
+      return status;
+    }
+    return results;
+  }
+
+  // Split the texts into contiguous shards of (almost) the same size, and
+  // annotate each of them in its own task.
+  std::vector<std::vector<int>> shard_text_indices(num_shards);
+  for (int i = 0; i < text_indices.size(); ++i) {
+    shard_text_indices[static_cast<int64>(i) * num_shards /
+                       text_indices.size()]
+        .push_back(text_indices[i]);
+  }
+  std::vector<Status> shard_statuses(num_shards);
+  std::vector<std::function<void()>> tasks;
+  tasks.reserve(num_shards);
+  for (int shard = 0; shard < num_shards; ++shard) {
+    tasks.push_back([this, &texts, &shard_text_indices, &options,
+                     &detected_text_language_tags, &results, &shard_statuses,
+                     shard]() {
+      // Each shard only writes the results of its own texts.
+      shard_statuses[shard] = AnnotateBatchShard(
+          texts, shard_text_indices[shard], options,
+          detected_text_language_tags, &results);
+    });
+  }
+  task_runner->RunAll(tasks);
+
+  for (const Status& status : shard_statuses) {
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  return results;
+}
+
+Status Annotator::AnnotateBatchShard(
+    const std::vector<std::string>& texts,
+    const std::vector<int>& text_indices, const AnnotationOptions& options,
+    const std::vector<Locale>& detected_text_language_tags,
+    std::vector<std::vector<AnnotatedSpan>>* results) const {
+  // Bounds the memory used by the cached features of the texts whose chunk
+  // candidates are scored together.
+  constexpr int kMaxTextsPerModelBatch = 64;
+
+  InterpreterManager interpreter_manager(
+      selection_interpreter_pool_.get(), classification_interpreter_pool_.get());
+  const bool model_annotations_enabled = ModelAnnotationsEnabled(options);
+  const bool knowledge_only =
+      options.annotation_usecase == ANNOTATION_USECASE_RAW &&
+      options.entity_types.size() == 1 &&
+      *options.entity_types.begin() == Collections::Entity();
+
+  for (int batch_start = 0; batch_start < text_indices.size();
+       batch_start += kMaxTextsPerModelBatch) {
+    const int batch_end =
+        std::min(batch_start + kMaxTextsPerModelBatch,
+                 static_cast<int>(text_indices.size()));
+
+    std::vector<const std::string*> contexts;
+    for (int i = batch_start; i < batch_end; ++i) {
+      contexts.push_back(&texts[text_indices[i]]);
+    }
+    std::vector<std::vector<Token>> model_tokens(contexts.size());
+    std::vector<std::vector<AnnotatedSpan>> model_annotations(contexts.size());
+    if (model_annotations_enabled && !knowledge_only &&
+        !ModelAnnotate(contexts, detected_text_language_tags, options,
+                       &interpreter_manager, &model_tokens,
+                       &model_annotations)) {
+      return Status(StatusCode::INTERNAL, "Couldn't run ModelAnnotate.");
+    }
+
+    for (int i = 0; i < contexts.size(); ++i) {
+      std::vector<AnnotatedSpan>* candidates =
+          &(*results)[text_indices[batch_start + i]];
+
+      // Same as Annotate(), the knowledge engine sees each text on its own.
+      if (knowledge_engine_) {
+        Annotations knowledge_candidates;
+        knowledge_candidates.annotated_spans.resize(1);
+        if (!knowledge_engine_
+                 ->ChunkMultipleSpans({*contexts[i]}, {FragmentMetadata()},
+                                      options.annotation_usecase,
+                                      options.location_context,
+                                      options.permissions,
+                                      options.annotate_mode,
+                                      &knowledge_candidates)
+                 .ok()) {
+          return Status(StatusCode::INTERNAL,
+                        "Couldn't run knowledge engine Chunk.");
+        }
+        if (knowledge_candidates.annotated_spans.size() != 1) {
+          return Status(StatusCode::INTERNAL,
+                        "Number of annotation candidates differs from "
+                        "number of texts to annotate.");
+        }
+        *candidates = std::move(knowledge_candidates.annotated_spans[0]);
+      }
+      if (knowledge_only) {
+        continue;
+      }
+
+      AddContactMetadataToKnowledgeClassificationResults(candidates);
+
+      const Status status = AnnotateSingleInput(
+          *contexts[i], options, detected_text_language_tags,
+          &interpreter_manager, &model_tokens[i], &model_annotations[i],
+          candidates);
+      if (!status.ok()) {
+        return status;
+      }
+    }
+  }
+  return Status::OK;
+}
+
 CodepointSpan Annotator::ComputeSelectionBoundaries(
     const UniLib::RegexMatcher* match,
     const RegexModel_::Pattern* config) const {
@@ -2822,6 +3395,18 @@ bool Annotator::RegexChunk(const UnicodeText& context_unicode,
                            const EnabledEntityTypes& enabled_entity_types,
                            const AnnotationUsecase& annotation_usecase,
                            std::vector<AnnotatedSpan>* result) const {
+  // Find the patterns that can match in a single pass over the text, to only
+  // run the matchers of those.
+  std::vector<bool> is_candidate_pattern;
+  if (regex_prefilter_ != nullptr && !rules.empty()) {
+    is_candidate_pattern =
+        regex_prefilter_->FindCandidatePatterns(context_unicode);
+  }
+
+  // A view of the context for the match verifiers.
+  const StringPiece context_utf8(context_unicode.data(),
+                                 context_unicode.size_bytes());
+
   for (int pattern_id : rules) {
     const CompiledRegexPattern& regex_pattern = regex_patterns_[pattern_id];
     if (!enabled_entity_types(regex_pattern.config->collection_name()->str()) &&
@@ -2829,6 +3414,9 @@ bool Annotator::RegexChunk(const UnicodeText& context_unicode,
       // No regex annotation type has been requested, skip regex annotation.
       continue;
     }
+    if (!is_candidate_pattern.empty() && !is_candidate_pattern[pattern_id]) {
+      continue;
+    }
     const auto matcher = regex_pattern.pattern->Matcher(context_unicode);
     if (!matcher) {
       TC3_LOG(ERROR) << "Could not get regex matcher for pattern: "
@@ -2836,13 +3424,19 @@ bool Annotator::RegexChunk(const UnicodeText& context_unicode,
       return false;
     }
 
+    const VerificationOptions* verification_options =
+        regex_pattern.config->verification_options();
     int status = UniLib::RegexMatcher::kNoError;
     while (matcher->Find(&status) && status == UniLib::RegexMatcher::kNoError) {
-      if (regex_pattern.config->verification_options()) {
-        if (!VerifyRegexMatchCandidate(
-                context_unicode.ToUTF8String(),
-                regex_pattern.config->verification_options(),
-                matcher->Group(1, &status).ToUTF8String(), matcher.get())) {
+      if (verification_options) {
+        // Only the checksum verification looks at the matched text, so don't
+        // extract it otherwise.
+        const std::string match_text =
+            verification_options->verify_luhn_checksum()
+                ? matcher->Group(1, &status).ToUTF8String()
+                : std::string();
+        if (!VerifyRegexMatchCandidate(context_utf8, verification_options,
+                                       match_text, matcher.get())) {
           continue;
         }
       }
@@ -2895,22 +3489,11 @@ bool Annotator::ModelChunk(int num_tokens, const TokenSpan& span_of_interest,
                            tflite::Interpreter* selection_interpreter,
                            const CachedFeatures& cached_features,
                            std::vector<TokenSpan>* chunks) const {
-  const int max_selection_span =
-      selection_feature_processor_->GetOptions()->max_selection_span();
-  // The inference span is the span of interest expanded to include
-  // max_selection_span tokens on either side, which is how far a selection can
-  // stretch from the click.
   const TokenSpan inference_span =
-      IntersectTokenSpans(span_of_interest.Expand(
-                              /*num_tokens_left=*/max_selection_span,
-                              /*num_tokens_right=*/max_selection_span),
-                          {0, num_tokens});
+      ChunkInferenceSpan(num_tokens, span_of_interest);
 
   std::vector<ScoredChunk> scored_chunks;
-  if (selection_feature_processor_->GetOptions()->bounds_sensitive_features() &&
-      selection_feature_processor_->GetOptions()
-          ->bounds_sensitive_features()
-          ->enabled()) {
+  if (UsesBoundsSensitiveSelectionFeatures()) {
     if (!ModelBoundsSensitiveScoreChunks(
             num_tokens, span_of_interest, inference_span, cached_features,
             selection_interpreter, &scored_chunks)) {
@@ -2923,7 +3506,35 @@ bool Annotator::ModelChunk(int num_tokens, const TokenSpan& span_of_interest,
       return false;
     }
   }
-  std::sort(scored_chunks.rbegin(), scored_chunks.rend(),
+  SelectNonOverlappingChunks(inference_span, &scored_chunks, chunks);
+  return true;
+}
+
+TokenSpan Annotator::ChunkInferenceSpan(
+    int num_tokens, const TokenSpan& span_of_interest) const {
+  const int max_selection_span =
+      selection_feature_processor_->GetOptions()->max_selection_span();
+  // The inference span is the span of interest expanded to include
+  // max_selection_span tokens on either side, which is how far a selection can
+  // stretch from the click.
+  return IntersectTokenSpans(span_of_interest.Expand(
+                                 /*num_tokens_left=*/max_selection_span,
+                                 /*num_tokens_right=*/max_selection_span),
+                             {0, num_tokens});
+}
+
+bool Annotator::UsesBoundsSensitiveSelectionFeatures() const {
+  return selection_feature_processor_->GetOptions()
+             ->bounds_sensitive_features() &&
+         selection_feature_processor_->GetOptions()
+             ->bounds_sensitive_features()
+             ->enabled();
+}
+
+void Annotator::SelectNonOverlappingChunks(
+    const TokenSpan& inference_span, std::vector<ScoredChunk>* scored_chunks,
+    std::vector<TokenSpan>* chunks) const {
+  std::sort(scored_chunks->rbegin(), scored_chunks->rend(),
             [](const ScoredChunk& lhs, const ScoredChunk& rhs) {
               return lhs.score < rhs.score;
             });
@@ -2933,7 +3544,7 @@ bool Annotator::ModelChunk(int num_tokens, const TokenSpan& span_of_interest,
   // chunks.
   std::vector<bool> token_used(inference_span.Size());
   chunks->clear();
-  for (const ScoredChunk& scored_chunk : scored_chunks) {
+  for (const ScoredChunk& scored_chunk : *scored_chunks) {
     bool feasible = true;
     for (int i = scored_chunk.token_span.first;
          i < scored_chunk.token_span.second; ++i) {
@@ -2956,8 +3567,6 @@ bool Annotator::ModelChunk(int num_tokens, const TokenSpan& span_of_interest,
   }
 
   std::sort(chunks->begin(), chunks->end());
-
-  return true;
 }
 
 namespace {
@@ -3050,6 +3659,24 @@ bool Annotator::ModelBoundsSensitiveScoreChunks(
     const TokenSpan& inference_span, const CachedFeatures& cached_features,
     tflite::Interpreter* selection_interpreter,
     std::vector<ScoredChunk>* scored_chunks) const {
+  scored_chunks->clear();
+  std::vector<TokenSpan> candidate_spans;
+  BoundsSensitiveChunkCandidates(span_of_interest, inference_span,
+                                 scored_chunks, &candidate_spans);
+
+  std::vector<ChunkCandidate> candidates;
+  candidates.reserve(candidate_spans.size());
+  for (const TokenSpan& candidate_span : candidate_spans) {
+    candidates.push_back(
+        ChunkCandidate{candidate_span, &cached_features, scored_chunks});
+  }
+  return ScoreChunkCandidates(candidates, selection_interpreter);
+}
+
+void Annotator::BoundsSensitiveChunkCandidates(
+    const TokenSpan& span_of_interest, const TokenSpan& inference_span,
+    std::vector<ScoredChunk>* scored_chunks,
+    std::vector<TokenSpan>* candidate_spans) const {
   const int max_selection_span =
       selection_feature_processor_->GetOptions()->max_selection_span();
   const int max_chunk_length = selection_feature_processor_->GetOptions()
@@ -3061,9 +3688,8 @@ bool Annotator::ModelBoundsSensitiveScoreChunks(
           ->bounds_sensitive_features()
           ->score_single_token_spans_as_zero();
 
-  scored_chunks->clear();
   if (score_single_token_spans_as_zero) {
-    scored_chunks->reserve(span_of_interest.Size());
+    scored_chunks->reserve(scored_chunks->size() + span_of_interest.Size());
   }
 
   // Prepare all chunk candidates into one batch:
@@ -3071,7 +3697,6 @@ bool Annotator::ModelBoundsSensitiveScoreChunks(
   //   - Have a non-empty intersection with the span of interest
   //   - Are at least one token long
   //   - Are not longer than the maximum chunk length
-  std::vector<TokenSpan> candidate_spans;
   for (int start = inference_span.first; start < span_of_interest.second;
        ++start) {
     const int leftmost_end_index = std::max(start, span_of_interest.first) + 1;
@@ -3084,31 +3709,35 @@ bool Annotator::ModelBoundsSensitiveScoreChunks(
         // for it directly to the output.
         scored_chunks->push_back(ScoredChunk{candidate_span, 0.0f});
       } else {
-        candidate_spans.push_back(candidate_span);
+        candidate_spans->push_back(candidate_span);
       }
     }
   }
+}
 
+bool Annotator::ScoreChunkCandidates(
+    const std::vector<ChunkCandidate>& candidates,
+    tflite::Interpreter* selection_interpreter) const {
   const int max_batch_size = model_->selection_options()->batch_size();
 
   std::vector<float> all_features;
-  scored_chunks->reserve(scored_chunks->size() + candidate_spans.size());
-  for (int batch_start = 0; batch_start < candidate_spans.size();
+  for (int batch_start = 0; batch_start < candidates.size();
        batch_start += max_batch_size) {
     const int batch_end = std::min(batch_start + max_batch_size,
-                                   static_cast<int>(candidate_spans.size()));
+                                   static_cast<int>(candidates.size()));
 
     // Prepare features for the whole batch.
+    const int features_size =
+        candidates[batch_start].cached_features->OutputFeaturesSize();
     all_features.clear();
-    all_features.reserve(max_batch_size * cached_features.OutputFeaturesSize());
+    all_features.reserve(max_batch_size * features_size);
     for (int i = batch_start; i < batch_end; ++i) {
-      cached_features.AppendBoundsSensitiveFeaturesForSpan(candidate_spans[i],
-                                                           &all_features);
+      candidates[i].cached_features->AppendBoundsSensitiveFeaturesForSpan(
+          candidates[i].token_span, &all_features);
     }
 
     // Run batched inference.
     const int batch_size = batch_end - batch_start;
-    const int features_size = cached_features.OutputFeaturesSize();
     TensorView<float> logits = selection_executor_->ComputeLogits(
         TensorView<float>(all_features.data(), {batch_size, features_size}),
         selection_interpreter);
@@ -3124,8 +3753,8 @@ bool Annotator::ModelBoundsSensitiveScoreChunks(
 
     // Save results.
     for (int i = batch_start; i < batch_end; ++i) {
-      scored_chunks->push_back(
-          ScoredChunk{candidate_spans[i], logits.data()[i - batch_start]});
+      candidates[i].scored_chunks->push_back(ScoredChunk{
+          candidates[i].token_span, logits.data()[i - batch_start]});
     }
   }
 
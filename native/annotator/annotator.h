@@ -47,10 +47,14 @@
 #include "utils/base/status.h"
 #include "utils/base/statusor.h"
 #include "utils/calendar/calendar.h"
+#include "utils/container/object-pool.h"
 #include "utils/flatbuffers/flatbuffers.h"
 #include "utils/flatbuffers/mutable.h"
 #include "utils/i18n/locale.h"
 #include "utils/memory/mmap.h"
+#include "utils/regex-prefilter.h"
+#include "utils/strings/stringpiece.h"
+#include "utils/task-runner.h"
 #include "utils/utf8/unicodetext.h"
 #include "utils/utf8/unilib.h"
 #include "utils/zlib/zlib.h"
@@ -58,6 +62,9 @@
 
 namespace libtextclassifier3 {
 
+// Pool of warm TFLite interpreters shared by concurrent requests.
+using InterpreterPool = ObjectPool<tflite::Interpreter>;
+
 // Holds TFLite interpreters for selection and classification models.
 // NOTE: This class is not thread-safe, thus should NOT be re-used across
 // threads.
@@ -71,6 +78,18 @@ class InterpreterManager {
       : selection_executor_(selection_executor),
         classification_executor_(classification_executor) {}
 
+  // Like above, but checks the interpreters out of the given pools instead of
+  // creating them, and returns them to the pools on destruction.
+  InterpreterManager(InterpreterPool* selection_pool,
+                     InterpreterPool* classification_pool)
+      : selection_pool_(selection_pool),
+        classification_pool_(classification_pool) {}
+
+  ~InterpreterManager();
+
+  InterpreterManager(const InterpreterManager&) = delete;
+  InterpreterManager& operator=(const InterpreterManager&) = delete;
+
   // Gets or creates and caches an interpreter for the selection model.
   tflite::Interpreter* SelectionInterpreter();
 
@@ -78,8 +97,10 @@ class InterpreterManager {
   tflite::Interpreter* ClassificationInterpreter();
 
  private:
-  const ModelExecutor* selection_executor_;
-  const ModelExecutor* classification_executor_;
+  const ModelExecutor* selection_executor_ = nullptr;
+  const ModelExecutor* classification_executor_ = nullptr;
+  InterpreterPool* selection_pool_ = nullptr;
+  InterpreterPool* classification_pool_ = nullptr;
 
   std::unique_ptr<tflite::Interpreter> selection_interpreter_;
   std::unique_ptr<tflite::Interpreter> classification_interpreter_;
@@ -104,7 +125,11 @@ class EnabledEntityTypes {
 
 // A text processing model that provides text classification, annotation,
 // selection suggestion for various types.
-// NOTE: This class is not thread-safe.
+// NOTE: Once initialized, a single instance can be shared between threads: the
+// const annotation methods check warm TFLite interpreters out of a bounded pool
+// per request. The Initialize*(), SetLangId(), SetTaskRunner() and
+// EnableTokenEmbeddingCache() methods are not thread-safe and need to be
+// called before the instance is shared.
 class Annotator {
  public:
   static std::unique_ptr<Annotator> FromUnownedBuffer(
@@ -178,6 +203,24 @@ class Annotator {
   // Sets up the lang-id instance that should be used.
   bool SetLangId(const libtextclassifier3::mobile::lang_id::LangId* lang_id);
 
+  // Sets up a task runner on which the annotation of a single input runs the
+  // independent sub-annotators (model, regex, datetime, number, ...)
+  // concurrently, and the POD NER annotator also runs the sliding windows of
+  // long inputs on it. The result is the same as with the sequential execution,
+  // which is used by default or when `task_runner` is null.
+  // The task runner is not owned and needs to outlive the annotator. With the
+  // Java-backed UniLib and CalendarLib, its threads need to be attached to the
+  // JVM.
+  void SetTaskRunner(TaskRunner* task_runner) { task_runner_ = task_runner; }
+
+  // Enables caching the embeddings of the model's tokens across calls, keyed
+  // by the token text, for up to `max_num_entries` distinct tokens per feature
+  // processor. Returns false if the model has no feature processors.
+  bool EnableTokenEmbeddingCache(int max_num_entries);
+
+  // Returns the hit and miss counts of the token embedding caches.
+  TokenEmbeddingCache::Stats GetTokenEmbeddingCacheStats() const;
+
   // Runs inference for given a context and current selection (i.e. index
   // of the first and one past last selected characters (utf8 codepoint
   // offsets)). Returns the indices (utf8 codepoint offsets) of the selection
@@ -216,6 +259,18 @@ class Annotator {
       const std::string& context,
       const AnnotationOptions& options = AnnotationOptions()) const;
 
+  // Annotates a batch of independent texts with the same options. The result
+  // for each text is the same as the one of Annotate(), but the per-request
+  // setup (option parsing, TFLite interpreters) is shared by the whole batch
+  // and the selection model scores the chunk candidates of several texts in
+  // shared, batched TFLite invocations.
+  // If a task runner is given, the batch is split into shards that are
+  // annotated in parallel on it.
+  StatusOr<std::vector<std::vector<AnnotatedSpan>>> AnnotateBatch(
+      const std::vector<std::string>& texts,
+      const AnnotationOptions& options = AnnotationOptions(),
+      TaskRunner* task_runner = nullptr) const;
+
   // Looks up a knowledge entity by its id. Returns the serialized knowledge
   // result.
   StatusOr<std::string> LookUpKnowledgeEntity(const std::string& id) const;
@@ -356,6 +411,18 @@ class Annotator {
                      std::vector<Token>* tokens,
                      std::vector<AnnotatedSpan>* result) const;
 
+  // Same as above, but for several contexts at once. The chunk candidates of
+  // all the contexts are scored by the selection model in shared batches.
+  // The tokens and annotations of the i-th context are appended to the i-th
+  // element of 'tokens' and 'results', which need to have the same size as
+  // 'contexts'.
+  bool ModelAnnotate(const std::vector<const std::string*>& contexts,
+                     const std::vector<Locale>& detected_text_language_tags,
+                     const AnnotationOptions& options,
+                     InterpreterManager* interpreter_manager,
+                     std::vector<std::vector<Token>>* tokens,
+                     std::vector<std::vector<AnnotatedSpan>>* results) const;
+
   // Groups the tokens into chunks. A chunk is a token span that should be the
   // suggested selection when any of its contained tokens is clicked. The chunks
   // are non-overlapping and are sorted by their position in the context string.
@@ -370,6 +437,20 @@ class Annotator {
                   const CachedFeatures& cached_features,
                   std::vector<TokenSpan>* chunks) const;
 
+  // Returns the span of tokens that can be part of a chunk touching the given
+  // span of interest.
+  TokenSpan ChunkInferenceSpan(int num_tokens,
+                               const TokenSpan& span_of_interest) const;
+
+  // Greedily picks the highest scoring non-overlapping chunks. Helper for
+  // ModelChunk().
+  void SelectNonOverlappingChunks(const TokenSpan& inference_span,
+                                  std::vector<ScoredChunk>* scored_chunks,
+                                  std::vector<TokenSpan>* chunks) const;
+
+  // Returns whether the selection model uses bounds-sensitive features.
+  bool UsesBoundsSensitiveSelectionFeatures() const;
+
   // A helper method for ModelChunk(). It generates scored chunk candidates for
   // a click context model.
   // NOTE: The returned chunks can (and most likely do) overlap.
@@ -388,6 +469,28 @@ class Annotator {
       tflite::Interpreter* selection_interpreter,
       std::vector<ScoredChunk>* scored_chunks) const;
 
+  // Enumerates the chunk candidates for the bounds-sensitive model. Candidates
+  // that don't need to be scored by the model are added to 'scored_chunks'
+  // directly, the others to 'candidate_spans'.
+  void BoundsSensitiveChunkCandidates(
+      const TokenSpan& span_of_interest, const TokenSpan& inference_span,
+      std::vector<ScoredChunk>* scored_chunks,
+      std::vector<TokenSpan>* candidate_spans) const;
+
+  // A chunk candidate waiting to be scored by the bounds-sensitive model.
+  struct ChunkCandidate {
+    TokenSpan token_span;
+    const CachedFeatures* cached_features;
+    std::vector<ScoredChunk>* scored_chunks;
+  };
+
+  // Scores the chunk candidates with the bounds-sensitive model, in batches of
+  // up to the model's batch size. The candidates can come from different lines
+  // or texts; each scored chunk is appended to the 'scored_chunks' of its
+  // candidate, in the order of the candidates.
+  bool ScoreChunkCandidates(const std::vector<ChunkCandidate>& candidates,
+                            tflite::Interpreter* selection_interpreter) const;
+
   // Produces chunks isolated by a set of regular expressions.
   bool RegexChunk(const UnicodeText& context_unicode,
                   const std::vector<int>& rules,
@@ -435,10 +538,11 @@ class Annotator {
       const std::vector<ClassificationResult>& classification) const;
 
   // Verifies a regex match and returns true if verification was successful.
+  // `context` and `match` are only viewed, so that verifying the matches of a
+  // long text doesn't copy it for every match.
   bool VerifyRegexMatchCandidate(
-      const std::string& context,
-      const VerificationOptions* verification_options, const std::string& match,
-      const UniLib::RegexMatcher* matcher) const;
+      StringPiece context, const VerificationOptions* verification_options,
+      StringPiece match, const UniLib::RegexMatcher* matcher) const;
 
   const Model* model_;
 
@@ -446,8 +550,14 @@ class Annotator {
   std::unique_ptr<const ModelExecutor> classification_executor_;
   std::unique_ptr<const EmbeddingExecutor> embedding_executor_;
 
-  std::unique_ptr<const FeatureProcessor> selection_feature_processor_;
-  std::unique_ptr<const FeatureProcessor> classification_feature_processor_;
+  // Idle interpreters for the selection and classification models, shared by
+  // all threads. Declared after the executors, so that they are destroyed
+  // first.
+  std::unique_ptr<InterpreterPool> selection_interpreter_pool_;
+  std::unique_ptr<InterpreterPool> classification_interpreter_pool_;
+
+  std::unique_ptr<FeatureProcessor> selection_feature_processor_;
+  std::unique_ptr<FeatureProcessor> classification_feature_processor_;
 
   std::unique_ptr<const grammar::Analyzer> analyzer_;
   std::unique_ptr<const DatetimeGrounder> datetime_grounder_;
@@ -470,14 +580,39 @@ class Annotator {
       const EnabledEntityTypes& is_entity_type_enabled,
       std::vector<AnnotatedSpan>* annotated_spans) const;
 
+  // Checks that the model supports the annotation request, and parses the
+  // detected text language tags from the options.
+  Status PrepareAnnotation(
+      const AnnotationOptions& options,
+      std::vector<Locale>* detected_text_language_tags) const;
+
+  // Returns whether the ML model needs to run for the given request.
+  bool ModelAnnotationsEnabled(const AnnotationOptions& options) const;
+
   // Runs only annotators that do not support structured input. Does conflict
   // resolution, removal of disallowed entities and sorting on both new
   // generated candidates and passed in entities.
+  // The language tags come from PrepareAnnotation(), and the interpreters are
+  // shared by all the inputs of the request. If 'model_tokens' and
+  // 'model_annotations' are given, they hold the already computed results of
+  // ModelAnnotate for the context (and are consumed), otherwise the ML model
+  // is run here.
   // Returns Status::Error if the annotation failed, in which case the vector of
   // candidates should be ignored.
-  Status AnnotateSingleInput(const std::string& context,
-                             const AnnotationOptions& options,
-                             std::vector<AnnotatedSpan>* candidates) const;
+  Status AnnotateSingleInput(
+      const std::string& context, const AnnotationOptions& options,
+      const std::vector<Locale>& detected_text_language_tags,
+      InterpreterManager* interpreter_manager,
+      std::vector<Token>* model_tokens,
+      std::vector<AnnotatedSpan>* model_annotations,
+      std::vector<AnnotatedSpan>* candidates) const;
+
+  // Annotates the texts with the given indices for AnnotateBatch().
+  Status AnnotateBatchShard(
+      const std::vector<std::string>& texts,
+      const std::vector<int>& text_indices, const AnnotationOptions& options,
+      const std::vector<Locale>& detected_text_language_tags,
+      std::vector<std::vector<AnnotatedSpan>>* results) const;
 
   // Parses the money amount into whole and decimal part and fills in the
   // entity data information.
@@ -522,6 +657,10 @@ class Annotator {
   std::vector<int> annotation_regex_patterns_, classification_regex_patterns_,
       selection_regex_patterns_;
 
+  // Rules out the regex patterns that cannot match a text, indexed like
+  // regex_patterns_.
+  std::unique_ptr<const RegexPrefilter> regex_prefilter_;
+
   const UniLib* unilib_;
   const CalendarLib* calendarlib_;
 
@@ -555,6 +694,9 @@ class Annotator {
   // Model for language identification.
   const libtextclassifier3::mobile::lang_id::LangId* lang_id_ = nullptr;
 
+  // Runs the sub-annotators of Annotate() concurrently, if set. Not owned.
+  TaskRunner* task_runner_ = nullptr;
+
   // If true, will prioritize the longest annotation during conflict resolution.
   bool prioritize_longest_annotation_ = false;
 
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "annotator/annotator.h"
+#include "annotator/types.h"
+#include "utils/base/logging.h"
+#include "utils/jvm-test-utils.h"
+#include "utils/testing/benchmark-utils.h"
+#include "utils/utf8/unicodetext.h"
+#include "benchmark/benchmark.h"
+
+namespace libtextclassifier3 {
+namespace {
+
+// Returns the annotator for a shipped model, e.g. "en". The annotators are
+// created once and shared by the benchmarks and their threads.
+const Annotator& GetAnnotator(const std::string& model_name) {
+  static std::mutex* mutex = new std::mutex;
+  static auto* annotators =
+      new std::map<std::string, std::unique_ptr<Annotator>>;
+  std::lock_guard<std::mutex> lock(*mutex);
+  std::unique_ptr<Annotator>& annotator = (*annotators)[model_name];
+  if (annotator == nullptr) {
+    annotator = Annotator::FromPath(
+        GetBenchmarkDataPath("models/textclassifier." + model_name + ".model"),
+        CreateUniLibForTesting(), CreateCalendarLibForTesting());
+    TC3_CHECK(annotator != nullptr) << "Couldn't load " << model_name;
+  }
+  return *annotator;
+}
+
+void SetLocalesAndReferenceTime(BaseOptions* base_options,
+                                DatetimeOptions* datetime_options) {
+  base_options->locales = "en";
+  datetime_options->reference_time_ms_utc = 1570000000000;
+  datetime_options->reference_timezone = "Europe/Zurich";
+}
+
+AnnotationOptions MakeAnnotationOptions() {
+  AnnotationOptions options;
+  SetLocalesAndReferenceTime(&options, &options);
+  return options;
+}
+
+// Arguments: script, text length in codepoints.
+void BM_Annotate(benchmark::State& state, const std::string& model_name) {
+  const Annotator& annotator = GetAnnotator(model_name);
+  const BenchmarkScript script = static_cast<BenchmarkScript>(state.range(0));
+  const std::string text = GenerateText(script, state.range(1));
+  const AnnotationOptions options = MakeAnnotationOptions();
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(annotator.Annotate(text, options));
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+  state.SetLabel(BenchmarkScriptName(script));
+}
+BENCHMARK_CAPTURE(BM_Annotate, en, "en")
+    ->ArgsProduct({{static_cast<int>(BenchmarkScript::kLatin)},
+                   benchmark::CreateRange(64, 16384, /*multi=*/4)});
+BENCHMARK_CAPTURE(BM_Annotate, universal, "universal")
+    ->ArgsProduct({{static_cast<int>(BenchmarkScript::kLatin),
+                    static_cast<int>(BenchmarkScript::kCyrillic),
+                    static_cast<int>(BenchmarkScript::kArabic),
+                    static_cast<int>(BenchmarkScript::kHan),
+                    static_cast<int>(BenchmarkScript::kMixed)},
+                   {256, 4096}});
+BENCHMARK_CAPTURE(BM_Annotate, en, "en")
+    ->Args({static_cast<int>(BenchmarkScript::kLatin), 1024})
+    ->Apply(ReportLatencyPercentiles);
+
+// Text that is dense with entities, such as logs, produces large groups of
+// conflicting candidates. The latency should grow about linearly with the
+// length of the text.
+// Arguments: number of lines of the text.
+void BM_AnnotateDenseEntities(benchmark::State& state) {
+  const Annotator& annotator = GetAnnotator("en");
+  const std::string text = GenerateDenseEntityText(state.range(0));
+  const AnnotationOptions options = MakeAnnotationOptions();
+
+  int num_annotations = 0;
+  for (auto _ : state) {
+    num_annotations = annotator.Annotate(text, options).size();
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+  state.counters["annotations"] = num_annotations;
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_AnnotateDenseEntities)
+    ->RangeMultiplier(4)
+    ->Range(1, 256)
+    ->Complexity(benchmark::oN);
+
+// Concurrent requests on one shared annotator.
+void BM_AnnotateMultiThreaded(benchmark::State& state) {
+  const Annotator& annotator = GetAnnotator("en");
+  const std::string text = GenerateDenseEntityText(
+      /*num_lines=*/2, /*seed=*/state.thread_index() + 1);
+  const AnnotationOptions options = MakeAnnotationOptions();
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(annotator.Annotate(text, options));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AnnotateMultiThreaded)->ThreadRange(1, 8)->UseRealTime();
+
+// Surrounds an entity with a context of the given length.
+// Returns the text and the span of the entity.
+std::pair<std::string, CodepointSpan> TextWithEntity(
+    const std::string& entity, const int context_length) {
+  const std::string context = GenerateText(
+      BenchmarkScript::kLatin, /*num_codepoints=*/context_length / 2);
+  const int begin = UTF8ToUnicodeText(context, /*do_copy=*/false).size() + 1;
+  const int end =
+      begin + UTF8ToUnicodeText(entity, /*do_copy=*/false).size();
+  return {context + " " + entity + " " + context, {begin, end}};
+}
+
+// Arguments: length of the context around the entity, in codepoints.
+void BM_ClassifyText(benchmark::State& state) {
+  const Annotator& annotator = GetAnnotator("en");
+  const auto text_and_span =
+      TextWithEntity("call 650-253-0000 tomorrow", state.range(0));
+  ClassificationOptions options;
+  SetLocalesAndReferenceTime(&options, &options);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(annotator.ClassifyText(
+        text_and_span.first, text_and_span.second, options));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ClassifyText)->RangeMultiplier(8)->Range(0, 4096);
+BENCHMARK(BM_ClassifyText)->Arg(256)->Apply(ReportLatencyPercentiles);
+
+// Arguments: length of the context around the clicked entity, in codepoints.
+void BM_SuggestSelection(benchmark::State& state) {
+  const Annotator& annotator = GetAnnotator("en");
+  const auto text_and_span =
+      TextWithEntity("350 Third Street, Cambridge", state.range(0));
+  // Click on "Third".
+  const CodepointSpan click = {text_and_span.second.first + 4,
+                               text_and_span.second.first + 9};
+  SelectionOptions options;
+  options.locales = "en";
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        annotator.SuggestSelection(text_and_span.first, click, options));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SuggestSelection)->RangeMultiplier(8)->Range(0, 4096);
+BENCHMARK(BM_SuggestSelection)->Arg(256)->Apply(ReportLatencyPercentiles);
+
+}  // namespace
+}  // namespace libtextclassifier3
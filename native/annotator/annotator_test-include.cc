@@ -128,6 +128,16 @@ TEST_F(AnnotatorTest, ClassifyText) {
   VerifyClassifyText(classifier.get());
 }
 
+TEST_F(AnnotatorTest, ClassifyTextWithPooledInterpreters) {
+  std::unique_ptr<Annotator> classifier = Annotator::FromPath(
+      GetTestModelPath(), unilib_.get(), calendarlib_.get());
+
+  // The second round runs on the interpreters returned to the pool by the
+  // first one and needs to produce the same results.
+  VerifyClassifyText(classifier.get());
+  VerifyClassifyText(classifier.get());
+}
+
 TEST_F(AnnotatorTest, ClassifyTextLocalesAndDictionary) {
   std::unique_ptr<Annotator> classifier = Annotator::FromPath(
       GetTestModelPath(), unilib_.get(), calendarlib_.get());
@@ -1228,6 +1238,121 @@ TEST_F(AnnotatorTest, Annotate) {
           .empty());
 }
 
+// Runs the tasks sequentially, but pretends to have several workers so that
+// the batch gets sharded.
+class ShardingTaskRunner : public SequentialTaskRunner {
+ public:
+  int NumWorkers() const override { return 3; }
+};
+
+TEST_F(AnnotatorTest, AnnotateBatch) {
+  std::unique_ptr<Annotator> classifier = Annotator::FromPath(
+      GetTestModelPath(), unilib_.get(), calendarlib_.get());
+  ASSERT_TRUE(classifier);
+
+  const std::vector<std::string> texts = {
+      "& saw Barack Obama today .. 350 Third Street, Cambridge\nand my phone "
+      "number is 853 225 3556",
+      "853 225 3556",
+      "853 225 3556\n\xf0\x9f\x98\x8b\x8b",
+      "",
+      "call me at (0845) 100 1000 today",
+      "853 225 3556 and then turn it up 99%, 99 number"};
+
+  for (const bool enable_optimization : {false, true}) {
+    AnnotationOptions options;
+    options.enable_optimization = enable_optimization;
+
+    StatusOr<std::vector<std::vector<AnnotatedSpan>>> batch_result =
+        classifier->AnnotateBatch(texts, options);
+    ASSERT_TRUE(batch_result.ok());
+    ShardingTaskRunner task_runner;
+    StatusOr<std::vector<std::vector<AnnotatedSpan>>> sharded_result =
+        classifier->AnnotateBatch(texts, options, &task_runner);
+    ASSERT_TRUE(sharded_result.ok());
+
+    ASSERT_EQ(batch_result.ValueOrDie().size(), texts.size());
+    ASSERT_EQ(sharded_result.ValueOrDie().size(), texts.size());
+    for (int i = 0; i < texts.size(); ++i) {
+      const std::vector<AnnotatedSpan> expected =
+          classifier->Annotate(texts[i], options);
+      for (const std::vector<AnnotatedSpan>& actual :
+           {batch_result.ValueOrDie()[i], sharded_result.ValueOrDie()[i]}) {
+        ASSERT_EQ(actual.size(), expected.size());
+        for (int j = 0; j < expected.size(); ++j) {
+          EXPECT_EQ(actual[j].span, expected[j].span);
+          EXPECT_EQ(actual[j].classification, expected[j].classification);
+        }
+      }
+    }
+  }
+}
+
+// Runs the tasks on the calling thread, in reverse order.
+class ReversingTaskRunner : public TaskRunner {
+ public:
+  void RunAll(const std::vector<std::function<void()>>& tasks) override {
+    for (auto it = tasks.rbegin(); it != tasks.rend(); ++it) {
+      (*it)();
+    }
+  }
+
+  int NumWorkers() const override { return 2; }
+};
+
+TEST_F(AnnotatorTest, AnnotateWithTaskRunnerIsDeterministic) {
+  std::unique_ptr<Annotator> classifier = Annotator::FromPath(
+      GetTestModelPath(), unilib_.get(), calendarlib_.get());
+  ASSERT_TRUE(classifier);
+
+  AnnotationOptions options;
+  options.entity_types = {"phone", "date", "datetime", "number", "percentage",
+                          "duration", "url", "email"};
+  options.annotation_usecase = ANNOTATION_USECASE_RAW;
+  const std::string text =
+      "call me at (0845) 100 1000 tomorrow at 4pm, it's 99% done in 3 hours "
+      "www.google.com";
+  const std::vector<AnnotatedSpan> expected =
+      classifier->Annotate(text, options);
+
+  ReversingTaskRunner task_runner;
+  classifier->SetTaskRunner(&task_runner);
+  const std::vector<AnnotatedSpan> actual = classifier->Annotate(text, options);
+
+  ASSERT_FALSE(expected.empty());
+  ASSERT_EQ(actual.size(), expected.size());
+  for (int i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(actual[i].span, expected[i].span);
+    EXPECT_EQ(actual[i].classification, expected[i].classification);
+  }
+}
+
+TEST_F(AnnotatorTest, AnnotateWithTokenEmbeddingCacheIsDeterministic) {
+  std::unique_ptr<Annotator> classifier = Annotator::FromPath(
+      GetTestModelPath(), unilib_.get(), calendarlib_.get());
+  ASSERT_TRUE(classifier);
+
+  const std::string text =
+      "call me at (0845) 100 1000 tomorrow at 4pm or at 857 225 3556 at 5pm";
+  const std::vector<AnnotatedSpan> expected = classifier->Annotate(text);
+
+  ASSERT_TRUE(classifier->EnableTokenEmbeddingCache(/*max_num_entries=*/100));
+  for (int i = 0; i < 2; ++i) {
+    const std::vector<AnnotatedSpan> actual = classifier->Annotate(text);
+    ASSERT_FALSE(expected.empty());
+    ASSERT_EQ(actual.size(), expected.size());
+    for (int j = 0; j < expected.size(); ++j) {
+      EXPECT_EQ(actual[j].span, expected[j].span);
+      EXPECT_EQ(actual[j].classification, expected[j].classification);
+    }
+  }
+
+  const TokenEmbeddingCache::Stats stats =
+      classifier->GetTokenEmbeddingCacheStats();
+  EXPECT_GT(stats.hits, 0);
+  EXPECT_GT(stats.misses, 0);
+}
+
 TEST_F(AnnotatorTest, AnnotatesWithBracketStripping) {
   std::unique_ptr<Annotator> classifier = Annotator::FromPath(
       GetTestModelPath(), unilib_.get(), calendarlib_.get());
@@ -2135,6 +2260,30 @@ TEST_F(AnnotatorTest, ResolveConflictsRawModeGeneralOverlapsAllowed) {
   EXPECT_THAT(chosen, ElementsAreArray({0, 1}));
 }
 
+TEST_F(AnnotatorTest, ResolveConflictsLargeGroup) {
+  TestingAnnotator classifier(unilib_.get(), calendarlib_.get());
+
+  // A chain of overlapping spans forms a single conflict group. Ties are
+  // broken by the position of the candidates, so every second span wins.
+  std::vector<AnnotatedSpan> candidates;
+  std::vector<int> expected;
+  for (int i = 0; i < 1000; i++) {
+    candidates.push_back(MakeAnnotatedSpan({2 * i, 2 * i + 3}, "phone", 1.0));
+    if (i % 2 == 0) {
+      expected.push_back(i);
+    }
+  }
+  std::vector<Locale> locales = {Locale::FromBCP47("en")};
+
+  BaseOptions options;
+  options.annotation_usecase = AnnotationUsecase_ANNOTATION_USECASE_SMART;
+  std::vector<int> chosen;
+  classifier.ResolveConflicts(candidates, /*context=*/"", /*cached_tokens=*/{},
+                              locales, options,
+                              /*interpreter_manager=*/nullptr, &chosen);
+  EXPECT_THAT(chosen, ElementsAreArray(expected));
+}
+
 void VerifyLongInput(const Annotator* classifier) {
   ASSERT_TRUE(classifier);
 
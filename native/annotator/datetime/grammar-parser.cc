@@ -24,6 +24,7 @@
 #include "utils/grammar/analyzer.h"
 #include "utils/grammar/evaluated-derivation.h"
 #include "utils/grammar/parsing/derivation.h"
+#include "utils/memory/arena-pool.h"
 
 using ::libtextclassifier3::grammar::EvaluatedDerivation;
 using ::libtextclassifier3::grammar::datetime::UngroundedDatetime;
@@ -37,7 +38,8 @@ GrammarDatetimeParser::GrammarDatetimeParser(
     : analyzer_(analyzer),
       datetime_grounder_(datetime_grounder),
       target_classification_score_(target_classification_score),
-      priority_score_(priority_score) {}
+      priority_score_(priority_score),
+      arena_pool_(new ArenaPool(/*block_size=*/16 << 10)) {}
 
 StatusOr<std::vector<DatetimeParseResultSpan>> GrammarDatetimeParser::Parse(
     const std::string& input, const int64 reference_time_ms_utc,
@@ -55,7 +57,7 @@ StatusOr<std::vector<DatetimeParseResultSpan>> GrammarDatetimeParser::Parse(
     ModeFlag mode, AnnotationUsecase annotation_usecase,
     bool anchor_start_end) const {
   std::vector<DatetimeParseResultSpan> results;
-  UnsafeArena arena(/*block_size=*/16 << 10);
+  ArenaPool::ScopedArena arena(arena_pool_.get());
   std::vector<Locale> locales = locale_list.GetLocales();
   // If the locale list is empty then datetime regex expression will still
   // execute but in grammar based parser the rules are associated with local
@@ -66,7 +68,7 @@ StatusOr<std::vector<DatetimeParseResultSpan>> GrammarDatetimeParser::Parse(
   }
   TC3_ASSIGN_OR_RETURN(
       const std::vector<EvaluatedDerivation> evaluated_derivations,
-      analyzer_.Parse(input, locales, &arena,
+      analyzer_.Parse(input, locales, arena.get(),
                       /*deduplicate_derivations=*/false));
 
   std::vector<EvaluatedDerivation> valid_evaluated_derivations;
@@ -17,6 +17,7 @@
 #ifndef LIBTEXTCLASSIFIER_ANNOTATOR_DATETIME_GRAMMAR_PARSER_H_
 #define LIBTEXTCLASSIFIER_ANNOTATOR_DATETIME_GRAMMAR_PARSER_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -26,6 +27,7 @@
 #include "utils/base/statusor.h"
 #include "utils/grammar/analyzer.h"
 #include "utils/i18n/locale-list.h"
+#include "utils/memory/arena-pool.h"
 #include "utils/utf8/unicodetext.h"
 
 namespace libtextclassifier3 {
@@ -61,6 +63,9 @@ class GrammarDatetimeParser : public DatetimeParser {
   const DatetimeGrounder& datetime_grounder_;
   const float target_classification_score_;
   const float priority_score_;
+
+  // Arenas for the parses, reused between calls.
+  const std::unique_ptr<ArenaPool> arena_pool_;
 };
 
 }  // namespace libtextclassifier3
@@ -16,15 +16,19 @@
 
 #include "annotator/datetime/regex-parser.h"
 
-#include <iterator>
-#include <set>
+#include <algorithm>
+#include <string>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "annotator/datetime/extractor.h"
 #include "annotator/datetime/utils.h"
+#include "utils/base/status_macros.h"
 #include "utils/base/statusor.h"
 #include "utils/calendar/calendar.h"
 #include "utils/i18n/locale.h"
+#include "utils/regex-prefilter.h"
 #include "utils/strings/split.h"
 #include "utils/zlib/zlib_regex.h"
 
@@ -51,14 +55,17 @@ RegexDatetimeParser::RegexDatetimeParser(const DatetimeModel* model,
     return;
   }
 
+  std::vector<std::string> rule_pattern_texts;
   if (model->patterns() != nullptr) {
     for (const DatetimeModelPattern* pattern : *model->patterns()) {
       if (pattern->regexes()) {
         for (const DatetimeModelPattern_::Regex* regex : *pattern->regexes()) {
+          rule_pattern_texts.emplace_back();
           std::unique_ptr<UniLib::RegexPattern> regex_pattern =
               UncompressMakeRegexPattern(
                   unilib_, regex->pattern(), regex->compressed_pattern(),
-                  model->lazy_regex_compilation(), decompressor);
+                  model->lazy_regex_compilation(), decompressor,
+                  &rule_pattern_texts.back());
           if (!regex_pattern) {
             TC3_LOG(ERROR) << "Couldn't create rule pattern.";
             return;
@@ -74,6 +81,12 @@ RegexDatetimeParser::RegexDatetimeParser(const DatetimeModel* model,
     }
   }
 
+  std::unique_ptr<RegexPrefilter> rule_prefilter(
+      new RegexPrefilter(rule_pattern_texts));
+  if (rule_prefilter->num_filtered_patterns() > 0) {
+    rule_prefilter_ = std::move(rule_prefilter);
+  }
+
   if (model->extractors() != nullptr) {
     for (const DatetimeModelExtractor* extractor : *model->extractors()) {
       std::unique_ptr<UniLib::RegexPattern> regex_pattern =
@@ -126,14 +139,22 @@ StatusOr<std::vector<DatetimeParseResultSpan>> RegexDatetimeParser::Parse(
                annotation_usecase, anchor_start_end);
 }
 
-StatusOr<std::vector<DatetimeParseResultSpan>>
-RegexDatetimeParser::FindSpansUsingLocales(
+Status RegexDatetimeParser::FindSpansUsingLocales(
     const std::vector<int>& locale_ids, const UnicodeText& input,
     const int64 reference_time_ms_utc, const std::string& reference_timezone,
     ModeFlag mode, AnnotationUsecase annotation_usecase, bool anchor_start_end,
     const std::string& reference_locale,
-    std::unordered_set<int>* executed_rules) const {
-  std::vector<DatetimeParseResultSpan> found_spans;
+    std::vector<DatetimeParseResultSpan>* found_spans) const {
+  // Find the rules that can match in a single pass over the input, to only
+  // run the matchers of those.
+  std::vector<bool> is_candidate_rule;
+  if (rule_prefilter_ != nullptr) {
+    is_candidate_rule = rule_prefilter_->FindCandidatePatterns(input);
+  }
+
+  // Rules are shared between locales, e.g. the numeric date formats. Each rule
+  // is executed only once, with the first requested locale that has it.
+  std::vector<bool> executed_rules(rules_.size(), false);
   for (const int locale_id : locale_ids) {
     auto rules_it = locale_to_rules_.find(locale_id);
     if (rules_it == locale_to_rules_.end()) {
@@ -141,8 +162,7 @@ RegexDatetimeParser::FindSpansUsingLocales(
     }
 
     for (const int rule_id : rules_it->second) {
-      // Skip rules that were already executed in previous locales.
-      if (executed_rules->find(rule_id) != executed_rules->end()) {
+      if (executed_rules[rule_id]) {
         continue;
       }
 
@@ -155,18 +175,16 @@ RegexDatetimeParser::FindSpansUsingLocales(
         continue;
       }
 
-      executed_rules->insert(rule_id);
-      TC3_ASSIGN_OR_RETURN(
-          const std::vector<DatetimeParseResultSpan>& found_spans_per_rule,
-          ParseWithRule(rules_[rule_id], input, reference_time_ms_utc,
-                        reference_timezone, reference_locale, locale_id,
-                        anchor_start_end));
-      found_spans.insert(std::end(found_spans),
-                         std::begin(found_spans_per_rule),
-                         std::end(found_spans_per_rule));
+      executed_rules[rule_id] = true;
+      if (!is_candidate_rule.empty() && !is_candidate_rule[rule_id]) {
+        continue;
+      }
+      TC3_RETURN_IF_ERROR(ParseWithRule(
+          rules_[rule_id], input, reference_time_ms_utc, reference_timezone,
+          reference_locale, locale_id, anchor_start_end, found_spans));
     }
   }
-  return found_spans;
+  return Status::OK;
 }
 
 StatusOr<std::vector<DatetimeParseResultSpan>> RegexDatetimeParser::Parse(
@@ -174,64 +192,38 @@ StatusOr<std::vector<DatetimeParseResultSpan>> RegexDatetimeParser::Parse(
     const std::string& reference_timezone, const LocaleList& locale_list,
     ModeFlag mode, AnnotationUsecase annotation_usecase,
     bool anchor_start_end) const {
-  std::unordered_set<int> executed_rules;
   const std::vector<int> requested_locales =
       ParseAndExpandLocales(locale_list.GetLocaleTags());
-  TC3_ASSIGN_OR_RETURN(
-      const std::vector<DatetimeParseResultSpan>& found_spans,
-      FindSpansUsingLocales(requested_locales, input, reference_time_ms_utc,
-                            reference_timezone, mode, annotation_usecase,
-                            anchor_start_end, locale_list.GetReferenceLocale(),
-                            &executed_rules));
-  std::vector<std::pair<DatetimeParseResultSpan, int>> indexed_found_spans;
-  indexed_found_spans.reserve(found_spans.size());
-  for (int i = 0; i < found_spans.size(); i++) {
-    indexed_found_spans.push_back({found_spans[i], i});
-  }
+  std::vector<DatetimeParseResultSpan> found_spans;
+  TC3_RETURN_IF_ERROR(FindSpansUsingLocales(
+      requested_locales, input, reference_time_ms_utc, reference_timezone,
+      mode, annotation_usecase, anchor_start_end,
+      locale_list.GetReferenceLocale(), &found_spans));
 
   // Resolve conflicts by always picking the longer span and breaking ties by
   // selecting the earlier entry in the list for a given locale.
-  std::sort(indexed_found_spans.begin(), indexed_found_spans.end(),
-            [](const std::pair<DatetimeParseResultSpan, int>& a,
-               const std::pair<DatetimeParseResultSpan, int>& b) {
-              if ((a.first.span.second - a.first.span.first) !=
-                  (b.first.span.second - b.first.span.first)) {
-                return (a.first.span.second - a.first.span.first) >
-                       (b.first.span.second - b.first.span.first);
-              } else {
-                return a.second < b.second;
-              }
-            });
+  std::stable_sort(found_spans.begin(), found_spans.end(),
+                   [](const DatetimeParseResultSpan& a,
+                      const DatetimeParseResultSpan& b) {
+                     return (a.span.second - a.span.first) >
+                            (b.span.second - b.span.first);
+                   });
 
   std::vector<DatetimeParseResultSpan> results;
-  std::vector<DatetimeParseResultSpan> resolved_found_spans;
-  resolved_found_spans.reserve(indexed_found_spans.size());
-  for (auto& span_index_pair : indexed_found_spans) {
-    resolved_found_spans.push_back(span_index_pair.first);
-  }
-
-  std::set<int, std::function<bool(int, int)>> chosen_indices_set(
-      [&resolved_found_spans](int a, int b) {
-        return resolved_found_spans[a].span.first <
-               resolved_found_spans[b].span.first;
-      });
-  for (int i = 0; i < resolved_found_spans.size(); ++i) {
-    if (!DoesCandidateConflict(i, resolved_found_spans, chosen_indices_set)) {
-      chosen_indices_set.insert(i);
-      results.push_back(resolved_found_spans[i]);
+  DisjointSpanSet chosen_spans;
+  for (DatetimeParseResultSpan& found_span : found_spans) {
+    if (chosen_spans.InsertIfDisjoint(found_span.span)) {
+      results.push_back(std::move(found_span));
     }
   }
   return results;
 }
 
-StatusOr<std::vector<DatetimeParseResultSpan>>
-RegexDatetimeParser::HandleParseMatch(const CompiledRule& rule,
-                                      const UniLib::RegexMatcher& matcher,
-                                      int64 reference_time_ms_utc,
-                                      const std::string& reference_timezone,
-                                      const std::string& reference_locale,
-                                      int locale_id) const {
-  std::vector<DatetimeParseResultSpan> results;
+Status RegexDatetimeParser::HandleParseMatch(
+    const CompiledRule& rule, const UniLib::RegexMatcher& matcher,
+    int64 reference_time_ms_utc, const std::string& reference_timezone,
+    const std::string& reference_locale, int locale_id,
+    std::vector<DatetimeParseResultSpan>* results) const {
   int status = UniLib::RegexMatcher::kNoError;
   const int start = matcher.Start(&status);
   if (status != UniLib::RegexMatcher::kNoError) {
@@ -262,43 +254,36 @@ RegexDatetimeParser::HandleParseMatch(const CompiledRule& rule,
     parse_result.target_classification_score =
         rule.pattern->target_classification_score();
     parse_result.priority_score = rule.pattern->priority_score();
-
-    for (DatetimeParseResult& alternative : alternatives) {
-      parse_result.data.push_back(alternative);
-    }
+    parse_result.data = std::move(alternatives);
   }
-  results.push_back(parse_result);
-  return results;
+  results->push_back(std::move(parse_result));
+  return Status::OK;
 }
 
-StatusOr<std::vector<DatetimeParseResultSpan>>
-RegexDatetimeParser::ParseWithRule(const CompiledRule& rule,
-                                   const UnicodeText& input,
-                                   const int64 reference_time_ms_utc,
-                                   const std::string& reference_timezone,
-                                   const std::string& reference_locale,
-                                   const int locale_id,
-                                   bool anchor_start_end) const {
-  std::vector<DatetimeParseResultSpan> results;
+Status RegexDatetimeParser::ParseWithRule(
+    const CompiledRule& rule, const UnicodeText& input,
+    const int64 reference_time_ms_utc, const std::string& reference_timezone,
+    const std::string& reference_locale, const int locale_id,
+    bool anchor_start_end,
+    std::vector<DatetimeParseResultSpan>* results) const {
   std::unique_ptr<UniLib::RegexMatcher> matcher =
       rule.compiled_regex->Matcher(input);
   int status = UniLib::RegexMatcher::kNoError;
   if (anchor_start_end) {
     if (matcher->Matches(&status) && status == UniLib::RegexMatcher::kNoError) {
       return HandleParseMatch(rule, *matcher, reference_time_ms_utc,
-                              reference_timezone, reference_locale, locale_id);
+                              reference_timezone, reference_locale, locale_id,
+                              results);
     }
   } else {
     while (matcher->Find(&status) && status == UniLib::RegexMatcher::kNoError) {
-      TC3_ASSIGN_OR_RETURN(
-          const std::vector<DatetimeParseResultSpan>& pattern_occurrence,
-          HandleParseMatch(rule, *matcher, reference_time_ms_utc,
-                           reference_timezone, reference_locale, locale_id));
-      results.insert(std::end(results), std::begin(pattern_occurrence),
-                     std::end(pattern_occurrence));
+      TC3_RETURN_IF_ERROR(HandleParseMatch(rule, *matcher,
+                                           reference_time_ms_utc,
+                                           reference_timezone, reference_locale,
+                                           locale_id, results));
     }
   }
-  return results;
+  return Status::OK;
 }
 
 std::vector<int> RegexDatetimeParser::ParseAndExpandLocales(
@@ -20,7 +20,6 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
-#include <unordered_set>
 #include <vector>
 
 #include "annotator/datetime/extractor.h"
@@ -28,8 +27,10 @@
 #include "annotator/model_generated.h"
 #include "annotator/types.h"
 #include "utils/base/integral_types.h"
+#include "utils/base/status.h"
 #include "utils/base/statusor.h"
 #include "utils/calendar/calendar.h"
+#include "utils/regex-prefilter.h"
 #include "utils/strings/stringpiece.h"
 #include "utils/utf8/unicodetext.h"
 #include "utils/utf8/unilib.h"
@@ -73,19 +74,25 @@ class RegexDatetimeParser : public DatetimeParser {
       const std::vector<StringPiece>& locales) const;
 
   // Helper function that finds datetime spans, only using the rules associated
-  // with the given locales.
-  StatusOr<std::vector<DatetimeParseResultSpan>> FindSpansUsingLocales(
+  // with the given locales, and appends them to 'found_spans'. Every rule is
+  // executed at most once per input, with the first of the locales that
+  // enables it, even if it's shared by several of the locales. Rules whose
+  // required literals don't occur in the input are not executed at all.
+  Status FindSpansUsingLocales(
       const std::vector<int>& locale_ids, const UnicodeText& input,
       const int64 reference_time_ms_utc, const std::string& reference_timezone,
       ModeFlag mode, AnnotationUsecase annotation_usecase,
       bool anchor_start_end, const std::string& reference_locale,
-      std::unordered_set<int>* executed_rules) const;
+      std::vector<DatetimeParseResultSpan>* found_spans) const;
 
-  StatusOr<std::vector<DatetimeParseResultSpan>> ParseWithRule(
-      const CompiledRule& rule, const UnicodeText& input,
-      int64 reference_time_ms_utc, const std::string& reference_timezone,
-      const std::string& reference_locale, const int locale_id,
-      bool anchor_start_end) const;
+  // Runs a single rule over the whole input and appends its matches to
+  // 'results'.
+  Status ParseWithRule(const CompiledRule& rule, const UnicodeText& input,
+                       int64 reference_time_ms_utc,
+                       const std::string& reference_timezone,
+                       const std::string& reference_locale, const int locale_id,
+                       bool anchor_start_end,
+                       std::vector<DatetimeParseResultSpan>* results) const;
 
   // Converts the current match in 'matcher' into DatetimeParseResult.
   bool ExtractDatetime(const CompiledRule& rule,
@@ -96,11 +103,14 @@ class RegexDatetimeParser : public DatetimeParser {
                        std::vector<DatetimeParseResult>* results,
                        CodepointSpan* result_span) const;
 
-  // Parse and extract information from current match in 'matcher'.
-  StatusOr<std::vector<DatetimeParseResultSpan>> HandleParseMatch(
-      const CompiledRule& rule, const UniLib::RegexMatcher& matcher,
-      int64 reference_time_ms_utc, const std::string& reference_timezone,
-      const std::string& reference_locale, int locale_id) const;
+  // Parse and extract information from current match in 'matcher' and append
+  // it to 'results'.
+  Status HandleParseMatch(const CompiledRule& rule,
+                          const UniLib::RegexMatcher& matcher,
+                          int64 reference_time_ms_utc,
+                          const std::string& reference_timezone,
+                          const std::string& reference_locale, int locale_id,
+                          std::vector<DatetimeParseResultSpan>* results) const;
 
  private:
   bool initialized_;
@@ -108,6 +118,10 @@ class RegexDatetimeParser : public DatetimeParser {
   const CalendarLib& calendarlib_;
   std::vector<CompiledRule> rules_;
   std::unordered_map<int, std::vector<int>> locale_to_rules_;
+
+  // Rules out the rules that can't match an input, indexed like `rules_`.
+  // Null if it can't rule out any of them.
+  std::unique_ptr<const RegexPrefilter> rule_prefilter_;
   std::vector<std::unique_ptr<const UniLib::RegexPattern>> extractor_rules_;
   std::unordered_map<DatetimeExtractorType, std::unordered_map<int, int>>
       type_and_locale_to_extractor_rule_;
@@ -21,6 +21,7 @@
 #include <vector>
 
 #include "utils/base/logging.h"
+#include "utils/hash/farmhash.h"
 #include "utils/strings/utf8.h"
 #include "utils/utf8/unicodetext.h"
 
@@ -825,6 +826,20 @@ bool FeatureProcessor::ExtractFeatures(
   return true;
 }
 
+void FeatureProcessor::EnableTokenEmbeddingCache(int max_num_entries) {
+  token_embedding_cache_.reset(
+      new TokenEmbeddingCache(GetOptions()->embedding_size(), max_num_entries));
+}
+
+uint64 FeatureProcessor::TokenEmbeddingCacheKey(const Token& token) const {
+  // The sparse features only depend on the token text, and are the same for
+  // all the padding and empty tokens.
+  if (token.is_padding) {
+    return tc3farmhash::Fingerprint64("", 0);
+  }
+  return tc3farmhash::Fingerprint64(token.value);
+}
+
 bool FeatureProcessor::AppendTokenFeaturesWithCache(
     const Token& token, const CodepointSpan& selection_span_for_feature,
     const EmbeddingExecutor* embedding_executor,
@@ -853,28 +868,49 @@ bool FeatureProcessor::AppendTokenFeaturesWithCache(
     }
   }
 
-  // Extract the sparse and dense features.
-  std::vector<int> sparse_features;
-  std::vector<float> dense_features;
-  if (!feature_extractor_.Extract(
-          token, token.IsContainedInSpan(selection_span_for_feature),
-          &sparse_features, &dense_features)) {
-    TC3_LOG(ERROR) << "Could not extract token's features.";
-    return false;
-  }
-
-  // Embed the sparse features, appending them directly to the output.
   const int embedding_size = GetOptions()->embedding_size();
   output_features->resize(output_features->size() + embedding_size);
   float* output_features_end =
       output_features->data() + output_features->size();
-  if (!embedding_executor->AddEmbedding(
-          TensorView<int>(sparse_features.data(),
-                          {static_cast<int>(sparse_features.size())}),
-          /*dest=*/output_features_end - embedding_size,
-          /*dest_size=*/embedding_size)) {
-    TC3_LOG(ERROR) << "Cound not embed token's sparse features.";
-    return false;
+
+  // Look for the embedded features in the cache shared across calls, which is
+  // keyed by the token text rather than its position.
+  const uint64 token_key =
+      token_embedding_cache_ != nullptr ? TokenEmbeddingCacheKey(token) : 0;
+  std::vector<float> dense_features;
+  if (token_embedding_cache_ != nullptr &&
+      token_embedding_cache_->Lookup(
+          token_key, /*dest=*/output_features_end - embedding_size)) {
+    if (!feature_extractor_.Extract(
+            token, token.IsContainedInSpan(selection_span_for_feature),
+            /*sparse_features=*/nullptr, &dense_features)) {
+      TC3_LOG(ERROR) << "Could not extract token's dense features.";
+      return false;
+    }
+  } else {
+    // Extract the sparse and dense features.
+    std::vector<int> sparse_features;
+    if (!feature_extractor_.Extract(
+            token, token.IsContainedInSpan(selection_span_for_feature),
+            &sparse_features, &dense_features)) {
+      TC3_LOG(ERROR) << "Could not extract token's features.";
+      return false;
+    }
+
+    // Embed the sparse features, appending them directly to the output.
+    if (!embedding_executor->AddEmbedding(
+            TensorView<int>(sparse_features.data(),
+                            {static_cast<int>(sparse_features.size())}),
+            /*dest=*/output_features_end - embedding_size,
+            /*dest_size=*/embedding_size)) {
+      TC3_LOG(ERROR) << "Cound not embed token's sparse features.";
+      return false;
+    }
+
+    if (token_embedding_cache_ != nullptr) {
+      token_embedding_cache_->Insert(token_key,
+                                     output_features_end - embedding_size);
+    }
   }
 
   // If there is a cache, the embedded features for the token were not in it,
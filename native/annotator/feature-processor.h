@@ -27,6 +27,7 @@
 
 #include "annotator/cached-features.h"
 #include "annotator/model_generated.h"
+#include "annotator/token-embedding-cache.h"
 #include "annotator/types.h"
 #include "utils/base/integral_types.h"
 #include "utils/base/logging.h"
@@ -126,6 +127,21 @@ class FeatureProcessor {
   // Same as above but takes UnicodeText.
   std::vector<Token> Tokenize(const UnicodeText& text_unicode) const;
 
+  const Tokenizer& tokenizer() const { return tokenizer_; }
+
+  // Enables a cache of token embeddings that is shared by all the subsequent
+  // calls, keyed by the token text, with room for `max_num_entries` tokens.
+  // The cached embeddings are only valid for one embedding executor, which
+  // must be the one passed to all the calls.
+  // NOTE: Not thread-safe, must be called before the feature processor is
+  // shared between threads.
+  void EnableTokenEmbeddingCache(int max_num_entries);
+
+  // Returns the cache enabled by EnableTokenEmbeddingCache(), or nullptr.
+  const TokenEmbeddingCache* token_embedding_cache() const {
+    return token_embedding_cache_.get();
+  }
+
   // Converts a label into a token span.
   bool LabelToTokenSpan(int label, TokenSpan* token_span) const;
 
@@ -283,13 +299,17 @@ class FeatureProcessor {
 
   // Extracts the features of a token and appends them to the output vector.
   // Uses the embedding cache to to avoid re-extracting the re-embedding the
-  // sparse features for the same token.
+  // sparse features for the same token, and the token embedding cache, if
+  // enabled, to avoid re-embedding the sparse features of the same token text.
   bool AppendTokenFeaturesWithCache(
       const Token& token, const CodepointSpan& selection_span_for_feature,
       const EmbeddingExecutor* embedding_executor,
       EmbeddingCache* embedding_cache,
       std::vector<float>* output_features) const;
 
+  // Returns the key of the token in the token embedding cache.
+  uint64 TokenEmbeddingCacheKey(const Token& token) const;
+
  protected:
   const TokenFeatureExtractor feature_extractor_;
 
@@ -312,6 +332,9 @@ class FeatureProcessor {
   std::map<std::string, int> collection_to_label_;
 
   Tokenizer tokenizer_;
+
+  // Embeddings of the tokens' sparse features, shared across calls.
+  std::unique_ptr<TokenEmbeddingCache> token_embedding_cache_;
 };
 
 }  // namespace libtextclassifier3
@@ -21,6 +21,7 @@
 #include "annotator/types.h"
 #include "utils/base/arena.h"
 #include "utils/base/logging.h"
+#include "utils/memory/arena-pool.h"
 #include "utils/normalization.h"
 #include "utils/optional.h"
 #include "utils/utf8/unicodetext.h"
@@ -83,7 +84,8 @@ GrammarAnnotator::GrammarAnnotator(
       model_(model),
       tokenizer_(BuildTokenizer(unilib, model->tokenizer_options())),
       entity_data_builder_(entity_data_builder),
-      analyzer_(unilib, model->rules(), &tokenizer_) {}
+      analyzer_(unilib, model->rules(), &tokenizer_),
+      arena_pool_(new ArenaPool(/*block_size=*/16 << 10)) {}
 
 // Filters out results that do not overlap with a reference span.
 std::vector<grammar::Derivation> GrammarAnnotator::OverlappingDerivations(
@@ -201,13 +203,20 @@ bool GrammarAnnotator::InstantiateClassificationFromDerivation(
 bool GrammarAnnotator::Annotate(const std::vector<Locale>& locales,
                                 const UnicodeText& text,
                                 std::vector<AnnotatedSpan>* result) const {
+  return Annotate(locales, text, /*tokenization_cache=*/nullptr, result);
+}
+
+bool GrammarAnnotator::Annotate(const std::vector<Locale>& locales,
+                                const UnicodeText& text,
+                                TokenizationCache* tokenization_cache,
+                                std::vector<AnnotatedSpan>* result) const {
   grammar::TextContext input_context =
-      analyzer_.BuildTextContextForInput(text, locales);
+      analyzer_.BuildTextContextForInput(text, locales, tokenization_cache);
 
-  UnsafeArena arena(/*block_size=*/16 << 10);
+  ArenaPool::ScopedArena arena(arena_pool_.get());
 
   for (const grammar::Derivation& derivation : ValidDeduplicatedDerivations(
-           analyzer_.parser().Parse(input_context, &arena))) {
+           analyzer_.parser().Parse(input_context, arena.get()))) {
     const GrammarModel_::RuleClassificationResult* interpretation =
         model_->rule_classification_result()->Get(derivation.rule_id);
     if ((interpretation->enabled_modes() & ModeFlag_ANNOTATION) == 0) {
@@ -235,13 +244,13 @@ bool GrammarAnnotator::SuggestSelection(const std::vector<Locale>& locales,
   grammar::TextContext input_context =
       analyzer_.BuildTextContextForInput(text, locales);
 
-  UnsafeArena arena(/*block_size=*/16 << 10);
+  ArenaPool::ScopedArena arena(arena_pool_.get());
 
   const GrammarModel_::RuleClassificationResult* best_interpretation = nullptr;
   const grammar::ParseTree* best_match = nullptr;
   for (const grammar::Derivation& derivation :
        ValidDeduplicatedDerivations(OverlappingDerivations(
-           selection, analyzer_.parser().Parse(input_context, &arena),
+           selection, analyzer_.parser().Parse(input_context, arena.get()),
            /*only_exact_overlap=*/false))) {
     const GrammarModel_::RuleClassificationResult* interpretation =
         model_->rule_classification_result()->Get(derivation.rule_id);
@@ -291,13 +300,13 @@ bool GrammarAnnotator::ClassifyText(
     }
   }
 
-  UnsafeArena arena(/*block_size=*/16 << 10);
+  ArenaPool::ScopedArena arena(arena_pool_.get());
 
   const GrammarModel_::RuleClassificationResult* best_interpretation = nullptr;
   const grammar::ParseTree* best_match = nullptr;
   for (const grammar::Derivation& derivation :
        ValidDeduplicatedDerivations(OverlappingDerivations(
-           selection, analyzer_.parser().Parse(input_context, &arena),
+           selection, analyzer_.parser().Parse(input_context, arena.get()),
            /*only_exact_overlap=*/true))) {
     const GrammarModel_::RuleClassificationResult* interpretation =
         model_->rule_classification_result()->Get(derivation.rule_id);
@@ -17,6 +17,7 @@
 #ifndef LIBTEXTCLASSIFIER_ANNOTATOR_GRAMMAR_GRAMMAR_ANNOTATOR_H_
 #define LIBTEXTCLASSIFIER_ANNOTATOR_GRAMMAR_GRAMMAR_ANNOTATOR_H_
 
+#include <memory>
 #include <vector>
 
 #include "annotator/model_generated.h"
@@ -26,6 +27,7 @@
 #include "utils/grammar/evaluated-derivation.h"
 #include "utils/grammar/text-context.h"
 #include "utils/i18n/locale.h"
+#include "utils/memory/arena-pool.h"
 #include "utils/tokenizer.h"
 #include "utils/utf8/unicodetext.h"
 #include "utils/utf8/unilib.h"
@@ -44,6 +46,12 @@ class GrammarAnnotator {
   bool Annotate(const std::vector<Locale>& locales, const UnicodeText& text,
                 std::vector<AnnotatedSpan>* result) const;
 
+  // Same as above, but reuses the tokens from `tokenization_cache` (if not
+  // null).
+  bool Annotate(const std::vector<Locale>& locales, const UnicodeText& text,
+                TokenizationCache* tokenization_cache,
+                std::vector<AnnotatedSpan>* result) const;
+
   // Classifies a span in a text.
   // Returns true if the span was classified by a grammar rule.
   bool ClassifyText(const std::vector<Locale>& locales, const UnicodeText& text,
@@ -82,6 +90,9 @@ class GrammarAnnotator {
   const Tokenizer tokenizer_;
   const MutableFlatbufferBuilder* entity_data_builder_;
   const grammar::Analyzer analyzer_;
+
+  // Arenas for the parses, reused between calls.
+  const std::unique_ptr<ArenaPool> arena_pool_;
 };
 
 }  // namespace libtextclassifier3
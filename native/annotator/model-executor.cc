@@ -16,8 +16,11 @@
 
 #include "annotator/model-executor.h"
 
+#include <algorithm>
+
 #include "annotator/quantization.h"
 #include "utils/base/logging.h"
+#include "utils/stage-timings.h"
 
 namespace libtextclassifier3 {
 
@@ -34,6 +37,7 @@ TensorView<float> ModelExecutor::ComputeLogits(
 
   SetInput<float>(kInputIndexFeatures, features, interpreter);
 
+  ScopedStage::CountModelInvocation();
   if (interpreter->Invoke() != kTfLiteOk) {
     TC3_VLOG(1) << "Interpreter failed.";
     return TensorView<float>::Invalid();
@@ -157,26 +161,27 @@ bool TFLiteEmbeddingExecutor::AddEmbedding(
     return false;
   }
   const int num_sparse_features = sparse_features.size();
-  for (int i = 0; i < num_sparse_features; ++i) {
-    const int bucket_id = sparse_features.data()[i];
-    int full_num_buckets;
-    if (!pruning_mask_.empty()) {
-      full_num_buckets = full_num_buckets_;
-    } else {
-      full_num_buckets = num_buckets_;
-    }
-    if (bucket_id >= full_num_buckets) {
-      return false;
-    }
-    int final_bucket_id;
-    if (!pruning_mask_.empty()) {
-      final_bucket_id = PruneBucketId(bucket_id);
-    } else {
-      final_bucket_id = bucket_id;
+  const int full_num_buckets =
+      pruning_mask_.empty() ? num_buckets_ : full_num_buckets_;
+
+  // The buckets are dequantized in batches, each in a single pass over `dest`.
+  static constexpr int kMaxBatchSize = 16;
+  int bucket_ids[kMaxBatchSize];
+  for (int begin = 0; begin < num_sparse_features; begin += kMaxBatchSize) {
+    const int batch_size =
+        std::min(kMaxBatchSize, num_sparse_features - begin);
+    for (int i = 0; i < batch_size; ++i) {
+      const int bucket_id = sparse_features.data()[begin + i];
+      if (bucket_id >= full_num_buckets) {
+        return false;
+      }
+      bucket_ids[i] =
+          pruning_mask_.empty() ? bucket_id : PruneBucketId(bucket_id);
     }
-    if (!DequantizeAdd(scales_->data.f, embeddings_->data.uint8,
-                       bytes_per_embedding_, num_sparse_features,
-                       quantization_bits_, final_bucket_id, dest, dest_size)) {
+    if (!DequantizeAddMultiple(scales_->data.f, embeddings_->data.uint8,
+                               bytes_per_embedding_, num_sparse_features,
+                               quantization_bits_, bucket_ids, batch_size,
+                               dest, dest_size)) {
       return false;
     }
   }
@@ -217,11 +217,27 @@ bool NumberAnnotator::TryParseNumber(const UnicodeText& token_text,
 bool NumberAnnotator::FindAll(const UnicodeText& context,
                               AnnotationUsecase annotation_usecase,
                               std::vector<AnnotatedSpan>* result) const {
+  return FindAll(context, annotation_usecase, /*tokenization_cache=*/nullptr,
+                 result);
+}
+
+bool NumberAnnotator::FindAll(const UnicodeText& context,
+                              AnnotationUsecase annotation_usecase,
+                              TokenizationCache* tokenization_cache,
+                              std::vector<AnnotatedSpan>* result) const {
   if (!options_->enabled()) {
     return true;
   }
 
-  const std::vector<Token> tokens = tokenizer_.Tokenize(context);
+  const bool use_tokenization_cache =
+      tokenization_cache != nullptr && tokenization_cache->IsForText(context);
+  std::vector<Token> owned_tokens;
+  if (!use_tokenization_cache) {
+    owned_tokens = tokenizer_.Tokenize(context);
+  }
+  const std::vector<Token>& tokens =
+      use_tokenization_cache ? tokenization_cache->Tokenize(tokenizer_)
+                             : owned_tokens;
   for (int i = 0; i < tokens.size(); ++i) {
     const Token token = tokens[i];
     if (tokens[i].value.empty() ||
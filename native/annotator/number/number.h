@@ -61,6 +61,13 @@ class NumberAnnotator {
                AnnotationUsecase annotation_usecase,
                std::vector<AnnotatedSpan>* result) const;
 
+  // Same as above, but takes the tokens from `tokenization_cache` if it is
+  // not null and holds the tokenizations of `context_unicode`.
+  bool FindAll(const UnicodeText& context_unicode,
+               AnnotationUsecase annotation_usecase,
+               TokenizationCache* tokenization_cache,
+               std::vector<AnnotatedSpan>* result) const;
+
  private:
   // Converts a Flatbuffer string containing zero-separated percent suffixes
   // to an unordered set.
@@ -24,6 +24,7 @@
 #include "annotator/types-test-util.h"
 #include "annotator/types.h"
 #include "utils/tokenizer-utils.h"
+#include "utils/tokenizer.h"
 #include "utils/utf8/unicodetext.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -188,6 +189,22 @@ TEST_F(NumberAnnotatorTest, FindsAllIntegerAndFloatNumbersInText) {
                                   /*priority_score=*/1)));
 }
 
+TEST_F(NumberAnnotatorTest, IgnoresTokenizationCacheOfOtherText) {
+  const UnicodeText other_text = UTF8ToUnicodeText("no numbers here");
+  TokenizationCache tokenization_cache(other_text);
+  std::vector<AnnotatedSpan> result;
+  EXPECT_TRUE(number_annotator_.FindAll(
+      UTF8ToUnicodeText("call me at 5 or 6"),
+      AnnotationUsecase_ANNOTATION_USECASE_RAW, &tokenization_cache, &result));
+
+  EXPECT_THAT(result,
+              UnorderedElementsAre(
+                  IsAnnotatedSpan(CodepointSpan(11, 12), "number",
+                                  /*int_value=*/5, /*double_value=*/5.0),
+                  IsAnnotatedSpan(CodepointSpan(16, 17), "number",
+                                  /*int_value=*/6, /*double_value=*/6.0)));
+}
+
 TEST_F(NumberAnnotatorTest, ClassifiesNonNumberCorrectly) {
   ClassificationResult classification_result;
   EXPECT_FALSE(number_annotator_.ClassifyText(
@@ -19,6 +19,7 @@
 #include <algorithm>
 #include <cstdint>
 #include <ctime>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <ostream>
@@ -30,6 +31,7 @@
 #include "annotator/types.h"
 #include "utils/base/logging.h"
 #include "utils/bert_tokenizer.h"
+#include "utils/stage-timings.h"
 #include "utils/tflite-model-executor.h"
 #include "utils/tokenizer-utils.h"
 #include "utils/utf8/unicodetext.h"
@@ -98,8 +100,24 @@ void FillDefaultLabelsAndCollections(float default_priority,
   }
 }
 
+std::unique_ptr<tflite::OpResolver> BuildPodNerOpResolver() {
+  return BuildOpResolver([](tflite::MutableOpResolver *mutable_resolver) {
+    mutable_resolver->AddBuiltin(::tflite::BuiltinOperator_SHAPE,
+                                 ::tflite::ops::builtin::Register_SHAPE());
+    mutable_resolver->AddBuiltin(::tflite::BuiltinOperator_RANGE,
+                                 ::tflite::ops::builtin::Register_RANGE());
+    mutable_resolver->AddBuiltin(::tflite::BuiltinOperator_ARG_MAX,
+                                 ::tflite::ops::builtin::Register_ARG_MAX());
+    mutable_resolver->AddBuiltin(
+        ::tflite::BuiltinOperator_EXPAND_DIMS,
+        ::tflite::ops::builtin::Register_EXPAND_DIMS());
+    mutable_resolver->AddCustom(
+        "LayerNorm", ::seq_flow_lite::ops::custom::Register_LAYER_NORM());
+  });
+}
+
 std::unique_ptr<tflite::Interpreter> CreateInterpreter(
-    const PodNerModel *model) {
+    const PodNerModel *model, const tflite::OpResolver &resolver) {
   TC3_CHECK(model != nullptr);
   if (model->tflite_model() == nullptr) {
     TC3_LOG(ERROR) << "Unable to create tf.lite interpreter, model is null.";
@@ -113,24 +131,8 @@ std::unique_ptr<tflite::Interpreter> CreateInterpreter(
     return nullptr;
   }
 
-  std::unique_ptr<tflite::OpResolver> resolver =
-      BuildOpResolver([](tflite::MutableOpResolver *mutable_resolver) {
-        mutable_resolver->AddBuiltin(::tflite::BuiltinOperator_SHAPE,
-                                     ::tflite::ops::builtin::Register_SHAPE());
-        mutable_resolver->AddBuiltin(::tflite::BuiltinOperator_RANGE,
-                                     ::tflite::ops::builtin::Register_RANGE());
-        mutable_resolver->AddBuiltin(
-            ::tflite::BuiltinOperator_ARG_MAX,
-            ::tflite::ops::builtin::Register_ARG_MAX());
-        mutable_resolver->AddBuiltin(
-            ::tflite::BuiltinOperator_EXPAND_DIMS,
-            ::tflite::ops::builtin::Register_EXPAND_DIMS());
-        mutable_resolver->AddCustom(
-            "LayerNorm", ::seq_flow_lite::ops::custom::Register_LAYER_NORM());
-      });
-
   std::unique_ptr<tflite::Interpreter> tflite_interpreter;
-  tflite::InterpreterBuilder(tflite_model, *resolver,
+  tflite::InterpreterBuilder(tflite_model, resolver,
                              nullptr)(&tflite_interpreter);
   if (tflite_interpreter == nullptr) {
     TC3_LOG(ERROR) << "Unable to create tf.lite interpreter.";
@@ -139,6 +141,22 @@ std::unique_ptr<tflite::Interpreter> CreateInterpreter(
   return tflite_interpreter;
 }
 
+// Resizes the input to shape [1, length], unless it already has that shape.
+// Returns whether the input was resized.
+bool ResizeInputIfNeeded(tflite::Interpreter *interpreter, int input_index,
+                         int length) {
+  const int tensor_index = interpreter->inputs()[input_index];
+  const TfLiteIntArray *dims = interpreter->tensor(tensor_index)->dims;
+  if (dims != nullptr && dims->size == 2 && dims->data[0] == 1 &&
+      dims->data[1] == length) {
+    return false;
+  }
+  const TfLiteStatus status =
+      interpreter->ResizeInputTensor(tensor_index, {1, length});
+  TC3_CHECK_EQ(status, kTfLiteOk);
+  return true;
+}
+
 bool FindSpecialWordpieceIds(const std::unique_ptr<BertTokenizer> &tokenizer,
                              int *cls_id, int *sep_id, int *period_id,
                              int *unknown_id) {
@@ -236,10 +254,38 @@ std::unique_ptr<PodNerAnnotator> PodNerAnnotator::Create(
   annotator->period_wordpiece_id_ = period_id;
   annotator->unknown_wordpiece_id_ = unknown_wordpiece_id;
   annotator->model_ = model;
+  annotator->op_resolver_ = BuildPodNerOpResolver();
+
+  PodNerAnnotator *annotator_ptr = annotator.get();
+  annotator->interpreter_pool_.reset(new ObjectPool<tflite::Interpreter>(
+      ObjectPool<tflite::Interpreter>::kDefaultMaxIdle,
+      [annotator_ptr]() { return annotator_ptr->CreateWarmInterpreter(); }));
+  annotator->interpreter_pool_->Warmup(/*num_objects=*/1);
 
   return annotator;
 }
 
+std::unique_ptr<tflite::Interpreter> PodNerAnnotator::CreateWarmInterpreter()
+    const {
+  std::unique_ptr<tflite::Interpreter> interpreter =
+      CreateInterpreter(model_, *op_resolver_);
+  if (interpreter == nullptr) {
+    return nullptr;
+  }
+
+  // The tensor arena keeps its high-water mark, so allocating for the longest
+  // window up front means that no later window reallocates it.
+  ResizeInputIfNeeded(interpreter.get(), /*input_index=*/0,
+                      model_->max_num_wordpieces());
+  ResizeInputIfNeeded(interpreter.get(), /*input_index=*/1,
+                      max_num_effective_wordpieces_);
+  if (interpreter->AllocateTensors() != kTfLiteOk) {
+    TC3_LOG(ERROR) << "Unable to allocate the tf.lite interpreter tensors.";
+    return nullptr;
+  }
+  return interpreter;
+}
+
 std::vector<LabelT> PodNerAnnotator::ReadResultsFromInterpreter(
     tflite::Interpreter &interpreter) const {
   TfLiteTensor *output =
@@ -267,7 +313,7 @@ std::vector<LabelT> PodNerAnnotator::ReadResultsFromInterpreter(
 }
 
 std::vector<LabelT> PodNerAnnotator::ExecuteModel(
-    const VectorSpan<int> &wordpiece_indices,
+    tflite::Interpreter *interpreter, const VectorSpan<int> &wordpiece_indices,
     const VectorSpan<int32_t> &token_starts,
     const VectorSpan<Token> &tokens) const {
   // Check that there are not more input indices than supported.
@@ -298,26 +344,18 @@ std::vector<LabelT> PodNerAnnotator::ExecuteModel(
     num_additional_wordpieces++;
   }
 
-  // Interpreter needs to be created for each inference call separately,
-  // otherwise the class is not thread-safe.
-  std::unique_ptr<tflite::Interpreter> interpreter = CreateInterpreter(model_);
-  if (interpreter == nullptr) {
-    TC3_LOG(ERROR) << "Couldn't create Interpreter.";
-    return {};
+  // Windows of the same size keep the shapes and the allocation of the
+  // previous window.
+  bool resized = ResizeInputIfNeeded(
+      interpreter, /*input_index=*/0,
+      wordpiece_indices.size() + num_additional_wordpieces);
+  resized |= ResizeInputIfNeeded(interpreter, /*input_index=*/1,
+                                 token_starts.size());
+  if (resized) {
+    const TfLiteStatus status = interpreter->AllocateTensors();
+    TC3_CHECK_EQ(status, kTfLiteOk);
   }
 
-  TfLiteStatus status;
-  status = interpreter->ResizeInputTensor(
-      interpreter->inputs()[0],
-      {1, wordpiece_indices.size() + num_additional_wordpieces});
-  TC3_CHECK_EQ(status, kTfLiteOk);
-  status = interpreter->ResizeInputTensor(interpreter->inputs()[1],
-                                          {1, token_starts.size()});
-  TC3_CHECK_EQ(status, kTfLiteOk);
-
-  status = interpreter->AllocateTensors();
-  TC3_CHECK_EQ(status, kTfLiteOk);
-
   TfLiteTensor *tensor = interpreter->tensor(interpreter->inputs()[0]);
   int wordpiece_tensor_index = 0;
   tensor->data.i32[wordpiece_tensor_index++] = cls_wordpiece_id_;
@@ -337,7 +375,8 @@ std::vector<LabelT> PodNerAnnotator::ExecuteModel(
     tensor->data.i32[i] = token_starts[i] + 1 - token_starts[0];
   }
 
-  status = interpreter->Invoke();
+  ScopedStage::CountModelInvocation();
+  const TfLiteStatus status = interpreter->Invoke();
   TC3_CHECK_EQ(status, kTfLiteOk);
 
   return ReadResultsFromInterpreter(*interpreter);
@@ -388,23 +427,72 @@ bool PodNerAnnotator::PrepareText(const UnicodeText &text_unicode,
 }
 
 bool PodNerAnnotator::Annotate(const UnicodeText &context,
-                               std::vector<AnnotatedSpan> *results) const {
+                               std::vector<AnnotatedSpan> *results,
+                               TaskRunner *task_runner) const {
   return AnnotateAroundSpanOfInterest(context, {0, context.size_codepoints()},
-                                      results);
+                                      results, task_runner);
+}
+
+bool PodNerAnnotator::AnnotateBatch(
+    const std::vector<UnicodeText> &contexts,
+    std::vector<std::vector<AnnotatedSpan>> *results,
+    TaskRunner *task_runner) const {
+  TC3_CHECK(results != nullptr);
+  results->assign(contexts.size(), {});
+
+  // Sized up front, the windows point into the prepared texts.
+  std::vector<PreparedText> texts(contexts.size());
+  std::vector<Window *> windows;
+  for (int i = 0; i < contexts.size(); ++i) {
+    if (!PrepareWindows(contexts[i], {0, contexts[i].size_codepoints()},
+                        &texts[i])) {
+      TC3_LOG(ERROR) << "PodNerAnnotator PrepareWindows(...) failed.";
+      return false;
+    }
+    for (Window &window : texts[i].windows) {
+      windows.push_back(&window);
+    }
+  }
+
+  ExecuteWindows(windows, task_runner);
+
+  for (int i = 0; i < texts.size(); ++i) {
+    if (!MergeWindows(texts[i], &(*results)[i])) {
+      return false;
+    }
+  }
+  return true;
 }
 
 bool PodNerAnnotator::AnnotateAroundSpanOfInterest(
     const UnicodeText &context, const CodepointSpan &span_of_interest,
-    std::vector<AnnotatedSpan> *results) const {
+    std::vector<AnnotatedSpan> *results, TaskRunner *task_runner) const {
   TC3_CHECK(results != nullptr);
 
-  std::vector<int32_t> wordpiece_indices;
-  std::vector<int32_t> token_starts;
-  std::vector<Token> tokens;
-  if (!PrepareText(context, &wordpiece_indices, &token_starts, &tokens)) {
+  PreparedText text;
+  if (!PrepareWindows(context, span_of_interest, &text)) {
+    return false;
+  }
+
+  std::vector<Window *> windows;
+  for (Window &window : text.windows) {
+    windows.push_back(&window);
+  }
+  ExecuteWindows(windows, task_runner);
+
+  return MergeWindows(text, results);
+}
+
+bool PodNerAnnotator::PrepareWindows(const UnicodeText &context,
+                                     const CodepointSpan &span_of_interest,
+                                     PreparedText *text) const {
+  if (!PrepareText(context, &text->wordpiece_indices, &text->token_starts,
+                   &text->tokens)) {
     TC3_LOG(ERROR) << "PodNerAnnotator PrepareText(...) failed.";
     return false;
   }
+  const std::vector<int32_t> &wordpiece_indices = text->wordpiece_indices;
+  const std::vector<Token> &tokens = text->tokens;
   const int unknown_wordpieces_count =
       std::count(wordpiece_indices.begin(), wordpiece_indices.end(),
                  unknown_wordpiece_id_);
@@ -415,42 +503,102 @@ bool PodNerAnnotator::AnnotateAroundSpanOfInterest(
     return true;
   }
 
-  std::vector<LabelT> labels;
-  int first_token_index_entire_window = 0;
-
   WindowGenerator window_generator(
-      wordpiece_indices, token_starts, tokens, max_num_effective_wordpieces_,
-      sliding_window_num_wordpieces_overlap_, span_of_interest);
+      wordpiece_indices, text->token_starts, tokens,
+      max_num_effective_wordpieces_, sliding_window_num_wordpieces_overlap_,
+      span_of_interest);
   while (!window_generator.Done()) {
-    VectorSpan<int32_t> cur_wordpiece_indices;
-    VectorSpan<int32_t> cur_token_starts;
-    VectorSpan<Token> cur_tokens;
-    if (!window_generator.Next(&cur_wordpiece_indices, &cur_token_starts,
-                               &cur_tokens) ||
-        cur_tokens.size() <= 0 || cur_token_starts.size() <= 0 ||
-        cur_wordpiece_indices.size() <= 0) {
+    Window window;
+    if (!window_generator.Next(&window.wordpiece_indices, &window.token_starts,
+                               &window.tokens) ||
+        window.tokens.size() <= 0 || window.token_starts.size() <= 0 ||
+        window.wordpiece_indices.size() <= 0) {
       return false;
     }
-    std::vector<LabelT> new_labels =
-        ExecuteModel(cur_wordpiece_indices, cur_token_starts, cur_tokens);
-    if (labels.empty()) {  // First loop.
-      first_token_index_entire_window = cur_tokens.begin() - tokens.begin();
+    text->windows.push_back(std::move(window));
+  }
+
+  // A text that should be annotated but has no windows is an error.
+  return !text->windows.empty();
+}
+
+void PodNerAnnotator::ExecuteWindows(const std::vector<Window *> &windows,
+                                     TaskRunner *task_runner) const {
+  if (windows.empty()) {
+    return;
+  }
+
+  const int num_shards =
+      task_runner == nullptr
+          ? 1
+          : std::max(1, std::min(task_runner->NumWorkers(),
+                                 static_cast<int>(windows.size())));
+
+  // Contiguous windows mostly have the same shape, so the interpreter of a
+  // shard rarely needs to be resized.
+  auto execute_shard = [this, &windows, num_shards](int shard) {
+    PooledObject<tflite::Interpreter> interpreter(interpreter_pool_.get());
+    if (!interpreter) {
+      TC3_LOG(ERROR) << "Couldn't create Interpreter.";
+      return;
+    }
+    const int begin = static_cast<int64>(shard) * windows.size() / num_shards;
+    const int end =
+        static_cast<int64>(shard + 1) * windows.size() / num_shards;
+    for (int i = begin; i < end; ++i) {
+      Window *window = windows[i];
+      window->labels =
+          ExecuteModel(interpreter.get(), window->wordpiece_indices,
+                       window->token_starts, window->tokens);
+    }
+  };
+
+  if (num_shards == 1) {
+    execute_shard(0);
+    return;
+  }
+  // The shards run on the workers of the task runner. Attribute their model
+  // invocations to the stage of the calling thread.
+  ScopedStage *const stage = ScopedStage::Current();
+  std::vector<std::function<void()>> tasks;
+  tasks.reserve(num_shards);
+  for (int shard = 0; shard < num_shards; ++shard) {
+    tasks.push_back([&execute_shard, shard, stage]() {
+      ScopedStage::ThreadScope stage_scope(stage);
+      execute_shard(shard);
+    });
+  }
+  task_runner->RunAll(tasks);
+}
+
+bool PodNerAnnotator::MergeWindows(const PreparedText &text,
+                                   std::vector<AnnotatedSpan> *results) const {
+  TC3_CHECK(results != nullptr);
+  if (text.windows.empty()) {
+    // The text was not meant to be annotated.
+    return true;
+  }
+
+  std::vector<LabelT> labels;
+  const int first_token_index_entire_window =
+      text.windows.front().tokens.begin() - text.tokens.begin();
+  for (const Window &window : text.windows) {
+    if (window.labels.empty()) {
+      // The model failed on this window.
+      return false;
     }
     if (!MergeLabelsIntoLeftSequence(
-            /*labels_right=*/new_labels,
-            /*index_first_right_tag_in_left=*/cur_tokens.begin() -
-                tokens.begin() - first_token_index_entire_window,
+            /*labels_right=*/window.labels,
+            /*index_first_right_tag_in_left=*/window.tokens.begin() -
+                text.tokens.begin() - first_token_index_entire_window,
             /*labels_left=*/&labels)) {
       return false;
     }
   }
 
-  if (labels.empty()) {
-    return false;
-  }
   ConvertTagsToAnnotatedSpans(
-      VectorSpan<Token>(tokens.begin() + first_token_index_entire_window,
-                        tokens.end()),
+      VectorSpan<Token>(text.tokens.begin() + first_token_index_entire_window,
+                        text.tokens.end()),
       labels, collections_, {PodNerModel_::Label_::MentionType_NAM},
       /*relaxed_inside_label_matching=*/false,
       /*relaxed_mention_type_matching=*/false, results);
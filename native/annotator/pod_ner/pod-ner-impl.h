@@ -22,6 +22,8 @@
 #include "annotator/model_generated.h"
 #include "annotator/types.h"
 #include "utils/bert_tokenizer.h"
+#include "utils/container/object-pool.h"
+#include "utils/task-runner.h"
 #include "utils/utf8/unicodetext.h"
 #include "utils/utf8/unilib.h"
 #include "tensorflow/lite/context.h"
@@ -37,8 +39,17 @@ class PodNerAnnotator {
   static std::unique_ptr<PodNerAnnotator> Create(const PodNerModel *model,
                                                  const UniLib &unilib);
 
-  bool Annotate(const UnicodeText &context,
-                std::vector<AnnotatedSpan> *results) const;
+  // If a task runner is given, the sliding windows of a long text are run
+  // through the model in parallel on it.
+  bool Annotate(const UnicodeText &context, std::vector<AnnotatedSpan> *results,
+                TaskRunner *task_runner = nullptr) const;
+
+  // Annotates several texts at once. The windows of all the texts are run
+  // together, spread over the workers of the task runner if one is given.
+  // The results are the same as the ones of Annotate() for each text.
+  bool AnnotateBatch(const std::vector<UnicodeText> &contexts,
+                     std::vector<std::vector<AnnotatedSpan>> *results,
+                     TaskRunner *task_runner = nullptr) const;
 
   // Returns true if an entity was detected under 'click', and the selection
   // indices expanded and assigned to 'result'. Otherwise returns false, and
@@ -54,10 +65,34 @@ class PodNerAnnotator {
  private:
   explicit PodNerAnnotator(const UniLib &unilib) : unilib_(unilib) {}
 
+  // A window of a text that is run through the model, and its labels.
+  struct Window {
+    VectorSpan<int32_t> wordpiece_indices;
+    VectorSpan<int32_t> token_starts;
+    VectorSpan<Token> tokens;
+    std::vector<PodNerModel_::LabelT> labels;
+  };
+
+  // A tokenized text and the windows it is split into. The windows point into
+  // the vectors of the text.
+  struct PreparedText {
+    std::vector<int32_t> wordpiece_indices;
+    std::vector<int32_t> token_starts;
+    std::vector<Token> tokens;
+    std::vector<Window> windows;
+  };
+
   std::vector<PodNerModel_::LabelT> ReadResultsFromInterpreter(
       tflite::Interpreter &interpreter) const;
 
+  // Creates an interpreter with the tensors allocated for the largest window,
+  // so that the arena never needs to grow for smaller windows.
+  std::unique_ptr<tflite::Interpreter> CreateWarmInterpreter() const;
+
+  // Runs the model on one window. The interpreter must be exclusively owned by
+  // the caller; its inputs are only resized when the window shape changes.
   std::vector<PodNerModel_::LabelT> ExecuteModel(
+      tflite::Interpreter *interpreter,
       const VectorSpan<int> &wordpiece_indices,
       const VectorSpan<int32_t> &token_starts,
       const VectorSpan<Token> &tokens) const;
@@ -67,9 +102,27 @@ class PodNerAnnotator {
                    std::vector<int32_t> *token_starts,
                    std::vector<Token> *tokens) const;
 
+  // Tokenizes the text and splits it into the windows covering the span of
+  // interest. Texts that should not be annotated (e.g. too short ones) get no
+  // windows. Returns false on error.
+  bool PrepareWindows(const UnicodeText &context,
+                      const CodepointSpan &span_of_interest,
+                      PreparedText *text) const;
+
+  // Runs the model on the windows and stores their labels. The windows are
+  // split into contiguous shards, each run on its own pooled interpreter.
+  void ExecuteWindows(const std::vector<Window *> &windows,
+                      TaskRunner *task_runner) const;
+
+  // Merges the labels of the overlapping windows of the text and converts
+  // them to annotated spans.
+  bool MergeWindows(const PreparedText &text,
+                    std::vector<AnnotatedSpan> *results) const;
+
   bool AnnotateAroundSpanOfInterest(const UnicodeText &context,
                                     const CodepointSpan &span_of_interest,
-                                    std::vector<AnnotatedSpan> *results) const;
+                                    std::vector<AnnotatedSpan> *results,
+                                    TaskRunner *task_runner = nullptr) const;
 
   const UniLib &unilib_;
   bool lowercase_input_;
@@ -88,6 +141,11 @@ class PodNerAnnotator {
   std::vector<PodNerModel_::LabelT> labels_;
   std::unique_ptr<BertTokenizer> tokenizer_;
   const PodNerModel *model_;
+  std::unique_ptr<tflite::OpResolver> op_resolver_;
+
+  // Idle interpreters shared by the concurrent calls. Each call checks out one
+  // interpreter and reuses it for all of its windows.
+  std::unique_ptr<ObjectPool<tflite::Interpreter>> interpreter_pool_;
 };
 
 }  // namespace libtextclassifier3
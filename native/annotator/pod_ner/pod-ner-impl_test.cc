@@ -23,6 +23,7 @@
 #include "annotator/model_generated.h"
 #include "annotator/types.h"
 #include "utils/jvm-test-utils.h"
+#include "utils/task-runner.h"
 #include "utils/test-data-test-utils.h"
 #include "utils/tokenizer-utils.h"
 #include "utils/utf8/unicodetext.h"
@@ -536,6 +537,68 @@ TEST_F(PodNerTest, ClassifyTextTest) {
   EXPECT_EQ(result.collection, "location");
 }
 
+TEST_F(PodNerTest, AnnotateWithReusedInterpreter) {
+  std::unique_ptr<PodNerAnnotator> annotator =
+      PodNerAnnotator::Create(model_, *unilib_);
+  ASSERT_TRUE(annotator != nullptr);
+
+  // The calls share one interpreter, whose inputs are resized in between.
+  const UnicodeText short_text =
+      UTF8ToUnicodeText("Google New York, in New York");
+  const UnicodeText longer_text = UTF8ToUnicodeText(
+      "Jamie I'm in the first picture and Cameron and Zach are in the second "
+      "picture.");
+  std::vector<AnnotatedSpan> first_annotations;
+  ASSERT_TRUE(annotator->Annotate(short_text, &first_annotations));
+  std::vector<AnnotatedSpan> longer_annotations;
+  ASSERT_TRUE(annotator->Annotate(longer_text, &longer_annotations));
+  EXPECT_THAT(longer_annotations, Not(IsEmpty()));
+  std::vector<AnnotatedSpan> second_annotations;
+  ASSERT_TRUE(annotator->Annotate(short_text, &second_annotations));
+
+  ASSERT_EQ(first_annotations.size(), second_annotations.size());
+  for (int i = 0; i < first_annotations.size(); ++i) {
+    EXPECT_EQ(first_annotations[i].span, second_annotations[i].span);
+    ASSERT_THAT(second_annotations[i].classification, Not(IsEmpty()));
+    EXPECT_EQ(first_annotations[i].classification[0].collection,
+              second_annotations[i].classification[0].collection);
+  }
+}
+
+TEST_F(PodNerTest, AnnotateBatchMatchesAnnotate) {
+  std::unique_ptr<PodNerAnnotator> annotator =
+      PodNerAnnotator::Create(model_, *unilib_);
+  ASSERT_TRUE(annotator != nullptr);
+
+  // Long enough to be split into several sliding windows.
+  std::string long_text;
+  for (int i = 0; i < 30; ++i) {
+    long_text += "Visit the Klondike Gold Rush Museum in Seattle with Zach. ";
+  }
+  const std::vector<UnicodeText> contexts = {
+      UTF8ToUnicodeText("Google New York, in New York"),
+      UTF8ToUnicodeText(long_text), UTF8ToUnicodeText(""),
+      UTF8ToUnicodeText("We met in New York")};
+
+  ThreadPoolTaskRunner task_runner(/*num_threads=*/3);
+  std::vector<std::vector<AnnotatedSpan>> batch_annotations;
+  ASSERT_TRUE(
+      annotator->AnnotateBatch(contexts, &batch_annotations, &task_runner));
+  ASSERT_EQ(batch_annotations.size(), contexts.size());
+
+  for (int i = 0; i < contexts.size(); ++i) {
+    std::vector<AnnotatedSpan> annotations;
+    ASSERT_TRUE(annotator->Annotate(contexts[i], &annotations));
+    ASSERT_EQ(batch_annotations[i].size(), annotations.size());
+    for (int j = 0; j < annotations.size(); ++j) {
+      EXPECT_EQ(batch_annotations[i][j].span, annotations[j].span);
+      EXPECT_EQ(batch_annotations[i][j].classification[0].collection,
+                annotations[j].classification[0].collection);
+    }
+  }
+  EXPECT_THAT(batch_annotations[1], Not(IsEmpty()));
+}
+
 TEST_F(PodNerTest, ThreadSafety) {
   std::unique_ptr<PodNerAnnotator> annotator =
       PodNerAnnotator::Create(model_, *unilib_);
@@ -16,47 +16,121 @@
 
 #include "annotator/quantization.h"
 
+#include <algorithm>
+
 #include "utils/base/logging.h"
 
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TC3_QUANTIZATION_NEON
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TC3_QUANTIZATION_SSE2
+#endif
+
 namespace libtextclassifier3 {
 namespace {
-float DequantizeValue(int num_sparse_features, int quantization_bias,
-                      float multiplier, int value) {
-  return 1.0 / num_sparse_features * (value - quantization_bias) * multiplier;
+
+// The embedding rows are dequantized and accumulated in chunks of this many
+// values, so that the accumulators of all the buckets of a token stay in
+// registers / L1 cache.
+constexpr int kChunkSize = 64;
+
+// dest[i] += factor * values[i], for i in [0, size).
+void AddScaled(const float* values, float factor, int size, float* dest) {
+  int i = 0;
+#if defined(TC3_QUANTIZATION_NEON)
+  const float32x4_t factor4 = vdupq_n_f32(factor);
+  for (; i + 4 <= size; i += 4) {
+    vst1q_f32(dest + i,
+              vmlaq_f32(vld1q_f32(dest + i), vld1q_f32(values + i), factor4));
+  }
+#elif defined(TC3_QUANTIZATION_SSE2)
+  const __m128 factor4 = _mm_set1_ps(factor);
+  for (; i + 4 <= size; i += 4) {
+    _mm_storeu_ps(dest + i,
+                  _mm_add_ps(_mm_loadu_ps(dest + i),
+                             _mm_mul_ps(_mm_loadu_ps(values + i), factor4)));
+  }
+#endif
+  for (; i < size; ++i) {
+    dest[i] += factor * values[i];
+  }
 }
 
-void DequantizeAdd8bit(const float* scales, const uint8* embeddings,
-                       int bytes_per_embedding, const int num_sparse_features,
-                       const int bucket_id, float* dest, int dest_size) {
+// Unpacks `size` 8-bit quantized values into `values`, removing the bias.
+void Unpack8bit(const uint8* data, int size, float* values) {
   static const int kQuantizationBias8bit = 128;
-  const float multiplier = scales[bucket_id];
-  for (int k = 0; k < dest_size; ++k) {
-    dest[k] +=
-        DequantizeValue(num_sparse_features, kQuantizationBias8bit, multiplier,
-                        embeddings[bucket_id * bytes_per_embedding + k]);
+  int i = 0;
+#if defined(TC3_QUANTIZATION_NEON)
+  const int16x8_t bias = vdupq_n_s16(kQuantizationBias8bit);
+  for (; i + 8 <= size; i += 8) {
+    const int16x8_t centered =
+        vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(data + i))), bias);
+    vst1q_f32(values + i, vcvtq_f32_s32(vmovl_s16(vget_low_s16(centered))));
+    vst1q_f32(values + i + 4,
+              vcvtq_f32_s32(vmovl_s16(vget_high_s16(centered))));
+  }
+#elif defined(TC3_QUANTIZATION_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i bias = _mm_set1_epi16(kQuantizationBias8bit);
+  for (; i + 8 <= size; i += 8) {
+    const __m128i centered = _mm_sub_epi16(
+        _mm_unpacklo_epi8(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data + i)), zero),
+        bias);
+    // Sign-extends the 16-bit values to 32 bits.
+    _mm_storeu_ps(values + i,
+                  _mm_cvtepi32_ps(_mm_srai_epi32(
+                      _mm_unpacklo_epi16(centered, centered), 16)));
+    _mm_storeu_ps(values + i + 4,
+                  _mm_cvtepi32_ps(_mm_srai_epi32(
+                      _mm_unpackhi_epi16(centered, centered), 16)));
+  }
+#endif
+  for (; i < size; ++i) {
+    values[i] = data[i] - kQuantizationBias8bit;
   }
 }
 
-void DequantizeAddNBit(const float* scales, const uint8* embeddings,
-                       int bytes_per_embedding, int num_sparse_features,
-                       int quantization_bits, int bucket_id, float* dest,
-                       int dest_size) {
+// Unpacks `size` N-bit quantized values into `values`, removing the bias.
+// The values are packed little-endian, starting at the lowest bit of `data`.
+void UnpackNBit(const uint8* data, int quantization_bits, int size,
+                float* values) {
   const int quantization_bias = 1 << (quantization_bits - 1);
-  const float multiplier = scales[bucket_id];
-  for (int i = 0; i < dest_size; ++i) {
-    const int bit_offset = i * quantization_bits;
-    const int read16_offset = bit_offset / 8;
-
-    uint16 data = embeddings[bucket_id * bytes_per_embedding + read16_offset];
-    // If we are not at the end of the embedding row, we can read 2-byte uint16,
-    // but if we are, we need to only read uint8.
-    if (read16_offset < bytes_per_embedding - 1) {
-      data |= embeddings[bucket_id * bytes_per_embedding + read16_offset + 1]
-              << 8;
+  const uint32 mask = (1 << quantization_bits) - 1;
+  if (8 % quantization_bits == 0) {
+    // The values don't cross byte boundaries.
+    const int values_per_byte = 8 / quantization_bits;
+    int i = 0;
+    for (; i + values_per_byte <= size; i += values_per_byte) {
+      uint32 byte = *data++;
+      for (int k = 0; k < values_per_byte; ++k) {
+        values[i + k] = static_cast<int>(byte & mask) - quantization_bias;
+        byte >>= quantization_bits;
+      }
     }
-    int value = (data >> (bit_offset % 8)) & ((1 << quantization_bits) - 1);
-    dest[i] += DequantizeValue(num_sparse_features, quantization_bias,
-                               multiplier, value);
+    if (i < size) {
+      uint32 byte = *data;
+      for (; i < size; ++i) {
+        values[i] = static_cast<int>(byte & mask) - quantization_bias;
+        byte >>= quantization_bits;
+      }
+    }
+    return;
+  }
+
+  // Only reads the bytes that hold bits of the requested values.
+  uint32 buffer = 0;
+  int num_buffered_bits = 0;
+  for (int i = 0; i < size; ++i) {
+    if (num_buffered_bits < quantization_bits) {
+      buffer |= static_cast<uint32>(*data++) << num_buffered_bits;
+      num_buffered_bits += 8;
+    }
+    values[i] = static_cast<int>(buffer & mask) - quantization_bias;
+    buffer >>= quantization_bits;
+    num_buffered_bits -= quantization_bits;
   }
 }
 }  // namespace
@@ -74,18 +148,44 @@ bool DequantizeAdd(const float* scales, const uint8* embeddings,
                    int bytes_per_embedding, int num_sparse_features,
                    int quantization_bits, int bucket_id, float* dest,
                    int dest_size) {
-  if (quantization_bits == 8) {
-    DequantizeAdd8bit(scales, embeddings, bytes_per_embedding,
-                      num_sparse_features, bucket_id, dest, dest_size);
-  } else if (quantization_bits != 8) {
-    DequantizeAddNBit(scales, embeddings, bytes_per_embedding,
-                      num_sparse_features, quantization_bits, bucket_id, dest,
-                      dest_size);
-  } else {
+  return DequantizeAddMultiple(scales, embeddings, bytes_per_embedding,
+                               num_sparse_features, quantization_bits,
+                               &bucket_id, /*num_bucket_ids=*/1, dest,
+                               dest_size);
+}
+
+bool DequantizeAddMultiple(const float* scales, const uint8* embeddings,
+                           int bytes_per_embedding, int num_sparse_features,
+                           int quantization_bits, const int* bucket_ids,
+                           int num_bucket_ids, float* dest, int dest_size) {
+  if (quantization_bits < 1 || quantization_bits > 8) {
     TC3_LOG(ERROR) << "Unsupported quantization_bits: " << quantization_bits;
     return false;
   }
 
+  const double normalizer = 1.0 / num_sparse_features;
+  float values[kChunkSize];
+  float accumulator[kChunkSize];
+  for (int begin = 0; begin < dest_size; begin += kChunkSize) {
+    const int size = std::min(kChunkSize, dest_size - begin);
+    // The chunks start at byte boundaries, as kChunkSize is a multiple of 8.
+    const int byte_offset = begin / 8 * quantization_bits;
+    std::fill(accumulator, accumulator + size, 0.0f);
+    for (int i = 0; i < num_bucket_ids; ++i) {
+      const int bucket_id = bucket_ids[i];
+      const uint8* data =
+          embeddings + bucket_id * bytes_per_embedding + byte_offset;
+      if (quantization_bits == 8) {
+        Unpack8bit(data, size, values);
+      } else {
+        UnpackNBit(data, quantization_bits, size, values);
+      }
+      AddScaled(values, static_cast<float>(normalizer * scales[bucket_id]),
+                size, accumulator);
+    }
+    AddScaled(accumulator, 1.0f, size, dest + begin);
+  }
+
   return true;
 }
 
@@ -34,6 +34,14 @@ bool DequantizeAdd(const float* scales, const uint8* embeddings,
                    int quantization_bits, int bucket_id, float* dest,
                    int dest_size);
 
+// Same as DequantizeAdd, but adds up the embeddings of all the buckets in
+// `bucket_ids` in a single pass over `dest`. `num_sparse_features` is the
+// normalizer of the embeddings, independent of `num_bucket_ids`.
+bool DequantizeAddMultiple(const float* scales, const uint8* embeddings,
+                           int bytes_per_embedding, int num_sparse_features,
+                           int quantization_bits, const int* bucket_ids,
+                           int num_bucket_ids, float* dest, int dest_size);
+
 }  // namespace libtextclassifier3
 
 #endif  // LIBTEXTCLASSIFIER_ANNOTATOR_QUANTIZATION_H_
@@ -16,6 +16,7 @@
 
 #include "annotator/quantization.h"
 
+#include <random>
 #include <vector>
 
 #include "gmock/gmock.h"
@@ -159,5 +160,63 @@ TEST(QuantizationTest, DequantizeAdd3bit) {
   EXPECT_THAT(dest, ElementsAreFloat(expected));
 }
 
+// Straightforward implementation of the dequantization, one value at a time.
+float ReferenceDequantizedValue(const float* scales, const uint8* embeddings,
+                                int bytes_per_embedding,
+                                int num_sparse_features, int quantization_bits,
+                                int bucket_id, int index) {
+  int value = 0;
+  for (int bit = 0; bit < quantization_bits; ++bit) {
+    const int bit_offset = index * quantization_bits + bit;
+    if (embeddings[bucket_id * bytes_per_embedding + bit_offset / 8] &
+        (1 << (bit_offset % 8))) {
+      value |= 1 << bit;
+    }
+  }
+  return 1.0 / num_sparse_features * scales[bucket_id] *
+         (value - (1 << (quantization_bits - 1)));
+}
+
+TEST(QuantizationTest, DequantizeAddMultipleMatchesReference) {
+  std::mt19937 random(/*seed=*/42);
+  const int num_buckets = 5;
+  const int num_sparse_features = 3;
+  const std::vector<int> bucket_ids = {4, 0, 2};
+  for (int quantization_bits = 1; quantization_bits <= 8;
+       ++quantization_bits) {
+    for (const int dest_size : {1, 7, 64, 100}) {
+      const int bytes_per_embedding =
+          (dest_size * quantization_bits + 7) / 8;
+      std::vector<float> scales(num_buckets);
+      for (float& scale : scales) {
+        scale = std::uniform_real_distribution<float>(-2.0, 2.0)(random);
+      }
+      std::vector<uint8> embeddings(num_buckets * bytes_per_embedding);
+      for (uint8& byte : embeddings) {
+        byte = std::uniform_int_distribution<int>(0, 255)(random);
+      }
+
+      std::vector<float> expected(dest_size, 1.0);
+      for (const int bucket_id : bucket_ids) {
+        for (int i = 0; i < dest_size; ++i) {
+          expected[i] += ReferenceDequantizedValue(
+              scales.data(), embeddings.data(), bytes_per_embedding,
+              num_sparse_features, quantization_bits, bucket_id, i);
+        }
+      }
+
+      std::vector<float> dest(dest_size, 1.0);
+      ASSERT_TRUE(DequantizeAddMultiple(
+          scales.data(), embeddings.data(), bytes_per_embedding,
+          num_sparse_features, quantization_bits, bucket_ids.data(),
+          bucket_ids.size(), dest.data(), dest.size()));
+      for (int i = 0; i < dest_size; ++i) {
+        EXPECT_NEAR(dest[i], expected[i], 1e-4)
+            << "bits: " << quantization_bits << ", index: " << i;
+      }
+    }
+  }
+}
+
 }  // namespace
 }  // namespace libtextclassifier3
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "annotator/token-embedding-cache.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace libtextclassifier3 {
+
+TokenEmbeddingCache::Shard::Shard(int embedding_size, int capacity)
+    : capacity(capacity) {
+  entry_for_key.reserve(capacity);
+  keys.reserve(capacity);
+  prev.reserve(capacity);
+  next.reserve(capacity);
+  embeddings.reserve(capacity * embedding_size);
+}
+
+void TokenEmbeddingCache::Shard::Unlink(int entry) {
+  if (prev[entry] >= 0) {
+    next[prev[entry]] = next[entry];
+  } else {
+    head = next[entry];
+  }
+  if (next[entry] >= 0) {
+    prev[next[entry]] = prev[entry];
+  } else {
+    tail = prev[entry];
+  }
+}
+
+void TokenEmbeddingCache::Shard::PushFront(int entry) {
+  prev[entry] = -1;
+  next[entry] = head;
+  if (head >= 0) {
+    prev[head] = entry;
+  }
+  head = entry;
+  if (tail < 0) {
+    tail = entry;
+  }
+}
+
+void TokenEmbeddingCache::Shard::Touch(int entry) {
+  if (entry != head) {
+    Unlink(entry);
+    PushFront(entry);
+  }
+}
+
+TokenEmbeddingCache::TokenEmbeddingCache(int embedding_size,
+                                         int max_num_entries, int num_shards)
+    : embedding_size_(embedding_size) {
+  num_shards = std::max(1, std::min(num_shards, max_num_entries));
+  for (int i = 0; i < num_shards; i++) {
+    // Distribute the entries evenly, the first shards get the remainder.
+    const int capacity =
+        max_num_entries / num_shards + (i < max_num_entries % num_shards);
+    shards_.emplace_back(new Shard(embedding_size, capacity));
+  }
+}
+
+TokenEmbeddingCache::Shard* TokenEmbeddingCache::ShardForKey(
+    uint64 key) const {
+  // The keys are fingerprints, so their high bits are as good as any.
+  return shards_[(key >> 32) % shards_.size()].get();
+}
+
+bool TokenEmbeddingCache::Lookup(uint64 key, float* dest) {
+  Shard* shard = ShardForKey(key);
+  {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    const auto it = shard->entry_for_key.find(key);
+    if (it != shard->entry_for_key.end()) {
+      shard->Touch(it->second);
+      memcpy(dest, shard->embeddings.data() + it->second * embedding_size_,
+             embedding_size_ * sizeof(float));
+      hits_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+void TokenEmbeddingCache::Insert(uint64 key, const float* embedding) {
+  Shard* shard = ShardForKey(key);
+  std::lock_guard<std::mutex> lock(shard->mutex);
+  if (shard->capacity == 0) {
+    return;
+  }
+  int entry;
+  const auto it = shard->entry_for_key.find(key);
+  if (it != shard->entry_for_key.end()) {
+    // Another thread inserted the same embedding in the meantime.
+    entry = it->second;
+    shard->Touch(entry);
+  } else if (shard->keys.size() < shard->capacity) {
+    entry = shard->keys.size();
+    shard->keys.push_back(key);
+    shard->prev.push_back(-1);
+    shard->next.push_back(-1);
+    shard->embeddings.resize(shard->embeddings.size() + embedding_size_);
+    shard->PushFront(entry);
+    shard->entry_for_key[key] = entry;
+  } else {
+    // Reuse the slot of the least recently used entry.
+    entry = shard->tail;
+    shard->entry_for_key.erase(shard->keys[entry]);
+    shard->keys[entry] = key;
+    shard->Touch(entry);
+    shard->entry_for_key[key] = entry;
+  }
+  memcpy(shard->embeddings.data() + entry * embedding_size_, embedding,
+         embedding_size_ * sizeof(float));
+}
+
+TokenEmbeddingCache::Stats TokenEmbeddingCache::GetStats() const {
+  Stats stats;
+  stats.hits = hits_.load(std::memory_order_relaxed);
+  stats.misses = misses_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+}  // namespace libtextclassifier3
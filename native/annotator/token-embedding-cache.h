@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBTEXTCLASSIFIER_ANNOTATOR_TOKEN_EMBEDDING_CACHE_H_
+#define LIBTEXTCLASSIFIER_ANNOTATOR_TOKEN_EMBEDDING_CACHE_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+#include <vector>
+
+#include "utils/base/integral_types.h"
+
+namespace libtextclassifier3 {
+
+// A bounded cache of token embeddings, keyed by a fingerprint of the token, to
+// be shared between the calls and threads using one feature processor.
+// The cache is split into independently locked shards, each keeping its
+// embeddings in a flat arena and evicting the least recently used entry when
+// full.
+class TokenEmbeddingCache {
+ public:
+  struct Stats {
+    int64 hits = 0;
+    int64 misses = 0;
+
+    // Fraction of the lookups that were answered by the cache.
+    float HitRate() const {
+      return hits + misses > 0 ? static_cast<float>(hits) / (hits + misses)
+                               : 0.0;
+    }
+  };
+
+  // Caches up to `max_num_entries` embeddings of `embedding_size` floats.
+  TokenEmbeddingCache(int embedding_size, int max_num_entries,
+                      int num_shards = 16);
+
+  TokenEmbeddingCache(const TokenEmbeddingCache&) = delete;
+  TokenEmbeddingCache& operator=(const TokenEmbeddingCache&) = delete;
+
+  // Copies the cached embedding for `key` to `dest` and returns true, or
+  // returns false if the embedding is not cached.
+  bool Lookup(uint64 key, float* dest);
+
+  // Caches the embedding for `key`.
+  void Insert(uint64 key, const float* embedding);
+
+  Stats GetStats() const;
+
+  int embedding_size() const { return embedding_size_; }
+
+ private:
+  // A shard caches a subset of the keys, the entries form a doubly linked list
+  // in the order of their last use.
+  struct Shard {
+    explicit Shard(int embedding_size, int capacity);
+
+    // Moves the entry to the front of the list of recently used entries.
+    void Touch(int entry);
+    void Unlink(int entry);
+    void PushFront(int entry);
+
+    std::mutex mutex;
+    const int capacity;
+    std::unordered_map<uint64, int> entry_for_key;
+    std::vector<uint64> keys;
+    std::vector<int> prev;
+    std::vector<int> next;
+    int head = -1;
+    int tail = -1;
+    std::vector<float> embeddings;
+  };
+
+  Shard* ShardForKey(uint64 key) const;
+
+  const int embedding_size_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::atomic<int64> hits_{0};
+  std::atomic<int64> misses_{0};
+};
+
+}  // namespace libtextclassifier3
+
+#endif  // LIBTEXTCLASSIFIER_ANNOTATOR_TOKEN_EMBEDDING_CACHE_H_
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "annotator/token-embedding-cache.h"
+
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace libtextclassifier3 {
+namespace {
+
+using testing::ElementsAre;
+
+TEST(TokenEmbeddingCacheTest, LooksUpInsertedEmbeddings) {
+  TokenEmbeddingCache cache(/*embedding_size=*/2, /*max_num_entries=*/10);
+  std::vector<float> embedding(2);
+  EXPECT_FALSE(cache.Lookup(1, embedding.data()));
+
+  const std::vector<float> inserted = {1.0, 2.0};
+  cache.Insert(1, inserted.data());
+  EXPECT_TRUE(cache.Lookup(1, embedding.data()));
+  EXPECT_THAT(embedding, ElementsAre(1.0, 2.0));
+  EXPECT_FALSE(cache.Lookup(2, embedding.data()));
+
+  const TokenEmbeddingCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 2);
+  EXPECT_FLOAT_EQ(stats.HitRate(), 1.0 / 3);
+}
+
+TEST(TokenEmbeddingCacheTest, EvictsLeastRecentlyUsed) {
+  TokenEmbeddingCache cache(/*embedding_size=*/1, /*max_num_entries=*/2,
+                            /*num_shards=*/1);
+  float embedding;
+  const float values[] = {10.0, 20.0, 30.0};
+  cache.Insert(0, &values[0]);
+  cache.Insert(1, &values[1]);
+
+  // Makes 1 the least recently used entry.
+  EXPECT_TRUE(cache.Lookup(0, &embedding));
+  cache.Insert(2, &values[2]);
+
+  EXPECT_TRUE(cache.Lookup(0, &embedding));
+  EXPECT_EQ(embedding, 10.0);
+  EXPECT_FALSE(cache.Lookup(1, &embedding));
+  EXPECT_TRUE(cache.Lookup(2, &embedding));
+  EXPECT_EQ(embedding, 30.0);
+}
+
+TEST(TokenEmbeddingCacheTest, HandlesZeroCapacity) {
+  TokenEmbeddingCache cache(/*embedding_size=*/1, /*max_num_entries=*/0);
+  const float value = 1.0;
+  cache.Insert(0, &value);
+  float embedding;
+  EXPECT_FALSE(cache.Lookup(0, &embedding));
+}
+
+TEST(TokenEmbeddingCacheTest, IsThreadSafe) {
+  const int kEmbeddingSize = 8;
+  TokenEmbeddingCache cache(kEmbeddingSize, /*max_num_entries=*/64,
+                            /*num_shards=*/4);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&cache, t]() {
+      std::vector<float> embedding(kEmbeddingSize);
+      for (int i = 0; i < 1000; i++) {
+        // The embedding of a key is filled with the key.
+        const uint64 key = ((i * 7 + t) % 100) * 0x100000001ULL;
+        if (cache.Lookup(key, embedding.data())) {
+          EXPECT_THAT(embedding,
+                      testing::Each(static_cast<float>(key >> 32)));
+        } else {
+          std::fill(embedding.begin(), embedding.end(), key >> 32);
+          cache.Insert(key, embedding.data());
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  const TokenEmbeddingCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(stats.hits + stats.misses, 4000);
+}
+
+}  // namespace
+}  // namespace libtextclassifier3
@@ -22,6 +22,8 @@
 #include <algorithm>
 #include <cmath>
 #include <functional>
+#include <iterator>
+#include <limits>
 #include <map>
 #include <set>
 #include <string>
@@ -35,6 +37,7 @@
 #include "utils/base/logging.h"
 #include "utils/flatbuffers/flatbuffers.h"
 #include "utils/optional.h"
+#include "utils/stage-timings.h"
 #include "utils/variant.h"
 
 namespace libtextclassifier3 {
@@ -106,37 +109,40 @@ inline bool SpanContains(const CodepointSpan& span,
   return span.first <= sub_span.first && span.second >= sub_span.second;
 }
 
-template <typename T>
-bool DoesCandidateConflict(
-    const int considered_candidate, const std::vector<T>& candidates,
-    const std::set<int, std::function<bool(int, int)>>& chosen_indices_set) {
-  if (chosen_indices_set.empty()) {
-    return false;
+// A set of mutually non-overlapping spans, kept sorted in a balanced tree.
+// Used for the greedy conflict resolution, where candidates are placed one by
+// one if they don't overlap with any of the already placed ones. Both the
+// lookup and the insertion are logarithmic, so placing k spans is O(k log k).
+class DisjointSpanSet {
+ public:
+  // Returns whether the span overlaps with any span in the set.
+  bool Overlaps(const CodepointSpan& span) const {
+    // The spans are disjoint, so only the first span starting after the start
+    // of `span` and the last one starting before it can overlap with it.
+    const auto it = spans_.upper_bound(CodepointSpan(
+        span.first, std::numeric_limits<CodepointIndex>::max()));
+    if (it != spans_.end() && SpansOverlap(*it, span)) {
+      return true;
+    }
+    return it != spans_.begin() && SpansOverlap(*std::prev(it), span);
   }
 
-  auto conflicting_it = chosen_indices_set.lower_bound(considered_candidate);
-  // Check conflict on the right.
-  if (conflicting_it != chosen_indices_set.end() &&
-      SpansOverlap(candidates[considered_candidate].span,
-                   candidates[*conflicting_it].span)) {
-    return true;
-  }
+  // Adds a span that doesn't overlap with any span in the set.
+  void Insert(const CodepointSpan& span) { spans_.insert(span); }
 
-  // Check conflict on the left.
-  // If we can't go more left, there can't be a conflict:
-  if (conflicting_it == chosen_indices_set.begin()) {
-    return false;
-  }
-  // Otherwise move one span left and insert if it doesn't overlap with the
-  // candidate.
-  --conflicting_it;
-  if (!SpansOverlap(candidates[considered_candidate].span,
-                    candidates[*conflicting_it].span)) {
-    return false;
+  // Adds the span if it doesn't overlap with any span in the set. Returns
+  // whether the span was added.
+  bool InsertIfDisjoint(const CodepointSpan& span) {
+    if (Overlaps(span)) {
+      return false;
+    }
+    Insert(span);
+    return true;
   }
 
-  return true;
-}
+ private:
+  std::set<CodepointSpan> spans_;
+};
 
 // Marks a span in a sequence of tokens. The first element is the index of the
 // first token in the span, and the second element is the index of the token one
@@ -535,6 +541,11 @@ struct BaseOptions {
   // to annotate "Dictionary". Otherwise, we use the FFModel to do so.
   bool use_vocab_annotator = true;
 
+  // If not null, the stages of the call are recorded into it. Only takes
+  // effect if the library is built with TC3_STAGE_TIMINGS defined. Not part of
+  // the equality of the options.
+  StageTimings* stage_timings = nullptr;
+
   bool operator==(const BaseOptions& other) const {
     bool location_context_equality = this->location_context.has_value() ==
                                      other.location_context.has_value();
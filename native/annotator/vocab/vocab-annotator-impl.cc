@@ -61,7 +61,26 @@ bool VocabAnnotator::Annotate(
     const UnicodeText& context,
     const std::vector<Locale> detected_text_language_tags,
     bool trigger_on_beginner_words, std::vector<AnnotatedSpan>* results) const {
-  std::vector<Token> tokens = feature_processor_.Tokenize(context);
+  return Annotate(context, detected_text_language_tags,
+                  trigger_on_beginner_words, /*tokenization_cache=*/nullptr,
+                  results);
+}
+
+bool VocabAnnotator::Annotate(
+    const UnicodeText& context,
+    const std::vector<Locale> detected_text_language_tags,
+    bool trigger_on_beginner_words, TokenizationCache* tokenization_cache,
+    std::vector<AnnotatedSpan>* results) const {
+  const bool use_tokenization_cache =
+      tokenization_cache != nullptr && tokenization_cache->IsForText(context);
+  std::vector<Token> owned_tokens;
+  if (!use_tokenization_cache) {
+    owned_tokens = feature_processor_.Tokenize(context);
+  }
+  const std::vector<Token>& tokens =
+      use_tokenization_cache
+          ? tokenization_cache->Tokenize(feature_processor_.tokenizer())
+          : owned_tokens;
   for (const Token& token : tokens) {
     ClassificationResult classification_result;
     CodepointSpan stripped_span;
@@ -22,6 +22,7 @@
 #include "annotator/types.h"
 #include "annotator/vocab/vocab-level-table.h"
 #include "utils/i18n/locale.h"
+#include "utils/tokenizer.h"
 #include "utils/utf8/unicodetext.h"
 #include "utils/utf8/unilib.h"
 
@@ -40,6 +41,14 @@ class VocabAnnotator {
                 bool trigger_on_beginner_words,
                 std::vector<AnnotatedSpan> *results) const;
 
+  // Same as above, but takes the tokens from `tokenization_cache` if it is
+  // not null and holds the tokenizations of `context`.
+  bool Annotate(const UnicodeText &context,
+                const std::vector<Locale> detected_text_language_tags,
+                bool trigger_on_beginner_words,
+                TokenizationCache *tokenization_cache,
+                std::vector<AnnotatedSpan> *results) const;
+
   bool ClassifyText(const UnicodeText &context, CodepointSpan click,
                     const std::vector<Locale> detected_text_language_tags,
                     bool trigger_on_beginner_words,
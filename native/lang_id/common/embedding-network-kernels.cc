@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lang_id/common/embedding-network-kernels.h"
+
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SAFTM_EMBEDDING_NETWORK_NEON
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SAFTM_EMBEDDING_NETWORK_SSE2
+#endif
+
+namespace libtextclassifier3 {
+namespace mobile {
+
+void AddScaledRow(const float *w, float scale, int size, float *y) {
+  int i = 0;
+#if defined(SAFTM_EMBEDDING_NETWORK_NEON)
+  const float32x4_t scale4 = vdupq_n_f32(scale);
+  for (; i + 8 <= size; i += 8) {
+    vst1q_f32(y + i, vaddq_f32(vld1q_f32(y + i),
+                               vmulq_f32(vld1q_f32(w + i), scale4)));
+    vst1q_f32(y + i + 4, vaddq_f32(vld1q_f32(y + i + 4),
+                                   vmulq_f32(vld1q_f32(w + i + 4), scale4)));
+  }
+#elif defined(SAFTM_EMBEDDING_NETWORK_SSE2)
+  const __m128 scale4 = _mm_set1_ps(scale);
+  for (; i + 8 <= size; i += 8) {
+    _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i),
+                                    _mm_mul_ps(_mm_loadu_ps(w + i), scale4)));
+    _mm_storeu_ps(y + i + 4,
+                  _mm_add_ps(_mm_loadu_ps(y + i + 4),
+                             _mm_mul_ps(_mm_loadu_ps(w + i + 4), scale4)));
+  }
+#endif
+  for (; i < size; ++i) {
+    y[i] += w[i] * scale;
+  }
+}
+
+void AddScaledRow(const float16 *w, float scale, int size, float *y) {
+  int i = 0;
+  // A float16 holds the upper 16 bits of a float (see Float16To32), so the
+  // conversion is a widening shift.
+#if defined(SAFTM_EMBEDDING_NETWORK_NEON)
+  const float32x4_t scale4 = vdupq_n_f32(scale);
+  for (; i + 8 <= size; i += 8) {
+    const uint16x8_t w8 = vld1q_u16(w + i);
+    const float32x4_t w_low =
+        vreinterpretq_f32_u32(vshll_n_u16(vget_low_u16(w8), 16));
+    const float32x4_t w_high =
+        vreinterpretq_f32_u32(vshll_n_u16(vget_high_u16(w8), 16));
+    vst1q_f32(y + i, vaddq_f32(vld1q_f32(y + i), vmulq_f32(w_low, scale4)));
+    vst1q_f32(y + i + 4,
+              vaddq_f32(vld1q_f32(y + i + 4), vmulq_f32(w_high, scale4)));
+  }
+#elif defined(SAFTM_EMBEDDING_NETWORK_SSE2)
+  const __m128 scale4 = _mm_set1_ps(scale);
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 8 <= size; i += 8) {
+    const __m128i w8 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(w + i));
+    const __m128 w_low = _mm_castsi128_ps(_mm_unpacklo_epi16(zero, w8));
+    const __m128 w_high = _mm_castsi128_ps(_mm_unpackhi_epi16(zero, w8));
+    _mm_storeu_ps(y + i,
+                  _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(w_low, scale4)));
+    _mm_storeu_ps(y + i + 4, _mm_add_ps(_mm_loadu_ps(y + i + 4),
+                                        _mm_mul_ps(w_high, scale4)));
+  }
+#endif
+  for (; i < size; ++i) {
+    y[i] += Float16To32(w[i]) * scale;
+  }
+}
+
+void AddScaledUint8Row(const uint8 *w, float scale, int size, float *y) {
+  int i = 0;
+#if defined(SAFTM_EMBEDDING_NETWORK_NEON)
+  const float32x4_t scale4 = vdupq_n_f32(scale);
+  const int16x8_t bias8 = vdupq_n_s16(128);
+  for (; i + 8 <= size; i += 8) {
+    const int16x8_t w8 =
+        vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(w + i))), bias8);
+    const float32x4_t w_low = vcvtq_f32_s32(vmovl_s16(vget_low_s16(w8)));
+    const float32x4_t w_high = vcvtq_f32_s32(vmovl_s16(vget_high_s16(w8)));
+    vst1q_f32(y + i, vaddq_f32(vld1q_f32(y + i), vmulq_f32(w_low, scale4)));
+    vst1q_f32(y + i + 4,
+              vaddq_f32(vld1q_f32(y + i + 4), vmulq_f32(w_high, scale4)));
+  }
+#elif defined(SAFTM_EMBEDDING_NETWORK_SSE2)
+  const __m128 scale4 = _mm_set1_ps(scale);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i bias8 = _mm_set1_epi16(128);
+  for (; i + 8 <= size; i += 8) {
+    const __m128i w8 = _mm_sub_epi16(
+        _mm_unpacklo_epi8(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i *>(w + i)), zero),
+        bias8);
+    // Sign-extends the 16-bit values to 32 bits.
+    const __m128 w_low =
+        _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(w8, w8), 16));
+    const __m128 w_high =
+        _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(w8, w8), 16));
+    _mm_storeu_ps(y + i,
+                  _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(w_low, scale4)));
+    _mm_storeu_ps(y + i + 4, _mm_add_ps(_mm_loadu_ps(y + i + 4),
+                                        _mm_mul_ps(w_high, scale4)));
+  }
+#endif
+  for (; i < size; ++i) {
+    // 128 is bias for UINT8 quantization.
+    y[i] += (static_cast<int>(w[i]) - 128) * scale;
+  }
+}
+
+void AddScaledUint4Row(const uint8 *w, float scale, int size, float *y) {
+  // Dequantized (but not yet scaled) values of the two weights of each byte.
+  static const float *const kUint4Values = []() {
+    float *values = new float[2 * 256];
+    for (int qq = 0; qq < 256; ++qq) {
+      values[2 * qq] = static_cast<int>((qq & 0xF0) | 0x08) - 128;
+      values[2 * qq + 1] = static_cast<int>(((qq & 0x0F) << 4) | 0x08) - 128;
+    }
+    return values;
+  }();
+
+  // The weights are dequantized in chunks, which are then accumulated with
+  // the float kernel.  Only whole bytes are read, so a trailing odd weight is
+  // skipped.
+  static constexpr int kChunkSize = 64;
+  float chunk[kChunkSize];
+  const int even_size = size & ~1;
+  for (int begin = 0; begin < even_size; begin += kChunkSize) {
+    const int chunk_size = std::min(kChunkSize, even_size - begin);
+    const uint8 *chunk_w = w + begin / 2;
+    for (int i = 0; i < chunk_size / 2; ++i) {
+      const float *values = kUint4Values + 2 * chunk_w[i];
+      chunk[2 * i] = values[0];
+      chunk[2 * i + 1] = values[1];
+    }
+    AddScaledRow(chunk, scale, chunk_size, y + begin);
+  }
+}
+
+}  // namespace mobile
+}  // namespace nlp_saft
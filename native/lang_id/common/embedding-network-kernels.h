@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NLP_SAFT_COMPONENTS_COMMON_MOBILE_EMBEDDING_NETWORK_KERNELS_H_
+#define NLP_SAFT_COMPONENTS_COMMON_MOBILE_EMBEDDING_NETWORK_KERNELS_H_
+
+#include "lang_id/common/lite_base/float16.h"
+#include "lang_id/common/lite_base/integral-types.h"
+
+namespace libtextclassifier3 {
+namespace mobile {
+
+// Kernels used by EmbeddingNetwork, for y[i] += scale * w[i], for i in [0,
+// size), where w is a row of a weight matrix, stored with one of the supported
+// quantization types.
+//
+// The vector instructions are selected at compile time from the target ABI:
+// NEON on ARM and SSE2 on x86, with scalar loops as fallback and for the tails
+// of the rows.  The vector bodies multiply and add separately, while the
+// compiler may contract the scalar loops into fused multiply-adds (e.g., clang
+// on arm64), so the results agree with a plain scalar loop only up to
+// rounding.
+
+void AddScaledRow(const float *w, float scale, int size, float *y);
+
+void AddScaledRow(const float16 *w, float scale, int size, float *y);
+
+// For UINT8 quantized weights, with the bias of 128 removed.
+void AddScaledUint8Row(const uint8 *w, float scale, int size, float *y);
+
+// For UINT4 quantized weights: each byte holds two weights, the first one in
+// the upper half.  size is the number of weights; if it is odd, the last
+// weight (which would be in the upper half of an extra byte) is ignored and
+// y[size - 1] is left unchanged.
+void AddScaledUint4Row(const uint8 *w, float scale, int size, float *y);
+
+}  // namespace mobile
+}  // namespace nlp_saft
+
+#endif  // NLP_SAFT_COMPONENTS_COMMON_MOBILE_EMBEDDING_NETWORK_KERNELS_H_
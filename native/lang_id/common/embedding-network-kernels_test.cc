@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lang_id/common/embedding-network-kernels.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace libtextclassifier3 {
+namespace mobile {
+namespace {
+
+// Sizes around the vector width and the UINT4 chunk size, so that both the
+// vector bodies and the scalar tails are exercised.
+constexpr int kSizes[] = {0,  1,  2,  3,  7,  8,  9,   15,  16,
+                          17, 63, 64, 65, 66, 127, 128, 130, 131};
+
+constexpr float kScale = 0.37f;
+
+// Relative tolerance: the kernels and the reference may round differently
+// (e.g., fused vs. separate multiply and add).
+void ExpectNear(const std::vector<float> &expected,
+                const std::vector<float> &actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (int i = 0; i < expected.size(); ++i) {
+    EXPECT_NEAR(expected[i], actual[i], 1e-5f * (1.0f + std::abs(expected[i])))
+        << "at " << i << " of " << expected.size();
+  }
+}
+
+class EmbeddingNetworkKernelsTest : public ::testing::Test {
+ protected:
+  std::vector<float> RandomFloats(int size) {
+    std::uniform_real_distribution<float> distribution(-10.0f, 10.0f);
+    std::vector<float> values(size);
+    for (float &value : values) {
+      value = distribution(random_);
+    }
+    return values;
+  }
+
+  std::vector<uint8> RandomBytes(int size) {
+    std::uniform_int_distribution<int> distribution(0, 255);
+    std::vector<uint8> values(size);
+    for (uint8 &value : values) {
+      value = distribution(random_);
+    }
+    return values;
+  }
+
+  std::mt19937 random_{/*seed=*/42};
+};
+
+TEST_F(EmbeddingNetworkKernelsTest, AddsScaledFloatRow) {
+  for (const int size : kSizes) {
+    const std::vector<float> w = RandomFloats(size);
+    std::vector<float> expected = RandomFloats(size);
+    std::vector<float> actual = expected;
+    for (int i = 0; i < size; ++i) {
+      expected[i] += w[i] * kScale;
+    }
+    AddScaledRow(w.data(), kScale, size, actual.data());
+    ExpectNear(expected, actual);
+  }
+}
+
+TEST_F(EmbeddingNetworkKernelsTest, AddsScaledFloat16Row) {
+  for (const int size : kSizes) {
+    std::vector<float16> w;
+    for (const float value : RandomFloats(size)) {
+      w.push_back(Float32To16(value));
+    }
+    std::vector<float> expected = RandomFloats(size);
+    std::vector<float> actual = expected;
+    for (int i = 0; i < size; ++i) {
+      expected[i] += Float16To32(w[i]) * kScale;
+    }
+    AddScaledRow(w.data(), kScale, size, actual.data());
+    ExpectNear(expected, actual);
+  }
+}
+
+TEST_F(EmbeddingNetworkKernelsTest, AddsScaledUint8Row) {
+  for (const int size : kSizes) {
+    const std::vector<uint8> w = RandomBytes(size);
+    std::vector<float> expected = RandomFloats(size);
+    std::vector<float> actual = expected;
+    for (int i = 0; i < size; ++i) {
+      expected[i] += (static_cast<int>(w[i]) - 128) * kScale;
+    }
+    AddScaledUint8Row(w.data(), kScale, size, actual.data());
+    ExpectNear(expected, actual);
+  }
+}
+
+TEST_F(EmbeddingNetworkKernelsTest, AddsScaledUint4Row) {
+  for (const int size : kSizes) {
+    // Room for the upper half of an extra byte, if size is odd.
+    const std::vector<uint8> w = RandomBytes((size + 1) / 2);
+    std::vector<float> expected = RandomFloats(size);
+    std::vector<float> actual = expected;
+    for (int i = 0; i < size / 2; ++i) {
+      expected[2 * i] +=
+          (static_cast<int>((w[i] & 0xF0) | 0x08) - 128) * kScale;
+      expected[2 * i + 1] +=
+          (static_cast<int>(((w[i] & 0x0F) << 4) | 0x08) - 128) * kScale;
+    }
+    AddScaledUint4Row(w.data(), kScale, size, actual.data());
+    ExpectNear(expected, actual);
+    if (size % 2 == 1) {
+      // The trailing odd weight is ignored.
+      EXPECT_EQ(expected.back(), actual.back());
+    }
+  }
+}
+
+}  // namespace
+}  // namespace mobile
+}  // namespace nlp_saft
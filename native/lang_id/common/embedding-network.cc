@@ -16,6 +16,7 @@
 
 #include "lang_id/common/embedding-network.h"
 
+#include "lang_id/common/embedding-network-kernels.h"
 #include "lang_id/common/lite_base/integral-types.h"
 #include "lang_id/common/lite_base/logging.h"
 
@@ -98,42 +99,31 @@ void SparseReluProductPlusBias(bool apply_relu,
       // of row #0, next the elements of row #1, etc.  In the comments below, we
       // write "weights[i][j]" to refer to the j-th element from the i-th row of
       // weights.
+      //
+      // Note: weights is kept in this layout (instead of e.g., a blocked one)
+      // as skipping the rows for the inputs zeroed by Relu is what saves most
+      // of the work.
       const float *weight_ptr =
           reinterpret_cast<const float *>(weights.elements);
-      for (int i = 0; i < x_size; ++i) {
-        // Invariant 1: weight_ptr points to the beginning of the i-th row from
+      for (int i = 0; i < x_size; ++i, weight_ptr += y_size) {
+        // Invariant: weight_ptr points to the beginning of the i-th row from
         // weights (i.e., weights[i][0]).
         const float scale = x[i];
         if (!apply_relu || (scale > 0)) {
-          for (int j = 0; j < y_size; ++j, ++weight_ptr) {
-            // Invariant 2: weight_ptr points to weights[i][j].
-            y_data[j] += (*weight_ptr) * scale;
-          }
-        } else {
-          // We don't update y_data, but we still have to move weight_ptr to the
-          // next row (to satisfy Invariant 1).  We do this by adding y_size ==
-          // weights.cols() (see earlier CHECK_EQ).
-          weight_ptr += y_size;
+          AddScaledRow(weight_ptr, scale, y_size, y_data);
         }
       }
       break;
     }
     case QuantizationType::FLOAT16: {
-      // See comments for the QuantizationType::NONE case: the code is almost
-      // identical, except for float16 (instead of float) and the Float16To32
-      // conversion.  We could unify these two cases using a template, but since
-      // this is a critical loop, don't want to risk that e.g., inlining of the
-      // conversion function doesn't happen.
+      // See comments for the QuantizationType::NONE case: the code is
+      // identical, except for float16 (instead of float) weights.
       const float16 *weight_ptr =
           reinterpret_cast<const float16 *>(weights.elements);
-      for (int i = 0; i < x_size; ++i) {
+      for (int i = 0; i < x_size; ++i, weight_ptr += y_size) {
         const float scale = x[i];
         if (!apply_relu || (scale > 0)) {
-          for (int j = 0; j < y_size; ++j, ++weight_ptr) {
-            y_data[j] += Float16To32(*weight_ptr) * scale;
-          }
-        } else {
-          weight_ptr += y_size;
+          AddScaledRow(weight_ptr, scale, y_size, y_data);
         }
       }
       break;
@@ -143,6 +133,101 @@ void SparseReluProductPlusBias(bool apply_relu,
                        << static_cast<int>(weights.quant_type);
   }
 }
+
+// Adds the Relu(xs[k])-weighted rows of weights (a matrix with x_size rows of
+// y_size elements) to ys[k], for each k.  The outer loop goes over the rows of
+// weights, such that each row is read once for the whole batch.
+template <typename WeightType>
+void AddReluProductsBatch(bool apply_relu, const WeightType *weight_ptr,
+                          int x_size, int y_size,
+                          const std::vector<std::vector<float>> &xs,
+                          std::vector<std::vector<float>> *ys) {
+  const int batch_size = xs.size();
+  for (int i = 0; i < x_size; ++i, weight_ptr += y_size) {
+    for (int k = 0; k < batch_size; ++k) {
+      const float scale = xs[k][i];
+      if (!apply_relu || (scale > 0)) {
+        AddScaledRow(weight_ptr, scale, y_size, (*ys)[k].data());
+      }
+    }
+  }
+}
+
+// Batch version of SparseReluProductPlusBias: computes ys[k] = weights *
+// Relu(xs[k]) + b, for each k.  Each ys[k] gets the same sequence of updates as
+// with SparseReluProductPlusBias, hence the results are identical.
+void SparseReluProductPlusBiasBatch(
+    bool apply_relu, const EmbeddingNetworkParams::Matrix &weights,
+    const EmbeddingNetworkParams::Matrix &b,
+    const std::vector<std::vector<float>> &xs,
+    std::vector<std::vector<float>> *ys) {
+  const float *b_start = reinterpret_cast<const float *>(b.elements);
+  SAFTM_DCHECK_EQ(b.cols, 1);
+  const int batch_size = xs.size();
+  ys->resize(batch_size);
+  for (int k = 0; k < batch_size; ++k) {
+    SAFTM_CHECK_EQ(weights.rows, static_cast<int>(xs[k].size()));
+    (*ys)[k].assign(b_start, b_start + b.rows);
+  }
+  SAFTM_CHECK_EQ(weights.cols, b.rows);
+  const int x_size = weights.rows;
+  const int y_size = weights.cols;
+
+  switch (weights.quant_type) {
+    case QuantizationType::NONE:
+      AddReluProductsBatch(apply_relu,
+                           reinterpret_cast<const float *>(weights.elements),
+                           x_size, y_size, xs, ys);
+      break;
+    case QuantizationType::FLOAT16:
+      AddReluProductsBatch(apply_relu,
+                           reinterpret_cast<const float16 *>(weights.elements),
+                           x_size, y_size, xs, ys);
+      break;
+    default:
+      SAFTM_LOG(FATAL) << "Unsupported weights quantization type: "
+                       << static_cast<int>(weights.quant_type);
+  }
+}
+
+// Adds multiplier times the embedding stored at embedding_data (a row of an
+// embedding matrix, with embedding_dim elements) to concat_ptr.
+typedef void (*AddEmbeddingFunction)(const void *embedding_data,
+                                     float multiplier, int embedding_dim,
+                                     float *concat_ptr);
+
+void AddFloatEmbedding(const void *embedding_data, float multiplier,
+                       int embedding_dim, float *concat_ptr) {
+  AddScaledRow(reinterpret_cast<const float *>(embedding_data), multiplier,
+               embedding_dim, concat_ptr);
+}
+
+void AddUint8Embedding(const void *embedding_data, float multiplier,
+                       int embedding_dim, float *concat_ptr) {
+  AddScaledUint8Row(reinterpret_cast<const uint8 *>(embedding_data),
+                    multiplier, embedding_dim, concat_ptr);
+}
+
+void AddUint4Embedding(const void *embedding_data, float multiplier,
+                       int embedding_dim, float *concat_ptr) {
+  AddScaledUint4Row(reinterpret_cast<const uint8 *>(embedding_data),
+                    multiplier, embedding_dim, concat_ptr);
+}
+
+// Returns the kernel for the embeddings with the given quantization type, or
+// nullptr if the quantization type is not supported for embeddings.
+AddEmbeddingFunction GetAddEmbeddingFunction(QuantizationType quant_type) {
+  switch (quant_type) {
+    case QuantizationType::NONE:
+      return AddFloatEmbedding;
+    case QuantizationType::UINT8:
+      return AddUint8Embedding;
+    case QuantizationType::UINT4:
+      return AddUint4Embedding;
+    default:
+      return nullptr;
+  }
+}
 }  // namespace
 
 void EmbeddingNetwork::ConcatEmbeddings(
@@ -160,6 +245,20 @@ void EmbeddingNetwork::ConcatEmbeddings(
     const int embedding_row_size_in_bytes =
         embedding_row_size_in_bytes_[es_index];
 
+    // All embeddings of an embedding space have the same quantization type,
+    // so we pick the kernel once per embedding space, not once per feature.
+    const AddEmbeddingFunction add_embedding =
+        GetAddEmbeddingFunction(embedding_matrix.quant_type);
+    if (add_embedding == nullptr) {
+      // We already checked (in GetMatrixRowSizeInBytes) that each embedding
+      // matrix has a known quantization type.  Hence, DLOG is enough here.
+      SAFTM_DLOG(ERROR) << "Unknown embeddings quantization type "
+                        << static_cast<int>(embedding_matrix.quant_type);
+      continue;
+    }
+    const bool is_quantized =
+        embedding_matrix.quant_type != QuantizationType::NONE;
+
     const FeatureVector &feature_vector = feature_vectors[es_index];
     const int num_features = feature_vector.size();
     for (int fi = 0; fi < num_features; ++fi) {
@@ -189,54 +288,15 @@ void EmbeddingNetwork::ConcatEmbeddings(
       SAFTM_CHECK_GE(feature_id, 0);
       SAFTM_CHECK_LT(feature_id, embedding_matrix.rows);
 
+      if (is_quantized) {
+        multiplier *= Float16To32(embedding_matrix.quant_scales[feature_id]);
+      }
+
       // Pointer to float / uint8 weights for relevant embedding.
       const void *embedding_data =
           (reinterpret_cast<const char *>(embedding_matrix.elements) +
            feature_id * embedding_row_size_in_bytes);
-
-      switch (embedding_matrix.quant_type) {
-        case QuantizationType::NONE: {
-          const float *weights =
-              reinterpret_cast<const float *>(embedding_data);
-          for (int i = 0; i < embedding_dim; ++i, ++weights, ++concat_ptr) {
-            *concat_ptr += *weights * multiplier;
-          }
-          break;
-        }
-        case QuantizationType::UINT8: {
-          multiplier *= Float16To32(embedding_matrix.quant_scales[feature_id]);
-          const uint8 *quant_weights =
-              reinterpret_cast<const uint8 *>(embedding_data);
-          for (int i = 0; i < embedding_dim;
-               ++i, ++quant_weights, ++concat_ptr) {
-            // 128 is bias for UINT8 quantization.
-            *concat_ptr +=
-                (static_cast<int>(*quant_weights) - 128) * multiplier;
-          }
-          break;
-        }
-        case QuantizationType::UINT4: {
-          multiplier *= Float16To32(embedding_matrix.quant_scales[feature_id]);
-          const uint8 *quant_weights =
-              reinterpret_cast<const uint8 *>(embedding_data);
-          for (int i = 0; i < embedding_dim / 2; ++i, ++quant_weights) {
-            const uint8 qq = *quant_weights;
-            concat_ptr[0] +=
-                (static_cast<int>((qq & 0xF0) | 0x08) - 128) * multiplier;
-            concat_ptr[1] +=
-                (static_cast<int>(((qq & 0x0F) << 4) | 0x08) - 128) *
-                multiplier;
-            concat_ptr += 2;
-          }
-          break;
-        }
-        default:
-          // We already checked (in GetMatrixRowSizeInBytes) that each embedding
-          // matrix has a known quantization type.  Hence, DLOG is enough here.
-          SAFTM_DLOG(ERROR) << "Unknown embeddings quantization type "
-                            << static_cast<int>(embedding_matrix.quant_type);
-          break;
-      }
+      add_embedding(embedding_data, multiplier, embedding_dim, concat_ptr);
     }
   }
 }
@@ -285,6 +345,31 @@ void EmbeddingNetwork::ComputeFinalScores(
   }
 }
 
+void EmbeddingNetwork::ComputeFinalScoresBatch(
+    const std::vector<std::vector<FeatureVector>> &batch_features,
+    std::vector<std::vector<float>> *scores) const {
+  // Construct the input layers for all inputs of the batch.
+  const int batch_size = batch_features.size();
+  std::vector<std::vector<float>> inputs(batch_size);
+  for (int k = 0; k < batch_size; ++k) {
+    ConcatEmbeddings(batch_features[k], &inputs[k]);
+  }
+
+  // Propagate the inputs through all layers of our FFNN, with the same
+  // alternating storage as in ComputeFinalScores.
+  std::vector<std::vector<float>> storage[2];
+  const std::vector<std::vector<float>> *v_in = &inputs;
+  const int num_layers = layer_weights_.size();
+  for (int i = 0; i < num_layers; ++i) {
+    std::vector<std::vector<float>> *v_out =
+        (i == num_layers - 1) ? scores : &(storage[i % 2]);
+    const bool apply_relu = i > 0;
+    SparseReluProductPlusBiasBatch(apply_relu, layer_weights_[i],
+                                   layer_bias_[i], *v_in, v_out);
+    v_in = v_out;
+  }
+}
+
 EmbeddingNetwork::EmbeddingNetwork(const EmbeddingNetworkParams *model)
     : model_(model) {
   int offset_sum = 0;
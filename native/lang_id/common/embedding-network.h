@@ -61,6 +61,15 @@ class EmbeddingNetwork {
                           const std::vector<float> &extra_inputs,
                           std::vector<float> *scores) const;
 
+  // Batch version of ComputeFinalScores(features, scores): fills (*scores)[k]
+  // with the scores for batch_features[k], for each k.  The results are the
+  // same as with one ComputeFinalScores() call per input, but the layers are
+  // computed for the whole batch at once, so that each weight matrix is read
+  // from memory once per batch, instead of once per input.
+  void ComputeFinalScoresBatch(
+      const std::vector<std::vector<FeatureVector>> &batch_features,
+      std::vector<std::vector<float>> *scores) const;
+
  private:
   // Constructs the concatenated input embedding vector in place in output
   // vector concat.
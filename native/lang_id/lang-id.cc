@@ -18,6 +18,7 @@
 
 #include <stdio.h>
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -155,22 +156,58 @@ class LangIdImpl {
     std::vector<float> scores;
     network_->ComputeFinalScores(features, &scores);
 
-    if (max_results == 1) {
-      // Optimization for the case when the user wants only the top result.
-      // Computing argmax is faster than the general top-k code.
-      int prediction_id = GetArgMax(scores);
-      const std::string language = GetLanguageForSoftmaxLabel(prediction_id);
-      float probability = ComputeSoftmaxProbability(scores, prediction_id);
-      result->predictions.emplace_back(language, probability);
-    } else {
-      // Compute and sort softmax in descending order by probability and convert
-      // IDs to language code strings.  When probabilities are equal, we sort by
-      // language code string in ascending order.
-      const std::vector<float> softmax = ComputeSoftmax(scores);
-      const std::vector<int> indices = GetTopKIndices(max_results, softmax);
-      for (const int index : indices) {
-        result->predictions.emplace_back(GetLanguageForSoftmaxLabel(index),
-                                         softmax[index]);
+    FillPredictions(scores, max_results, result);
+  }
+
+  void FindLanguagesBatch(const std::vector<StringPiece> &texts,
+                          std::vector<LangIdResult> *results,
+                          int max_results) const {
+    if (results == nullptr) return;
+
+    if (max_results <= 0) {
+      max_results = languages_.size();
+    }
+    results->resize(texts.size());
+    for (LangIdResult &result : *results) {
+      result.predictions.clear();
+    }
+    if (!is_valid() || (max_results == 0)) {
+      for (LangIdResult &result : *results) {
+        result.predictions.emplace_back(LangId::kUnknownLanguageCode, 1);
+      }
+      return;
+    }
+
+    // The texts are scored in batches of limited size, such that the
+    // activations of a batch stay in cache while the weights of each layer
+    // stream through it.
+    static constexpr int kMaxBatchSize = 32;
+    const int num_texts = texts.size();
+    std::vector<std::vector<FeatureVector>> batch_features;
+    std::vector<int> batch_text_indices;
+    std::vector<std::vector<float>> batch_scores;
+    for (int begin = 0; begin < num_texts; begin += kMaxBatchSize) {
+      const int end = std::min(begin + kMaxBatchSize, num_texts);
+      batch_features.clear();
+      batch_text_indices.clear();
+      for (int i = begin; i < end; ++i) {
+        // Same pre-processing as in FindLanguages.
+        LightSentence sentence;
+        tokenizer_.Tokenize(texts[i], &sentence);
+        if (IsTooShort(sentence)) {
+          (*results)[i].predictions.emplace_back(LangId::kUnknownLanguageCode,
+                                                 1);
+          continue;
+        }
+        batch_features.push_back(
+            lang_id_brain_interface_.GetFeaturesNoCaching(&sentence));
+        batch_text_indices.push_back(i);
+      }
+
+      network_->ComputeFinalScoresBatch(batch_features, &batch_scores);
+      for (int k = 0; k < batch_text_indices.size(); ++k) {
+        FillPredictions(batch_scores[k], max_results,
+                        &(*results)[batch_text_indices[k]]);
       }
     }
   }
@@ -251,6 +288,30 @@ class LangIdImpl {
     }
   }
 
+  // Fills result with the top max_results predictions (max_results > 0) for
+  // the given scores (softmax logits).
+  void FillPredictions(const std::vector<float> &scores, int max_results,
+                       LangIdResult *result) const {
+    if (max_results == 1) {
+      // Optimization for the case when the user wants only the top result.
+      // Computing argmax is faster than the general top-k code.
+      int prediction_id = GetArgMax(scores);
+      const std::string language = GetLanguageForSoftmaxLabel(prediction_id);
+      float probability = ComputeSoftmaxProbability(scores, prediction_id);
+      result->predictions.emplace_back(language, probability);
+    } else {
+      // Compute and sort softmax in descending order by probability and convert
+      // IDs to language code strings.  When probabilities are equal, we sort by
+      // language code string in ascending order.
+      const std::vector<float> softmax = ComputeSoftmax(scores);
+      const std::vector<int> indices = GetTopKIndices(max_results, softmax);
+      for (const int index : indices) {
+        result->predictions.emplace_back(GetLanguageForSoftmaxLabel(index),
+                                         softmax[index]);
+      }
+    }
+  }
+
   bool IsTooShort(const LightSentence &sentence) const {
     int text_size = 0;
     for (const std::string &token : sentence) {
@@ -315,6 +376,13 @@ void LangId::FindLanguages(const char *data, size_t num_bytes,
   pimpl_->FindLanguages(text, result, max_results);
 }
 
+void LangId::FindLanguagesBatch(const std::vector<StringPiece> &texts,
+                                std::vector<LangIdResult> *results,
+                                int max_results) const {
+  SAFTM_DCHECK(results) << "Results must not be null.";
+  pimpl_->FindLanguagesBatch(texts, results, max_results);
+}
+
 bool LangId::is_valid() const { return pimpl_->is_valid(); }
 
 int LangId::GetModelVersion() const { return pimpl_->GetModelVersion(); }
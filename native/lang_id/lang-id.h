@@ -26,6 +26,7 @@
 #include <vector>
 
 #include "lang_id/common/lite_base/macros.h"
+#include "lang_id/common/lite_strings/stringpiece.h"
 #include "lang_id/model-provider.h"
 
 namespace libtextclassifier3 {
@@ -92,6 +93,14 @@ class LangId {
     FindLanguages(text.data(), text.size(), result, max_results);
   }
 
+  // Batch version of FindLanguages: resizes |results| to the number of |texts|
+  // and sets (*results)[i] to the same n-best list as FindLanguages(texts[i],
+  // ...).  The texts are scored together, which is faster than calling
+  // FindLanguages for each of them.
+  void FindLanguagesBatch(const std::vector<StringPiece> &texts,
+                          std::vector<LangIdResult> *results,
+                          int max_results = 0) const;
+
   // Returns language code for the most likely language for a piece of text.
   //
   // The input text consists of the |num_bytes| bytes that start at |data|.
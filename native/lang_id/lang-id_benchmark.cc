@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lang_id/fb_model/lang-id-from-fb.h"
+#include "lang_id/lang-id.h"
+#include "utils/base/logging.h"
+#include "utils/testing/benchmark-utils.h"
+#include "benchmark/benchmark.h"
+
+namespace libtextclassifier3 {
+namespace mobile {
+namespace lang_id {
+namespace {
+
+// The model is shared by all benchmarks, and by all threads of a benchmark.
+const LangId &GetLangId() {
+  static const LangId *lang_id = []() {
+    std::unique_ptr<LangId> lang_id = GetLangIdFromFlatbufferFile(
+        GetBenchmarkDataPath("models/lang_id.model"));
+    TC3_CHECK(lang_id != nullptr && lang_id->is_valid());
+    return lang_id.release();
+  }();
+  return *lang_id;
+}
+
+// Arguments: script, text length in codepoints.
+void BM_FindLanguages(benchmark::State &state) {
+  const LangId &lang_id = GetLangId();
+  const BenchmarkScript script = static_cast<BenchmarkScript>(state.range(0));
+  const std::string text = GenerateText(script, state.range(1));
+
+  LangIdResult result;
+  for (auto _ : state) {
+    lang_id.FindLanguages(text, &result);
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+  state.SetLabel(BenchmarkScriptName(script));
+}
+BENCHMARK(BM_FindLanguages)
+    ->ArgsProduct({{static_cast<int>(BenchmarkScript::kLatin),
+                    static_cast<int>(BenchmarkScript::kCyrillic),
+                    static_cast<int>(BenchmarkScript::kArabic),
+                    static_cast<int>(BenchmarkScript::kHan),
+                    static_cast<int>(BenchmarkScript::kMixed)},
+                   {16, 128, 1024}});
+BENCHMARK(BM_FindLanguages)
+    ->Args({static_cast<int>(BenchmarkScript::kLatin), 128})
+    ->Apply(ReportLatencyPercentiles);
+
+// Many short texts, one FindLanguages call each, vs. one FindLanguagesBatch
+// call for all of them.
+// Arguments: number of texts.
+void BM_FindLanguagesOneByOne(benchmark::State &state) {
+  const LangId &lang_id = GetLangId();
+  std::vector<std::string> texts;
+  for (int i = 0; i < state.range(0); i++) {
+    texts.push_back(GenerateText(BenchmarkScript::kMixed,
+                                 /*num_codepoints=*/32, /*seed=*/i + 1));
+  }
+
+  LangIdResult result;
+  for (auto _ : state) {
+    for (const std::string &text : texts) {
+      lang_id.FindLanguages(text, &result, /*max_results=*/1);
+      benchmark::DoNotOptimize(result);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * texts.size());
+}
+BENCHMARK(BM_FindLanguagesOneByOne)->Arg(1)->Arg(32)->Arg(1024);
+
+void BM_FindLanguagesBatch(benchmark::State &state) {
+  const LangId &lang_id = GetLangId();
+  std::vector<std::string> texts;
+  for (int i = 0; i < state.range(0); i++) {
+    texts.push_back(GenerateText(BenchmarkScript::kMixed,
+                                 /*num_codepoints=*/32, /*seed=*/i + 1));
+  }
+  const std::vector<StringPiece> text_pieces(texts.begin(), texts.end());
+
+  std::vector<LangIdResult> results;
+  for (auto _ : state) {
+    lang_id.FindLanguagesBatch(text_pieces, &results, /*max_results=*/1);
+    benchmark::DoNotOptimize(results);
+  }
+  state.SetItemsProcessed(state.iterations() * texts.size());
+}
+BENCHMARK(BM_FindLanguagesBatch)->Arg(1)->Arg(32)->Arg(1024);
+
+// Concurrent requests on one shared LangId, e.g. from the text classifier
+// service. Every thread classifies a different text.
+void BM_FindLanguagesMultiThreaded(benchmark::State &state) {
+  const LangId &lang_id = GetLangId();
+  const std::string text =
+      GenerateText(BenchmarkScript::kMixed, /*num_codepoints=*/128,
+                   /*seed=*/state.thread_index() + 1);
+
+  LangIdResult result;
+  for (auto _ : state) {
+    lang_id.FindLanguages(text, &result);
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FindLanguagesMultiThreaded)->ThreadRange(1, 8)->UseRealTime();
+
+}  // namespace
+}  // namespace lang_id
+}  // namespace mobile
+}  // namespace libtextclassifier3
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lang_id/lang-id.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lang_id/fb_model/lang-id-from-fb.h"
+#include "utils/test-data-test-utils.h"
+#include "gtest/gtest.h"
+
+namespace libtextclassifier3 {
+namespace mobile {
+namespace lang_id {
+namespace {
+
+class LangIdTest : public ::testing::Test {
+ protected:
+  LangIdTest()
+      : lang_id_(GetLangIdFromFlatbufferFile(
+            GetTestDataPath("models/lang_id.model"))) {}
+
+  // Checks that FindLanguagesBatch returns the same results as one
+  // FindLanguages call per text.
+  void ExpectBatchMatchesSingleTexts(const std::vector<std::string> &texts,
+                                     int max_results) {
+    const std::vector<StringPiece> text_pieces(texts.begin(), texts.end());
+    std::vector<LangIdResult> results;
+    lang_id_->FindLanguagesBatch(text_pieces, &results, max_results);
+    ASSERT_EQ(results.size(), texts.size());
+
+    for (int i = 0; i < texts.size(); ++i) {
+      SCOPED_TRACE(texts[i]);
+      LangIdResult expected;
+      lang_id_->FindLanguages(texts[i], &expected, max_results);
+      ASSERT_EQ(results[i].predictions.size(), expected.predictions.size());
+      for (int k = 0; k < expected.predictions.size(); ++k) {
+        EXPECT_EQ(results[i].predictions[k].first,
+                  expected.predictions[k].first);
+        EXPECT_FLOAT_EQ(results[i].predictions[k].second,
+                        expected.predictions[k].second);
+      }
+    }
+  }
+
+  std::unique_ptr<LangId> lang_id_;
+};
+
+// More texts than fit in one batch, with the texts that are too short to be
+// scored spread over the batches.
+std::vector<std::string> GetTexts() {
+  const std::vector<std::string> sentences = {
+      "Hello, how are you doing today?",
+      "Bonjour, comment allez-vous aujourd'hui ?",
+      "Wie geht es dir heute?",
+      "今日はお元気ですか",
+      "Привет, как дела?",
+      "¿Dónde está la estación de tren?",
+      "Dziękuję bardzo za pomoc.",
+      "مرحبا، كيف حالك اليوم؟",
+      "这是一个测试句子。",
+      "Het weer is vandaag erg mooi.",
+      "Oggi andiamo al mare con gli amici.",
+      "Bugün hava çok güzel.",
+  };
+  const std::vector<std::string> too_short_texts = {"", " ", "a", "hi", "\n"};
+
+  std::vector<std::string> texts;
+  for (int i = 0; i < 100; ++i) {
+    if (i % 7 == 3) {
+      texts.push_back(too_short_texts[(i / 7) % too_short_texts.size()]);
+    } else {
+      texts.push_back(sentences[i % sentences.size()]);
+    }
+  }
+  return texts;
+}
+
+TEST_F(LangIdTest, BatchMatchesSingleTextsForAllResults) {
+  ASSERT_TRUE(lang_id_->is_valid());
+  ExpectBatchMatchesSingleTexts(GetTexts(), /*max_results=*/0);
+}
+
+TEST_F(LangIdTest, BatchMatchesSingleTextsForTopResult) {
+  ASSERT_TRUE(lang_id_->is_valid());
+  ExpectBatchMatchesSingleTexts(GetTexts(), /*max_results=*/1);
+}
+
+TEST_F(LangIdTest, BatchMatchesSingleTextsForTopResults) {
+  ASSERT_TRUE(lang_id_->is_valid());
+  ExpectBatchMatchesSingleTexts(GetTexts(), /*max_results=*/3);
+}
+
+TEST_F(LangIdTest, BatchReportsUnknownLanguageForTooShortTexts) {
+  ASSERT_TRUE(lang_id_->is_valid());
+  std::vector<LangIdResult> results;
+  lang_id_->FindLanguagesBatch({"", "hi", "Hello, how are you doing today?"},
+                               &results);
+  ASSERT_EQ(results.size(), 3);
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_EQ(results[i].predictions.size(), 1);
+    EXPECT_EQ(results[i].predictions[0].first, LangId::kUnknownLanguageCode);
+    EXPECT_EQ(results[i].predictions[0].second, 1.0f);
+  }
+  EXPECT_EQ(results[2].predictions[0].first, "en");
+}
+
+TEST_F(LangIdTest, BatchOfNoTexts) {
+  ASSERT_TRUE(lang_id_->is_valid());
+  std::vector<LangIdResult> results(3);
+  lang_id_->FindLanguagesBatch({}, &results);
+  EXPECT_TRUE(results.empty());
+}
+
+}  // namespace
+}  // namespace lang_id
+}  // namespace mobile
+}  // namespace nlp_saft
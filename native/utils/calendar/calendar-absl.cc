@@ -0,0 +1,575 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/calendar/calendar-absl.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include "absl/time/civil_time.h"
+
+namespace libtextclassifier3 {
+namespace {
+
+constexpr int64 kOneSecond = 1000;
+constexpr int64 kOneMinute = 60 * kOneSecond;
+constexpr int64 kOneHour = 60 * kOneMinute;
+constexpr int64 kOneDay = 24 * kOneHour;
+
+// Fixed date of 1970-01-01.
+constexpr int64 kEpochOffset = 719163;
+
+// Field stamps, as in java.util.Calendar. Fields set by the user get
+// increasing stamps starting at kMinimumUserStamp, so that the most recently
+// set fields win during the resolution.
+constexpr int kUnset = 0;
+constexpr int kComputed = 1;
+constexpr int kMinimumUserStamp = 2;
+
+// Regions whose week starts on a day other than Monday, and regions whose
+// first week of the year needs at least 4 days, from the CLDR week data.
+const char* const kSundayFirstRegions[] = {
+    "AG", "AS", "AU", "BD", "BR", "BS", "BT", "BW", "BZ", "CA", "CN",
+    "CO", "DM", "DO", "ET", "GT", "GU", "HK", "HN", "ID", "IL", "IN",
+    "JM", "JP", "KE", "KH", "KR", "LA", "MH", "MM", "MO", "MT", "MX",
+    "MZ", "NI", "NP", "PA", "PE", "PH", "PK", "PR", "PT", "PY", "SA",
+    "SG", "SV", "TH", "TT", "TW", "UM", "US", "VE", "VI", "WS", "YE",
+    "ZA", "ZW"};
+const char* const kSaturdayFirstRegions[] = {
+    "AE", "AF", "BH", "DJ", "DZ", "EG", "IQ", "IR",
+    "JO", "KW", "LY", "OM", "QA", "SD", "SY"};
+const char* const kFridayFirstRegions[] = {"MV"};
+const char* const kMinimalDays4Regions[] = {
+    "AD", "AN", "AT", "AX", "BE", "BG", "CH", "CZ", "DE", "DK",
+    "EE", "ES", "FI", "FJ", "FO", "FR", "GB", "GF", "GG", "GI",
+    "GP", "GR", "HU", "IE", "IM", "IS", "IT", "JE", "LI", "LT",
+    "LU", "MC", "MQ", "NL", "NO", "PL", "RE", "RU", "SE", "SJ",
+    "SK", "SM", "VA"};
+
+template <int N>
+bool ContainsRegion(const char* const (&regions)[N],
+                    const std::string& region) {
+  return std::any_of(regions, regions + N, [&region](const char* other) {
+    return region == other;
+  });
+}
+
+// Likely regions of the languages whose week data differs from the default
+// (week starting on Monday, first week of the year with at least 1 day).
+const char* const kLikelyRegions[][2] = {
+    {"af", "ZA"}, {"am", "ET"}, {"ar", "EG"}, {"bg", "BG"}, {"bn", "BD"},
+    {"ca", "ES"}, {"cs", "CZ"}, {"da", "DK"}, {"de", "DE"}, {"el", "GR"},
+    {"en", "US"}, {"es", "ES"}, {"et", "EE"}, {"eu", "ES"}, {"fa", "IR"},
+    {"fi", "FI"}, {"fil", "PH"}, {"fo", "FO"}, {"fr", "FR"}, {"ga", "IE"},
+    {"gl", "ES"}, {"gu", "IN"}, {"he", "IL"}, {"hi", "IN"}, {"hu", "HU"},
+    {"id", "ID"}, {"in", "ID"}, {"is", "IS"}, {"it", "IT"}, {"iw", "IL"},
+    {"ja", "JP"}, {"jv", "ID"}, {"km", "KH"}, {"kn", "IN"}, {"ko", "KR"},
+    {"lb", "LU"}, {"lo", "LA"}, {"lt", "LT"}, {"ml", "IN"}, {"mr", "IN"},
+    {"my", "MM"}, {"nb", "NO"}, {"ne", "NP"}, {"nl", "NL"}, {"nn", "NO"},
+    {"no", "NO"}, {"pa", "IN"}, {"pl", "PL"}, {"ps", "AF"}, {"pt", "BR"},
+    {"ru", "RU"}, {"sk", "SK"}, {"sv", "SE"}, {"ta", "IN"}, {"te", "IN"},
+    {"th", "TH"}, {"tl", "PH"}, {"ur", "PK"}, {"zh", "CN"}, {"zu", "ZA"}};
+
+// Extracts the region from a BCP 47 tag (e.g. "CH" for "de-CH"). Like ICU,
+// falls back to the likely region of the language if the tag has no region.
+std::string GetRegion(const std::string& locale) {
+  const size_t end = std::min(locale.find(','), locale.size());
+  const size_t language_end = std::min(locale.find_first_of("-_"), end);
+  size_t start = language_end;
+  while (start < end) {
+    ++start;
+    const size_t next = std::min(locale.find_first_of("-_", start), end);
+    const std::string subtag = locale.substr(start, next - start);
+    if (subtag.size() == 1) {
+      // Extensions and private use subtags come after the region.
+      break;
+    }
+    if (subtag.size() == 2 && std::isalpha(subtag[0]) &&
+        std::isalpha(subtag[1])) {
+      return {static_cast<char>(std::toupper(subtag[0])),
+              static_cast<char>(std::toupper(subtag[1]))};
+    }
+    start = next;
+  }
+
+  std::string language = locale.substr(0, language_end);
+  std::transform(language.begin(), language.end(), language.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  for (const auto& likely_region : kLikelyRegions) {
+    if (language == likely_region[0]) {
+      return likely_region[1];
+    }
+  }
+  return "";
+}
+
+int64 FloorDivide(int64 numerator, int64 denominator) {
+  return numerator >= 0 ? numerator / denominator
+                        : ((numerator + 1) / denominator) - 1;
+}
+
+int64 FloorMod(int64 numerator, int64 denominator) {
+  return numerator - denominator * FloorDivide(numerator, denominator);
+}
+
+// Returns the fixed date (days since 0001-01-01, which is day 1) of a
+// proleptic Gregorian date. Out of range months and days are normalized.
+int64 ToFixedDate(int64 year, int month, int day) {
+  return (absl::CivilDay(year, month, day) - absl::CivilDay(1, 1, 1)) + 1;
+}
+
+// Returns the fixed date of the given day of the week on or before the given
+// fixed date.
+int64 GetDayOfWeekDateOnOrBefore(int64 fixed_date, int day_of_week) {
+  return fixed_date - FloorMod(fixed_date - (day_of_week - 1), 7);
+}
+
+// Returns the number of days of a 0-based month.
+int GetMonthLength(int month, int64 year) {
+  return ToFixedDate(year, month + 2, 1) - ToFixedDate(year, month + 1, 1);
+}
+
+int Mask(int field) { return 1 << field; }
+
+int AggregateStamp(int stamp_a, int stamp_b) {
+  if (stamp_a == kUnset || stamp_b == kUnset) {
+    return kUnset;
+  }
+  return std::max(stamp_a, stamp_b);
+}
+
+}  // namespace
+
+bool Calendar::Initialize(const std::string& time_zone,
+                          const std::string& locale, int64 time_ms_utc) {
+  if (!absl::LoadTimeZone(time_zone, &time_zone_)) {
+    // Like java.util.TimeZone, fall back to GMT for unknown ids.
+    time_zone_ = absl::UTCTimeZone();
+  }
+
+  const std::string region = GetRegion(locale);
+  if (ContainsRegion(kSundayFirstRegions, region)) {
+    first_day_of_week_ = kSunday;
+  } else if (ContainsRegion(kSaturdayFirstRegions, region)) {
+    first_day_of_week_ = kSaturday;
+  } else if (ContainsRegion(kFridayFirstRegions, region)) {
+    first_day_of_week_ = kFriday;
+  } else {
+    first_day_of_week_ = kMonday;
+  }
+  minimal_days_in_first_week_ =
+      ContainsRegion(kMinimalDays4Regions, region) ? 4 : 1;
+
+  int dst_offset;
+  GetOffsetsByUtcTime(time_ms_utc, &raw_offset_, &dst_offset);
+  next_stamp_ = kMinimumUserStamp;
+  SetTimeInMillis(time_ms_utc);
+  return true;
+}
+
+void Calendar::GetOffsetsByUtcTime(int64 time_ms_utc, int* raw_offset,
+                                   int* dst_offset) const {
+  const absl::Time time = absl::FromUnixMillis(time_ms_utc);
+  const absl::TimeZone::CivilInfo info = time_zone_.At(time);
+  const int total_offset = info.offset * kOneSecond;
+  *dst_offset = 0;
+  if (info.is_dst) {
+    // The zone doesn't tell the DST savings directly, take the difference to
+    // the standard time half a year before or after.
+    *dst_offset = kOneHour;
+    for (const int days : {-183, 183}) {
+      const absl::TimeZone::CivilInfo standard_info =
+          time_zone_.At(time + absl::Hours(24 * days));
+      if (!standard_info.is_dst) {
+        *dst_offset = total_offset - standard_info.offset * kOneSecond;
+        break;
+      }
+    }
+  }
+  *raw_offset = total_offset - *dst_offset;
+}
+
+void Calendar::SetTimeInMillis(int64 time_ms_utc) {
+  time_ms_utc_ = time_ms_utc;
+  is_time_set_ = true;
+  ComputeFields(/*tz_mask=*/0);
+}
+
+void Calendar::ComputeFields(int tz_mask) {
+  int zone_offset = 0;
+  int dst_offset = 0;
+  if (tz_mask != (Mask(kZoneOffset) | Mask(kDstOffset))) {
+    GetOffsetsByUtcTime(time_ms_utc_, &zone_offset, &dst_offset);
+  }
+  if (tz_mask & Mask(kZoneOffset)) {
+    zone_offset = fields_[kZoneOffset];
+  }
+  if (tz_mask & Mask(kDstOffset)) {
+    dst_offset = fields_[kDstOffset];
+  }
+
+  const int64 local_ms = time_ms_utc_ + zone_offset + dst_offset;
+  fixed_date_ = FloorDivide(local_ms, kOneDay) + kEpochOffset;
+  int time_of_day = FloorMod(local_ms, kOneDay);
+
+  const absl::CivilDay day = absl::CivilDay(1, 1, 1) + (fixed_date_ - 1);
+  const int64 year = day.year();
+  const int day_of_month = day.day();
+  fields_[kYear] = year;
+  fields_[kMonth] = day.month() - 1;
+  fields_[kDayOfMonth] = day_of_month;
+  fields_[kDayOfWeek] = FloorMod(fixed_date_, 7) + kSunday;
+  fields_[kHourOfDay] = time_of_day / kOneHour;
+  time_of_day %= kOneHour;
+  fields_[kMinute] = time_of_day / kOneMinute;
+  time_of_day %= kOneMinute;
+  fields_[kSecond] = time_of_day / kOneSecond;
+  fields_[kMillisecond] = time_of_day % kOneSecond;
+  fields_[kZoneOffset] = zone_offset;
+  fields_[kDstOffset] = dst_offset;
+
+  const int64 fixed_date_jan1 = ToFixedDate(year, 1, 1);
+  fields_[kDayOfYear] = fixed_date_ - fixed_date_jan1 + 1;
+  int week_of_year = GetWeekNumber(fixed_date_jan1, fixed_date_);
+  if (week_of_year == 0) {
+    // The date belongs to the last week of the previous year.
+    week_of_year =
+        GetWeekNumber(ToFixedDate(year - 1, 1, 1), fixed_date_jan1 - 1);
+  } else if (week_of_year >= 52) {
+    // The date may belong to the first week of the next year.
+    const int64 next_jan1 = ToFixedDate(year + 1, 1, 1);
+    const int64 next_jan1st =
+        GetDayOfWeekDateOnOrBefore(next_jan1 + 6, first_day_of_week_);
+    if (next_jan1st - next_jan1 >= minimal_days_in_first_week_ &&
+        fixed_date_ >= next_jan1st - 7) {
+      week_of_year = 1;
+    }
+  }
+  fields_[kWeekOfYear] = week_of_year;
+  fields_[kWeekOfMonth] =
+      GetWeekNumber(fixed_date_ - day_of_month + 1, fixed_date_);
+  fields_[kDayOfWeekInMonth] = (day_of_month - 1) / 7 + 1;
+
+  std::fill(stamps_, stamps_ + kNumFields, kComputed);
+}
+
+int Calendar::GetWeekNumber(int64 fixed_day1, int64 fixed_date) const {
+  int64 fixed_day1st =
+      GetDayOfWeekDateOnOrBefore(fixed_day1 + 6, first_day_of_week_);
+  if (fixed_day1st - fixed_day1 >= minimal_days_in_first_week_) {
+    fixed_day1st -= 7;
+  }
+  return FloorDivide(fixed_date - fixed_day1st, 7) + 1;
+}
+
+int Calendar::SelectFields() const {
+  int field_mask = Mask(kYear);
+
+  // Find the most recently set combination of fields that specifies the day.
+  const int dow_stamp = stamps_[kDayOfWeek];
+  const int dom_stamp = stamps_[kDayOfMonth];
+  const int wom_stamp = AggregateStamp(stamps_[kWeekOfMonth], dow_stamp);
+  const int dowim_stamp =
+      AggregateStamp(stamps_[kDayOfWeekInMonth], dow_stamp);
+  const int doy_stamp = stamps_[kDayOfYear];
+  const int woy_stamp = AggregateStamp(stamps_[kWeekOfYear], dow_stamp);
+  const int best_stamp =
+      std::max({dom_stamp, wom_stamp, dowim_stamp, doy_stamp, woy_stamp});
+
+  if (best_stamp == dom_stamp ||
+      (best_stamp == wom_stamp &&
+       stamps_[kWeekOfMonth] >= stamps_[kWeekOfYear]) ||
+      (best_stamp == dowim_stamp &&
+       stamps_[kDayOfWeekInMonth] >= stamps_[kWeekOfYear])) {
+    field_mask |= Mask(kMonth);
+    if (best_stamp == dom_stamp) {
+      field_mask |= Mask(kDayOfMonth);
+    } else {
+      if (dow_stamp != kUnset) {
+        field_mask |= Mask(kDayOfWeek);
+      }
+      if (wom_stamp == dowim_stamp) {
+        field_mask |= stamps_[kWeekOfMonth] >= stamps_[kDayOfWeekInMonth]
+                          ? Mask(kWeekOfMonth)
+                          : Mask(kDayOfWeekInMonth);
+      } else if (best_stamp == wom_stamp) {
+        field_mask |= Mask(kWeekOfMonth);
+      } else if (stamps_[kDayOfWeekInMonth] != kUnset) {
+        field_mask |= Mask(kDayOfWeekInMonth);
+      }
+    }
+  } else if (best_stamp == doy_stamp) {
+    field_mask |= Mask(kDayOfYear);
+  } else {
+    if (dow_stamp != kUnset) {
+      field_mask |= Mask(kDayOfWeek);
+    }
+    field_mask |= Mask(kWeekOfYear);
+  }
+
+  for (const Field field : {kHourOfDay, kMinute, kSecond, kMillisecond}) {
+    if (stamps_[field] != kUnset) {
+      field_mask |= Mask(field);
+    }
+  }
+  for (const Field field : {kZoneOffset, kDstOffset}) {
+    if (stamps_[field] >= kMinimumUserStamp) {
+      field_mask |= Mask(field);
+    }
+  }
+  return field_mask;
+}
+
+int64 Calendar::GetFixedDate(int year, int field_mask) const {
+  int month = 0;
+  if (field_mask & Mask(kMonth)) {
+    month = fields_[kMonth];
+    year += FloorDivide(month, 12);
+    month = FloorMod(month, 12);
+  }
+  int64 fixed_date = ToFixedDate(year, month + 1, 1);
+
+  if (field_mask & Mask(kMonth)) {
+    if (field_mask & Mask(kDayOfMonth)) {
+      if (stamps_[kDayOfMonth] != kUnset) {
+        fixed_date += fields_[kDayOfMonth] - 1;
+      }
+    } else if (field_mask & Mask(kWeekOfMonth)) {
+      int64 first_day_of_week =
+          GetDayOfWeekDateOnOrBefore(fixed_date + 6, first_day_of_week_);
+      if (first_day_of_week - fixed_date >= minimal_days_in_first_week_) {
+        first_day_of_week -= 7;
+      }
+      if (field_mask & Mask(kDayOfWeek)) {
+        first_day_of_week = GetDayOfWeekDateOnOrBefore(first_day_of_week + 6,
+                                                       fields_[kDayOfWeek]);
+      }
+      fixed_date = first_day_of_week + 7 * (fields_[kWeekOfMonth] - 1);
+    } else {
+      const int day_of_week = (field_mask & Mask(kDayOfWeek))
+                                  ? fields_[kDayOfWeek]
+                                  : first_day_of_week_;
+      const int day_of_week_in_month = (field_mask & Mask(kDayOfWeekInMonth))
+                                           ? fields_[kDayOfWeekInMonth]
+                                           : 1;
+      if (day_of_week_in_month >= 0) {
+        fixed_date = GetDayOfWeekDateOnOrBefore(
+            fixed_date + 7 * day_of_week_in_month - 1, day_of_week);
+      } else {
+        // Count the weeks back from the end of the month.
+        const int last_date = GetMonthLength(month, year) +
+                              7 * (day_of_week_in_month + 1);
+        fixed_date = GetDayOfWeekDateOnOrBefore(fixed_date + last_date - 1,
+                                                day_of_week);
+      }
+    }
+  } else if (field_mask & Mask(kDayOfYear)) {
+    fixed_date += fields_[kDayOfYear] - 1;
+  } else {
+    int64 first_day_of_week =
+        GetDayOfWeekDateOnOrBefore(fixed_date + 6, first_day_of_week_);
+    if (first_day_of_week - fixed_date >= minimal_days_in_first_week_) {
+      first_day_of_week -= 7;
+    }
+    if ((field_mask & Mask(kDayOfWeek)) &&
+        fields_[kDayOfWeek] != first_day_of_week_) {
+      first_day_of_week = GetDayOfWeekDateOnOrBefore(first_day_of_week + 6,
+                                                     fields_[kDayOfWeek]);
+    }
+    fixed_date = first_day_of_week + 7 * (fields_[kWeekOfYear] - 1);
+  }
+  return fixed_date;
+}
+
+void Calendar::ComputeTime() {
+  const int field_mask = SelectFields();
+
+  int64 time_of_day = fields_[kHourOfDay];
+  time_of_day = time_of_day * 60 + fields_[kMinute];
+  time_of_day = time_of_day * 60 + fields_[kSecond];
+  time_of_day = time_of_day * 1000 + fields_[kMillisecond];
+  const int64 fixed_date = FloorDivide(time_of_day, kOneDay) +
+                           GetFixedDate(fields_[kYear], field_mask);
+  const int64 wall_time_ms =
+      (fixed_date - kEpochOffset) * kOneDay + FloorMod(time_of_day, kOneDay);
+
+  // Times in a DST gap or overlap are interpreted as standard time. Explicitly
+  // set zone offsets take precedence over the ones of the time zone.
+  const int tz_mask = field_mask & (Mask(kZoneOffset) | Mask(kDstOffset));
+  int zone_offset = 0;
+  int dst_offset = 0;
+  if (tz_mask != (Mask(kZoneOffset) | Mask(kDstOffset))) {
+    const int gmt_offset =
+        (tz_mask & Mask(kZoneOffset)) ? fields_[kZoneOffset] : raw_offset_;
+    const int64 standard_time_ms = wall_time_ms - gmt_offset;
+    GetOffsetsByUtcTime(standard_time_ms, &zone_offset, &dst_offset);
+    if (dst_offset != 0 &&
+        !time_zone_.At(absl::FromUnixMillis(standard_time_ms - dst_offset))
+             .is_dst) {
+      dst_offset = 0;
+    }
+  }
+  if (tz_mask & Mask(kZoneOffset)) {
+    zone_offset = fields_[kZoneOffset];
+  }
+  if (tz_mask & Mask(kDstOffset)) {
+    dst_offset = fields_[kDstOffset];
+  }
+
+  time_ms_utc_ = wall_time_ms - zone_offset - dst_offset;
+  is_time_set_ = true;
+  ComputeFields(tz_mask);
+}
+
+void Calendar::Complete() {
+  if (!is_time_set_) {
+    ComputeTime();
+  }
+}
+
+void Calendar::Set(Field field, int value) {
+  fields_[field] = value;
+  stamps_[field] = next_stamp_++;
+  is_time_set_ = false;
+}
+
+int Calendar::Get(Field field) {
+  Complete();
+  return fields_[field];
+}
+
+void Calendar::Add(Field field, int amount) {
+  if (amount == 0) {
+    return;
+  }
+  Complete();
+
+  if (field == kYear || field == kMonth) {
+    if (field == kYear) {
+      Set(kYear, fields_[kYear] + amount);
+    } else {
+      const int64 month = static_cast<int64>(fields_[kMonth]) + amount;
+      const int64 year_amount = FloorDivide(month, 12);
+      if (year_amount != 0) {
+        Set(kYear, fields_[kYear] + year_amount);
+      }
+      Set(kMonth, FloorMod(month, 12));
+    }
+
+    // Keep the day of month in the new month, e.g. Jan 31 + 1 month is the
+    // last day of February.
+    const int month_length = GetMonthLength(fields_[kMonth], fields_[kYear]);
+    if (fields_[kDayOfMonth] > month_length) {
+      Set(kDayOfMonth, month_length);
+    }
+    return;
+  }
+
+  int64 delta = amount;
+  switch (field) {
+    case kHourOfDay:
+      delta *= kOneHour;
+      break;
+    case kMinute:
+      delta *= kOneMinute;
+      break;
+    case kSecond:
+      delta *= kOneSecond;
+      break;
+    default:
+      break;
+  }
+  if (field >= kHourOfDay) {
+    SetTimeInMillis(time_ms_utc_ + delta);
+    return;
+  }
+
+  // Days are added to the wall clock time, so that the time of day stays the
+  // same across DST changes.
+  int64 fixed_date = fixed_date_;
+  int64 time_of_day = fields_[kHourOfDay];
+  time_of_day = time_of_day * 60 + fields_[kMinute];
+  time_of_day = time_of_day * 60 + fields_[kSecond];
+  time_of_day = time_of_day * 1000 + fields_[kMillisecond];
+  fixed_date += delta;
+  int zone_offset = fields_[kZoneOffset] + fields_[kDstOffset];
+  SetTimeInMillis((fixed_date - kEpochOffset) * kOneDay + time_of_day -
+                  zone_offset);
+  zone_offset -= fields_[kZoneOffset] + fields_[kDstOffset];
+  if (zone_offset != 0) {
+    SetTimeInMillis(time_ms_utc_ + zone_offset);
+    // If the adjustment has changed the date, then take the previous one.
+    if (fixed_date_ != fixed_date) {
+      SetTimeInMillis(time_ms_utc_ - zone_offset);
+    }
+  }
+}
+
+bool Calendar::GetDayOfWeek(int* value) {
+  *value = Get(kDayOfWeek);
+  return true;
+}
+
+bool Calendar::GetFirstDayOfWeek(int* value) const {
+  *value = first_day_of_week_;
+  return true;
+}
+
+bool Calendar::GetMinimalDaysInFirstWeek(int* value) const {
+  *value = minimal_days_in_first_week_;
+  return true;
+}
+
+bool Calendar::GetTimeInMillis(int64* value) {
+  Complete();
+  *value = time_ms_utc_;
+  return true;
+}
+
+// Below is the boilerplate code for implementing the add/set methods for the
+// various field types.
+#define TC3_DEFINE_FIELD_ACCESSOR(NAME, FIELD, KIND) \
+  bool Calendar::KIND##NAME(int value) {             \
+    KIND(FIELD, value);                              \
+    return true;                                     \
+  }
+#define TC3_DEFINE_ADD(NAME, FIELD) TC3_DEFINE_FIELD_ACCESSOR(NAME, FIELD, Add)
+#define TC3_DEFINE_SET(NAME, FIELD) TC3_DEFINE_FIELD_ACCESSOR(NAME, FIELD, Set)
+
+TC3_DEFINE_ADD(Second, kSecond)
+TC3_DEFINE_ADD(Minute, kMinute)
+TC3_DEFINE_ADD(HourOfDay, kHourOfDay)
+TC3_DEFINE_ADD(DayOfMonth, kDayOfMonth)
+TC3_DEFINE_ADD(Year, kYear)
+TC3_DEFINE_ADD(Month, kMonth)
+TC3_DEFINE_SET(ZoneOffset, kZoneOffset)
+TC3_DEFINE_SET(DstOffset, kDstOffset)
+TC3_DEFINE_SET(Year, kYear)
+TC3_DEFINE_SET(Month, kMonth)
+TC3_DEFINE_SET(DayOfYear, kDayOfYear)
+TC3_DEFINE_SET(DayOfMonth, kDayOfMonth)
+TC3_DEFINE_SET(DayOfWeek, kDayOfWeek)
+TC3_DEFINE_SET(HourOfDay, kHourOfDay)
+TC3_DEFINE_SET(Minute, kMinute)
+TC3_DEFINE_SET(Second, kSecond)
+TC3_DEFINE_SET(Millisecond, kMillisecond)
+
+#undef TC3_DEFINE_FIELD_ACCESSOR
+#undef TC3_DEFINE_ADD
+#undef TC3_DEFINE_SET
+
+}  // namespace libtextclassifier3
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// An implementation of CalendarLib on top of the abseil civil time and time
+// zone libraries, for environments without a JVM.
+// The Calendar reproduces the field resolution of Android's
+// java.util.GregorianCalendar (lenient mode), so that the results are the same
+// as with the Java ICU implementation.
+
+#ifndef LIBTEXTCLASSIFIER_UTILS_CALENDAR_CALENDAR_ABSL_H_
+#define LIBTEXTCLASSIFIER_UTILS_CALENDAR_CALENDAR_ABSL_H_
+
+#include <string>
+
+#include "annotator/types.h"
+#include "utils/base/integral_types.h"
+#include "utils/calendar/calendar-common.h"
+#include "absl/time/time.h"
+
+namespace libtextclassifier3 {
+
+class Calendar {
+ public:
+  bool Initialize(const std::string& time_zone, const std::string& locale,
+                  int64 time_ms_utc);
+  bool AddSecond(int value);
+  bool AddMinute(int value);
+  bool AddHourOfDay(int value);
+  bool AddDayOfMonth(int value);
+  bool AddYear(int value);
+  bool AddMonth(int value);
+  bool GetDayOfWeek(int* value);
+  bool GetFirstDayOfWeek(int* value) const;
+  bool GetMinimalDaysInFirstWeek(int* value) const;
+  bool GetTimeInMillis(int64* value);
+  bool SetZoneOffset(int value);
+  bool SetDstOffset(int value);
+  bool SetYear(int value);
+  bool SetMonth(int value);
+  bool SetDayOfYear(int value);
+  bool SetDayOfMonth(int value);
+  bool SetDayOfWeek(int value);
+  bool SetHourOfDay(int value);
+  bool SetMinute(int value);
+  bool SetSecond(int value);
+  bool SetMillisecond(int value);
+
+ private:
+  // The subset of the java.util.Calendar fields that take part in the
+  // resolution of the fields set by CalendarLibTempl.
+  enum Field {
+    kYear,
+    kMonth,
+    kWeekOfYear,
+    kWeekOfMonth,
+    kDayOfMonth,
+    kDayOfYear,
+    kDayOfWeek,
+    kDayOfWeekInMonth,
+    kHourOfDay,
+    kMinute,
+    kSecond,
+    kMillisecond,
+    kZoneOffset,
+    kDstOffset,
+    kNumFields,
+  };
+
+  void Set(Field field, int value);
+  int Get(Field field);
+  void Add(Field field, int amount);
+
+  // Recomputes the time from the fields, if any of them was set since.
+  void Complete();
+  void ComputeTime();
+  void SetTimeInMillis(int64 time_ms_utc);
+
+  // Computes all the fields from the time. The zone offset fields in
+  // `tz_mask` are kept instead of being taken from the time zone.
+  void ComputeFields(int tz_mask);
+
+  // Returns the mask of the fields used to compute the time.
+  int SelectFields() const;
+
+  // Returns the fixed date (days since 0001-01-01, which is day 1) of the date
+  // described by the fields in `field_mask`.
+  int64 GetFixedDate(int year, int field_mask) const;
+  int GetWeekNumber(int64 fixed_day1, int64 fixed_date) const;
+
+  // Gets the raw and the DST offset of the time zone at the given time.
+  void GetOffsetsByUtcTime(int64 time_ms_utc, int* raw_offset,
+                           int* dst_offset) const;
+
+  absl::TimeZone time_zone_;
+  int raw_offset_ = 0;
+  int first_day_of_week_ = kSunday;
+  int minimal_days_in_first_week_ = 1;
+
+  int64 time_ms_utc_ = 0;
+  bool is_time_set_ = false;
+  int64 fixed_date_ = 0;
+  int fields_[kNumFields] = {};
+  int stamps_[kNumFields] = {};
+  int next_stamp_ = 0;
+};
+
+class CalendarLib {
+ public:
+  bool InterpretParseData(const DatetimeParsedData& parse_data,
+                          int64 reference_time_ms_utc,
+                          const std::string& reference_timezone,
+                          const std::string& reference_locale,
+                          bool prefer_future_for_unspecified_date,
+                          int64* interpreted_time_ms_utc,
+                          DatetimeGranularity* granularity) const {
+    Calendar calendar;
+    if (!impl_.InterpretParseData(parse_data, reference_time_ms_utc,
+                                  reference_timezone, reference_locale,
+                                  prefer_future_for_unspecified_date, &calendar,
+                                  granularity)) {
+      return false;
+    }
+    return calendar.GetTimeInMillis(interpreted_time_ms_utc);
+  }
+
+  DatetimeGranularity GetGranularity(const DatetimeParsedData& data) const {
+    return impl_.GetGranularity(data);
+  }
+
+ private:
+  calendar::CalendarLibTempl<Calendar> impl_;
+};
+
+}  // namespace libtextclassifier3
+
+#endif  // LIBTEXTCLASSIFIER_UTILS_CALENDAR_CALENDAR_ABSL_H_
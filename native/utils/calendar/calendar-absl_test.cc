@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/calendar/calendar-absl.h"
+
+#include <string>
+
+#include "annotator/types.h"
+#include "gtest/gtest.h"
+
+namespace libtextclassifier3 {
+namespace {
+
+int FirstDayOfWeek(const std::string& locale) {
+  Calendar calendar;
+  EXPECT_TRUE(calendar.Initialize("Europe/Zurich", locale, /*time_ms_utc=*/0));
+  int first_day_of_week;
+  EXPECT_TRUE(calendar.GetFirstDayOfWeek(&first_day_of_week));
+  return first_day_of_week;
+}
+
+int MinimalDaysInFirstWeek(const std::string& locale) {
+  Calendar calendar;
+  EXPECT_TRUE(calendar.Initialize("Europe/Zurich", locale, /*time_ms_utc=*/0));
+  int minimal_days;
+  EXPECT_TRUE(calendar.GetMinimalDaysInFirstWeek(&minimal_days));
+  return minimal_days;
+}
+
+TEST(CalendarAbslTest, FirstDayOfWeekOfRegion) {
+  EXPECT_EQ(FirstDayOfWeek("en-US"), kSunday);
+  EXPECT_EQ(FirstDayOfWeek("de-CH"), kMonday);
+  EXPECT_EQ(FirstDayOfWeek("en-GB"), kMonday);
+  EXPECT_EQ(FirstDayOfWeek("ar-EG"), kSaturday);
+  EXPECT_EQ(FirstDayOfWeek("dv-MV"), kFriday);
+
+  // The region wins over the language.
+  EXPECT_EQ(FirstDayOfWeek("en-DE"), kMonday);
+  EXPECT_EQ(FirstDayOfWeek("de-US"), kSunday);
+
+  // Script subtags and extensions are skipped.
+  EXPECT_EQ(FirstDayOfWeek("zh-Hant-TW"), kSunday);
+  EXPECT_EQ(FirstDayOfWeek("es-419"), kMonday);
+  EXPECT_EQ(FirstDayOfWeek("de-u-ca-US"), kMonday);
+  EXPECT_EQ(FirstDayOfWeek("pt_BR"), kSunday);
+  EXPECT_EQ(FirstDayOfWeek("fr-ca"), kSunday);
+}
+
+TEST(CalendarAbslTest, FirstDayOfWeekOfLikelyRegion) {
+  EXPECT_EQ(FirstDayOfWeek("en"), kSunday);
+  EXPECT_EQ(FirstDayOfWeek("ja"), kSunday);
+  EXPECT_EQ(FirstDayOfWeek("de"), kMonday);
+  EXPECT_EQ(FirstDayOfWeek("fa"), kSaturday);
+  EXPECT_EQ(FirstDayOfWeek("EN"), kSunday);
+  EXPECT_EQ(FirstDayOfWeek(""), kMonday);
+  EXPECT_EQ(FirstDayOfWeek("und"), kMonday);
+}
+
+TEST(CalendarAbslTest, MinimalDaysInFirstWeekOfRegion) {
+  EXPECT_EQ(MinimalDaysInFirstWeek("de-CH"), 4);
+  EXPECT_EQ(MinimalDaysInFirstWeek("en-GB"), 4);
+  EXPECT_EQ(MinimalDaysInFirstWeek("fr"), 4);
+  EXPECT_EQ(MinimalDaysInFirstWeek("en-US"), 1);
+  EXPECT_EQ(MinimalDaysInFirstWeek("uk-UA"), 1);
+  EXPECT_EQ(MinimalDaysInFirstWeek("ja"), 1);
+  EXPECT_EQ(MinimalDaysInFirstWeek(""), 1);
+}
+
+class CalendarAbslDstTest : public ::testing::Test {
+ protected:
+  int64 Interpret(const DatetimeParsedData& data,
+                  const int64 reference_time_ms_utc) {
+    int64 time = 0;
+    DatetimeGranularity granularity;
+    EXPECT_TRUE(calendarlib_.InterpretParseData(
+        data, reference_time_ms_utc, /*reference_timezone=*/"Europe/Zurich",
+        /*reference_locale=*/"de-CH",
+        /*prefer_future_for_unspecified_date=*/false, &time, &granularity));
+    return time;
+  }
+
+  CalendarLib calendarlib_;
+};
+
+TEST_F(CalendarAbslDstTest, MovesTimeInTheGapForward) {
+  DatetimeParsedData data;
+  data.SetAbsoluteValue(DatetimeComponent::ComponentType::HOUR, 2);
+  data.SetAbsoluteValue(DatetimeComponent::ComponentType::MINUTE, 30);
+
+  // As the lenient java.util.Calendar: 02:30 doesn't exist on that day, and
+  // is interpreted as 03:30 CEST.
+  EXPECT_EQ(Interpret(data,
+                      /*reference_time_ms_utc=*/1521932400000L
+                      /* Sun Mar 25 2018 00:00:00 CET */),
+            1521941400000L /* Sun Mar 25 2018 03:30:00 CEST */);
+}
+
+TEST_F(CalendarAbslDstTest, InterpretsAmbiguousTimeAsStandardTime) {
+  DatetimeParsedData data;
+  data.SetAbsoluteValue(DatetimeComponent::ComponentType::HOUR, 2);
+  data.SetAbsoluteValue(DatetimeComponent::ComponentType::MINUTE, 30);
+
+  EXPECT_EQ(Interpret(data,
+                      /*reference_time_ms_utc=*/1540677600000L
+                      /* Sun Oct 28 2018 00:00:00 CEST */),
+            1540690200000L /* Sun Oct 28 2018 02:30:00 CET */);
+}
+
+TEST_F(CalendarAbslDstTest, KeepsWallTimeWhenAddingDaysOverTransition) {
+  DatetimeParsedData data;
+  data.SetRelativeValue(DatetimeComponent::ComponentType::DAY_OF_MONTH,
+                        DatetimeComponent::RelativeQualifier::FUTURE);
+  data.SetRelativeCount(DatetimeComponent::ComponentType::DAY_OF_MONTH, 1);
+
+  // The reference time is half an hour before the clocks are set forward.
+  EXPECT_EQ(Interpret(data,
+                      /*reference_time_ms_utc=*/1521937800000L
+                      /* Sun Mar 25 2018 01:30:00 CET */),
+            1522020600000L /* Mon Mar 26 2018 01:30:00 CEST */);
+}
+
+TEST_F(CalendarAbslDstTest, AddsHoursOverTransition) {
+  DatetimeParsedData data;
+  data.SetRelativeValue(DatetimeComponent::ComponentType::HOUR,
+                        DatetimeComponent::RelativeQualifier::FUTURE);
+  data.SetRelativeCount(DatetimeComponent::ComponentType::HOUR, 1);
+
+  EXPECT_EQ(Interpret(data,
+                      /*reference_time_ms_utc=*/1521937800000L
+                      /* Sun Mar 25 2018 01:30:00 CET */),
+            1521941400000L /* Sun Mar 25 2018 03:30:00 CEST */);
+}
+
+}  // namespace
+}  // namespace libtextclassifier3
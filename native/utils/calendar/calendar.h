@@ -20,6 +20,9 @@
 #if defined TC3_CALENDAR_ICU
 #include "utils/calendar/calendar-icu.h"
 #define INIT_CALENDARLIB_FOR_TESTING(VAR) VAR()
+#elif defined TC3_CALENDAR_ABSL
+#include "utils/calendar/calendar-absl.h"
+#define INIT_CALENDARLIB_FOR_TESTING(VAR) VAR()
 #elif defined TC3_CALENDAR_DUMMY
 #include "utils/calendar/calendar-dummy.h"
 #define INIT_CALENDARLIB_FOR_TESTING(VAR) VAR()
@@ -19,7 +19,7 @@
 
 namespace libtextclassifier3 {
 
-bool VerifyLuhnChecksum(const std::string& input, bool ignore_whitespace) {
+bool VerifyLuhnChecksum(StringPiece input, bool ignore_whitespace) {
   int sum = 0;
   int num_digits = 0;
   bool is_odd = true;
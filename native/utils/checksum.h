@@ -19,15 +19,14 @@
 #ifndef LIBTEXTCLASSIFIER_UTILS_CHECKSUM_H_
 #define LIBTEXTCLASSIFIER_UTILS_CHECKSUM_H_
 
-#include <string>
+#include "utils/strings/stringpiece.h"
 
 namespace libtextclassifier3 {
 
 // Computes and verifies that the last digit of `input` matches the Luhn
 // checksum. Returns false if presented with non-digits, or on whitespace
 // characters if `ignore_whitespace` is false.
-bool VerifyLuhnChecksum(const std::string& input,
-                        bool ignore_whitespace = true);
+bool VerifyLuhnChecksum(StringPiece input, bool ignore_whitespace = true);
 
 }  // namespace libtextclassifier3
 
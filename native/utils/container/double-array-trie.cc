@@ -20,8 +20,9 @@
 
 namespace libtextclassifier3 {
 
-bool DoubleArrayTrie::GatherPrefixMatches(
-    StringPiece input, const std::function<void(Match)>& update_fn) const {
+template <typename UpdateFn>
+bool DoubleArrayTrie::GatherPrefixMatches(StringPiece input,
+                                          const UpdateFn& update_fn) const {
   uint32 pos = 0;
   if (nodes_length_ == 0) {
     TC3_LOG(WARNING) << "Trie is empty. Skipping.";
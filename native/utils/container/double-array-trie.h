@@ -73,8 +73,10 @@ class DoubleArrayTrie : public StringSet {
     return (node >> 10) << ((node & 0x200) >> 6);
   }
 
-  bool GatherPrefixMatches(StringPiece input,
-                           const std::function<void(Match)>& update_fn) const;
+  // Calls update_fn(match) for each piece that is a prefix of the input. A
+  // template instead of a std::function, so that the callback is inlined.
+  template <typename UpdateFn>
+  bool GatherPrefixMatches(StringPiece input, const UpdateFn& update_fn) const;
 
   const TrieNode* nodes_;
   const int nodes_length_;
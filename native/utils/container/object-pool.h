@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBTEXTCLASSIFIER_UTILS_CONTAINER_OBJECT_POOL_H_
+#define LIBTEXTCLASSIFIER_UTILS_CONTAINER_OBJECT_POOL_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <utility>
+
+namespace libtextclassifier3 {
+
+// A bounded, lock-free pool of objects that are expensive to create (e.g.
+// TFLite interpreters), to be shared between threads.
+// Objects are checked out with Acquire() and handed back with Release(). If
+// the pool is empty, a new object is created with the factory; if the pool is
+// full, a released object is destroyed. Thus at most `capacity` idle objects
+// are kept alive, while the number of objects in use is not limited.
+// NOTE: The pool is thread-safe, the pooled objects are not: an object is only
+// ever owned by one caller at a time.
+template <typename T>
+class ObjectPool {
+ public:
+  using Factory = std::function<std::unique_ptr<T>()>;
+
+  // Default capacity. Idle objects are only created up to the number of
+  // concurrent callers, so a single-threaded client keeps just one warm object.
+  static constexpr int kDefaultMaxIdle = 8;
+
+  ObjectPool(const int capacity, Factory factory)
+      : capacity_(capacity > 0 ? capacity : 0),
+        factory_(std::move(factory)),
+        slots_(new std::atomic<T*>[capacity_]) {
+    for (int i = 0; i < capacity_; i++) {
+      slots_[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  ~ObjectPool() {
+    for (int i = 0; i < capacity_; i++) {
+      delete slots_[i].exchange(nullptr, std::memory_order_acquire);
+    }
+  }
+
+  ObjectPool(const ObjectPool&) = delete;
+  ObjectPool& operator=(const ObjectPool&) = delete;
+
+  // Checks out an idle object from the pool, or creates a new one if there is
+  // none. Returns nullptr if the factory failed to create an object.
+  std::unique_ptr<T> Acquire() {
+    const int start = NextSlot();
+    for (int i = 0; i < capacity_; i++) {
+      std::atomic<T*>& slot = slots_[(start + i) % capacity_];
+      if (slot.load(std::memory_order_relaxed) == nullptr) {
+        continue;
+      }
+      T* object = slot.exchange(nullptr, std::memory_order_acquire);
+      if (object != nullptr) {
+        return std::unique_ptr<T>(object);
+      }
+    }
+    return factory_();
+  }
+
+  // Returns an object to the pool. The object is destroyed if the pool is
+  // already full.
+  void Release(std::unique_ptr<T> object) {
+    if (object == nullptr) {
+      return;
+    }
+    const int start = NextSlot();
+    for (int i = 0; i < capacity_; i++) {
+      std::atomic<T*>& slot = slots_[(start + i) % capacity_];
+      T* expected = nullptr;
+      if (slot.compare_exchange_strong(expected, object.get(),
+                                       std::memory_order_release,
+                                       std::memory_order_relaxed)) {
+        object.release();
+        return;
+      }
+    }
+  }
+
+  // Eagerly creates up to `num_objects` idle objects, so that the first
+  // requests don't pay for the object construction.
+  void Warmup(const int num_objects) {
+    for (int i = 0; i < num_objects && i < capacity_; i++) {
+      std::unique_ptr<T> object = factory_();
+      if (object == nullptr) {
+        return;
+      }
+      Release(std::move(object));
+    }
+  }
+
+  int capacity() const { return capacity_; }
+
+  // Number of idle objects currently held by the pool. Only approximate when
+  // the pool is used concurrently.
+  int NumIdle() const {
+    int num_idle = 0;
+    for (int i = 0; i < capacity_; i++) {
+      if (slots_[i].load(std::memory_order_relaxed) != nullptr) {
+        ++num_idle;
+      }
+    }
+    return num_idle;
+  }
+
+ private:
+  // Spreads concurrent callers over different slots to reduce contention.
+  int NextSlot() {
+    if (capacity_ == 0) {
+      return 0;
+    }
+    return static_cast<unsigned int>(
+               next_slot_.fetch_add(1, std::memory_order_relaxed)) %
+           capacity_;
+  }
+
+  const int capacity_;
+  const Factory factory_;
+  std::unique_ptr<std::atomic<T*>[]> slots_;
+  std::atomic<unsigned int> next_slot_{0};
+};
+
+// Scoped checkout of an object from an ObjectPool, returns the object to the
+// pool when it goes out of scope.
+template <typename T>
+class PooledObject {
+ public:
+  explicit PooledObject(ObjectPool<T>* pool)
+      : pool_(pool), object_(pool->Acquire()) {}
+
+  // Creates an empty checkout, an object can be checked out later on with
+  // Reset().
+  PooledObject() : pool_(nullptr) {}
+
+  ~PooledObject() { Reset(nullptr); }
+
+  // Returns the current object, if any, to its pool and checks out a new
+  // object from `pool`, if given.
+  void Reset(ObjectPool<T>* pool) {
+    if (pool_ != nullptr) {
+      pool_->Release(std::move(object_));
+    }
+    object_.reset();
+    pool_ = pool;
+    if (pool_ != nullptr) {
+      object_ = pool_->Acquire();
+    }
+  }
+
+  PooledObject(const PooledObject&) = delete;
+  PooledObject& operator=(const PooledObject&) = delete;
+
+  T* get() const { return object_.get(); }
+  T* operator->() const { return object_.get(); }
+  T& operator*() const { return *object_; }
+  explicit operator bool() const { return object_ != nullptr; }
+
+ private:
+  ObjectPool<T>* pool_;
+  std::unique_ptr<T> object_;
+};
+
+}  // namespace libtextclassifier3
+
+#endif  // LIBTEXTCLASSIFIER_UTILS_CONTAINER_OBJECT_POOL_H_
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/container/object-pool.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace libtextclassifier3 {
+namespace {
+
+TEST(ObjectPoolTest, ReusesReleasedObjects) {
+  int num_created = 0;
+  ObjectPool<int> pool(/*capacity=*/2, [&num_created]() {
+    return std::unique_ptr<int>(new int(num_created++));
+  });
+
+  std::unique_ptr<int> first = pool.Acquire();
+  ASSERT_NE(first, nullptr);
+  EXPECT_EQ(*first, 0);
+  int* first_ptr = first.get();
+  pool.Release(std::move(first));
+  EXPECT_EQ(pool.NumIdle(), 1);
+
+  std::unique_ptr<int> second = pool.Acquire();
+  EXPECT_EQ(second.get(), first_ptr);
+  EXPECT_EQ(num_created, 1);
+  EXPECT_EQ(pool.NumIdle(), 0);
+}
+
+TEST(ObjectPoolTest, IsBounded) {
+  ObjectPool<int> pool(/*capacity=*/2,
+                       []() { return std::unique_ptr<int>(new int(0)); });
+
+  std::vector<std::unique_ptr<int>> objects;
+  for (int i = 0; i < 5; i++) {
+    objects.push_back(pool.Acquire());
+  }
+  for (std::unique_ptr<int>& object : objects) {
+    pool.Release(std::move(object));
+  }
+  EXPECT_EQ(pool.NumIdle(), 2);
+}
+
+TEST(ObjectPoolTest, WorksWithoutCapacity) {
+  ObjectPool<int> pool(/*capacity=*/0,
+                       []() { return std::unique_ptr<int>(new int(7)); });
+  std::unique_ptr<int> object = pool.Acquire();
+  ASSERT_NE(object, nullptr);
+  EXPECT_EQ(*object, 7);
+  pool.Release(std::move(object));
+  EXPECT_EQ(pool.NumIdle(), 0);
+}
+
+TEST(ObjectPoolTest, Warmup) {
+  int num_created = 0;
+  ObjectPool<int> pool(/*capacity=*/3, [&num_created]() {
+    return std::unique_ptr<int>(new int(num_created++));
+  });
+  pool.Warmup(/*num_objects=*/5);
+  EXPECT_EQ(num_created, 3);
+  EXPECT_EQ(pool.NumIdle(), 3);
+}
+
+TEST(ObjectPoolTest, PooledObjectReturnsToPool) {
+  ObjectPool<int> pool(/*capacity=*/1,
+                       []() { return std::unique_ptr<int>(new int(1)); });
+  {
+    PooledObject<int> object(&pool);
+    ASSERT_TRUE(object);
+    EXPECT_EQ(*object, 1);
+    EXPECT_EQ(pool.NumIdle(), 0);
+  }
+  EXPECT_EQ(pool.NumIdle(), 1);
+}
+
+TEST(ObjectPoolTest, EmptyPooledObjectChecksOutOnReset) {
+  ObjectPool<int> pool(/*capacity=*/1,
+                       []() { return std::unique_ptr<int>(new int(1)); });
+  pool.Warmup(1);
+  {
+    PooledObject<int> object;
+    EXPECT_FALSE(object);
+    EXPECT_EQ(pool.NumIdle(), 1);
+    object.Reset(&pool);
+    ASSERT_TRUE(object);
+    EXPECT_EQ(pool.NumIdle(), 0);
+  }
+  EXPECT_EQ(pool.NumIdle(), 1);
+}
+
+TEST(ObjectPoolTest, ConcurrentAccessNeverSharesObjects) {
+  std::atomic<int> num_created(0);
+  ObjectPool<std::atomic<int>> pool(/*capacity=*/4, [&num_created]() {
+    num_created++;
+    return std::unique_ptr<std::atomic<int>>(new std::atomic<int>(0));
+  });
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&pool]() {
+      for (int i = 0; i < 1000; i++) {
+        PooledObject<std::atomic<int>> object(&pool);
+        // Each object is exclusively owned while checked out.
+        EXPECT_EQ(object->fetch_add(1), 0);
+        object->fetch_sub(1);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_LE(pool.NumIdle(), 4);
+}
+
+}  // namespace
+}  // namespace libtextclassifier3
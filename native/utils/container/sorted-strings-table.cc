@@ -23,8 +23,9 @@
 
 namespace libtextclassifier3 {
 
-void SortedStringsTable::GatherPrefixMatches(
-    StringPiece input, const std::function<void(Match)>& update_fn) const {
+template <typename UpdateFn>
+void SortedStringsTable::GatherPrefixMatches(StringPiece input,
+                                             const UpdateFn& update_fn) const {
   int left = 0;
   int right = num_pieces_;
   int span_size = right - left;
@@ -17,7 +17,6 @@
 #ifndef LIBTEXTCLASSIFIER_UTILS_CONTAINER_SORTED_STRINGS_TABLE_H_
 #define LIBTEXTCLASSIFIER_UTILS_CONTAINER_SORTED_STRINGS_TABLE_H_
 
-#include <functional>
 #include <vector>
 
 #include "utils/base/integral_types.h"
@@ -53,8 +52,10 @@ class SortedStringsTable : public StringSet {
                           Match* longest_match) const override;
 
  private:
-  void GatherPrefixMatches(StringPiece input,
-                           const std::function<void(Match)>& update_fn) const;
+  // Calls update_fn(match) for each piece that is a prefix of the input. A
+  // template instead of a std::function, so that the callback is inlined.
+  template <typename UpdateFn>
+  void GatherPrefixMatches(StringPiece input, const UpdateFn& update_fn) const;
 
   const int num_pieces_;
   const uint32* offsets_;
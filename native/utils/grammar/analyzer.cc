@@ -78,9 +78,20 @@ StatusOr<std::vector<EvaluatedDerivation>> Analyzer::Parse(
 
 TextContext Analyzer::BuildTextContextForInput(
     const UnicodeText& text, const std::vector<Locale>& locales) const {
+  return BuildTextContextForInput(text, locales,
+                                  /*tokenization_cache=*/nullptr);
+}
+
+TextContext Analyzer::BuildTextContextForInput(
+    const UnicodeText& text, const std::vector<Locale>& locales,
+    TokenizationCache* tokenization_cache) const {
   TextContext context;
   context.text = UnicodeText(text, /*do_copy=*/false);
-  context.tokens = tokenizer_->Tokenize(context.text);
+  if (tokenization_cache != nullptr && tokenization_cache->IsForText(text)) {
+    context.tokens = tokenization_cache->Tokenize(*tokenizer_);
+  } else {
+    context.tokens = tokenizer_->Tokenize(context.text);
+  }
   context.codepoints = context.text.Codepoints();
   context.codepoints.push_back(context.text.end());
   context.locales = locales;
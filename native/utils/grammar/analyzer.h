@@ -50,6 +50,12 @@ class Analyzer {
   TextContext BuildTextContextForInput(
       const UnicodeText& text, const std::vector<Locale>& locales = {}) const;
 
+  // Same as above, but takes the tokens from `tokenization_cache` (if not
+  // null and holding the tokenizations of `text`).
+  TextContext BuildTextContextForInput(
+      const UnicodeText& text, const std::vector<Locale>& locales,
+      TokenizationCache* tokenization_cache) const;
+
   const Parser& parser() const { return parser_; }
 
  private:
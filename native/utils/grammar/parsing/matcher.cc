@@ -149,6 +149,50 @@ const char* FindTerminal(T input_iterator, const char* strings,
   return nullptr;
 }
 
+// Checks whether the input matches a zero-terminated terminal string.
+template <typename T>
+bool MatchesTerminal(T input_iterator, const char* terminal) {
+  for (; input_iterator.HasNext(); ++terminal) {
+    if (*terminal == 0 || input_iterator.Next() != *terminal) {
+      return false;
+    }
+  }
+  return *terminal == 0;
+}
+
+// Searches a terminal match with the hash table index of the terminals.
+template <typename T>
+const char* FindTerminalInHashTable(
+    T input_iterator, const char* strings, const uint32* offsets,
+    const int num_terminals, const flatbuffers::Vector<uint32>* hash_table,
+    int* terminal_index) {
+  uint32 hash = kTerminalHashSeed;
+  for (T it = input_iterator; it.HasNext();) {
+    hash = TerminalHash(hash, static_cast<unsigned char>(it.Next()));
+  }
+  const uint32 mask = hash_table->size() - 1;
+  uint32 slot = hash & mask;
+  for (int i = 0; i < hash_table->size(); i++, slot = (slot + 1) & mask) {
+    const uint32 entry = hash_table->Get(slot);
+    if (entry == 0 || entry > static_cast<uint32>(num_terminals)) {
+      return nullptr;
+    }
+    const char* terminal =
+        &strings[LittleEndian::ToHost32(offsets[entry - 1])];
+    if (MatchesTerminal(input_iterator, terminal)) {
+      *terminal_index = entry - 1;
+      return terminal;
+    }
+  }
+  return nullptr;
+}
+
+// Checks that a terminal hash table can be used for lookups.
+bool IsValidHashTable(const flatbuffers::Vector<uint32>* hash_table) {
+  return hash_table != nullptr && hash_table->size() > 0 &&
+         (hash_table->size() & (hash_table->size() - 1)) == 0;
+}
+
 // Finds terminal matches in the terminal rules hash tables.
 // In case a match is found, `terminal` will be set to point into the
 // terminals string pool.
@@ -163,10 +207,19 @@ const RulesSet_::LhsSet* FindTerminalMatches(
     return nullptr;
   }
   int terminal_index;
-  if (const char* terminal_match = FindTerminal(
-          input_iterator, rules_set->terminals()->data(),
-          terminal_rules->terminal_offsets()->data(),
-          terminal_rules->terminal_offsets()->size(), &terminal_index)) {
+  const char* terminal_match =
+      IsValidHashTable(terminal_rules->terminal_hash_table())
+          ? FindTerminalInHashTable(input_iterator,
+                                    rules_set->terminals()->data(),
+                                    terminal_rules->terminal_offsets()->data(),
+                                    terminal_rules->terminal_offsets()->size(),
+                                    terminal_rules->terminal_hash_table(),
+                                    &terminal_index)
+          : FindTerminal(input_iterator, rules_set->terminals()->data(),
+                         terminal_rules->terminal_offsets()->data(),
+                         terminal_rules->terminal_offsets()->size(),
+                         &terminal_index);
+  if (terminal_match != nullptr) {
     *terminal = StringPiece(terminal_match, terminal->length());
     return rules_set->lhs_set()->Get(
         terminal_rules->lhs_set_index()->Get(terminal_index));
@@ -121,7 +121,7 @@ class Matcher {
   // fulfilled.
   void ProcessPendingExclusionMatches();
 
-  UniLib unilib_;
+  const UniLib& unilib_;
 
   // Memory arena for match allocation.
   UnsafeArena* arena_;
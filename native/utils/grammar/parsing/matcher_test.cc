@@ -16,6 +16,7 @@
 
 #include "utils/grammar/parsing/matcher.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -146,6 +147,36 @@ TEST_F(MatcherTest, HandlesBasicOperations) {
                           IsNonterminal(0, 4, "<action>")));
 }
 
+TEST_F(MatcherTest, HandlesRulesWithoutTerminalHashTable) {
+  grammar::LocaleShardMap locale_shard_map =
+      grammar::LocaleShardMap::CreateLocaleShardMap({""});
+  Rules rules(locale_shard_map);
+  rules.Add("<test>", {"the", "quick", "brown", "fox"},
+            static_cast<CallbackId>(DefaultCallback::kRootRule));
+  RulesSetT rules_set_t;
+  rules.Finalize().Serialize(/*include_debug_information=*/true, &rules_set_t);
+
+  // Drop the terminal index, as in rules compiled before it was added.
+  for (const std::unique_ptr<RulesSet_::RulesT>& shard : rules_set_t.rules) {
+    EXPECT_THAT(shard->lowercase_terminal_rules->terminal_hash_table,
+                testing::SizeIs(8));
+    shard->lowercase_terminal_rules->terminal_hash_table.clear();
+  }
+  flatbuffers::FlatBufferBuilder builder;
+  builder.Finish(RulesSet::Pack(builder, &rules_set_t));
+  const RulesSet* rules_set =
+      flatbuffers::GetRoot<RulesSet>(builder.GetBufferPointer());
+  Matcher matcher(&unilib_, rules_set, &arena_);
+
+  matcher.AddTerminal(0, 1, "The");
+  matcher.AddTerminal(1, 2, "quick");
+  matcher.AddTerminal(2, 3, "brown");
+  matcher.AddTerminal(3, 4, "fox");
+
+  EXPECT_THAT(GetMatchResults(matcher.chart(), rules_set->debug_information()),
+              ElementsAre(IsNonterminal(0, 4, "<test>")));
+}
+
 std::string CreateTestGrammar() {
   // Create an example grammar.
   grammar::LocaleShardMap locale_shard_map =
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "utils/grammar/parsing/derivation.h"
+#include "utils/grammar/parsing/parser.h"
+#include "utils/grammar/rules_generated.h"
+#include "utils/grammar/text-context.h"
+#include "utils/grammar/types.h"
+#include "utils/grammar/utils/rules.h"
+#include "utils/i18n/locale.h"
+#include "utils/jvm-test-utils.h"
+#include "utils/memory/arena-pool.h"
+#include "utils/testing/benchmark-utils.h"
+#include "utils/tokenizer.h"
+#include "utils/utf8/unicodetext.h"
+#include "utils/utf8/unilib.h"
+#include "benchmark/benchmark.h"
+
+namespace libtextclassifier3::grammar {
+namespace {
+
+// Rules for dates, times, flight and card numbers, in the style of the
+// grammar annotator rules.
+std::string CreateRules() {
+  LocaleShardMap locale_shard_map = LocaleShardMap::CreateLocaleShardMap({""});
+  Rules rules(locale_shard_map);
+  rules.Add("<day>", {"<1_digits>"});
+  rules.Add("<day>", {"<2_digits>"});
+  rules.Add("<month>", {"<1_digits>"});
+  rules.Add("<month>", {"<2_digits>"});
+  rules.Add("<year>", {"<4_digits>"});
+  rules.Add("<hour>", {"<1_digits>"});
+  rules.Add("<hour>", {"<2_digits>"});
+  rules.Add("<minute>", {"<2_digits>"});
+  rules.Add("<meridiem>", {"am"});
+  rules.Add("<meridiem>", {"pm"});
+  rules.Add("<carrier>", {"lx"});
+  rules.Add("<carrier>", {"aa"});
+  rules.Add("<carrier>", {"ua"});
+
+  constexpr int kDate = 0;
+  rules.Add("<date>", {"<year>", "-", "<month>", "-", "<day>"},
+            static_cast<CallbackId>(DefaultCallback::kRootRule), kDate);
+  rules.Add("<date>", {"<day>", "/", "<month>"},
+            static_cast<CallbackId>(DefaultCallback::kRootRule), kDate);
+  constexpr int kTime = 1;
+  rules.Add("<time>", {"<hour>", ":", "<minute>"},
+            static_cast<CallbackId>(DefaultCallback::kRootRule), kTime);
+  rules.Add("<time>", {"at?", "<hour>", "<meridiem>"},
+            static_cast<CallbackId>(DefaultCallback::kRootRule), kTime);
+  constexpr int kFlight = 2;
+  rules.Add("<flight>", {"flight?", "<carrier>", "<digits>", "<\b>"},
+            static_cast<CallbackId>(DefaultCallback::kRootRule), kFlight);
+  constexpr int kCard = 3;
+  rules.Add("<card>",
+            {"<4_digits>", "<4_digits>", "<4_digits>", "<4_digits>"},
+            static_cast<CallbackId>(DefaultCallback::kRootRule), kCard);
+  return rules.Finalize().SerializeAsFlatbuffer();
+}
+
+// Arguments: number of lines of the input.
+void BM_Parse(benchmark::State& state) {
+  const std::unique_ptr<UniLib> unilib = CreateUniLibForTesting();
+  const std::string rules_buffer = CreateRules();
+  const Parser parser(unilib.get(),
+                      flatbuffers::GetRoot<RulesSet>(rules_buffer.data()));
+  const Tokenizer tokenizer(TokenizationType_ICU, unilib.get(),
+                            /*codepoint_ranges=*/{},
+                            /*internal_tokenizer_codepoint_ranges=*/{},
+                            /*split_on_script_change=*/false,
+                            /*icu_preserve_whitespace_tokens=*/false);
+
+  TextContext context;
+  context.text = UTF8ToUnicodeText(GenerateDenseEntityText(state.range(0)));
+  context.tokens = tokenizer.Tokenize(context.text);
+  context.codepoints = context.text.Codepoints();
+  context.codepoints.push_back(context.text.end());
+  context.locales = {Locale::FromBCP47("en")};
+  context.context_span = {0, static_cast<int>(context.tokens.size())};
+
+  ArenaPool arena_pool(/*block_size=*/16 << 10);
+  int num_derivations = 0;
+  for (auto _ : state) {
+    ArenaPool::ScopedArena arena(&arena_pool);
+    num_derivations = parser.Parse(context, arena.get()).size();
+  }
+  state.SetBytesProcessed(state.iterations() * context.text.size_bytes());
+  state.counters["derivations"] = num_derivations;
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_Parse)
+    ->RangeMultiplier(4)
+    ->Range(1, 256)
+    ->Complexity(benchmark::oN);
+BENCHMARK(BM_Parse)->Arg(16)->Apply(ReportLatencyPercentiles);
+
+}  // namespace
+}  // namespace libtextclassifier3::grammar
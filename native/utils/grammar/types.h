@@ -71,6 +71,14 @@ struct BinaryRuleHasher {
   }
 };
 
+// Hash of a terminal string for the terminal rules hash tables (32-bit
+// FNV-1a), computed incrementally byte by byte.
+constexpr uint32 kTerminalHashSeed = 0x811c9dc5;
+
+inline uint32 TerminalHash(const uint32 hash, const unsigned char c) {
+  return (hash ^ c) * 0x01000193;
+}
+
 }  // namespace libtextclassifier3::grammar
 
 #endif  // LIBTEXTCLASSIFIER_UTILS_GRAMMAR_TYPES_H_
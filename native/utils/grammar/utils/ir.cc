@@ -394,6 +394,33 @@ void Ir::SerializeTerminalRules(
     rules_maps[entry.set_index]->lhs_set_index.push_back(
         AddLhsSet(entry.lhs_set, rules_set));
   }
+
+  // Build the hash table index of the terminals of each set. The tables are
+  // kept at most half full for short probe sequences.
+  for (int i = 0; i < terminal_rules_sets.size(); i++) {
+    const int num_terminals = terminal_rules_sets[i]->size();
+    if (num_terminals == 0) {
+      continue;
+    }
+    int table_size = 1;
+    while (table_size < 2 * num_terminals) {
+      table_size <<= 1;
+    }
+    rules_maps[i]->terminal_hash_table.assign(table_size, 0);
+  }
+  for (const TerminalEntry& entry : terminal_rules) {
+    auto& table = rules_maps[entry.set_index]->terminal_hash_table;
+    uint32 hash = kTerminalHashSeed;
+    for (const char c : entry.terminal) {
+      hash = TerminalHash(hash, static_cast<unsigned char>(c));
+    }
+    const uint32 mask = table.size() - 1;
+    uint32 slot = hash & mask;
+    while (table[slot] != 0) {
+      slot = (slot + 1) & mask;
+    }
+    table[slot] = entry.index + 1;
+  }
 }
 
 void Ir::Serialize(const bool include_debug_information,
@@ -211,6 +211,13 @@ TEST(IrTest, HandlesRulesSharding) {
               SizeIs(6));
   EXPECT_THAT(rules.rules[1]->terminal_rules->terminal_offsets, IsEmpty());
 
+  // The terminal hash tables are at most half full.
+  EXPECT_THAT(rules.rules[0]->lowercase_terminal_rules->terminal_hash_table,
+              SizeIs(16));
+  EXPECT_THAT(rules.rules[1]->lowercase_terminal_rules->terminal_hash_table,
+              SizeIs(16));
+  EXPECT_THAT(rules.rules[1]->terminal_rules->terminal_hash_table, IsEmpty());
+
   EXPECT_THAT(rules.terminals,
               Eq(std::string("bring\0bringen\0buy\0erinnere\0erinnern\0kaufen\0"
                              "me\0mich\0remind\0to\0zu\0",
@@ -42,6 +42,13 @@ static constexpr const char kClassificationKey[] = "classification";
 static constexpr const char kSerializedEntity[] = "serialized_entity";
 static constexpr const char kEntityKey[] = "entity";
 
+// Registry field holding the snapshot of the shared globals.
+static constexpr const char kGlobalsSnapshotKey[] = "tc3_globals_snapshot";
+
+// Field of a table copy in the snapshot that holds the metatable of the table.
+// Its address is used as a light userdata key, which Lua code can't produce.
+static constexpr char kSnapshotMetatableKey = 0;
+
 // Implementation of a lua_Writer that appends the data to a string.
 int LuaStringWriter(lua_State* state, const void* data, size_t size,
                     void* result) {
@@ -51,6 +58,84 @@ int LuaStringWriter(lua_State* state, const void* data, size_t size,
   return LUA_OK;
 }
 
+// Adds a copy of the table at the top of the stack to the snapshot at
+// `snapshot_index`, keyed by the table, and does the same for all the tables
+// and metatables reachable from it.
+void SnapshotTable(lua_State* state, const int snapshot_index) {
+  luaL_checkstack(state, 4, nullptr);
+  const int table = lua_gettop(state);
+  lua_pushvalue(state, table);
+  if (lua_rawget(state, snapshot_index) != LUA_TNIL) {
+    // Already in the snapshot.
+    lua_pop(state, 1);
+    return;
+  }
+  lua_pop(state, 1);
+
+  lua_newtable(state);
+  const int copy = lua_gettop(state);
+  lua_pushvalue(state, table);
+  lua_pushvalue(state, copy);
+  lua_rawset(state, snapshot_index);
+
+  lua_pushnil(state);
+  while (lua_next(state, table) != 0) {
+    lua_pushvalue(state, -2);
+    lua_pushvalue(state, -2);
+    lua_rawset(state, copy);
+    if (lua_type(state, -1) == LUA_TTABLE) {
+      SnapshotTable(state, snapshot_index);
+    }
+    lua_pop(state, 1);  // Value.
+  }
+
+  if (lua_getmetatable(state, table)) {
+    SnapshotTable(state, snapshot_index);
+    lua_rawsetp(state, copy, &kSnapshotMetatableKey);
+  }
+  lua_pop(state, 1);  // Copy.
+}
+
+// Restores the tables of a snapshot taken with SnapshotTable: removes the
+// fields that were added since, and resets the fields and metatables that were
+// changed.
+void RestoreSnapshot(lua_State* state, const int snapshot_index) {
+  lua_pushnil(state);
+  while (lua_next(state, snapshot_index) != 0) {
+    const int table = lua_gettop(state) - 1;
+    const int copy = lua_gettop(state);
+
+    // Clearing fields while traversing a table is allowed.
+    lua_pushnil(state);
+    while (lua_next(state, table) != 0) {
+      lua_pop(state, 1);  // Value.
+      lua_pushvalue(state, -1);
+      if (lua_rawget(state, copy) == LUA_TNIL) {
+        lua_pushvalue(state, -2);
+        lua_pushnil(state);
+        lua_rawset(state, table);
+      }
+      lua_pop(state, 1);
+    }
+
+    lua_pushnil(state);
+    while (lua_next(state, copy) != 0) {
+      if (lua_touserdata(state, -2) == &kSnapshotMetatableKey) {
+        lua_pop(state, 1);  // Value.
+        continue;
+      }
+      lua_pushvalue(state, -2);
+      lua_insert(state, -2);
+      lua_rawset(state, table);
+    }
+
+    lua_rawgetp(state, copy, &kSnapshotMetatableKey);
+    lua_setmetatable(state, table);
+
+    lua_pop(state, 1);  // Copy.
+  }
+}
+
 }  // namespace
 
 LuaEnvironment::LuaEnvironment() { state_ = luaL_newstate(); }
@@ -334,6 +419,67 @@ void LuaEnvironment::LoadDefaultLibraries() {
   }
 }
 
+int LuaEnvironment::LoadSnippet(StringPiece snippet) const {
+  if (luaL_loadbuffer(state_, snippet.data(), snippet.size(),
+                      /*name=*/nullptr) != LUA_OK) {
+    TC3_LOG(ERROR) << "Could not load lua snippet: "
+                   << ReadString(/*index=*/kIndexStackTop);
+    lua_pop(state_, 1);
+    return LUA_NOREF;
+  }
+  return luaL_ref(state_, LUA_REGISTRYINDEX);
+}
+
+void LuaEnvironment::PushSnippetWithFreshEnvironment(const int snippet) const {
+  // The shared globals, the libraries and the string metatable are
+  // snapshotted before the first run, and restored after each one.
+  if (lua_getfield(state_, LUA_REGISTRYINDEX, kGlobalsSnapshotKey) ==
+      LUA_TNIL) {
+    lua_newtable(state_);
+    const int snapshot_index = lua_gettop(state_);
+    lua_rawgeti(state_, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+    SnapshotTable(state_, snapshot_index);
+    lua_pop(state_, 1);
+    lua_pushliteral(state_, "");
+    if (lua_getmetatable(state_, /*objindex=*/-1)) {
+      SnapshotTable(state_, snapshot_index);
+      lua_pop(state_, 1);
+    }
+    lua_pop(state_, 1);
+    lua_setfield(state_, LUA_REGISTRYINDEX, kGlobalsSnapshotKey);
+  } else {
+    lua_pop(state_, 1);
+  }
+
+  lua_rawgeti(state_, LUA_REGISTRYINDEX, snippet);
+
+  // Fresh environment that falls back to the shared globals.
+  lua_newtable(state_);
+  lua_newtable(state_);
+  lua_rawgeti(state_, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+  lua_setfield(state_, /*idx=*/-2, kIndexKey);
+  lua_setmetatable(state_, /*idx=*/-2);
+
+  // The environment of a chunk is its first (and only) upvalue, `_ENV`.
+  lua_pushvalue(state_, /*idx=*/-1);
+  lua_setupvalue(state_, /*funcindex=*/-3, /*n=*/1);
+}
+
+void LuaEnvironment::ResetSnippetEnvironment(const int snippet) const {
+  lua_rawgeti(state_, LUA_REGISTRYINDEX, snippet);
+  lua_rawgeti(state_, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+  lua_setupvalue(state_, /*funcindex=*/-2, /*n=*/1);
+  lua_pop(state_, 1);
+
+  // Undo the changes of the run to the shared globals, e.g. `_G.x = ...`,
+  // `rawset(_G, ...)` or writes to the library tables.
+  if (lua_getfield(state_, LUA_REGISTRYINDEX, kGlobalsSnapshotKey) ==
+      LUA_TTABLE) {
+    RestoreSnapshot(state_, lua_gettop(state_));
+  }
+  lua_pop(state_, 1);
+}
+
 StringPiece LuaEnvironment::ReadString(const int index) const {
   size_t length = 0;
   const char* data = lua_tolstring(state_, index, &length);
@@ -75,6 +75,27 @@ class LuaEnvironment {
   // Loads default libraries.
   void LoadDefaultLibraries();
 
+  // Loads a (compiled) snippet once and keeps it in the registry, so that it
+  // can be run repeatedly without being loaded again.
+  // Returns the registry reference of the snippet, or LUA_NOREF if the snippet
+  // could not be loaded.
+  int LoadSnippet(StringPiece snippet) const;
+
+  // Pushes a snippet loaded with LoadSnippet, set up to run with a fresh
+  // global environment, followed by the environment table.
+  // Globals set by the run only end up in this environment, while the shared
+  // globals (e.g. the default libraries) are still visible through it. This
+  // keeps the state of one run from leaking into the next one when the
+  // environment is reused.
+  // The first call takes a snapshot of the shared globals and of the tables
+  // reachable from them, which ResetSnippetEnvironment restores.
+  void PushSnippetWithFreshEnvironment(int snippet) const;
+
+  // Points a snippet back to the shared globals after a run, so that the data
+  // of the last run can be garbage collected, and undoes any change the run
+  // made to the shared globals, e.g. through `_G` or `rawset`.
+  void ResetSnippetEnvironment(int snippet) const;
+
   // Provides a callback to Lua.
   template <typename T>
   void PushFunction(int (T::*handler)()) {
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/memory/arena-pool.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "utils/base/logging.h"
+
+namespace libtextclassifier3 {
+
+constexpr size_t ArenaPool::kDefaultMaxRetainedBytes;
+
+ReusableArena::ReusableArena(const size_t block_size,
+                             const size_t max_retained_bytes)
+    : max_retained_bytes_(std::max(block_size, max_retained_bytes)),
+      first_block_size_(block_size),
+      first_block_(new char[block_size]),
+      arena_(new UnsafeArena(first_block_.get(), block_size)) {}
+
+ArenaStats ReusableArena::Stats() const {
+  ArenaStats stats;
+  stats.bytes_reserved = arena_->status().bytes_allocated();
+  stats.num_blocks = arena_->block_count();
+  return stats;
+}
+
+ArenaStats ReusableArena::Reset() {
+  const ArenaStats stats = Stats();
+  if (stats.num_blocks > 1 && first_block_size_ < max_retained_bytes_) {
+    // Grow the first block to the high-water mark, the arena needs to go
+    // before the block it was using.
+    first_block_size_ = std::min(stats.bytes_reserved, max_retained_bytes_);
+    arena_.reset();
+    first_block_.reset(new char[first_block_size_]);
+    arena_.reset(new UnsafeArena(first_block_.get(), first_block_size_));
+  } else {
+    arena_->Reset();
+  }
+  return stats;
+}
+
+ArenaPool::ArenaPool(const size_t block_size, const size_t max_retained_bytes,
+                     const int capacity)
+    : arenas_(capacity, [block_size, max_retained_bytes]() {
+        return std::unique_ptr<ReusableArena>(
+            new ReusableArena(block_size, max_retained_bytes));
+      }) {}
+
+void ArenaPool::RecordUse(const ArenaStats& stats) {
+  size_t peak = peak_bytes_reserved_.load(std::memory_order_relaxed);
+  while (stats.bytes_reserved > peak &&
+         !peak_bytes_reserved_.compare_exchange_weak(
+             peak, stats.bytes_reserved, std::memory_order_relaxed)) {
+  }
+  if (stats.num_blocks > 1) {
+    TC3_VLOG(INFO) << "Arena use needed " << stats.num_blocks
+                   << " blocks, " << stats.bytes_reserved << " bytes.";
+  }
+}
+
+ArenaPool::ScopedArena::ScopedArena(ArenaPool* pool)
+    : pool_(pool), arena_(pool->arenas_.Acquire()) {}
+
+ArenaPool::ScopedArena::~ScopedArena() {
+  pool_->RecordUse(arena_->Reset());
+  pool_->arenas_.Release(std::move(arena_));
+}
+
+}  // namespace libtextclassifier3
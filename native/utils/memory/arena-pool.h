@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Arenas that are reset rather than freed between uses, e.g. between the
+// parses of the grammar rules.
+
+#ifndef LIBTEXTCLASSIFIER_UTILS_MEMORY_ARENA_POOL_H_
+#define LIBTEXTCLASSIFIER_UTILS_MEMORY_ARENA_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include "utils/base/arena.h"
+#include "utils/container/object-pool.h"
+
+namespace libtextclassifier3 {
+
+// Memory statistics of one use of an arena.
+struct ArenaStats {
+  // Total size of the memory blocks held by the arena.
+  size_t bytes_reserved = 0;
+
+  // Number of memory blocks held by the arena.
+  int num_blocks = 0;
+};
+
+// An arena that keeps its memory between uses.
+// When a use didn't fit into the first block, the arena replaces its first
+// block with one that is large enough for the whole use (its high-water mark,
+// up to `max_retained_bytes`) on reset. Once warm, the allocations of a use
+// are thus served from a single block without further mallocs.
+class ReusableArena {
+ public:
+  ReusableArena(size_t block_size, size_t max_retained_bytes);
+
+  UnsafeArena* arena() const { return arena_.get(); }
+
+  // Statistics of the current use.
+  ArenaStats Stats() const;
+
+  // Releases all allocations of the current use and prepares the arena for the
+  // next one. Returns the statistics of the use that ended.
+  ArenaStats Reset();
+
+ private:
+  const size_t max_retained_bytes_;
+  size_t first_block_size_;
+  std::unique_ptr<char[]> first_block_;
+  std::unique_ptr<UnsafeArena> arena_;
+};
+
+// A pool of reusable arenas, shared between threads.
+class ArenaPool {
+ public:
+  // Maximum size an arena keeps between uses.
+  static constexpr size_t kDefaultMaxRetainedBytes = 1 << 20;
+
+  explicit ArenaPool(size_t block_size,
+                     size_t max_retained_bytes = kDefaultMaxRetainedBytes,
+                     int capacity = ObjectPool<ReusableArena>::kDefaultMaxIdle);
+
+  // Scoped checkout of an arena. The arena is reset and returned to the pool
+  // when it goes out of scope.
+  class ScopedArena {
+   public:
+    explicit ScopedArena(ArenaPool* pool);
+    ~ScopedArena();
+
+    ScopedArena(const ScopedArena&) = delete;
+    ScopedArena& operator=(const ScopedArena&) = delete;
+
+    UnsafeArena* get() const { return arena_->arena(); }
+
+    // Statistics of the current use.
+    ArenaStats Stats() const { return arena_->Stats(); }
+
+   private:
+    ArenaPool* pool_;
+    std::unique_ptr<ReusableArena> arena_;
+  };
+
+  // The largest memory reserved by a single use so far.
+  size_t peak_bytes_reserved() const {
+    return peak_bytes_reserved_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  void RecordUse(const ArenaStats& stats);
+
+  ObjectPool<ReusableArena> arenas_;
+  std::atomic<size_t> peak_bytes_reserved_{0};
+};
+
+}  // namespace libtextclassifier3
+
+#endif  // LIBTEXTCLASSIFIER_UTILS_MEMORY_ARENA_POOL_H_
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/memory/arena-pool.h"
+
+#include <cstring>
+
+#include "gtest/gtest.h"
+
+namespace libtextclassifier3 {
+namespace {
+
+TEST(ReusableArenaTest, KeepsHighWaterMarkInSingleBlock) {
+  ReusableArena arena(/*block_size=*/1024, /*max_retained_bytes=*/1 << 16);
+  for (int i = 0; i < 10; i++) {
+    memset(arena.arena()->Alloc(512), 0, 512);
+  }
+  const ArenaStats first_use = arena.Reset();
+  EXPECT_GT(first_use.num_blocks, 1);
+  EXPECT_GE(first_use.bytes_reserved, 10 * 512);
+
+  // The second use of the same size fits into the first block.
+  for (int i = 0; i < 10; i++) {
+    memset(arena.arena()->Alloc(512), 0, 512);
+  }
+  const ArenaStats second_use = arena.Reset();
+  EXPECT_EQ(second_use.num_blocks, 1);
+  EXPECT_EQ(second_use.bytes_reserved, first_use.bytes_reserved);
+}
+
+TEST(ReusableArenaTest, LimitsRetainedMemory) {
+  ReusableArena arena(/*block_size=*/1024, /*max_retained_bytes=*/2048);
+  for (int i = 0; i < 10; i++) {
+    arena.arena()->Alloc(512);
+  }
+  arena.Reset();
+  EXPECT_EQ(arena.Stats().bytes_reserved, 2048);
+  EXPECT_EQ(arena.Stats().num_blocks, 1);
+}
+
+TEST(ArenaPoolTest, ReusesArenas) {
+  ArenaPool pool(/*block_size=*/1024);
+  {
+    ArenaPool::ScopedArena arena(&pool);
+    memset(arena.get()->Alloc(4096), 0, 4096);
+    EXPECT_GT(arena.Stats().num_blocks, 1);
+  }
+  EXPECT_GE(pool.peak_bytes_reserved(), 4096);
+  {
+    ArenaPool::ScopedArena arena(&pool);
+    // The arena was grown to the previous use.
+    memset(arena.get()->Alloc(4096), 0, 4096);
+    EXPECT_EQ(arena.Stats().num_blocks, 1);
+  }
+  {
+    ArenaPool::ScopedArena arena(&pool);
+    {
+      // A concurrent use gets a different arena.
+      ArenaPool::ScopedArena other_arena(&pool);
+      EXPECT_NE(arena.get(), other_arena.get());
+    }
+  }
+}
+
+}  // namespace
+}  // namespace libtextclassifier3
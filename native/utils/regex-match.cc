@@ -41,14 +41,13 @@ namespace {
 class LuaVerifier : public LuaEnvironment {
  public:
   static std::unique_ptr<LuaVerifier> Create(
-      const std::string& context, const std::string& verifier_code,
+      StringPiece context, StringPiece verifier_code,
       const UniLib::RegexMatcher* matcher);
 
   bool Verify(bool* result);
 
  private:
-  explicit LuaVerifier(const std::string& context,
-                       const std::string& verifier_code,
+  explicit LuaVerifier(StringPiece context, StringPiece verifier_code,
                        const UniLib::RegexMatcher* matcher)
       : context_(context), verifier_code_(verifier_code), matcher_(matcher) {}
   bool Initialize();
@@ -56,8 +55,11 @@ class LuaVerifier : public LuaEnvironment {
   // Provides details of a capturing group to lua.
   int GetCapturingGroup();
 
-  const std::string& context_;
-  const std::string& verifier_code_;
+  // Provides the lazily initialized global variables to lua.
+  int GetGlobal();
+
+  const StringPiece context_;
+  const StringPiece verifier_code_;
   const UniLib::RegexMatcher* matcher_;
 };
 
@@ -67,8 +69,14 @@ bool LuaVerifier::Initialize() {
            LoadDefaultLibraries();
 
            // Expose context of the match as `context` global variable.
-           PushString(context_);
-           lua_setglobal(state_, "context");
+           // The context can be long and most verifiers only look at the
+           // match, so it is only copied into lua on first access.
+           lua_pushglobaltable(state_);
+           lua_newtable(state_);
+           PushFunction(&LuaVerifier::GetGlobal);
+           lua_setfield(state_, /*idx=*/-2, kIndexKey);
+           lua_setmetatable(state_, /*idx=*/-2);
+           lua_pop(state_, 1);
 
            // Expose match array as `match` global variable.
            // Each entry `match[i]` exposes the ith capturing group as:
@@ -82,7 +90,7 @@ bool LuaVerifier::Initialize() {
 }
 
 std::unique_ptr<LuaVerifier> LuaVerifier::Create(
-    const std::string& context, const std::string& verifier_code,
+    StringPiece context, StringPiece verifier_code,
     const UniLib::RegexMatcher* matcher) {
   auto verifier = std::unique_ptr<LuaVerifier>(
       new LuaVerifier(context, verifier_code, matcher));
@@ -93,6 +101,22 @@ std::unique_ptr<LuaVerifier> LuaVerifier::Create(
   return verifier;
 }
 
+int LuaVerifier::GetGlobal() {
+  // Called with the global table and the key on the stack.
+  if (lua_type(state_, /*idx=*/-1) != LUA_TSTRING ||
+      !ReadString(/*index=*/-1).Equals("context")) {
+    lua_pushnil(state_);
+    return 1;
+  }
+  PushString(context_);
+
+  // Cache the value, so that it is copied at most once.
+  lua_pushvalue(state_, /*idx=*/-2);
+  lua_pushvalue(state_, /*idx=*/-2);
+  lua_rawset(state_, /*idx=*/-5);
+  return 1;
+}
+
 int LuaVerifier::GetCapturingGroup() {
   if (lua_type(state_, /*idx=*/-1) != LUA_TNUMBER) {
     TC3_LOG(ERROR) << "Unexpected type for match group lookup: "
@@ -163,9 +187,8 @@ Optional<std::string> GetCapturingGroupText(const UniLib::RegexMatcher* matcher,
   return Optional<std::string>(group_text);
 }
 
-bool VerifyMatch(const std::string& context,
-                 const UniLib::RegexMatcher* matcher,
-                 const std::string& lua_verifier_code) {
+bool VerifyMatch(StringPiece context, const UniLib::RegexMatcher* matcher,
+                 StringPiece lua_verifier_code) {
   bool status = false;
 #ifndef TC3_DISABLE_LUA
   auto verifier = LuaVerifier::Create(context, lua_verifier_code, matcher);
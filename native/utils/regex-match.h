@@ -18,6 +18,7 @@
 #define LIBTEXTCLASSIFIER_UTILS_REGEX_MATCH_H_
 
 #include "utils/optional.h"
+#include "utils/strings/stringpiece.h"
 #include "utils/utf8/unilib.h"
 
 namespace libtextclassifier3 {
@@ -29,7 +30,8 @@ Optional<std::string> GetCapturingGroupText(const UniLib::RegexMatcher* matcher,
 
 // Post-checks a regular expression match with a lua verifier script.
 // The verifier can access:
-//   * `context`: The context as a string.
+//   * `context`: The context as a string. It is only copied into the lua
+//       environment if the verifier reads it.
 //   * `match`: The groups of the regex match as an array, each group gives
 //       * `begin`: span start
 //       * `end`: span end
@@ -37,9 +39,8 @@ Optional<std::string> GetCapturingGroupText(const UniLib::RegexMatcher* matcher,
 // The verifier is expected to return a boolean, indicating whether the
 // verification succeeded or not.
 // Returns true if the verification was successful, false if not.
-bool VerifyMatch(const std::string& context,
-                 const UniLib::RegexMatcher* matcher,
-                 const std::string& lua_verifier_code);
+bool VerifyMatch(StringPiece context, const UniLib::RegexMatcher* matcher,
+                 StringPiece lua_verifier_code);
 
 }  // namespace libtextclassifier3
 
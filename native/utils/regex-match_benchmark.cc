@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <string>
+
+#include "utils/jvm-test-utils.h"
+#include "utils/regex-match.h"
+#include "utils/testing/benchmark-utils.h"
+#include "utils/utf8/unicodetext.h"
+#include "utils/utf8/unilib.h"
+#include "benchmark/benchmark.h"
+
+namespace libtextclassifier3 {
+namespace {
+
+#ifndef TC3_DISABLE_LUA
+constexpr char kLuhnVerifier[] = R"(
+function luhn(candidate)
+    local sum = 0
+    local num_digits = string.len(candidate)
+    local parity = num_digits % 2
+    for pos = 1,num_digits do
+      d = tonumber(string.sub(candidate, pos, pos))
+      if pos % 2 ~= parity then
+        d = d * 2
+      end
+      if d > 9 then
+        d = d - 9
+      end
+      sum = sum + d
+    end
+    return (sum % 10) == 0
+end
+return luhn(match[1].text);
+)";
+
+constexpr char kContextVerifier[] = R"(
+return #context > 0 and match[1].text ~= nil;
+)";
+
+// Verifies all the matches of a regex in a long context, as the annotator does
+// for the regex patterns with a verifier. The cost per match should not depend
+// on the length of the context.
+// Arguments: number of lines with a match.
+void BM_VerifyMatches(benchmark::State& state, const char* verifier) {
+  const std::unique_ptr<UniLib> unilib = CreateUniLibForTesting();
+  const std::unique_ptr<UniLib::RegexPattern> pattern =
+      unilib->CreateRegexPattern(UTF8ToUnicodeText("(\\d{16})"));
+  std::string context;
+  for (int i = 0; i < state.range(0); i++) {
+    context += "Payment " + std::to_string(i) +
+               " with card 4012888888881881, " +
+               GenerateText(BenchmarkScript::kLatin, /*num_codepoints=*/200,
+                            /*seed=*/i + 1) +
+               "\n";
+  }
+  const UnicodeText context_unicode =
+      UTF8ToUnicodeText(context, /*do_copy=*/false);
+
+  for (auto _ : state) {
+    const std::unique_ptr<UniLib::RegexMatcher> matcher =
+        pattern->Matcher(context_unicode);
+    int status = UniLib::RegexMatcher::kNoError;
+    int num_verified = 0;
+    while (matcher->Find(&status) &&
+           status == UniLib::RegexMatcher::kNoError) {
+      num_verified += VerifyMatch(context, matcher.get(), verifier);
+    }
+    benchmark::DoNotOptimize(num_verified);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK_CAPTURE(BM_VerifyMatches, luhn, kLuhnVerifier)
+    ->RangeMultiplier(4)
+    ->Range(8, 1024)
+    ->Complexity(benchmark::oN);
+BENCHMARK_CAPTURE(BM_VerifyMatches, reads_context, kContextVerifier)
+    ->RangeMultiplier(4)
+    ->Range(8, 1024)
+    ->Complexity(benchmark::oN);
+#endif  // TC3_DISABLE_LUA
+
+}  // namespace
+}  // namespace libtextclassifier3
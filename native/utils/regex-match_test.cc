@@ -39,6 +39,15 @@ TEST_F(RegexMatchTest, HandlesSimpleVerification) {
 }
 #endif  // TC3_DISABLE_LUA
 
+#ifndef TC3_DISABLE_LUA
+TEST_F(RegexMatchTest, ProvidesContextToVerifier) {
+  EXPECT_TRUE(VerifyMatch(StringPiece("hello world", 5), /*matcher=*/nullptr,
+                          "return context == 'hello' and #context == 5;"));
+  EXPECT_TRUE(VerifyMatch(/*context=*/"hello", /*matcher=*/nullptr,
+                          "return other == nil and context == 'hello';"));
+}
+#endif  // TC3_DISABLE_LUA
+
 #ifndef TC3_DISABLE_LUA
 TEST_F(RegexMatchTest, HandlesCustomVerification) {
   UnicodeText pattern = UTF8ToUnicodeText("(\\d{16})",
@@ -0,0 +1,737 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/regex-prefilter.h"
+
+#include <algorithm>
+#include <limits>
+#include <queue>
+#include <set>
+
+namespace libtextclassifier3 {
+namespace {
+
+typedef std::vector<char32> Literal;
+
+// Bounds the size of the literal sets tracked while analyzing a pattern.
+constexpr int kMaxExactLiterals = 16;
+constexpr int kMaxRequiredLiterals = 64;
+
+// The text and the literals are compared with ASCII letters lowercased. This
+// makes the prefilter case-insensitive for ASCII, which is needed for patterns
+// with the case-insensitive flag, and only makes it less selective otherwise.
+char32 FoldCase(const char32 codepoint) {
+  if (codepoint >= 'A' && codepoint <= 'Z') {
+    return codepoint - 'A' + 'a';
+  }
+  return codepoint;
+}
+
+// Returns whether a lowercase ASCII letter has a case-insensitive match
+// outside of ASCII. These are the letters of the non-ASCII codepoints whose
+// case folding is ASCII ("k", "s") or contains ASCII letters, e.g. U+FB00 "ﬀ"
+// folds to "ff", U+1E96 "ẖ" to "h" and a combining mark.
+bool HasNonAsciiCaseVariant(const char32 codepoint) {
+  switch (codepoint) {
+    case 'a':
+    case 'f':
+    case 'h':
+    case 'i':
+    case 'j':
+    case 'k':
+    case 'l':
+    case 'n':
+    case 's':
+    case 't':
+    case 'w':
+    case 'y':
+      return true;
+    default:
+      return false;
+  }
+}
+
+// What is known about the strings matched by a (sub)pattern.
+struct LiteralInfo {
+  // If true, `exact` is the set of all the strings the subpattern can match.
+  bool is_exact = false;
+  std::set<Literal> exact;
+
+  // Otherwise, every match contains one of these literals. An empty set means
+  // that nothing is known.
+  std::set<Literal> required;
+
+  static LiteralInfo Exact(std::set<Literal> literals) {
+    LiteralInfo info;
+    info.is_exact = true;
+    info.exact = std::move(literals);
+    return info;
+  }
+
+  static LiteralInfo EmptyString() { return Exact({Literal()}); }
+
+  static LiteralInfo Any() { return LiteralInfo(); }
+
+  static LiteralInfo Required(std::set<Literal> literals) {
+    LiteralInfo info;
+    info.required = std::move(literals);
+    return info;
+  }
+
+  // Returns the literals one of which occurs in every match.
+  std::set<Literal> RequiredLiterals() const {
+    if (!is_exact) {
+      return required;
+    }
+    if (exact.count(Literal()) > 0) {
+      return {};
+    }
+    return exact;
+  }
+};
+
+// Length of the shortest literal of the set, 0 if nothing is known.
+int MinLength(const std::set<Literal>& literals) {
+  if (literals.empty()) {
+    return 0;
+  }
+  int min_length = std::numeric_limits<int>::max();
+  for (const Literal& literal : literals) {
+    min_length = std::min(min_length, static_cast<int>(literal.size()));
+  }
+  return min_length;
+}
+
+// Of two sets of literals that are both required, returns the more selective
+// one: the one with longer literals, or fewer of them.
+std::set<Literal> MoreSelective(std::set<Literal> a, std::set<Literal> b) {
+  const int a_length = MinLength(a);
+  const int b_length = MinLength(b);
+  if (a_length > b_length || (a_length == b_length && a.size() <= b.size())) {
+    return a;
+  }
+  return b;
+}
+
+// Concatenates two exact sets, returns false if the result would be too big.
+bool ConcatExact(const LiteralInfo& a, const LiteralInfo& b,
+                 LiteralInfo* result) {
+  if (!a.is_exact || !b.is_exact ||
+      a.exact.size() * b.exact.size() > kMaxExactLiterals) {
+    return false;
+  }
+  std::set<Literal> exact;
+  for (const Literal& prefix : a.exact) {
+    for (const Literal& suffix : b.exact) {
+      Literal literal = prefix;
+      literal.insert(literal.end(), suffix.begin(), suffix.end());
+      exact.insert(std::move(literal));
+    }
+  }
+  *result = LiteralInfo::Exact(std::move(exact));
+  return true;
+}
+
+// Builds the info of a concatenation from the infos of its parts.
+class ConcatenationBuilder {
+ public:
+  void Append(const LiteralInfo& part) {
+    if (ConcatExact(run_, part, &run_)) {
+      return;
+    }
+    is_exact_ = false;
+    required_ = MoreSelective(std::move(required_), run_.RequiredLiterals());
+    if (part.is_exact) {
+      run_ = part;
+    } else {
+      required_ = MoreSelective(std::move(required_), part.RequiredLiterals());
+      run_ = LiteralInfo::EmptyString();
+    }
+  }
+
+  LiteralInfo Build() const {
+    if (is_exact_) {
+      return run_;
+    }
+    return LiteralInfo::Required(
+        MoreSelective(required_, run_.RequiredLiterals()));
+  }
+
+ private:
+  // The exact strings matched by the current run of exact parts.
+  LiteralInfo run_ = LiteralInfo::EmptyString();
+  bool is_exact_ = true;
+
+  // The most selective required literals before the current run.
+  std::set<Literal> required_;
+};
+
+LiteralInfo Alternate(const LiteralInfo& a, const LiteralInfo& b) {
+  if (a.is_exact && b.is_exact &&
+      a.exact.size() + b.exact.size() <= kMaxExactLiterals) {
+    std::set<Literal> exact = a.exact;
+    exact.insert(b.exact.begin(), b.exact.end());
+    return LiteralInfo::Exact(std::move(exact));
+  }
+
+  // Either of the alternatives can match.
+  std::set<Literal> required = a.RequiredLiterals();
+  const std::set<Literal> b_required = b.RequiredLiterals();
+  if (required.empty() || b_required.empty() ||
+      required.size() + b_required.size() > kMaxRequiredLiterals) {
+    return LiteralInfo::Any();
+  }
+  required.insert(b_required.begin(), b_required.end());
+  return LiteralInfo::Required(std::move(required));
+}
+
+// Removes the literals that contain another literal of the set: whenever they
+// occur, the shorter literal occurs too.
+std::set<Literal> RemoveRedundantLiterals(const std::set<Literal>& literals) {
+  std::set<Literal> result;
+  for (const Literal& literal : literals) {
+    bool is_redundant = false;
+    for (const Literal& other : literals) {
+      if (other.size() < literal.size() &&
+          std::search(literal.begin(), literal.end(), other.begin(),
+                      other.end()) != literal.end()) {
+        is_redundant = true;
+        break;
+      }
+    }
+    if (!is_redundant) {
+      result.insert(literal);
+    }
+  }
+  return result;
+}
+
+// A conservative parser of the Java/ICU regex syntax, that only keeps track of
+// the literals. Whenever the syntax is not understood, the analysis fails.
+class LiteralExtractor {
+ public:
+  explicit LiteralExtractor(const std::string& pattern) {
+    for (const char32 codepoint :
+         UTF8ToUnicodeText(pattern, /*do_copy=*/false)) {
+      pattern_.push_back(codepoint);
+    }
+  }
+
+  bool Extract(std::set<Literal>* literals) {
+    if (!ScanFlags()) {
+      return false;
+    }
+    const LiteralInfo info = ParseAlternation();
+    if (failed_ || pos_ != pattern_.size()) {
+      return false;
+    }
+    *literals = RemoveRedundantLiterals(info.RequiredLiterals());
+    return !literals->empty();
+  }
+
+ private:
+  // Looks for inline flags. Case-insensitive matching is handled by only
+  // using the codepoints without tricky case folding, comments mode is not
+  // supported.
+  // NOTE: This also picks up character sequences like "\(?i", which only makes
+  // the analysis more conservative.
+  bool ScanFlags() {
+    for (int i = 0; i + 1 < pattern_.size(); i++) {
+      if (pattern_[i] != '(' || pattern_[i + 1] != '?') {
+        continue;
+      }
+      for (int j = i + 2; j < pattern_.size(); j++) {
+        const char32 flag = pattern_[j];
+        if (flag == 'i') {
+          case_insensitive_ = true;
+        } else if (flag == 'x') {
+          return false;
+        } else if (!((flag >= 'a' && flag <= 'z') ||
+                     (flag >= 'A' && flag <= 'Z') || flag == '-')) {
+          break;
+        }
+      }
+    }
+    return true;
+  }
+
+  bool AtEnd() const { return pos_ >= pattern_.size(); }
+
+  char32 Peek() const { return pattern_[pos_]; }
+
+  bool Consume(const char32 codepoint) {
+    if (AtEnd() || Peek() != codepoint) {
+      return false;
+    }
+    ++pos_;
+    return true;
+  }
+
+  LiteralInfo Fail() {
+    failed_ = true;
+    return LiteralInfo::Any();
+  }
+
+  LiteralInfo ParseAlternation() {
+    LiteralInfo info = ParseConcatenation();
+    while (!failed_ && Consume('|')) {
+      info = Alternate(info, ParseConcatenation());
+    }
+    return info;
+  }
+
+  LiteralInfo ParseConcatenation() {
+    ConcatenationBuilder concatenation;
+    while (!failed_ && !AtEnd() && Peek() != '|' && Peek() != ')') {
+      concatenation.Append(ParseRepetition());
+    }
+    return concatenation.Build();
+  }
+
+  LiteralInfo ParseRepetition() {
+    LiteralInfo info = ParseAtom();
+    while (!failed_ && !AtEnd()) {
+      int min_repetitions;
+      int max_repetitions;
+      if (Consume('?')) {
+        min_repetitions = 0;
+        max_repetitions = 1;
+      } else if (Consume('*')) {
+        min_repetitions = 0;
+        max_repetitions = -1;
+      } else if (Consume('+')) {
+        min_repetitions = 1;
+        max_repetitions = -1;
+      } else if (Peek() == '{') {
+        if (!ParseBounds(&min_repetitions, &max_repetitions)) {
+          return Fail();
+        }
+      } else {
+        break;
+      }
+      // Lazy and possessive quantifiers match the same strings.
+      if (!Consume('?')) {
+        Consume('+');
+      }
+      info = Repeat(info, min_repetitions, max_repetitions);
+    }
+    return info;
+  }
+
+  // Parses "{n}", "{n,}" or "{n,m}". A missing maximum is returned as -1.
+  bool ParseBounds(int* min_repetitions, int* max_repetitions) {
+    ++pos_;
+    if (!ParseNumber(min_repetitions)) {
+      return false;
+    }
+    *max_repetitions = *min_repetitions;
+    if (Consume(',')) {
+      *max_repetitions = -1;
+      if (!AtEnd() && Peek() != '}' && !ParseNumber(max_repetitions)) {
+        return false;
+      }
+    }
+    return Consume('}');
+  }
+
+  bool ParseNumber(int* number) {
+    *number = 0;
+    const int start = pos_;
+    while (!AtEnd() && Peek() >= '0' && Peek() <= '9' && pos_ - start < 6) {
+      *number = *number * 10 + (Peek() - '0');
+      ++pos_;
+    }
+    return pos_ > start;
+  }
+
+  LiteralInfo Repeat(const LiteralInfo& info, const int min_repetitions,
+                     const int max_repetitions) {
+    if (min_repetitions == 1 && max_repetitions == 1) {
+      return info;
+    }
+    if (min_repetitions == 0) {
+      if (max_repetitions == 1 && info.is_exact &&
+          info.exact.size() < kMaxExactLiterals) {
+        std::set<Literal> exact = info.exact;
+        exact.insert(Literal());
+        return LiteralInfo::Exact(std::move(exact));
+      }
+      return LiteralInfo::Any();
+    }
+    return LiteralInfo::Required(info.RequiredLiterals());
+  }
+
+  LiteralInfo ParseAtom() {
+    const char32 codepoint = Peek();
+    switch (codepoint) {
+      case '(':
+        ++pos_;
+        return ParseGroup();
+      case '[':
+        ++pos_;
+        return SkipCharacterClass();
+      case '.':
+        ++pos_;
+        return LiteralInfo::Any();
+      case '^':
+      case '$':
+        ++pos_;
+        return LiteralInfo::EmptyString();
+      case '\\':
+        ++pos_;
+        return ParseEscape();
+      case '*':
+      case '+':
+      case '?':
+      case '{':
+        return Fail();
+      default:
+        ++pos_;
+        return Character(codepoint);
+    }
+  }
+
+  LiteralInfo ParseGroup() {
+    bool is_lookaround = false;
+    if (Consume('?')) {
+      if (Consume('=') || Consume('!')) {
+        is_lookaround = true;
+      } else if (Consume('<')) {
+        if (Consume('=') || Consume('!')) {
+          is_lookaround = true;
+        } else {
+          // Named group.
+          while (!AtEnd() && Peek() != '>') {
+            ++pos_;
+          }
+          if (!Consume('>')) {
+            return Fail();
+          }
+        }
+      } else if (!Consume(':') && !Consume('>')) {
+        // Inline flags, either "(?flags)" or "(?flags:...)".
+        while (!AtEnd() && Peek() != ')' && Peek() != ':') {
+          ++pos_;
+        }
+        if (Consume(')')) {
+          return LiteralInfo::EmptyString();
+        }
+        if (!Consume(':')) {
+          return Fail();
+        }
+      }
+    }
+    LiteralInfo info = ParseAlternation();
+    if (failed_ || !Consume(')')) {
+      return Fail();
+    }
+    // Lookarounds don't consume any text.
+    return is_lookaround ? LiteralInfo::EmptyString() : info;
+  }
+
+  // Skips a (possibly nested) character class, whose contents are not
+  // tracked.
+  LiteralInfo SkipCharacterClass() {
+    Consume('^');
+    if (AtEnd() || Peek() == ']') {
+      return Fail();
+    }
+    int depth = 1;
+    while (!AtEnd()) {
+      const char32 codepoint = Peek();
+      ++pos_;
+      if (codepoint == '\\') {
+        if (AtEnd() || Peek() == 'Q') {
+          return Fail();
+        }
+        ++pos_;
+      } else if (codepoint == '[') {
+        ++depth;
+      } else if (codepoint == ']' && --depth == 0) {
+        return LiteralInfo::Any();
+      }
+    }
+    return Fail();
+  }
+
+  LiteralInfo ParseEscape() {
+    if (AtEnd()) {
+      return Fail();
+    }
+    const char32 codepoint = Peek();
+    ++pos_;
+    switch (codepoint) {
+      // Zero-width assertions.
+      case 'b':
+        if (!AtEnd() && Peek() == '{') {
+          return Fail();
+        }
+        return LiteralInfo::EmptyString();
+      case 'B':
+      case 'A':
+      case 'G':
+      case 'Z':
+      case 'z':
+        return LiteralInfo::EmptyString();
+
+      // Character classes.
+      case 'd':
+      case 'D':
+      case 's':
+      case 'S':
+      case 'w':
+      case 'W':
+      case 'h':
+      case 'H':
+      case 'v':
+      case 'V':
+      case 'R':
+      case 'X':
+        return LiteralInfo::Any();
+      case 'p':
+      case 'P':
+        if (Consume('{')) {
+          return SkipUntil('}');
+        }
+        return SkipCodepoints(1);
+
+      // Codepoints given by their value, and back references.
+      case 'x':
+        if (Consume('{')) {
+          return SkipUntil('}');
+        }
+        return SkipCodepoints(2);
+      case 'u':
+        return SkipCodepoints(4);
+      case 'c':
+        return SkipCodepoints(1);
+      case 'k':
+        if (!Consume('<')) {
+          return Fail();
+        }
+        return SkipUntil('>');
+
+      case 't':
+        return Character('\t');
+      case 'n':
+        return Character('\n');
+      case 'r':
+        return Character('\r');
+      case 'f':
+        return Character('\f');
+      case 'a':
+        return Character('\a');
+      case 'e':
+        return Character(0x1b);
+
+      case 'Q': {
+        ConcatenationBuilder quoted;
+        while (!AtEnd()) {
+          if (Peek() == '\\' && pos_ + 1 < pattern_.size() &&
+              pattern_[pos_ + 1] == 'E') {
+            pos_ += 2;
+            break;
+          }
+          quoted.Append(Character(Peek()));
+          ++pos_;
+        }
+        return quoted.Build();
+      }
+      default:
+        break;
+    }
+    if (codepoint >= '0' && codepoint <= '9') {
+      // Octal escape or back reference.
+      while (!AtEnd() && Peek() >= '0' && Peek() <= '9') {
+        ++pos_;
+      }
+      return LiteralInfo::Any();
+    }
+    if ((codepoint >= 'a' && codepoint <= 'z') ||
+        (codepoint >= 'A' && codepoint <= 'Z')) {
+      return Fail();
+    }
+    // Escaped punctuation.
+    return Character(codepoint);
+  }
+
+  LiteralInfo SkipUntil(const char32 end) {
+    while (!AtEnd() && Peek() != end) {
+      ++pos_;
+    }
+    if (!Consume(end)) {
+      return Fail();
+    }
+    return LiteralInfo::Any();
+  }
+
+  LiteralInfo SkipCodepoints(const int num_codepoints) {
+    if (pos_ + num_codepoints > pattern_.size()) {
+      return Fail();
+    }
+    pos_ += num_codepoints;
+    return LiteralInfo::Any();
+  }
+
+  LiteralInfo Character(const char32 codepoint) {
+    // With case-insensitive matching, non-ASCII codepoints and the letters
+    // that have non-ASCII case variants can match codepoints that are
+    // different after FoldCase: either a single codepoint (e.g. the Kelvin
+    // sign for "k") or, with full case folding, a codepoint that folds to
+    // several (e.g. "ﬀ" for "ff", "ß" for "ss").
+    if (case_insensitive_ &&
+        (codepoint >= 0x80 || HasNonAsciiCaseVariant(FoldCase(codepoint)))) {
+      return LiteralInfo::Any();
+    }
+    return LiteralInfo::Exact({Literal{FoldCase(codepoint)}});
+  }
+
+  std::vector<char32> pattern_;
+  int pos_ = 0;
+  bool case_insensitive_ = false;
+  bool failed_ = false;
+};
+
+}  // namespace
+
+RegexPrefilter::RegexPrefilter(const std::vector<std::string>& patterns)
+    : nodes_(1), is_filtered_(patterns.size(), false) {
+  for (int pattern_id = 0; pattern_id < patterns.size(); pattern_id++) {
+    std::set<Literal> literals;
+    if (!LiteralExtractor(patterns[pattern_id]).Extract(&literals)) {
+      continue;
+    }
+    is_filtered_[pattern_id] = true;
+    ++num_filtered_patterns_;
+    for (const Literal& literal : literals) {
+      AddLiteral(literal, pattern_id);
+    }
+  }
+  BuildFailureLinks();
+}
+
+int RegexPrefilter::Child(const int node, const char32 codepoint) const {
+  const std::vector<std::pair<char32, int>>& children = nodes_[node].children;
+  const auto it = std::lower_bound(
+      children.begin(), children.end(), codepoint,
+      [](const std::pair<char32, int>& child, const char32 codepoint) {
+        return child.first < codepoint;
+      });
+  if (it == children.end() || it->first != codepoint) {
+    return -1;
+  }
+  return it->second;
+}
+
+void RegexPrefilter::AddLiteral(const std::vector<char32>& literal,
+                                const int pattern_id) {
+  int node = 0;
+  for (const char32 codepoint : literal) {
+    int child = Child(node, codepoint);
+    if (child < 0) {
+      child = nodes_.size();
+      nodes_.emplace_back();
+      std::vector<std::pair<char32, int>>& children = nodes_[node].children;
+      children.insert(
+          std::upper_bound(children.begin(), children.end(),
+                           std::make_pair(codepoint, child)),
+          std::make_pair(codepoint, child));
+    }
+    node = child;
+  }
+  std::vector<int>& pattern_ids = nodes_[node].pattern_ids;
+  if (pattern_ids.empty() || pattern_ids.back() != pattern_id) {
+    pattern_ids.push_back(pattern_id);
+  }
+}
+
+void RegexPrefilter::BuildFailureLinks() {
+  std::queue<int> queue;
+  for (const std::pair<char32, int>& child : nodes_[0].children) {
+    queue.push(child.second);
+  }
+  while (!queue.empty()) {
+    const int node = queue.front();
+    queue.pop();
+    for (const std::pair<char32, int>& child : nodes_[node].children) {
+      int failure = nodes_[node].failure;
+      while (failure != 0 && Child(failure, child.first) < 0) {
+        failure = nodes_[failure].failure;
+      }
+      const int failure_child = Child(failure, child.first);
+      Node& child_node = nodes_[child.second];
+      child_node.failure = failure_child >= 0 ? failure_child : 0;
+      child_node.output_link =
+          nodes_[child_node.failure].pattern_ids.empty()
+              ? nodes_[child_node.failure].output_link
+              : child_node.failure;
+      queue.push(child.second);
+    }
+  }
+}
+
+std::vector<bool> RegexPrefilter::FindCandidatePatterns(
+    const UnicodeText& text) const {
+  std::vector<bool> is_candidate(is_filtered_.size());
+  for (int i = 0; i < is_filtered_.size(); i++) {
+    is_candidate[i] = !is_filtered_[i];
+  }
+  int num_unresolved = num_filtered_patterns_;
+  int node = 0;
+  for (auto it = text.begin(); it != text.end() && num_unresolved > 0; ++it) {
+    const char32 codepoint = FoldCase(*it);
+    int child = Child(node, codepoint);
+    while (child < 0 && node != 0) {
+      node = nodes_[node].failure;
+      child = Child(node, codepoint);
+    }
+    node = child >= 0 ? child : 0;
+    for (int output = nodes_[node].pattern_ids.empty()
+                          ? nodes_[node].output_link
+                          : node;
+         output >= 0; output = nodes_[output].output_link) {
+      for (const int pattern_id : nodes_[output].pattern_ids) {
+        if (!is_candidate[pattern_id]) {
+          is_candidate[pattern_id] = true;
+          --num_unresolved;
+        }
+      }
+    }
+  }
+  return is_candidate;
+}
+
+namespace internal {
+
+bool ExtractRequiredLiterals(const std::string& pattern,
+                             std::vector<std::string>* literals) {
+  std::set<Literal> required;
+  if (!LiteralExtractor(pattern).Extract(&required)) {
+    return false;
+  }
+  literals->clear();
+  for (const Literal& literal : required) {
+    UnicodeText literal_text;
+    for (const char32 codepoint : literal) {
+      literal_text.push_back(codepoint);
+    }
+    literals->push_back(literal_text.ToUTF8String());
+  }
+  return true;
+}
+
+}  // namespace internal
+}  // namespace libtextclassifier3
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBTEXTCLASSIFIER_UTILS_REGEX_PREFILTER_H_
+#define LIBTEXTCLASSIFIER_UTILS_REGEX_PREFILTER_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "utils/base/integral_types.h"
+#include "utils/utf8/unicodetext.h"
+
+namespace libtextclassifier3 {
+
+// Cheaply rules out regex patterns that cannot match a text, before the
+// (backtracking) regex matchers are run.
+// For each pattern, a set of literals is extracted such that every match of
+// the pattern contains at least one of them. All the literals of all the
+// patterns are compiled into a single Aho-Corasick automaton, so that a single
+// pass over the text finds the patterns that can possibly match.
+// Patterns without a usable set of literals (e.g. "\d{3}") always pass.
+class RegexPrefilter {
+ public:
+  // The pattern ids are the indices into `patterns`.
+  explicit RegexPrefilter(const std::vector<std::string>& patterns);
+
+  // Returns for each pattern whether it can match somewhere in `text`.
+  std::vector<bool> FindCandidatePatterns(const UnicodeText& text) const;
+
+  // Number of patterns that can be ruled out by the prefilter.
+  int num_filtered_patterns() const { return num_filtered_patterns_; }
+
+ private:
+  struct Node {
+    // Sorted by codepoint.
+    std::vector<std::pair<char32, int>> children;
+    int failure = 0;
+    // Next node on the failure chain with a non-empty `pattern_ids`, or -1.
+    int output_link = -1;
+    std::vector<int> pattern_ids;
+  };
+
+  // Returns the child of the node for the codepoint, or -1.
+  int Child(int node, char32 codepoint) const;
+
+  void AddLiteral(const std::vector<char32>& literal, int pattern_id);
+  void BuildFailureLinks();
+
+  std::vector<Node> nodes_;
+  std::vector<bool> is_filtered_;
+  int num_filtered_patterns_ = 0;
+};
+
+namespace internal {
+
+// Extracts a set of literals such that every match of the (Java/ICU syntax)
+// regex `pattern` contains at least one of them. ASCII letters are lowercased.
+// Returns false if there is no such set, or if the pattern uses syntax that is
+// not understood.
+bool ExtractRequiredLiterals(const std::string& pattern,
+                             std::vector<std::string>* literals);
+
+}  // namespace internal
+}  // namespace libtextclassifier3
+
+#endif  // LIBTEXTCLASSIFIER_UTILS_REGEX_PREFILTER_H_
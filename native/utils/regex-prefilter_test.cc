@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/regex-prefilter.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace libtextclassifier3 {
+namespace {
+
+using testing::ElementsAre;
+using testing::UnorderedElementsAre;
+
+std::vector<std::string> RequiredLiterals(const std::string& pattern) {
+  std::vector<std::string> literals;
+  if (!internal::ExtractRequiredLiterals(pattern, &literals)) {
+    return {};
+  }
+  return literals;
+}
+
+TEST(RegexPrefilterTest, ExtractsLiterals) {
+  EXPECT_THAT(RequiredLiterals("abc"), ElementsAre("abc"));
+  EXPECT_THAT(RequiredLiterals("Flight"), ElementsAre("flight"));
+  EXPECT_THAT(RequiredLiterals("\\d+@\\w+\\.com"), ElementsAre(".com"));
+  EXPECT_THAT(RequiredLiterals("(?:https?://)?www\\.[a-z]+"),
+              ElementsAre("www."));
+  EXPECT_THAT(RequiredLiterals("ab?c"), UnorderedElementsAre("abc", "ac"));
+  EXPECT_THAT(RequiredLiterals("(foo|bar)\\d"),
+              UnorderedElementsAre("foo", "bar"));
+  EXPECT_THAT(RequiredLiterals("x+yz"), ElementsAre("yz"));
+  EXPECT_THAT(RequiredLiterals("(?<!\\w)pin(?=\\d)"), ElementsAre("pin"));
+  EXPECT_THAT(RequiredLiterals("\\Qa.b\\E"), ElementsAre("a.b"));
+  EXPECT_THAT(RequiredLiterals("(?<code>ab){2,3}"), ElementsAre("ab"));
+}
+
+TEST(RegexPrefilterTest, ExtractsNothingWithoutRequiredLiterals) {
+  EXPECT_THAT(RequiredLiterals("\\d{3}-?\\d{4}"), ElementsAre());
+  EXPECT_THAT(RequiredLiterals("\\d{3}\\s\\d{4}"), ElementsAre());
+  EXPECT_THAT(RequiredLiterals("(abc)*"), ElementsAre());
+  EXPECT_THAT(RequiredLiterals("abc|\\d"), ElementsAre());
+  EXPECT_THAT(RequiredLiterals("a?"), ElementsAre());
+}
+
+TEST(RegexPrefilterTest, ExtractsLiteralsBeforeBackreferences) {
+  EXPECT_THAT(RequiredLiterals("(a)\\1"), ElementsAre("a"));
+}
+
+TEST(RegexPrefilterTest, HandlesCaseInsensitivePatterns) {
+  // 'k' and 's' have non-ASCII case variants.
+  EXPECT_THAT(RequiredLiterals("(?i)desk-"), ElementsAre("de"));
+  EXPECT_THAT(RequiredLiterals("(?i:cb)d"), ElementsAre("cbd"));
+
+  // 'f' and 'l' are part of the full case folding of the ligatures.
+  EXPECT_THAT(RequiredLiterals("(?i)ff"), ElementsAre());
+  EXPECT_THAT(RequiredLiterals("(?i)flex"), ElementsAre("ex"));
+}
+
+TEST(RegexPrefilterTest, KeepsCaseInsensitivePatternsMatchingLigatures) {
+  const RegexPrefilter prefilter({"(?i)ff", "(?i)fl\\d", "ff"});
+  EXPECT_THAT(prefilter.FindCandidatePatterns(
+                  UTF8ToUnicodeText("\uFB00 \uFB021", /*do_copy=*/false)),
+              ElementsAre(true, true, false));
+}
+
+TEST(RegexPrefilterTest, RejectsUnsupportedSyntax) {
+  EXPECT_THAT(RequiredLiterals("(?x) a b c"), ElementsAre());
+  EXPECT_THAT(RequiredLiterals("abc)"), ElementsAre());
+  EXPECT_THAT(RequiredLiterals("(abc"), ElementsAre());
+  EXPECT_THAT(RequiredLiterals("[abc"), ElementsAre());
+  EXPECT_THAT(RequiredLiterals("\\yabc"), ElementsAre());
+}
+
+TEST(RegexPrefilterTest, SkipsCharacterClasses) {
+  EXPECT_THAT(RequiredLiterals("[a-z&&[^aeiou]]+foo"), ElementsAre("foo"));
+  EXPECT_THAT(RequiredLiterals("[\\]x]bar"), ElementsAre("bar"));
+}
+
+TEST(RegexPrefilterTest, FindsCandidatePatterns) {
+  const RegexPrefilter prefilter(
+      {"\\w+@\\w+", "www\\.\\w+", "\\d{3}", "(flight|flug) \\d+", "bar"});
+  EXPECT_EQ(prefilter.num_filtered_patterns(), 4);
+
+  EXPECT_THAT(prefilter.FindCandidatePatterns(
+                  UTF8ToUnicodeText("Call 555 now", /*do_copy=*/false)),
+              ElementsAre(false, false, true, false, false));
+  EXPECT_THAT(
+      prefilter.FindCandidatePatterns(UTF8ToUnicodeText(
+          "Mail me@x.com, FLIGHT LX 38 ab WWW.foobar", /*do_copy=*/false)),
+      ElementsAre(true, true, true, true, true));
+  EXPECT_THAT(prefilter.FindCandidatePatterns(
+                  UTF8ToUnicodeText("flug 12", /*do_copy=*/false)),
+              ElementsAre(false, false, true, true, false));
+}
+
+TEST(RegexPrefilterTest, FindsOverlappingLiterals) {
+  const RegexPrefilter prefilter({"abcd", "bc", "c", "bcx"});
+  EXPECT_THAT(prefilter.FindCandidatePatterns(
+                  UTF8ToUnicodeText("xxabcy", /*do_copy=*/false)),
+              ElementsAre(false, true, true, false));
+  EXPECT_THAT(prefilter.FindCandidatePatterns(
+                  UTF8ToUnicodeText("abcbcx", /*do_copy=*/false)),
+              ElementsAre(false, true, true, true));
+}
+
+}  // namespace
+}  // namespace libtextclassifier3
@@ -20,16 +20,44 @@ namespace libtextclassifier3 {
 
 bool Encoder::Encode(StringPiece normalized_text,
                      std::vector<int>* encoded_text) const {
+  Workspace workspace;
+  return Encode(normalized_text, &workspace, encoded_text);
+}
+
+bool Encoder::Encode(StringPiece normalized_text, Workspace* workspace,
+                     std::vector<int>* encoded_text) const {
+  encoded_text->clear();
+  return AppendEncoding(normalized_text, workspace, encoded_text);
+}
+
+bool Encoder::EncodeBatch(const std::vector<StringPiece>& normalized_texts,
+                          Workspace* workspace,
+                          std::vector<int>* encoded_texts,
+                          std::vector<int>* encoded_offsets) const {
+  for (const StringPiece normalized_text : normalized_texts) {
+    if (!AppendEncoding(normalized_text, workspace, encoded_texts)) {
+      return false;
+    }
+    encoded_offsets->push_back(encoded_texts->size());
+  }
+  return true;
+}
+
+bool Encoder::AppendEncoding(StringPiece normalized_text, Workspace* workspace,
+                             std::vector<int>* encoded_text) const {
   const int len = normalized_text.size();
   if (len <= 0) {
-    *encoded_text = {start_code_, end_code_};
+    encoded_text->push_back(start_code_);
+    encoded_text->push_back(end_code_);
     return true;
   }
   // We use `previous_pos` to indicate whether a dynamic programming state was
   // reachable.
-  std::vector<SegmentationEntry> segmentation(
-      len + 1, {/*score=*/0, /*previous_pos=*/-1, /*piece_id=*/-1,
-                /*num_pieces=*/0});
+  std::vector<Workspace::SegmentationEntry>& segmentation =
+      workspace->segmentation_;
+  segmentation.assign(len + 1, {/*score=*/0, /*previous_pos=*/-1,
+                                /*piece_id=*/-1, /*num_pieces=*/0});
+  std::vector<StringSet::Match>& matches = workspace->matches_;
   for (int i = 0; i < len; i++) {
     // State couldn't be reached.
     if (i > 0 && segmentation[i].previous_pos < 0) {
@@ -57,7 +85,7 @@ bool Encoder::Encode(StringPiece normalized_text,
         }
       }
     }
-    std::vector<StringSet::Match> matches;
+    matches.clear();
     if (!pieces_->FindAllPrefixMatches(normalized_text, &matches)) {
       TC3_LOG(ERROR)
           << "Couldn't successfully gather prefix sentence piece matches.";
@@ -78,18 +106,22 @@ bool Encoder::Encode(StringPiece normalized_text,
     normalized_text.RemovePrefix(1);
   }
   if (segmentation[len].num_pieces <= 0) {
-    *encoded_text = {start_code_, end_code_};
+    encoded_text->push_back(start_code_);
+    encoded_text->push_back(end_code_);
     return true;
   }
+  // The pieces are found from the end of the text, and written backwards.
   const int num_pieces = segmentation[len].num_pieces;
-  encoded_text->resize(num_pieces + 2);
-  (*encoded_text)[num_pieces + 1] = end_code_;
+  const int begin = encoded_text->size();
+  encoded_text->resize(begin + num_pieces + 2);
+  int* encoded = encoded_text->data() + begin;
+  encoded[num_pieces + 1] = end_code_;
   int pos = len;
   for (int i = num_pieces; i > 0; i--) {
-    (*encoded_text)[i] = segmentation[pos].piece_id;
+    encoded[i] = segmentation[pos].piece_id;
     pos = segmentation[pos].previous_pos;
   }
-  (*encoded_text)[0] = start_code_;
+  encoded[0] = start_code_;
   return true;
 }
 
@@ -52,27 +52,54 @@ class Encoder {
         unknown_code_(unknown_code),
         unknown_score_(unknown_score) {}
 
+  // Scratch space of the encoder: the dynamic programming lattice and the
+  // piece matches. Reusing a workspace across calls avoids allocating for each
+  // input once it has grown to the size of the longest input. A workspace
+  // must not be used by several threads at the same time.
+  class Workspace {
+   private:
+    friend class Encoder;
+
+    // State in the dynamic programming algorithm.
+    struct SegmentationEntry {
+      // Accumulated score.
+      float score;
+
+      // Position before last piece.
+      int previous_pos;
+
+      // Last piece used.
+      int piece_id;
+
+      // Total number of pieces used.
+      int num_pieces;
+    };
+
+    std::vector<SegmentationEntry> segmentation_;
+    std::vector<StringSet::Match> matches_;
+  };
+
   // Segment the input so that the total score of the pieces used is maximized.
   // This is a simplified implementation of the general Viterbi algorithm,
   // assuming independence between individual pieces.
   bool Encode(StringPiece normalized_text,
               std::vector<int>* encoded_text) const;
 
- private:
-  // State in the dynamic programming algorithm.
-  struct SegmentationEntry {
-    // Accumulated score.
-    float score;
-
-    // Position before last piece.
-    int previous_pos;
+  // Same as above, but uses the given workspace instead of allocating one.
+  bool Encode(StringPiece normalized_text, Workspace* workspace,
+              std::vector<int>* encoded_text) const;
 
-    // Last piece used.
-    int piece_id;
+  // Encodes the texts one after another, reusing the same workspace. Appends
+  // the encodings to `encoded_texts`, and the offset of the end of each of them
+  // in `encoded_texts` to `encoded_offsets`.
+  bool EncodeBatch(const std::vector<StringPiece>& normalized_texts,
+                   Workspace* workspace, std::vector<int>* encoded_texts,
+                   std::vector<int>* encoded_offsets) const;
 
-    // Total number of pieces used.
-    int num_pieces;
-  };
+ private:
+  // Appends the encoding of the text to `encoded_text`.
+  bool AppendEncoding(StringPiece normalized_text, Workspace* workspace,
+                      std::vector<int>* encoded_text) const;
 
   const int num_pieces_;
   const float* scores_;
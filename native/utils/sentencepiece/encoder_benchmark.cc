@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "utils/base/integral_types.h"
+#include "utils/container/sorted-strings-table.h"
+#include "utils/sentencepiece/encoder.h"
+#include "utils/testing/benchmark-utils.h"
+#include "benchmark/benchmark.h"
+
+namespace libtextclassifier3 {
+namespace {
+
+// A synthetic sentencepiece vocabulary: all single letters, and the most
+// frequent 2 to 6-grams of a synthetic text.
+class SyntheticVocabulary {
+ public:
+  explicit SyntheticVocabulary(const int num_ngrams) {
+    const std::string text = GenerateText(BenchmarkScript::kLatin,
+                                          /*num_codepoints=*/100000,
+                                          /*seed=*/42);
+    std::map<std::string, int> counts;
+    for (int i = 0; i < text.size(); i++) {
+      for (int length = 2; length <= 6 && i + length <= text.size();
+           length++) {
+        const std::string ngram = text.substr(i, length);
+        if (ngram.find(' ') != std::string::npos) {
+          break;
+        }
+        counts[ngram]++;
+      }
+    }
+    std::vector<std::pair<int, std::string>> by_count;
+    for (const auto& ngram_count : counts) {
+      by_count.push_back({-ngram_count.second, ngram_count.first});
+    }
+    std::sort(by_count.begin(), by_count.end());
+    if (by_count.size() > num_ngrams) {
+      by_count.resize(num_ngrams);
+    }
+
+    // The pieces need to be sorted for the lookup.
+    std::map<std::string, float> pieces;
+    for (char c = 'a'; c <= 'z'; c++) {
+      pieces[std::string(1, c)] = -10.0;
+    }
+    for (const auto& count_ngram : by_count) {
+      pieces[count_ngram.second] = -1.0 / -count_ngram.first;
+    }
+    for (const auto& piece_score : pieces) {
+      offsets_.push_back(pieces_.size());
+      pieces_ += piece_score.first;
+      pieces_.push_back('\0');
+      scores_.push_back(piece_score.second);
+    }
+    table_.reset(new SortedStringsTable(offsets_.size(), offsets_.data(),
+                                        StringPiece(pieces_)));
+  }
+
+  const StringSet* table() const { return table_.get(); }
+  int size() const { return offsets_.size(); }
+  const float* scores() const { return scores_.data(); }
+
+ private:
+  std::string pieces_;
+  std::vector<uint32> offsets_;
+  std::vector<float> scores_;
+  std::unique_ptr<StringSet> table_;
+};
+
+void BM_Encode(benchmark::State& state) {
+  const SyntheticVocabulary vocabulary(/*num_ngrams=*/8000);
+  const Encoder encoder(vocabulary.table(), vocabulary.size(),
+                        vocabulary.scores());
+  const std::string text =
+      GenerateText(BenchmarkScript::kLatin, /*num_codepoints=*/state.range(0));
+
+  std::vector<int> encoded_text;
+  for (auto _ : state) {
+    encoded_text.clear();
+    benchmark::DoNotOptimize(encoder.Encode(text, &encoded_text));
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_Encode)->RangeMultiplier(4)->Range(16, 4096);
+BENCHMARK(BM_Encode)->Arg(256)->Apply(ReportLatencyPercentiles);
+
+void BM_EncodeWithWorkspace(benchmark::State& state) {
+  const SyntheticVocabulary vocabulary(/*num_ngrams=*/8000);
+  const Encoder encoder(vocabulary.table(), vocabulary.size(),
+                        vocabulary.scores());
+  const std::string text =
+      GenerateText(BenchmarkScript::kLatin, /*num_codepoints=*/state.range(0));
+
+  Encoder::Workspace workspace;
+  std::vector<int> encoded_text;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(encoder.Encode(text, &workspace, &encoded_text));
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_EncodeWithWorkspace)->RangeMultiplier(4)->Range(16, 4096);
+
+// A batch of short messages, as encoded by the TEXT_ENCODER op.
+void BM_EncodeBatch(benchmark::State& state) {
+  const SyntheticVocabulary vocabulary(/*num_ngrams=*/8000);
+  const Encoder encoder(vocabulary.table(), vocabulary.size(),
+                        vocabulary.scores());
+  std::vector<std::string> texts;
+  std::vector<StringPiece> text_pieces;
+  int num_bytes = 0;
+  for (int i = 0; i < state.range(0); i++) {
+    texts.push_back(GenerateText(BenchmarkScript::kLatin,
+                                 /*num_codepoints=*/64, /*seed=*/i + 1));
+    num_bytes += texts.back().size();
+  }
+  for (const std::string& text : texts) {
+    text_pieces.push_back(text);
+  }
+
+  Encoder::Workspace workspace;
+  std::vector<int> encoded_texts;
+  std::vector<int> encoded_offsets;
+  for (auto _ : state) {
+    encoded_texts.clear();
+    encoded_offsets.clear();
+    benchmark::DoNotOptimize(encoder.EncodeBatch(
+        text_pieces, &workspace, &encoded_texts, &encoded_offsets));
+  }
+  state.SetBytesProcessed(state.iterations() * num_bytes);
+}
+BENCHMARK(BM_EncodeBatch)->Arg(1)->Arg(8)->Arg(32);
+
+}  // namespace
+}  // namespace libtextclassifier3
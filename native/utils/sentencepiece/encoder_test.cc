@@ -118,5 +118,36 @@ TEST(EncoderTest, HandlesOutOfDictionary) {
   }
 }
 
+TEST(EncoderTest, EncodesBatchWithWorkspace) {
+  const char pieces_table[] = "hell\0hello\0o\0there\0";
+  const uint32 offsets[] = {0, 5, 11, 13};
+  float scores[] = {-0.5, -1.0, -10.0, -1.0};
+  std::unique_ptr<StringSet> pieces(new SortedStringsTable(
+      /*num_pieces=*/4, offsets, StringPiece(pieces_table, 18)));
+  const Encoder encoder(pieces.get(),
+                        /*num_pieces=*/4, scores);
+  Encoder::Workspace workspace;
+  {
+    std::vector<int> encoded_text = {42};
+    EXPECT_TRUE(encoder.Encode("hellothere", &workspace, &encoded_text));
+    EXPECT_THAT(encoded_text, ElementsAre(0, 3, 5, 1));
+  }
+  {
+    std::vector<int> encoded_text;
+    EXPECT_TRUE(encoder.Encode("hellhello", &workspace, &encoded_text));
+    EXPECT_THAT(encoded_text, ElementsAre(0, 2, 3, 1));
+  }
+  {
+    std::vector<int> encoded_texts;
+    std::vector<int> encoded_offsets;
+    EXPECT_TRUE(encoder.EncodeBatch(
+        {"hellothere", "", "hellathere", "hellohell"}, &workspace,
+        &encoded_texts, &encoded_offsets));
+    EXPECT_THAT(encoded_texts,
+                ElementsAre(0, 3, 5, 1, 0, 1, 0, 1, 0, 3, 2, 1));
+    EXPECT_THAT(encoded_offsets, ElementsAre(4, 6, 8, 12));
+  }
+}
+
 }  // namespace
 }  // namespace libtextclassifier3
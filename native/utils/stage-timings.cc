@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/stage-timings.h"
+
+#include <atomic>
+#include <utility>
+
+namespace libtextclassifier3 {
+namespace {
+
+std::atomic<int64 (*)()> allocated_bytes_counter(nullptr);
+
+#ifdef TC3_STAGE_TIMINGS
+thread_local ScopedStage* current_stage = nullptr;
+#endif  // TC3_STAGE_TIMINGS
+
+}  // namespace
+
+void StageTimings::Record(StageStats stats) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stages_.push_back(std::move(stats));
+}
+
+std::vector<StageStats> StageTimings::stages() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stages_;
+}
+
+void StageTimings::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stages_.clear();
+}
+
+void SetAllocatedBytesCounter(int64 (*counter)()) {
+  allocated_bytes_counter.store(counter);
+}
+
+#ifdef TC3_STAGE_TIMINGS
+ScopedStage::ScopedStage(StageTimings* timings, const char* name,
+                         const void* outputs,
+                         size_t (*outputs_size)(const void*))
+    : timings_(timings),
+      name_(name),
+      outputs_(outputs),
+      outputs_size_(outputs_size) {
+  if (timings_ == nullptr) {
+    return;
+  }
+  if (outputs_ != nullptr) {
+    start_outputs_size_ = outputs_size_(outputs_);
+  }
+  if (int64 (*counter)() = allocated_bytes_counter.load()) {
+    start_bytes_allocated_ = counter();
+  }
+  parent_ = current_stage;
+  current_stage = this;
+  start_time_ = std::chrono::steady_clock::now();
+}
+
+ScopedStage::~ScopedStage() {
+  if (timings_ == nullptr) {
+    return;
+  }
+  StageStats stats;
+  stats.wall_time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - start_time_)
+                           .count();
+  if (int64 (*counter)() = allocated_bytes_counter.load()) {
+    stats.bytes_allocated = counter() - start_bytes_allocated_;
+  }
+  current_stage = parent_;
+  if (outputs_ != nullptr) {
+    stats.num_candidates = outputs_size_(outputs_) - start_outputs_size_;
+  }
+  stats.num_model_invocations = num_model_invocations_.load();
+  stats.name = name_;
+  timings_->Record(std::move(stats));
+}
+
+void ScopedStage::CountModelInvocation() {
+  if (current_stage != nullptr) {
+    ++current_stage->num_model_invocations_;
+  }
+}
+
+ScopedStage* ScopedStage::Current() { return current_stage; }
+
+ScopedStage::ThreadScope::ThreadScope(ScopedStage* stage)
+    : previous_(current_stage) {
+  current_stage = stage;
+}
+
+ScopedStage::ThreadScope::~ThreadScope() { current_stage = previous_; }
+#endif  // TC3_STAGE_TIMINGS
+
+}  // namespace libtextclassifier3
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Instrumentation of the stages of the annotation and actions pipelines, to
+// attribute the latency of a call to its sub-annotators.
+//
+// The stages are only measured when the library is built with
+// TC3_STAGE_TIMINGS defined. Otherwise ScopedStage and the counting hooks
+// compile to nothing, and a StageTimings passed in the options stays empty.
+
+#ifndef LIBTEXTCLASSIFIER_UTILS_STAGE_TIMINGS_H_
+#define LIBTEXTCLASSIFIER_UTILS_STAGE_TIMINGS_H_
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "utils/base/integral_types.h"
+
+namespace libtextclassifier3 {
+
+// The measurements of one stage of a call.
+struct StageStats {
+  // Name of the stage, e.g. "regex" or "conflict_resolution".
+  std::string name;
+
+  // Wall time spent in the stage, including the stages nested in it.
+  int64 wall_time_us = 0;
+
+  // Number of candidates the stage produced, or -1 if not applicable.
+  int num_candidates = -1;
+
+  // Number of TFLite interpreter invocations of the stage. An invocation is
+  // attributed to the innermost stage running on the invoking thread, or
+  // attached to it with ScopedStage::ThreadScope.
+  int num_model_invocations = 0;
+
+  // Number of bytes the thread allocated during the stage, or -1 if no
+  // allocation counter is installed, see SetAllocatedBytesCounter.
+  int64 bytes_allocated = -1;
+};
+
+// Collects the stats of the stages of one or more calls, in the order in which
+// the stages finished. Thread-safe, so that sub-annotators running in parallel
+// can record into the same object.
+class StageTimings {
+ public:
+  void Record(StageStats stats);
+
+  // Returns a copy of the stats recorded so far.
+  std::vector<StageStats> stages() const;
+
+  void Clear();
+
+ private:
+  mutable std::mutex mutex_;
+  std::vector<StageStats> stages_;
+};
+
+// Installs a function that returns the total number of bytes allocated by the
+// calling thread so far, e.g. from the per-thread statistics of the allocator.
+// The stages record the difference of its values at their start and end.
+// Passing nullptr uninstalls the counter. Not thread-safe with running stages.
+void SetAllocatedBytesCounter(int64 (*counter)());
+
+// Measures a stage from construction to destruction and records it into
+// `timings`, unless that is nullptr. If `outputs` is given, the number of
+// elements added to it during the stage is recorded as the candidate count.
+class ScopedStage {
+ public:
+#ifdef TC3_STAGE_TIMINGS
+  ScopedStage(StageTimings* timings, const char* name)
+      : ScopedStage(timings, name, /*outputs=*/nullptr,
+                    /*outputs_size=*/nullptr) {}
+
+  template <typename T>
+  ScopedStage(StageTimings* timings, const char* name,
+              const std::vector<T>* outputs)
+      : ScopedStage(timings, name, outputs, [](const void* vector) {
+          return static_cast<const std::vector<T>*>(vector)->size();
+        }) {}
+
+  ~ScopedStage();
+
+  ScopedStage(const ScopedStage&) = delete;
+  ScopedStage& operator=(const ScopedStage&) = delete;
+
+  // Attributes a TFLite interpreter invocation to the innermost stage running
+  // on the calling thread, if any.
+  static void CountModelInvocation();
+
+  // Returns the innermost stage running on the calling thread, or nullptr.
+  static ScopedStage* Current();
+
+  // Makes `stage` the current stage of the calling thread while in scope, so
+  // that the work a stage hands off to other threads, e.g. as tasks of a
+  // TaskRunner, is attributed to it. The stage must outlive the scope.
+  class ThreadScope {
+   public:
+    explicit ThreadScope(ScopedStage* stage);
+    ~ThreadScope();
+
+    ThreadScope(const ThreadScope&) = delete;
+    ThreadScope& operator=(const ThreadScope&) = delete;
+
+   private:
+    ScopedStage* const previous_;
+  };
+
+ private:
+  ScopedStage(StageTimings* timings, const char* name, const void* outputs,
+              size_t (*outputs_size)(const void*));
+
+  StageTimings* const timings_;
+  const char* const name_;
+  const void* const outputs_;
+  size_t (*const outputs_size_)(const void*);
+  size_t start_outputs_size_ = 0;
+  int64 start_bytes_allocated_ = 0;
+  std::atomic<int> num_model_invocations_{0};
+  std::chrono::steady_clock::time_point start_time_;
+
+  // The enclosing stage on the same thread, restored on destruction.
+  ScopedStage* parent_ = nullptr;
+#else
+  ScopedStage(StageTimings* /*timings*/, const char* /*name*/) {}
+
+  template <typename T>
+  ScopedStage(StageTimings* /*timings*/, const char* /*name*/,
+              const std::vector<T>* /*outputs*/) {}
+
+  static void CountModelInvocation() {}
+
+  static ScopedStage* Current() { return nullptr; }
+
+  class ThreadScope {
+   public:
+    explicit ThreadScope(ScopedStage* /*stage*/) {}
+  };
+#endif  // TC3_STAGE_TIMINGS
+};
+
+}  // namespace libtextclassifier3
+
+#endif  // LIBTEXTCLASSIFIER_UTILS_STAGE_TIMINGS_H_
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "utils/stage-timings.h"
+
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace libtextclassifier3 {
+namespace {
+
+using testing::ElementsAre;
+using testing::Field;
+using testing::IsEmpty;
+
+TEST(StageTimingsTest, RecordsAndClears) {
+  StageTimings timings;
+  StageStats stats;
+  stats.name = "regex";
+  stats.num_candidates = 3;
+  timings.Record(stats);
+  stats.name = "datetime";
+  timings.Record(stats);
+
+  EXPECT_THAT(timings.stages(), ElementsAre(Field(&StageStats::name, "regex"),
+                                            Field(&StageStats::name,
+                                                  "datetime")));
+  timings.Clear();
+  EXPECT_THAT(timings.stages(), IsEmpty());
+}
+
+TEST(StageTimingsTest, NullTimingsIsIgnored) {
+  ScopedStage stage(/*timings=*/nullptr, "stage");
+  ScopedStage::CountModelInvocation();
+}
+
+#ifdef TC3_STAGE_TIMINGS
+int64 num_allocated_bytes = 0;
+
+int64 AllocatedBytes() { return num_allocated_bytes; }
+
+TEST(StageTimingsTest, RecordsNestedStages) {
+  StageTimings timings;
+  std::vector<int> outputs = {1, 2};
+  SetAllocatedBytesCounter(&AllocatedBytes);
+  {
+    ScopedStage outer(&timings, "outer", &outputs);
+    outputs.push_back(3);
+    ScopedStage::CountModelInvocation();
+    num_allocated_bytes += 100;
+    {
+      ScopedStage inner(&timings, "inner");
+      ScopedStage::CountModelInvocation();
+      ScopedStage::CountModelInvocation();
+      num_allocated_bytes += 20;
+    }
+  }
+  SetAllocatedBytesCounter(nullptr);
+
+  const std::vector<StageStats> stages = timings.stages();
+  ASSERT_EQ(stages.size(), 2);
+  EXPECT_EQ(stages[0].name, "inner");
+  EXPECT_EQ(stages[0].num_candidates, -1);
+  EXPECT_EQ(stages[0].num_model_invocations, 2);
+  EXPECT_EQ(stages[0].bytes_allocated, 20);
+  EXPECT_EQ(stages[1].name, "outer");
+  EXPECT_EQ(stages[1].num_candidates, 1);
+  EXPECT_EQ(stages[1].num_model_invocations, 1);
+  EXPECT_EQ(stages[1].bytes_allocated, 120);
+  EXPECT_GE(stages[1].wall_time_us, stages[0].wall_time_us);
+}
+
+TEST(StageTimingsTest, CountsInvocationsOfAttachedThreads) {
+  StageTimings timings;
+  {
+    ScopedStage stage(&timings, "stage");
+    ScopedStage* const current = ScopedStage::Current();
+    EXPECT_EQ(current, &stage);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+      threads.emplace_back([current]() {
+        // Not attributed without a stage on this thread.
+        ScopedStage::CountModelInvocation();
+        ScopedStage::ThreadScope stage_scope(current);
+        ScopedStage::CountModelInvocation();
+        ScopedStage::CountModelInvocation();
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    EXPECT_EQ(ScopedStage::Current(), &stage);
+  }
+  EXPECT_EQ(ScopedStage::Current(), nullptr);
+
+  const std::vector<StageStats> stages = timings.stages();
+  ASSERT_EQ(stages.size(), 1);
+  EXPECT_EQ(stages[0].num_model_invocations, 8);
+}
+#else
+TEST(StageTimingsTest, CompiledOut) {
+  StageTimings timings;
+  std::vector<int> outputs;
+  {
+    ScopedStage stage(&timings, "stage", &outputs);
+    outputs.push_back(1);
+  }
+  EXPECT_THAT(timings.stages(), IsEmpty());
+}
+#endif  // TC3_STAGE_TIMINGS
+
+}  // namespace
+}  // namespace libtextclassifier3
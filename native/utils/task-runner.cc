@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/task-runner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace libtextclassifier3 {
+namespace {
+
+// The tasks of one RunAll() call. The tasks are claimed one by one by the
+// calling thread and by the workers that picked up the batch.
+class TaskBatch {
+ public:
+  explicit TaskBatch(const std::vector<std::function<void()>>* tasks)
+      : tasks_(tasks), num_tasks_(tasks->size()), num_pending_(num_tasks_) {}
+
+  // Runs tasks until there is none left to claim.
+  void RunTasks() {
+    for (int i = next_task_.fetch_add(1); i < num_tasks_;
+         i = next_task_.fetch_add(1)) {
+      (*tasks_)[i]();
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--num_pending_ == 0) {
+        done_.notify_all();
+      }
+    }
+  }
+
+  // Blocks until all the tasks have finished.
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return num_pending_ == 0; });
+  }
+
+ private:
+  // Only dereferenced while some task is still pending, i.e. while the owning
+  // RunAll() call has not returned.
+  const std::vector<std::function<void()>>* tasks_;
+  const int num_tasks_;
+  std::atomic<int> next_task_{0};
+
+  std::mutex mutex_;
+  std::condition_variable done_;
+  int num_pending_;
+};
+
+}  // namespace
+
+ThreadPoolTaskRunner::ThreadPoolTaskRunner(const int num_threads) {
+  for (int i = 0; i < num_threads; i++) {
+    threads_.emplace_back(&ThreadPoolTaskRunner::WorkerLoop, this);
+  }
+}
+
+ThreadPoolTaskRunner::~ThreadPoolTaskRunner() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  work_available_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPoolTaskRunner::RunAll(
+    const std::vector<std::function<void()>>& tasks) {
+  if (tasks.size() <= 1 || threads_.empty()) {
+    for (const std::function<void()>& task : tasks) {
+      task();
+    }
+    return;
+  }
+
+  // The batch can be picked up by a worker after RunAll() returned, so it is
+  // kept alive by the queued helpers.
+  auto batch = std::make_shared<TaskBatch>(&tasks);
+  const int num_helpers =
+      std::min(static_cast<int>(threads_.size()),
+               static_cast<int>(tasks.size()) - 1);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int i = 0; i < num_helpers; i++) {
+      queue_.push_back([batch]() { batch->RunTasks(); });
+    }
+  }
+  work_available_.notify_all();
+
+  batch->RunTasks();
+  batch->Wait();
+}
+
+void ThreadPoolTaskRunner::WorkerLoop() {
+  while (true) {
+    std::function<void()> work;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_available_.wait(lock,
+                           [this]() { return stopping_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+      work = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    work();
+  }
+}
+
+}  // namespace libtextclassifier3
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBTEXTCLASSIFIER_UTILS_TASK_RUNNER_H_
+#define LIBTEXTCLASSIFIER_UTILS_TASK_RUNNER_H_
+
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <functional>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+namespace libtextclassifier3 {
+
+// Runs independent tasks, possibly in parallel. Lets the callers plug in their
+// own thread pool.
+class TaskRunner {
+ public:
+  virtual ~TaskRunner() {}
+
+  // Runs all the tasks and returns once all of them have finished. The tasks
+  // must not depend on each other.
+  virtual void RunAll(const std::vector<std::function<void()>>& tasks) = 0;
+
+  // Returns the number of tasks that can make progress at the same time.
+  virtual int NumWorkers() const = 0;
+};
+
+// Runs the tasks one after another on the calling thread.
+class SequentialTaskRunner : public TaskRunner {
+ public:
+  void RunAll(const std::vector<std::function<void()>>& tasks) override {
+    for (const std::function<void()>& task : tasks) {
+      task();
+    }
+  }
+
+  int NumWorkers() const override { return 1; }
+};
+
+// Runs the tasks on a fixed set of worker threads. The calling thread takes
+// part in running the tasks of its RunAll() call, so nested RunAll() calls
+// from within a task make progress even if all the workers are busy.
+class ThreadPoolTaskRunner : public TaskRunner {
+ public:
+  explicit ThreadPoolTaskRunner(int num_threads);
+  ~ThreadPoolTaskRunner() override;
+
+  ThreadPoolTaskRunner(const ThreadPoolTaskRunner&) = delete;
+  ThreadPoolTaskRunner& operator=(const ThreadPoolTaskRunner&) = delete;
+
+  void RunAll(const std::vector<std::function<void()>>& tasks) override;
+
+  int NumWorkers() const override { return threads_.size() + 1; }
+
+ private:
+  void WorkerLoop();
+
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::deque<std::function<void()>> queue_;
+  bool stopping_ = false;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace libtextclassifier3
+
+#endif  // LIBTEXTCLASSIFIER_UTILS_TASK_RUNNER_H_
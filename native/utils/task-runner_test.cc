@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/task-runner.h"
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace libtextclassifier3 {
+namespace {
+
+using testing::Each;
+using testing::Eq;
+
+TEST(TaskRunnerTest, SequentialRunsAllTasks) {
+  SequentialTaskRunner task_runner;
+  std::vector<int> runs(10, 0);
+  std::vector<std::function<void()>> tasks;
+  for (int i = 0; i < runs.size(); i++) {
+    tasks.push_back([&runs, i]() { runs[i]++; });
+  }
+  task_runner.RunAll(tasks);
+  EXPECT_THAT(runs, Each(Eq(1)));
+  EXPECT_EQ(task_runner.NumWorkers(), 1);
+}
+
+TEST(TaskRunnerTest, ThreadPoolRunsAllTasks) {
+  ThreadPoolTaskRunner task_runner(/*num_threads=*/3);
+  EXPECT_EQ(task_runner.NumWorkers(), 4);
+  for (int round = 0; round < 100; round++) {
+    std::vector<int> runs(20, 0);
+    std::vector<std::function<void()>> tasks;
+    for (int i = 0; i < runs.size(); i++) {
+      tasks.push_back([&runs, i]() { runs[i]++; });
+    }
+    task_runner.RunAll(tasks);
+    EXPECT_THAT(runs, Each(Eq(1)));
+  }
+}
+
+TEST(TaskRunnerTest, ThreadPoolWithoutThreads) {
+  ThreadPoolTaskRunner task_runner(/*num_threads=*/0);
+  int num_runs = 0;
+  task_runner.RunAll({[&num_runs]() { num_runs++; },
+                      [&num_runs]() { num_runs++; }});
+  EXPECT_EQ(num_runs, 2);
+}
+
+TEST(TaskRunnerTest, ThreadPoolHandlesNestedCalls) {
+  ThreadPoolTaskRunner task_runner(/*num_threads=*/2);
+  std::atomic<int> num_runs(0);
+  std::vector<std::function<void()>> inner_tasks(
+      5, [&num_runs]() { num_runs++; });
+  std::vector<std::function<void()>> outer_tasks(
+      6, [&task_runner, &inner_tasks]() { task_runner.RunAll(inner_tasks); });
+  task_runner.RunAll(outer_tasks);
+  EXPECT_EQ(num_runs, 30);
+}
+
+}  // namespace
+}  // namespace libtextclassifier3
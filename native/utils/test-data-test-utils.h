@@ -19,6 +19,12 @@
 #ifndef LIBTEXTCLASSIFIER_UTILS_TEST_DATA_TEST_UTILS_H_
 #define LIBTEXTCLASSIFIER_UTILS_TEST_DATA_TEST_UTILS_H_
 #include <fstream>
+#include <string>
+
+#if !defined(__ANDROID__)
+#include <limits.h>
+#include <unistd.h>
+#endif
 
 #include "gtest/gtest.h"
 
@@ -26,7 +32,18 @@ namespace libtextclassifier3 {
 
 // Get the file path to the test data.
 inline std::string GetTestDataPath(const std::string& relative_path) {
+#if defined(__ANDROID__)
   return "/data/local/tmp/" + relative_path;
+#else
+  // Host tests are installed with their data next to the test binary.
+  char path[PATH_MAX];
+  const ssize_t length = readlink("/proc/self/exe", path, sizeof(path));
+  if (length <= 0 || length == sizeof(path)) {
+    return relative_path;
+  }
+  const std::string executable(path, length);
+  return executable.substr(0, executable.rfind('/') + 1) + relative_path;
+#endif
 }
 
 inline std::string GetTestFileContent(const std::string& relative_path) {
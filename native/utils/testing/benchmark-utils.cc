@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/testing/benchmark-utils.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <random>
+
+#include "utils/utf8/unicodetext.h"
+
+namespace libtextclassifier3 {
+namespace {
+
+// Number of repetitions the statistics of the repetition means are computed
+// over.
+constexpr int kLatencyRepetitions = 20;
+
+std::string* DataDir() {
+  static std::string* data_dir = []() {
+    // Default to the directory of the binary.
+    char path[4096];
+    const ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (length <= 0) {
+      return new std::string("./");
+    }
+    const std::string binary_path(path, length);
+    return new std::string(
+        binary_path.substr(0, binary_path.find_last_of('/') + 1));
+  }();
+  return data_dir;
+}
+
+// A range of codepoints words of a script are sampled from.
+struct ScriptRange {
+  char32 first;
+  char32 last;
+  bool separate_words;
+};
+
+ScriptRange GetScriptRange(const BenchmarkScript script) {
+  switch (script) {
+    case BenchmarkScript::kCyrillic:
+      return {0x0430, 0x044F, /*separate_words=*/true};
+    case BenchmarkScript::kArabic:
+      return {0x0627, 0x064A, /*separate_words=*/true};
+    case BenchmarkScript::kHan:
+      return {0x4E00, 0x9FA5, /*separate_words=*/false};
+    case BenchmarkScript::kLatin:
+    case BenchmarkScript::kMixed:
+    default:
+      return {'a', 'z', /*separate_words=*/true};
+  }
+}
+
+double Percentile(const std::vector<double>& values, const double percentile) {
+  if (values.empty()) {
+    return 0.0;
+  }
+  std::vector<double> sorted(values);
+  const int rank = std::min<int>(values.size() - 1,
+                                 static_cast<int>(percentile * values.size()));
+  std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+  return sorted[rank];
+}
+
+double P50(const std::vector<double>& values) {
+  return Percentile(values, 0.5);
+}
+
+double P90(const std::vector<double>& values) {
+  return Percentile(values, 0.9);
+}
+
+double Max(const std::vector<double>& values) {
+  return values.empty() ? 0.0 : *std::max_element(values.begin(), values.end());
+}
+
+}  // namespace
+
+void SetBenchmarkDataDir(const std::string& data_dir) {
+  *DataDir() = data_dir;
+  if (!DataDir()->empty() && DataDir()->back() != '/') {
+    DataDir()->push_back('/');
+  }
+}
+
+std::string GetBenchmarkDataPath(const std::string& relative_path) {
+  return *DataDir() + relative_path;
+}
+
+const char* BenchmarkScriptName(const BenchmarkScript script) {
+  switch (script) {
+    case BenchmarkScript::kLatin:
+      return "latin";
+    case BenchmarkScript::kCyrillic:
+      return "cyrillic";
+    case BenchmarkScript::kArabic:
+      return "arabic";
+    case BenchmarkScript::kHan:
+      return "han";
+    case BenchmarkScript::kMixed:
+      return "mixed";
+  }
+  return "unknown";
+}
+
+std::string GenerateText(const BenchmarkScript script, const int num_codepoints,
+                         const uint32 seed) {
+  std::mt19937 random(seed);
+  std::uniform_int_distribution<int> word_length(2, 9);
+  std::uniform_int_distribution<int> word_script(
+      static_cast<int>(BenchmarkScript::kLatin),
+      static_cast<int>(BenchmarkScript::kHan));
+
+  UnicodeText text;
+  int size = 0;
+  int num_words = 0;
+  while (size < num_codepoints) {
+    const ScriptRange range =
+        script == BenchmarkScript::kMixed
+            ? GetScriptRange(static_cast<BenchmarkScript>(word_script(random)))
+            : GetScriptRange(script);
+    std::uniform_int_distribution<char32> codepoint(range.first, range.last);
+    for (int i = word_length(random); i > 0 && size < num_codepoints; --i) {
+      text.push_back(codepoint(random));
+      ++size;
+    }
+    if (++num_words % 12 == 0 && size < num_codepoints) {
+      text.push_back(range.separate_words ? '.' : 0x3002);
+      ++size;
+    }
+    if (range.separate_words && size < num_codepoints) {
+      text.push_back(' ');
+      ++size;
+    }
+  }
+  return text.ToUTF8String();
+}
+
+std::string GenerateDenseEntityText(const int num_lines, const uint32 seed) {
+  std::mt19937 random(seed);
+  std::uniform_int_distribution<int> digit(0, 9);
+  std::uniform_int_distribution<int> day(1, 28);
+  std::uniform_int_distribution<int> month(1, 12);
+  std::uniform_int_distribution<int> hour(0, 23);
+  std::uniform_int_distribution<int> minute(0, 59);
+  const auto digits = [&random, &digit](const int num_digits) {
+    std::string result;
+    for (int i = 0; i < num_digits; i++) {
+      result.push_back('0' + digit(random));
+    }
+    return result;
+  };
+
+  std::string text;
+  for (int i = 0; i < num_lines; i++) {
+    text += "2020-" + std::to_string(month(random)) + "-" +
+            std::to_string(day(random)) + " " + std::to_string(hour(random)) +
+            ":" + std::to_string(minute(random)) + " user" + digits(3) +
+            "@example.com called +1 650 " + digits(3) + " " + digits(4) +
+            " about flight LX " + digits(2) + " on " +
+            std::to_string(day(random)) + "/" + std::to_string(month(random)) +
+            " at " + std::to_string(hour(random) % 12 + 1) +
+            "pm, see https://www.example.com/track/" + digits(8) +
+            " order " + digits(4) + " " + digits(4) + " " + digits(4) + " " +
+            digits(4) + " amount " + digits(1) + "," + digits(3) + "." +
+            digits(2) + "\n";
+  }
+  return text;
+}
+
+std::vector<std::pair<int, std::string>> GenerateChatMessages(
+    const int num_messages, const uint32 seed) {
+  static const char* const kMessages[] = {
+      "Where are you?",
+      "Can you call me at 650-253-0000?",
+      "Let's meet tomorrow at 6pm at 350 Third Street, Cambridge",
+      "Thanks!",
+      "Are you free on Saturday?",
+      "My flight LX 38 lands at 3pm",
+      "Send it to someone@example.com please",
+      "How are you doing?",
+      "See www.example.com for the details",
+      "I'll be there in 10 minutes",
+  };
+  constexpr int kNumMessages = sizeof(kMessages) / sizeof(kMessages[0]);
+  std::mt19937 random(seed);
+  std::uniform_int_distribution<int> message(0, kNumMessages - 1);
+
+  std::vector<std::pair<int, std::string>> messages;
+  for (int i = 0; i < num_messages; i++) {
+    messages.push_back({i % 2, kMessages[message(random)]});
+  }
+  return messages;
+}
+
+void ReportLatencyPercentiles(benchmark::internal::Benchmark* benchmark) {
+  benchmark->Repetitions(kLatencyRepetitions)
+      ->ComputeStatistics("rep_p50", P50)
+      ->ComputeStatistics("rep_p90", P90)
+      ->ComputeStatistics("rep_max", Max);
+}
+
+}  // namespace libtextclassifier3
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Helper utilities for the libtextclassifier benchmarks: access to the shipped
+// models and synthetic input corpora.
+
+#ifndef LIBTEXTCLASSIFIER_UTILS_TESTING_BENCHMARK_UTILS_H_
+#define LIBTEXTCLASSIFIER_UTILS_TESTING_BENCHMARK_UTILS_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "utils/base/integral_types.h"
+#include "benchmark/benchmark.h"
+
+namespace libtextclassifier3 {
+
+// Sets the directory the data files of the benchmarks are read from, i.e. the
+// `native` directory of the source tree. Defaults to the directory of the
+// benchmark binary, where the build installs the data files.
+void SetBenchmarkDataDir(const std::string& data_dir);
+
+// Gets the path of a data file, relative to the data directory, e.g.
+// "models/textclassifier.en.model".
+std::string GetBenchmarkDataPath(const std::string& relative_path);
+
+// Scripts of the synthetic texts.
+enum class BenchmarkScript {
+  kLatin,
+  kCyrillic,
+  kArabic,
+  kHan,
+
+  // Every word in a random one of the above.
+  kMixed,
+};
+
+const char* BenchmarkScriptName(BenchmarkScript script);
+
+// Generates a text of about `num_codepoints` codepoints of pseudo-random words
+// in the given script. The same seed gives the same text.
+std::string GenerateText(BenchmarkScript script, int num_codepoints,
+                         uint32 seed = 1);
+
+// Generates a text of `num_lines` log-like lines that are dense with entities:
+// numbers, dates, times, URLs, emails, phone and flight numbers. The entities
+// of the same line overlap when split differently, which produces large
+// conflict groups in the annotator.
+std::string GenerateDenseEntityText(int num_lines, uint32 seed = 1);
+
+// Generates a conversation of `num_messages` short chat messages that mention
+// some entities, as (user id, text) pairs.
+std::vector<std::pair<int, std::string>> GenerateChatMessages(
+    int num_messages, uint32 seed = 1);
+
+// Makes the benchmark run a number of repetitions and also report the 50th and
+// 90th percentile and the maximum of the repetition means as "rep_p50",
+// "rep_p90" and "rep_max". These are statistics of the mean latency of each
+// repetition, not of the latencies of single calls. To be used with
+// `->Apply(ReportLatencyPercentiles)`.
+void ReportLatencyPercentiles(benchmark::internal::Benchmark* benchmark);
+
+}  // namespace libtextclassifier3
+
+#endif  // LIBTEXTCLASSIFIER_UTILS_TESTING_BENCHMARK_UTILS_H_
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Runs the libtextclassifier benchmarks, e.g.:
+//
+//   libtextclassifier_benchmarks --data_dir=<path of the native directory>
+//       --benchmark_out=results.json --benchmark_out_format=json
+//
+// The JSON output has, for every benchmark, the latency per iteration (real
+// and CPU time, and the p50/p90/max of the repetition means) and the
+// throughput (bytes and items per second), to be compared between releases.
+
+#include <cstdio>
+
+#include "utils/strings/stringpiece.h"
+#include "utils/testing/benchmark-utils.h"
+#include "benchmark/benchmark.h"
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  for (int i = 1; i < argc; i++) {
+    libtextclassifier3::StringPiece arg(argv[i]);
+    if (libtextclassifier3::ConsumePrefix(&arg, "--data_dir=")) {
+      libtextclassifier3::SetBenchmarkDataDir(arg.ToString());
+    } else {
+      fprintf(stderr, "Unknown flag: %s\n", argv[i]);
+      return 1;
+    }
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -16,7 +16,9 @@
 
 #include "utils/tflite/text_encoder.h"
 
+#include <algorithm>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "utils/base/logging.h"
@@ -40,6 +42,18 @@ struct TextEncoderOp {
   std::unique_ptr<SentencePieceNormalizer> normalizer;
   std::unique_ptr<Encoder> encoder;
   std::unique_ptr<StringSet> matcher;
+
+  // Buffers reused across invocations, so that encoding doesn't allocate once
+  // they have grown to the size of the largest input. An interpreter is not
+  // invoked concurrently, so they are not shared between threads.
+  Encoder::Workspace encoder_workspace;
+  std::string normalized;
+  std::string normalized_texts;
+  std::vector<int> normalized_offsets;
+  std::vector<StringPiece> normalized_pieces;
+  std::vector<int> encoded_total;
+  std::vector<int> encoded_offsets;
+  std::vector<int> encoded_positions;
 };
 
 // Input parameters for the op.
@@ -211,8 +225,7 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
   if (node->user_data == nullptr) {
     return kTfLiteError;
   }
-  const TextEncoderOp* encoder_op =
-      reinterpret_cast<TextEncoderOp*>(node->user_data);
+  TextEncoderOp* encoder_op = reinterpret_cast<TextEncoderOp*>(node->user_data);
   const TfLiteTensor& input_text =
       context->tensors[node->inputs->data[kInputTexts]];
   const int num_strings = tflite::GetStringCount(&input_text);
@@ -232,26 +245,50 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
   TfLiteTensor& output_positions =
       context->tensors[node->outputs->data[kOutputPosition]];
 
-  std::vector<int> encoded_total;
-  std::vector<int> encoded_offsets;
-  std::vector<int> encoded_positions;
-  encoded_offsets.reserve(num_strings);
   const int max_output_length = output_encoded.dims->data[1];
   const int max_encoded_position = max_output_length;
 
+  // Normalize all the texts into one buffer, and encode them together.
+  std::string& normalized_texts = encoder_op->normalized_texts;
+  std::vector<int>& normalized_offsets = encoder_op->normalized_offsets;
+  normalized_texts.clear();
+  normalized_offsets.clear();
   for (int i = 0; i < num_strings; ++i) {
     const auto& strref = tflite::GetString(&input_text, i);
-    std::string normalized;
-    TF_LITE_ENSURE(context,
-                   encoder_op->normalizer->Normalize(
-                       StringPiece(strref.str, strref.len), &normalized));
-    std::vector<int> encoded;
-    TF_LITE_ENSURE(context, encoder_op->encoder->Encode(normalized, &encoded));
-    encoded_total.insert(encoded_total.end(), encoded.begin(), encoded.end());
-    encoded_offsets.push_back(encoded_total.size());
-    for (int i = 0; i < encoded.size(); i++) {
+    // Normalize appends to its output, which holds the previous text.
+    encoder_op->normalized.clear();
+    TF_LITE_ENSURE(context, encoder_op->normalizer->Normalize(
+                                StringPiece(strref.str, strref.len),
+                                &encoder_op->normalized));
+    normalized_texts += encoder_op->normalized;
+    normalized_offsets.push_back(normalized_texts.size());
+  }
+  std::vector<StringPiece>& normalized_pieces = encoder_op->normalized_pieces;
+  normalized_pieces.clear();
+  int normalized_begin = 0;
+  for (const int normalized_end : normalized_offsets) {
+    normalized_pieces.push_back(
+        StringPiece(normalized_texts.data() + normalized_begin,
+                    normalized_end - normalized_begin));
+    normalized_begin = normalized_end;
+  }
+
+  std::vector<int>& encoded_total = encoder_op->encoded_total;
+  std::vector<int>& encoded_offsets = encoder_op->encoded_offsets;
+  std::vector<int>& encoded_positions = encoder_op->encoded_positions;
+  encoded_total.clear();
+  encoded_offsets.clear();
+  encoded_positions.clear();
+  TF_LITE_ENSURE(context, encoder_op->encoder->EncodeBatch(
+                              normalized_pieces,
+                              &encoder_op->encoder_workspace, &encoded_total,
+                              &encoded_offsets));
+  int encoded_begin = 0;
+  for (const int encoded_end : encoded_offsets) {
+    for (int i = 0; i < encoded_end - encoded_begin; i++) {
       encoded_positions.push_back(std::min(i, max_encoded_position - 1));
     }
+    encoded_begin = encoded_end;
   }
 
   const int num_skip = CopyDataToTensorAndPadOrTruncate(
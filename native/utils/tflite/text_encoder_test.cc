@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/tflite/text_encoder.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "utils/base/integral_types.h"
+#include "utils/container/sorted-strings-table.h"
+#include "utils/flatbuffers/flatbuffers.h"
+#include "utils/sentencepiece/encoder.h"
+#include "utils/sentencepiece/normalizer.h"
+#include "utils/sentencepiece/test_utils.h"
+#include "utils/test-data-test-utils.h"
+#include "utils/tflite/encoder_common.h"
+#include "utils/tflite/text_encoder_config_generated.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "flatbuffers/flexbuffers.h"
+#include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/string_util.h"
+
+namespace libtextclassifier3 {
+namespace {
+
+using testing::ElementsAreArray;
+
+// Sorted sentence pieces, with their scores.
+const char kPiecesTable[] =
+    "hell\0hello\0o\0there\0\xe2\x96\x81\0\xe2\x96\x81hell\0"
+    "\xe2\x96\x81hello\0\xe2\x96\x81there\0";
+const uint32 kPiecesOffsets[] = {0, 5, 11, 13, 19, 23, 31, 40};
+const float kPiecesScores[] = {-0.5, -1.0, -10.0, -1.0,
+                               -5.0, -0.5, -1.0,  -1.0};
+constexpr int kNumPieces = 8;
+constexpr int kUnknownCode = 100;
+constexpr float kUnknownScore = -20.0;
+
+constexpr int kMaxOutputLength = 64;
+constexpr int kNumTexts = 3;
+
+std::string GetNormalizationSpec() {
+  return GetTestFileContent(
+      "utils/sentencepiece/test_data/nmt_nfkc_charsmap.bin");
+}
+
+// Op config with the normalization spec of the test data, and the pieces
+// above.
+std::string GetTextEncoderConfig() {
+  const std::string spec = GetNormalizationSpec();
+  const uint32 trie_blob_size = reinterpret_cast<const uint32*>(spec.data())[0];
+
+  TextEncoderConfigT config;
+  config.normalization_charsmap = spec.substr(sizeof(uint32), trie_blob_size);
+  config.normalization_charsmap_values =
+      spec.substr(sizeof(uint32) + trie_blob_size);
+  config.unknown_code = kUnknownCode;
+  config.unknown_score = kUnknownScore;
+  config.pieces_scores.assign(kPiecesScores, kPiecesScores + kNumPieces);
+  config.pieces.assign(kPiecesTable, sizeof(kPiecesTable) - 1);
+  config.pieces_offsets.assign(kPiecesOffsets, kPiecesOffsets + kNumPieces);
+  config.matcher_type = SentencePieceMatcherType_SORTED_STRING_TABLE;
+  return PackFlatbuffer<TextEncoderConfig>(&config);
+}
+
+class TextEncoderOpTest : public testing::Test {
+ protected:
+  TextEncoderOpTest()
+      : normalizer_(NormalizerFromSpec(normalization_spec_,
+                                       /*add_dummy_prefix=*/true,
+                                       /*remove_extra_whitespaces=*/true,
+                                       /*escape_whitespaces=*/true)),
+        pieces_(kNumPieces, kPiecesOffsets,
+                StringPiece(kPiecesTable, sizeof(kPiecesTable) - 1)),
+        encoder_(&pieces_, kNumPieces, kPiecesScores, /*start_code=*/0,
+                 /*end_code=*/1, /*encoding_offset=*/2, kUnknownCode,
+                 kUnknownScore) {
+    // Inputs: texts, number of texts, maximum output length, one attribute.
+    // Outputs: encoded, positions, length, the aligned attribute.
+    interpreter_.AddTensors(8);
+    interpreter_.SetInputs({0, 1, 2, 3});
+    interpreter_.SetOutputs({4, 5, 6, 7});
+    interpreter_.SetTensorParametersReadWrite(0, kTfLiteString, "texts",
+                                              {1, kNumTexts},
+                                              TfLiteQuantization());
+    interpreter_.SetTensorParametersReadWrite(1, kTfLiteInt32, "num_texts",
+                                              {1}, TfLiteQuantization());
+    interpreter_.SetTensorParametersReadWrite(2, kTfLiteInt64, "max_length",
+                                              {1}, TfLiteQuantization());
+    interpreter_.SetTensorParametersReadWrite(3, kTfLiteInt32, "attr",
+                                              {1, kNumTexts},
+                                              TfLiteQuantization());
+    interpreter_.SetTensorParametersReadWrite(4, kTfLiteInt32, "encoded", {},
+                                              TfLiteQuantization());
+    interpreter_.SetTensorParametersReadWrite(5, kTfLiteInt32, "positions", {},
+                                              TfLiteQuantization());
+    interpreter_.SetTensorParametersReadWrite(6, kTfLiteInt32, "length", {},
+                                              TfLiteQuantization());
+    interpreter_.SetTensorParametersReadWrite(7, kTfLiteInt32, "attr_out", {},
+                                              TfLiteQuantization());
+
+    const std::string config = GetTextEncoderConfig();
+    flexbuffers::Builder options;
+    options.Map([&]() {
+      options.Key("text_encoder_config");
+      options.Blob(config.data(), config.size());
+    });
+    options.Finish();
+    interpreter_.AddNodeWithParameters(
+        /*inputs=*/{0, 1, 2, 3}, /*outputs=*/{4, 5, 6, 7},
+        reinterpret_cast<const char*>(options.GetBuffer().data()),
+        options.GetBuffer().size(), /*builtin_data=*/nullptr,
+        tflite::ops::custom::Register_TEXT_ENCODER());
+  }
+
+  // Runs the op on the texts, with the attribute values 10, 11, ...
+  std::vector<int> Invoke(const std::vector<std::string>& texts) {
+    tflite::DynamicBuffer buffer;
+    for (const std::string& text : texts) {
+      buffer.AddString(text.data(), text.size());
+    }
+    buffer.WriteToTensor(interpreter_.tensor(0),
+                         CreateIntArray({1, static_cast<int>(texts.size())}));
+    interpreter_.typed_tensor<int32_t>(1)[0] = texts.size();
+    interpreter_.typed_tensor<int64_t>(2)[0] = kMaxOutputLength;
+    for (int i = 0; i < texts.size(); ++i) {
+      interpreter_.typed_tensor<int32_t>(3)[i] = 10 + i;
+    }
+    EXPECT_EQ(interpreter_.Invoke(), kTfLiteOk);
+
+    const int length = interpreter_.typed_tensor<int32_t>(6)[0];
+    const int32_t* encoded = interpreter_.typed_tensor<int32_t>(4);
+    return std::vector<int>(encoded, encoded + length);
+  }
+
+  // Encodes the texts one by one with Encode, and concatenates the results.
+  std::vector<int> EncodeOneByOne(const std::vector<std::string>& texts) {
+    std::vector<int> encoded_texts;
+    for (const std::string& text : texts) {
+      std::string normalized;
+      EXPECT_TRUE(normalizer_.Normalize(text, &normalized));
+      std::vector<int> encoded;
+      EXPECT_TRUE(encoder_.Encode(normalized, &encoded));
+      encoded_texts.insert(encoded_texts.end(), encoded.begin(),
+                           encoded.end());
+    }
+    return encoded_texts;
+  }
+
+  const std::string normalization_spec_ = GetNormalizationSpec();
+  const SentencePieceNormalizer normalizer_;
+  const SortedStringsTable pieces_;
+  const Encoder encoder_;
+  tflite::Interpreter interpreter_;
+};
+
+TEST_F(TextEncoderOpTest, EncodesTextsAsEncoder) {
+  ASSERT_EQ(interpreter_.AllocateTensors(), kTfLiteOk);
+
+  const std::vector<std::string> texts = {"hello there", "hellothere",
+                                          "  hell  o  "};
+  EXPECT_THAT(Invoke(texts), ElementsAreArray(EncodeOneByOne(texts)));
+}
+
+TEST_F(TextEncoderOpTest, EncodesTextsAsEncoderOnEachInvocation) {
+  ASSERT_EQ(interpreter_.AllocateTensors(), kTfLiteOk);
+
+  const std::vector<std::string> texts = {"hello there", "", "there hello"};
+  EXPECT_THAT(Invoke(texts), ElementsAreArray(EncodeOneByOne(texts)));
+
+  const std::vector<std::string> other_texts = {"hell", "ｈｅｌｌｏ",
+                                                "hello, there"};
+  EXPECT_THAT(Invoke(other_texts),
+              ElementsAreArray(EncodeOneByOne(other_texts)));
+}
+
+TEST_F(TextEncoderOpTest, AlignsAttributesToPieces) {
+  ASSERT_EQ(interpreter_.AllocateTensors(), kTfLiteOk);
+
+  const std::vector<std::string> texts = {"hello", "hello there", "o"};
+  const std::vector<int> encoded = Invoke(texts);
+
+  std::vector<int> expected_attrs;
+  std::vector<int> expected_positions;
+  for (int i = 0; i < texts.size(); ++i) {
+    const int num_pieces = EncodeOneByOne({texts[i]}).size();
+    for (int k = 0; k < num_pieces; ++k) {
+      expected_attrs.push_back(10 + i);
+      expected_positions.push_back(k);
+    }
+  }
+  ASSERT_EQ(encoded.size(), expected_attrs.size());
+  const int32_t* attrs = interpreter_.typed_tensor<int32_t>(7);
+  EXPECT_THAT(std::vector<int>(attrs, attrs + encoded.size()),
+              ElementsAreArray(expected_attrs));
+  const int32_t* positions = interpreter_.typed_tensor<int32_t>(5);
+  EXPECT_THAT(std::vector<int>(positions, positions + encoded.size()),
+              ElementsAreArray(expected_positions));
+}
+
+}  // namespace
+}  // namespace libtextclassifier3
@@ -16,54 +16,78 @@
 
 #include "utils/token-feature-extractor.h"
 
+#include <algorithm>
 #include <cctype>
+#include <cstring>
 #include <string>
 
 #include "utils/base/logging.h"
 #include "utils/hash/farmhash.h"
 #include "utils/strings/stringpiece.h"
+#include "utils/strings/utf8.h"
 #include "utils/utf8/unicodetext.h"
 
 namespace libtextclassifier3 {
 
 namespace {
 
-std::string RemapTokenAscii(const std::string& token,
-                            const TokenFeatureExtractorOptions& options) {
-  if (!options.remap_digits && !options.lowercase_tokens) {
-    return token;
+// Padding and out-of-vocabulary tokens have extra buckets reserved because
+// they are special and important tokens, and we don't want them to share
+// embedding with other charactergrams.
+// TODO(zilka): Experimentally verify.
+const int kNumExtraBuckets = 2;
+
+// Builds the feature word of a token ("^" + word + "$") in place. Words of
+// usual lengths are built on the stack, without allocating.
+class FeatureWordBuilder {
+ public:
+  // `max_size` is an upper bound of the number of bytes of the word.
+  explicit FeatureWordBuilder(int max_size) {
+    if (max_size <= kStackBufferSize) {
+      data_ = stack_buffer_;
+    } else {
+      heap_buffer_.resize(max_size);
+      data_ = &heap_buffer_[0];
+    }
   }
 
-  std::string copy = token;
-  for (int i = 0; i < token.size(); ++i) {
-    if (options.remap_digits && isdigit(copy[i])) {
-      copy[i] = '0';
-    }
-    if (options.lowercase_tokens) {
-      copy[i] = tolower(copy[i]);
-    }
+  void Append(char c) { data_[size_++] = c; }
+
+  void Append(const char* data, int size) {
+    memcpy(data_ + size_, data, size);
+    size_ += size;
   }
-  return copy;
-}
 
-void RemapTokenUnicode(const std::string& token,
-                       const TokenFeatureExtractorOptions& options,
-                       const UniLib& unilib, UnicodeText* remapped) {
+  void AppendCodepoint(char32 codepoint) {
+    size_ += ValidRuneToChar(codepoint, data_ + size_);
+  }
+
+  StringPiece word() const { return StringPiece(data_, size_); }
+
+ private:
+  static constexpr int kStackBufferSize = 128;
+  char stack_buffer_[kStackBufferSize];
+  std::string heap_buffer_;
+  char* data_;
+  int size_ = 0;
+};
+
+void AppendRemappedAscii(const char* data, int size,
+                         const TokenFeatureExtractorOptions& options,
+                         FeatureWordBuilder* feature_word) {
   if (!options.remap_digits && !options.lowercase_tokens) {
-    // Leave remapped untouched.
+    feature_word->Append(data, size);
     return;
   }
-
-  UnicodeText word = UTF8ToUnicodeText(token, /*do_copy=*/false);
-  remapped->clear();
-  for (auto it = word.begin(); it != word.end(); ++it) {
-    if (options.remap_digits && unilib.IsDigit(*it)) {
-      remapped->push_back('0');
-    } else if (options.lowercase_tokens) {
-      remapped->push_back(unilib.ToLower(*it));
-    } else {
-      remapped->push_back(*it);
+  for (int i = 0; i < size; ++i) {
+    char c = data[i];
+    if (options.remap_digits && isdigit(c)) {
+      c = '0';
+    }
+    if (options.lowercase_tokens) {
+      c = tolower(c);
     }
+    feature_word->Append(c);
   }
 }
 
@@ -77,6 +101,17 @@ TokenFeatureExtractor::TokenFeatureExtractor(
         unilib_.CreateRegexPattern(UTF8ToUnicodeText(
             pattern.c_str(), pattern.size(), /*do_copy=*/false))));
   }
+
+  for (const std::string& chargram : options_.allowed_chargrams) {
+    allowed_chargrams_.push_back(
+        {tc3farmhash::Fingerprint64(chargram),
+         static_cast<int>(allowed_chargrams_data_.size()),
+         static_cast<int>(chargram.size())});
+    allowed_chargrams_data_ += chargram;
+  }
+  std::sort(allowed_chargrams_.begin(), allowed_chargrams_.end());
+
+  padding_bucket_ = HashToken("<PAD>");
 }
 
 bool TokenFeatureExtractor::Extract(const Token& token, bool is_in_span,
@@ -86,51 +121,66 @@ bool TokenFeatureExtractor::Extract(const Token& token, bool is_in_span,
     return false;
   }
   if (sparse_features) {
-    *sparse_features = ExtractCharactergramFeatures(token);
+    sparse_features->clear();
+    AppendCharactergramFeatures(token, sparse_features);
   }
-  *dense_features = ExtractDenseFeatures(token, is_in_span);
+  dense_features->clear();
+  AppendDenseFeatures(token, is_in_span, dense_features);
   return true;
 }
 
 std::vector<int> TokenFeatureExtractor::ExtractCharactergramFeatures(
     const Token& token) const {
-  if (options_.unicode_aware_features) {
-    return ExtractCharactergramFeaturesUnicode(token);
-  } else {
-    return ExtractCharactergramFeaturesAscii(token);
-  }
+  std::vector<int> result;
+  AppendCharactergramFeatures(token, &result);
+  return result;
 }
 
 std::vector<float> TokenFeatureExtractor::ExtractDenseFeatures(
     const Token& token, bool is_in_span) const {
   std::vector<float> dense_features;
+  AppendDenseFeatures(token, is_in_span, &dense_features);
+  return dense_features;
+}
 
+void TokenFeatureExtractor::AppendCharactergramFeatures(
+    const Token& token, std::vector<int>* result) const {
+  if (options_.unicode_aware_features) {
+    AppendCharactergramFeaturesUnicode(token, result);
+  } else {
+    AppendCharactergramFeaturesAscii(token, result);
+  }
+}
+
+void TokenFeatureExtractor::AppendDenseFeatures(
+    const Token& token, bool is_in_span,
+    std::vector<float>* dense_features) const {
   if (options_.extract_case_feature) {
     if (options_.unicode_aware_features) {
       UnicodeText token_unicode =
           UTF8ToUnicodeText(token.value, /*do_copy=*/false);
       if (!token.value.empty() && unilib_.IsUpper(*token_unicode.begin())) {
-        dense_features.push_back(1.0);
+        dense_features->push_back(1.0);
       } else {
-        dense_features.push_back(-1.0);
+        dense_features->push_back(-1.0);
       }
     } else {
       if (!token.value.empty() && isupper(*token.value.begin())) {
-        dense_features.push_back(1.0);
+        dense_features->push_back(1.0);
       } else {
-        dense_features.push_back(-1.0);
+        dense_features->push_back(-1.0);
       }
     }
   }
 
   if (options_.extract_selection_mask_feature) {
     if (is_in_span) {
-      dense_features.push_back(1.0);
+      dense_features->push_back(1.0);
     } else {
       if (options_.unicode_aware_features) {
-        dense_features.push_back(-1.0);
+        dense_features->push_back(-1.0);
       } else {
-        dense_features.push_back(0.0);
+        dense_features->push_back(0.0);
       }
     }
   }
@@ -141,170 +191,186 @@ std::vector<float> TokenFeatureExtractor::ExtractDenseFeatures(
         UTF8ToUnicodeText(token.value, /*do_copy=*/false);
     for (int i = 0; i < regex_patterns_.size(); ++i) {
       if (!regex_patterns_[i].get()) {
-        dense_features.push_back(-1.0);
+        dense_features->push_back(-1.0);
         continue;
       }
       auto matcher = regex_patterns_[i]->Matcher(token_unicode);
       int status;
       if (matcher->Matches(&status)) {
-        dense_features.push_back(1.0);
+        dense_features->push_back(1.0);
       } else {
-        dense_features.push_back(-1.0);
+        dense_features->push_back(-1.0);
       }
     }
   }
+}
 
-  return dense_features;
+bool TokenFeatureExtractor::IsAllowedChargram(StringPiece chargram,
+                                              uint64 fingerprint) const {
+  for (auto it = std::lower_bound(allowed_chargrams_.begin(),
+                                  allowed_chargrams_.end(),
+                                  AllowedChargram{fingerprint, 0, 0});
+       it != allowed_chargrams_.end() && it->fingerprint == fingerprint;
+       ++it) {
+    if (chargram.Equals(StringPiece(allowed_chargrams_data_.data() + it->offset,
+                                    it->size))) {
+      return true;
+    }
+  }
+  return false;
 }
 
 int TokenFeatureExtractor::HashToken(StringPiece token) const {
-  if (options_.allowed_chargrams.empty()) {
-    return tc3farmhash::Fingerprint64(token) % options_.num_buckets;
+  const uint64 fingerprint = tc3farmhash::Fingerprint64(token);
+  if (allowed_chargrams_.empty()) {
+    return fingerprint % options_.num_buckets;
   } else {
-    // Padding and out-of-vocabulary tokens have extra buckets reserved because
-    // they are special and important tokens, and we don't want them to share
-    // embedding with other charactergrams.
-    // TODO(zilka): Experimentally verify.
-    const int kNumExtraBuckets = 2;
-    const std::string token_string = token.ToString();
-    if (token_string == "<PAD>") {
+    if (token.Equals("<PAD>")) {
       return 1;
-    } else if (options_.allowed_chargrams.find(token_string) ==
-               options_.allowed_chargrams.end()) {
+    } else if (!IsAllowedChargram(token, fingerprint)) {
       return 0;  // Out-of-vocabulary.
     } else {
-      return (tc3farmhash::Fingerprint64(token) %
-              (options_.num_buckets - kNumExtraBuckets)) +
+      return (fingerprint % (options_.num_buckets - kNumExtraBuckets)) +
              kNumExtraBuckets;
     }
   }
 }
 
-std::vector<int> TokenFeatureExtractor::ExtractCharactergramFeaturesAscii(
-    const Token& token) const {
-  std::vector<int> result;
+void TokenFeatureExtractor::AppendCharactergramFeaturesAscii(
+    const Token& token, std::vector<int>* result) const {
   if (token.is_padding || token.value.empty()) {
-    result.push_back(HashToken("<PAD>"));
+    result->push_back(padding_bucket_);
+    return;
+  }
+
+  // Trim words that are over max_word_length characters.
+  const std::string& word = token.value;
+  const int max_word_length = options_.max_word_length;
+  FeatureWordBuilder feature_word_builder(word.size() + 3);
+  feature_word_builder.Append('^');
+  if (word.size() > max_word_length) {
+    AppendRemappedAscii(word.data(), max_word_length / 2, options_,
+                        &feature_word_builder);
+    feature_word_builder.Append('\1');
+    AppendRemappedAscii(word.data() + word.size() - max_word_length / 2,
+                        max_word_length / 2, options_, &feature_word_builder);
   } else {
-    const std::string word = RemapTokenAscii(token.value, options_);
-
-    // Trim words that are over max_word_length characters.
-    const int max_word_length = options_.max_word_length;
-    std::string feature_word;
-    if (word.size() > max_word_length) {
-      feature_word =
-          "^" + word.substr(0, max_word_length / 2) + "\1" +
-          word.substr(word.size() - max_word_length / 2, max_word_length / 2) +
-          "$";
-    } else {
-      // Add a prefix and suffix to the word.
-      feature_word = "^" + word + "$";
-    }
+    AppendRemappedAscii(word.data(), word.size(), options_,
+                        &feature_word_builder);
+  }
+  feature_word_builder.Append('$');
+  const StringPiece feature_word = feature_word_builder.word();
 
-    // Upper-bound the number of charactergram extracted to avoid resizing.
-    result.reserve(options_.chargram_orders.size() * feature_word.size());
+  // Upper-bound the number of charactergram extracted to avoid resizing.
+  result->reserve(result->size() +
+                  options_.chargram_orders.size() * feature_word.size());
 
-    if (options_.chargram_orders.empty()) {
-      result.push_back(HashToken(feature_word));
-    } else {
-      // Generate the character-grams.
-      for (int chargram_order : options_.chargram_orders) {
-        if (chargram_order == 1) {
-          for (int i = 1; i < feature_word.size() - 1; ++i) {
-            result.push_back(
-                HashToken(StringPiece(feature_word, /*offset=*/i, /*len=*/1)));
-          }
-        } else {
-          for (int i = 0;
-               i < static_cast<int>(feature_word.size()) - chargram_order + 1;
-               ++i) {
-            result.push_back(HashToken(StringPiece(feature_word, /*offset=*/i,
-                                                   /*len=*/chargram_order)));
-          }
+  if (options_.chargram_orders.empty()) {
+    result->push_back(HashToken(feature_word));
+  } else {
+    // Generate the character-grams.
+    for (int chargram_order : options_.chargram_orders) {
+      if (chargram_order == 1) {
+        for (int i = 1; i < feature_word.size() - 1; ++i) {
+          result->push_back(
+              HashToken(StringPiece(feature_word.data() + i, /*len=*/1)));
+        }
+      } else {
+        for (int i = 0;
+             i < static_cast<int>(feature_word.size()) - chargram_order + 1;
+             ++i) {
+          result->push_back(HashToken(
+              StringPiece(feature_word.data() + i, /*len=*/chargram_order)));
         }
       }
     }
   }
-  return result;
 }
 
-std::vector<int> TokenFeatureExtractor::ExtractCharactergramFeaturesUnicode(
-    const Token& token) const {
-  std::vector<int> result;
+void TokenFeatureExtractor::AppendCharactergramFeaturesUnicode(
+    const Token& token, std::vector<int>* result) const {
   if (token.is_padding || token.value.empty()) {
-    result.push_back(HashToken("<PAD>"));
-  } else {
-    UnicodeText word = UTF8ToUnicodeText(token.value, /*do_copy=*/false);
-    RemapTokenUnicode(token.value, options_, unilib_, &word);
-
-    // Trim the word if needed by finding a left-cut point and right-cut point.
-    auto left_cut = word.begin();
-    auto right_cut = word.end();
-    for (int i = 0; i < options_.max_word_length / 2; i++) {
-      if (left_cut < right_cut) {
-        ++left_cut;
+    result->push_back(padding_bucket_);
+    return;
+  }
+
+  const UnicodeText word = UTF8ToUnicodeText(token.value, /*do_copy=*/false);
+  const bool remap = options_.remap_digits || options_.lowercase_tokens;
+
+  // Trim the word if needed, keeping max_word_length / 2 codepoints from both
+  // ends.
+  const int num_codepoints = word.size_codepoints();
+  const int num_kept_codepoints = std::max(options_.max_word_length / 2, 0);
+  const bool trim = num_codepoints > 2 * num_kept_codepoints;
+
+  FeatureWordBuilder feature_word_builder(
+      (remap ? 4 * num_codepoints : word.size_bytes()) + 3);
+  feature_word_builder.Append('^');
+  int i = 0;
+  for (auto it = word.begin(); it != word.end(); ++it, ++i) {
+    if (trim) {
+      if (i == num_kept_codepoints) {
+        feature_word_builder.Append('\1');
       }
-      if (left_cut < right_cut) {
-        --right_cut;
+      if (i >= num_kept_codepoints &&
+          i < num_codepoints - num_kept_codepoints) {
+        continue;
       }
     }
-
-    std::string feature_word;
-    if (left_cut == right_cut) {
-      feature_word = "^" + word.UTF8Substring(word.begin(), word.end()) + "$";
+    if (!remap) {
+      feature_word_builder.Append(it.utf8_data(), it.utf8_length());
+    } else if (options_.remap_digits && unilib_.IsDigit(*it)) {
+      feature_word_builder.Append('0');
+    } else if (options_.lowercase_tokens) {
+      feature_word_builder.AppendCodepoint(unilib_.ToLower(*it));
     } else {
-      // clang-format off
-      feature_word = "^" +
-                     word.UTF8Substring(word.begin(), left_cut) +
-                     "\1" +
-                     word.UTF8Substring(right_cut, word.end()) +
-                     "$";
-      // clang-format on
+      feature_word_builder.AppendCodepoint(*it);
     }
+  }
+  feature_word_builder.Append('$');
+  const StringPiece feature_word = feature_word_builder.word();
+  const UnicodeText feature_word_unicode =
+      UTF8ToUnicodeText(feature_word, /*do_copy=*/false);
 
-    const UnicodeText feature_word_unicode =
-        UTF8ToUnicodeText(feature_word, /*do_copy=*/false);
-
-    // Upper-bound the number of charactergram extracted to avoid resizing.
-    result.reserve(options_.chargram_orders.size() * feature_word.size());
+  // Upper-bound the number of charactergram extracted to avoid resizing.
+  result->reserve(result->size() +
+                  options_.chargram_orders.size() * feature_word.size());
 
-    if (options_.chargram_orders.empty()) {
-      result.push_back(HashToken(feature_word));
-    } else {
-      // Generate the character-grams.
-      for (int chargram_order : options_.chargram_orders) {
-        UnicodeText::const_iterator it_start = feature_word_unicode.begin();
-        UnicodeText::const_iterator it_end = feature_word_unicode.end();
-        if (chargram_order == 1) {
-          ++it_start;
-          --it_end;
-        }
+  if (options_.chargram_orders.empty()) {
+    result->push_back(HashToken(feature_word));
+  } else {
+    // Generate the character-grams.
+    for (int chargram_order : options_.chargram_orders) {
+      UnicodeText::const_iterator it_start = feature_word_unicode.begin();
+      UnicodeText::const_iterator it_end = feature_word_unicode.end();
+      if (chargram_order == 1) {
+        ++it_start;
+        --it_end;
+      }
 
-        UnicodeText::const_iterator it_chargram_start = it_start;
-        UnicodeText::const_iterator it_chargram_end = it_start;
-        bool chargram_is_complete = true;
-        for (int i = 0; i < chargram_order; ++i) {
-          if (it_chargram_end == it_end) {
-            chargram_is_complete = false;
-            break;
-          }
-          ++it_chargram_end;
-        }
-        if (!chargram_is_complete) {
-          continue;
+      UnicodeText::const_iterator it_chargram_start = it_start;
+      UnicodeText::const_iterator it_chargram_end = it_start;
+      bool chargram_is_complete = true;
+      for (int i = 0; i < chargram_order; ++i) {
+        if (it_chargram_end == it_end) {
+          chargram_is_complete = false;
+          break;
         }
+        ++it_chargram_end;
+      }
+      if (!chargram_is_complete) {
+        continue;
+      }
 
-        for (; it_chargram_end <= it_end;
-             ++it_chargram_start, ++it_chargram_end) {
-          const int length_bytes =
-              it_chargram_end.utf8_data() - it_chargram_start.utf8_data();
-          result.push_back(HashToken(
-              StringPiece(it_chargram_start.utf8_data(), length_bytes)));
-        }
+      for (; it_chargram_end <= it_end;
+           ++it_chargram_start, ++it_chargram_end) {
+        const int length_bytes =
+            it_chargram_end.utf8_data() - it_chargram_start.utf8_data();
+        result->push_back(HashToken(
+            StringPiece(it_chargram_start.utf8_data(), length_bytes)));
       }
     }
   }
-  return result;
 }
 
 }  // namespace libtextclassifier3
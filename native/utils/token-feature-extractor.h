@@ -18,10 +18,12 @@
 #define LIBTEXTCLASSIFIER_UTILS_TOKEN_FEATURE_EXTRACTOR_H_
 
 #include <memory>
+#include <string>
 #include <unordered_set>
 #include <vector>
 
 #include "annotator/types.h"
+#include "utils/base/integral_types.h"
 #include "utils/strings/stringpiece.h"
 #include "utils/utf8/unilib.h"
 
@@ -75,6 +77,9 @@ class TokenFeatureExtractor {
   // selection span (true) or not (false).
   // The sparse_features output is optional. Fails and returns false if
   // dense_fatures in a nullptr.
+  // The output vectors are overwritten, but their capacity is reused, so
+  // extracting the features of many tokens into the same vectors doesn't
+  // allocate.
   bool Extract(const Token& token, bool is_in_span,
                std::vector<int>* sparse_features,
                std::vector<float>* dense_features) const;
@@ -98,18 +103,51 @@ class TokenFeatureExtractor {
   // Hashes given token to given number of buckets.
   int HashToken(StringPiece token) const;
 
-  // Extracts the charactergram features from the token in a non-unicode-aware
+  // Appends the charactergram features of the token to `result`.
+  void AppendCharactergramFeatures(const Token& token,
+                                   std::vector<int>* result) const;
+
+  // Appends the charactergram features from the token in a non-unicode-aware
   // way.
-  std::vector<int> ExtractCharactergramFeaturesAscii(const Token& token) const;
+  void AppendCharactergramFeaturesAscii(const Token& token,
+                                        std::vector<int>* result) const;
+
+  // Appends the charactergram features from the token in a unicode-aware way.
+  void AppendCharactergramFeaturesUnicode(const Token& token,
+                                          std::vector<int>* result) const;
 
-  // Extracts the charactergram features from the token in a unicode-aware way.
-  std::vector<int> ExtractCharactergramFeaturesUnicode(
-      const Token& token) const;
+  // Appends the dense features of the token to `result`.
+  void AppendDenseFeatures(const Token& token, bool is_in_span,
+                           std::vector<float>* result) const;
 
  private:
+  // An entry of `allowed_chargrams_`, referring to its bytes in
+  // `allowed_chargrams_data_`.
+  struct AllowedChargram {
+    uint64 fingerprint;
+    int offset;
+    int size;
+
+    bool operator<(const AllowedChargram& other) const {
+      return fingerprint < other.fingerprint;
+    }
+  };
+
+  // Returns whether the charactergram with the given fingerprint is in
+  // options_.allowed_chargrams.
+  bool IsAllowedChargram(StringPiece chargram, uint64 fingerprint) const;
+
   TokenFeatureExtractorOptions options_;
   std::vector<std::unique_ptr<UniLib::RegexPattern>> regex_patterns_;
   const UniLib& unilib_;
+
+  // The allowed charactergrams, sorted by fingerprint, so that they can be
+  // looked up without copying the charactergram.
+  std::vector<AllowedChargram> allowed_chargrams_;
+  std::string allowed_chargrams_data_;
+
+  // Bucket of the padding token.
+  int padding_bucket_;
 };
 
 }  // namespace libtextclassifier3
@@ -575,5 +575,50 @@ TEST_F(TokenFeatureExtractorTest, ExtractEmptyToken) {
   EXPECT_THAT(dense_features, testing::ElementsAreArray({-1.0, 1.0}));
 }
 
+TEST_F(TokenFeatureExtractorTest, ExtractVeryLongWord) {
+  TokenFeatureExtractorOptions options;
+  options.num_buckets = 1000;
+  options.chargram_orders = std::vector<int>{1};
+  options.unicode_aware_features = true;
+  options.lowercase_tokens = true;
+  options.max_word_length = 1000;
+  TestingTokenFeatureExtractor extractor(options, &unilib_);
+
+  // The word doesn't fit into the stack buffer of the extractor.
+  std::string word;
+  for (int i = 0; i < 100; ++i) {
+    word += "ř";
+  }
+  std::vector<int> sparse_features;
+  std::vector<float> dense_features;
+  extractor.Extract(Token{word, 0, 100}, true, &sparse_features,
+                    &dense_features);
+
+  EXPECT_EQ(sparse_features,
+            std::vector<int>(100, extractor.HashToken("ř")));
+}
+
+TEST_F(TokenFeatureExtractorTest, ExtractOverwritesOutputs) {
+  TokenFeatureExtractorOptions options;
+  options.num_buckets = 1000;
+  options.chargram_orders = std::vector<int>{2};
+  options.extract_case_feature = true;
+  TestingTokenFeatureExtractor extractor(options, &unilib_);
+
+  std::vector<int> sparse_features;
+  std::vector<float> dense_features;
+  extractor.Extract(Token{"Hello", 0, 5}, true, &sparse_features,
+                    &dense_features);
+  extractor.Extract(Token{"ab", 0, 2}, true, &sparse_features,
+                    &dense_features);
+
+  EXPECT_THAT(sparse_features, testing::ElementsAreArray({
+                                   extractor.HashToken("^a"),
+                                   extractor.HashToken("ab"),
+                                   extractor.HashToken("b$"),
+                               }));
+  EXPECT_THAT(dense_features, testing::ElementsAreArray({-1.0}));
+}
+
 }  // namespace
 }  // namespace libtextclassifier3
@@ -17,13 +17,51 @@
 #include "utils/tokenizer.h"
 
 #include <algorithm>
+#include <cstdint>
 
 #include "utils/base/logging.h"
 #include "utils/base/macros.h"
+#include "utils/hash/farmhash.h"
 #include "utils/strings/utf8.h"
 #include "utils/utf8/unicodetext.h"
 
 namespace libtextclassifier3 {
+namespace {
+
+// Computes a fingerprint of everything that influences the tokenization.
+uint64 TokenizerConfigFingerprint(
+    const TokenizationType type, const UniLib* unilib,
+    const std::vector<std::unique_ptr<const TokenizationCodepointRangeT>>&
+        codepoint_ranges,
+    const std::vector<CodepointRangeStruct>&
+        internal_tokenizer_codepoint_ranges,
+    const bool split_on_script_change,
+    const bool icu_preserve_whitespace_tokens,
+    const bool preserve_floating_numbers) {
+  std::vector<int64> config = {
+      static_cast<int64>(type),
+      static_cast<int64>(reinterpret_cast<uintptr_t>(unilib)),
+      split_on_script_change,
+      icu_preserve_whitespace_tokens,
+      preserve_floating_numbers,
+      static_cast<int64>(codepoint_ranges.size())};
+  for (const auto& range : codepoint_ranges) {
+    config.push_back(range->start);
+    config.push_back(range->end);
+    config.push_back(static_cast<int64>(range->role));
+    config.push_back(range->script_id);
+  }
+  for (const CodepointRangeStruct& range :
+       internal_tokenizer_codepoint_ranges) {
+    config.push_back(range.start);
+    config.push_back(range.end);
+  }
+  return tc3farmhash::Fingerprint64(
+      reinterpret_cast<const char*>(config.data()),
+      config.size() * sizeof(int64));
+}
+
+}  // namespace
 
 Tokenizer::Tokenizer(
     const TokenizationType type, const UniLib* unilib,
@@ -50,6 +88,10 @@ Tokenizer::Tokenizer(
 
   SortCodepointRanges(internal_tokenizer_codepoint_ranges,
                       &internal_tokenizer_codepoint_ranges_);
+  config_fingerprint_ = TokenizerConfigFingerprint(
+      type_, unilib_, codepoint_ranges_, internal_tokenizer_codepoint_ranges_,
+      split_on_script_change_, icu_preserve_whitespace_tokens_,
+      preserve_floating_numbers_);
   if (type_ == TokenizationType_MIXED && split_on_script_change) {
     TC3_LOG(ERROR) << "The option `split_on_script_change` is unavailable for "
                       "the selected tokenizer type (mixed).";
@@ -344,4 +386,31 @@ bool Tokenizer::NumberTokenize(const UnicodeText& text_unicode,
   return true;
 }
 
+const std::vector<Token>& TokenizationCache::Tokenize(
+    const Tokenizer& tokenizer) {
+  const uint64 config_fingerprint = tokenizer.ConfigFingerprint();
+  Entry* entry = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const std::unique_ptr<Entry>& cached_entry : entries_) {
+      if (cached_entry->config_fingerprint == config_fingerprint) {
+        entry = cached_entry.get();
+        break;
+      }
+    }
+    if (entry == nullptr) {
+      entries_.emplace_back(new Entry(config_fingerprint));
+      entry = entries_.back().get();
+    }
+  }
+  std::call_once(entry->tokenized, [this, &tokenizer, entry]() {
+    entry->tokens = tokenizer.Tokenize(text_);
+  });
+  return entry->tokens;
+}
+
+bool TokenizationCache::IsForText(const UnicodeText& text) const {
+  return text.data() == text_.data() && text.size_bytes() == text_.size_bytes();
+}
+
 }  // namespace libtextclassifier3
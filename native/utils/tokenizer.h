@@ -17,6 +17,8 @@
 #ifndef LIBTEXTCLASSIFIER_UTILS_TOKENIZER_H_
 #define LIBTEXTCLASSIFIER_UTILS_TOKENIZER_H_
 
+#include <memory>
+#include <mutex>  // NOLINT
 #include <string>
 #include <vector>
 
@@ -95,6 +97,10 @@ class Tokenizer {
   // Same as above but takes UnicodeText.
   std::vector<Token> Tokenize(const UnicodeText& text_unicode) const;
 
+  // Returns a fingerprint of the tokenizer configuration. Tokenizers with the
+  // same fingerprint produce the same tokens for any input.
+  uint64 ConfigFingerprint() const { return config_fingerprint_; }
+
  protected:
   // Finds the tokenization codepoint range config for given codepoint.
   // Internally uses binary search so should be O(log(# of codepoint_ranges)).
@@ -149,6 +155,46 @@ class Tokenizer {
 
   const bool icu_preserve_whitespace_tokens_;
   const bool preserve_floating_numbers_;
+
+  uint64 config_fingerprint_;
+};
+
+// Caches the tokenizations of a single text, keyed by the tokenizer
+// configuration, so that the annotators working on the same input share the
+// result of a tokenizer instead of re-running it.
+// NOTE: The text must outlive the cache. The cache is thread-safe, concurrent
+// requests for the same configuration wait for a single tokenization.
+class TokenizationCache {
+ public:
+  explicit TokenizationCache(const UnicodeText& text) : text_(text) {}
+
+  // Returns the tokens of the text as produced by `tokenizer`. Only the first
+  // call for a given tokenizer configuration runs the tokenizer.
+  const std::vector<Token>& Tokenize(const Tokenizer& tokenizer);
+
+  // Returns whether the cache holds tokenizations of `text`.
+  bool IsForText(const UnicodeText& text) const;
+
+  const UnicodeText& text() const { return text_; }
+
+ private:
+  struct Entry {
+    explicit Entry(uint64 arg_config_fingerprint)
+        : config_fingerprint(arg_config_fingerprint) {}
+
+    const uint64 config_fingerprint;
+    std::once_flag tokenized;
+    std::vector<Token> tokens;
+  };
+
+  const UnicodeText& text_;
+
+  // Guards `entries_`, the tokenization itself runs outside of the lock.
+  std::mutex mutex_;
+
+  // Typically only a handful of distinct tokenizers run on one input, so a
+  // linear scan is cheaper than a hash map here.
+  std::vector<std::unique_ptr<Entry>> entries_;
 };
 
 }  // namespace libtextclassifier3
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "utils/jvm-test-utils.h"
+#include "utils/testing/benchmark-utils.h"
+#include "utils/tokenizer.h"
+#include "utils/utf8/unicodetext.h"
+#include "utils/utf8/unilib.h"
+#include "benchmark/benchmark.h"
+
+namespace libtextclassifier3 {
+namespace {
+
+// Arguments: tokenization type, script, text length in codepoints.
+void BM_Tokenize(benchmark::State& state) {
+  const std::unique_ptr<UniLib> unilib = CreateUniLibForTesting();
+  const TokenizationType type = static_cast<TokenizationType>(state.range(0));
+  const Tokenizer tokenizer(type, unilib.get(), /*codepoint_ranges=*/{},
+                            /*internal_tokenizer_codepoint_ranges=*/{},
+                            /*split_on_script_change=*/false,
+                            /*icu_preserve_whitespace_tokens=*/false,
+                            /*preserve_floating_numbers=*/true);
+  const BenchmarkScript script = static_cast<BenchmarkScript>(state.range(1));
+  const UnicodeText text =
+      UTF8ToUnicodeText(GenerateText(script, state.range(2)));
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(tokenizer.Tokenize(text));
+  }
+  state.SetBytesProcessed(state.iterations() * text.size_bytes());
+  state.SetLabel(std::string(EnumNameTokenizationType(type)) + "/" +
+                 BenchmarkScriptName(script));
+}
+BENCHMARK(BM_Tokenize)
+    ->ArgsProduct({{TokenizationType_INTERNAL_TOKENIZER, TokenizationType_ICU,
+                    TokenizationType_LETTER_DIGIT},
+                   {static_cast<int>(BenchmarkScript::kLatin),
+                    static_cast<int>(BenchmarkScript::kHan),
+                    static_cast<int>(BenchmarkScript::kMixed)},
+                   {64, 1024, 16384}});
+BENCHMARK(BM_Tokenize)
+    ->Args({TokenizationType_ICU, static_cast<int>(BenchmarkScript::kLatin),
+            1024})
+    ->Apply(ReportLatencyPercentiles);
+
+}  // namespace
+}  // namespace libtextclassifier3
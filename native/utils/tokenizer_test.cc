@@ -95,6 +95,8 @@ class TestingTokenizerProxy {
     return tokenizer_->Tokenize(utf8_text);
   }
 
+  const Tokenizer& tokenizer() const { return *tokenizer_; }
+
  private:
   UniLib unilib_;
   std::vector<flatbuffers::DetachedBuffer> buffers_;
@@ -622,5 +624,44 @@ TEST(TokenizerTest, LetterDigitTokenizeWhitespcesInSameToken) {
                                         Token("5", 9, 10)}));
 }
 
+TEST(TokenizerTest, ConfigFingerprint) {
+  const Tokenizer tokenizer(/*codepoint_ranges=*/{},
+                            /*split_on_script_change=*/false);
+  const Tokenizer same_tokenizer(/*codepoint_ranges=*/{},
+                                 /*split_on_script_change=*/false);
+  const Tokenizer other_tokenizer(/*codepoint_ranges=*/{},
+                                  /*split_on_script_change=*/true);
+
+  EXPECT_EQ(tokenizer.ConfigFingerprint(), same_tokenizer.ConfigFingerprint());
+  EXPECT_NE(tokenizer.ConfigFingerprint(), other_tokenizer.ConfigFingerprint());
+}
+
+TEST(TokenizationCacheTest, TokenizesOncePerConfig) {
+  TestingTokenizerProxy tokenizer(TokenizationType_LETTER_DIGIT, {}, {},
+                                  /*split_on_script_change=*/false,
+                                  /*icu_preserve_whitespace_tokens=*/false,
+                                  /*preserve_floating_numbers=*/true);
+  TestingTokenizerProxy other_tokenizer(
+      TokenizationType_LETTER_DIGIT, {}, {},
+      /*split_on_script_change=*/false,
+      /*icu_preserve_whitespace_tokens=*/false,
+      /*preserve_floating_numbers=*/false);
+  const std::string text = "Pi is 3.14.";
+  const UnicodeText text_unicode = UTF8ToUnicodeText(text, /*do_copy=*/false);
+  TokenizationCache cache(text_unicode);
+
+  const std::vector<Token>& tokens = cache.Tokenize(tokenizer.tokenizer());
+  EXPECT_EQ(tokens, tokenizer.Tokenize(text));
+  EXPECT_EQ(&cache.Tokenize(tokenizer.tokenizer()), &tokens);
+
+  const std::vector<Token>& other_tokens =
+      cache.Tokenize(other_tokenizer.tokenizer());
+  EXPECT_NE(&other_tokens, &tokens);
+  EXPECT_EQ(other_tokens, other_tokenizer.Tokenize(text));
+
+  EXPECT_TRUE(cache.IsForText(UTF8ToUnicodeText(text, /*do_copy=*/false)));
+  EXPECT_FALSE(cache.IsForText(UTF8ToUnicodeText("Pi", /*do_copy=*/false)));
+}
+
 }  // namespace
 }  // namespace libtextclassifier3
@@ -0,0 +1,359 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/utf8/unilib-icu.h"
+
+#include <limits>
+#include <string>
+#include <utility>
+
+#include "utils/base/logging.h"
+#include "unicode/uchar.h"
+#include "unicode/utypes.h"
+
+namespace libtextclassifier3 {
+
+namespace {
+
+icu::UnicodeString ToIcuString(const UnicodeText& text) {
+  return icu::UnicodeString::fromUTF8(
+      icu::StringPiece(text.data(), text.size_bytes()));
+}
+
+UnicodeText ToUnicodeText(const icu::UnicodeString& text) {
+  std::string utf8;
+  text.toUTF8String(utf8);
+  return UTF8ToUnicodeText(utf8, /*do_copy=*/true);
+}
+
+}  // namespace
+
+bool UniLibBase::IsOpeningBracket(char32 codepoint) const {
+  return libtextclassifier3::IsOpeningBracket(codepoint);
+}
+
+bool UniLibBase::IsClosingBracket(char32 codepoint) const {
+  return libtextclassifier3::IsClosingBracket(codepoint);
+}
+
+bool UniLibBase::IsWhitespace(char32 codepoint) const {
+  return libtextclassifier3::IsWhitespace(codepoint);
+}
+
+bool UniLibBase::IsDigit(char32 codepoint) const {
+  return libtextclassifier3::IsDigit(codepoint);
+}
+
+bool UniLibBase::IsLower(char32 codepoint) const {
+  return libtextclassifier3::IsLower(codepoint);
+}
+
+bool UniLibBase::IsUpper(char32 codepoint) const {
+  return libtextclassifier3::IsUpper(codepoint);
+}
+
+bool UniLibBase::IsPunctuation(char32 codepoint) const {
+  return libtextclassifier3::IsPunctuation(codepoint);
+}
+
+char32 UniLibBase::ToLower(char32 codepoint) const {
+  return libtextclassifier3::ToLower(codepoint);
+}
+
+char32 UniLibBase::ToUpper(char32 codepoint) const {
+  return libtextclassifier3::ToUpper(codepoint);
+}
+
+char32 UniLibBase::GetPairedBracket(char32 codepoint) const {
+  return libtextclassifier3::GetPairedBracket(codepoint);
+}
+
+StatusOr<int32> UniLibBase::Length(const UnicodeText& text) const {
+  // Counted on the converted text, so that invalid UTF-8 is counted the same
+  // way as in the regex and break iterator offsets.
+  return ToIcuString(text).countChar32();
+}
+
+template <class T>
+bool UniLibBase::ParseInt(const UnicodeText& text, T* result) const {
+  T value = 0;
+  if (!PassesIntPreChesks(text, value)) {
+    return false;
+  }
+
+  // Same semantics as Java's Integer.parseInt: any decimal digits, no
+  // overflow.
+  for (const char32 codepoint : text) {
+    const int digit = u_charDigitValue(codepoint);
+    if (digit < 0 || digit > 9 ||
+        value > (std::numeric_limits<T>::max() - digit) / 10) {
+      return false;
+    }
+    value = value * 10 + digit;
+  }
+  *result = value;
+  return true;
+}
+
+bool UniLibBase::ParseInt32(const UnicodeText& text, int32* result) const {
+  return ParseInt(text, result);
+}
+
+bool UniLibBase::ParseInt64(const UnicodeText& text, int64* result) const {
+  return ParseInt(text, result);
+}
+
+bool UniLibBase::ParseDouble(const UnicodeText& text, double* result) const {
+  auto it_dot = text.begin();
+  for (; it_dot != text.end() && !IsDot(*it_dot); it_dot++) {
+  }
+
+  int32 integer_part;
+  if (!ParseInt(UnicodeText::Substring(text.begin(), it_dot, /*do_copy=*/false),
+                &integer_part)) {
+    return false;
+  }
+
+  int32 fractional_part = 0;
+  if (it_dot != text.end()) {
+    if (!ParseInt(
+            UnicodeText::Substring(++it_dot, text.end(), /*do_copy=*/false),
+            &fractional_part)) {
+      return false;
+    }
+  }
+
+  double factional_part_double = fractional_part;
+  while (factional_part_double >= 1) {
+    factional_part_double /= 10;
+  }
+  *result = integer_part + factional_part_double;
+
+  return true;
+}
+
+std::unique_ptr<UniLibBase::RegexPattern> UniLibBase::CreateRegexPattern(
+    const UnicodeText& regex) const {
+  return std::unique_ptr<UniLibBase::RegexPattern>(
+      new UniLibBase::RegexPattern(regex, /*lazy=*/false));
+}
+
+std::unique_ptr<UniLibBase::RegexPattern> UniLibBase::CreateLazyRegexPattern(
+    const UnicodeText& regex) const {
+  return std::unique_ptr<UniLibBase::RegexPattern>(
+      new UniLibBase::RegexPattern(regex, /*lazy=*/true));
+}
+
+UniLibBase::RegexPattern::RegexPattern(const UnicodeText& pattern, bool lazy)
+    : initialized_(false), pattern_text_(pattern) {
+  if (!lazy) {
+    LockedInitializeIfNotAlready();
+  }
+}
+
+void UniLibBase::RegexPattern::LockedInitializeIfNotAlready() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (initialized_) {
+    return;
+  }
+
+  UErrorCode status = U_ZERO_ERROR;
+  UParseError parse_error;
+  pattern_.reset(icu::RegexPattern::compile(ToIcuString(pattern_text_),
+                                            /*flags=*/0, parse_error, status));
+  if (U_FAILURE(status)) {
+    TC3_LOG(ERROR) << "Could not compile regex: " << u_errorName(status)
+                   << " at offset " << parse_error.offset;
+    pattern_.reset();
+  }
+  initialized_ = true;
+  pattern_text_.clear();  // We don't need this anymore.
+}
+
+constexpr int UniLibBase::RegexMatcher::kError;
+constexpr int UniLibBase::RegexMatcher::kNoError;
+
+std::unique_ptr<UniLibBase::RegexMatcher> UniLibBase::RegexPattern::Matcher(
+    const UnicodeText& context) const {
+  LockedInitializeIfNotAlready();  // Possibly lazy initialization.
+  if (pattern_ == nullptr) {
+    return nullptr;
+  }
+
+  std::unique_ptr<icu::UnicodeString> text(
+      new icu::UnicodeString(ToIcuString(context)));
+  UErrorCode status = U_ZERO_ERROR;
+  std::unique_ptr<icu::RegexMatcher> matcher(pattern_->matcher(*text, status));
+  if (U_FAILURE(status) || matcher == nullptr) {
+    return nullptr;
+  }
+  return std::unique_ptr<UniLibBase::RegexMatcher>(
+      new RegexMatcher(std::move(text), std::move(matcher)));
+}
+
+UniLibBase::RegexMatcher::RegexMatcher(
+    std::unique_ptr<icu::UnicodeString> text,
+    std::unique_ptr<icu::RegexMatcher> matcher)
+    : text_(std::move(text)), matcher_(std::move(matcher)) {}
+
+int UniLibBase::RegexMatcher::ToCodepointIndex(int utf16_index) const {
+  if (utf16_index >= last_utf16_index_) {
+    last_codepoint_index_ += text_->countChar32(
+        last_utf16_index_, utf16_index - last_utf16_index_);
+  } else {
+    last_codepoint_index_ -=
+        text_->countChar32(utf16_index, last_utf16_index_ - utf16_index);
+  }
+  last_utf16_index_ = utf16_index;
+  return last_codepoint_index_;
+}
+
+bool UniLibBase::RegexMatcher::Matches(int* status) const {
+  UErrorCode icu_status = U_ZERO_ERROR;
+  const bool result = matcher_->matches(icu_status);
+  if (U_FAILURE(icu_status)) {
+    *status = kError;
+    return false;
+  }
+  *status = kNoError;
+  return result;
+}
+
+bool UniLibBase::RegexMatcher::ApproximatelyMatches(int* status) {
+  *status = kNoError;
+
+  matcher_->reset();
+  if (!Find(status) || *status != kNoError) {
+    return false;
+  }
+
+  UErrorCode icu_status = U_ZERO_ERROR;
+  const int found_start = matcher_->start(icu_status);
+  const int found_end = matcher_->end(icu_status);
+  if (U_FAILURE(icu_status)) {
+    *status = kError;
+    return false;
+  }
+
+  return found_start == 0 && found_end == text_->length();
+}
+
+bool UniLibBase::RegexMatcher::Find(int* status) {
+  UErrorCode icu_status = U_ZERO_ERROR;
+  const bool result = matcher_->find(icu_status);
+  if (U_FAILURE(icu_status)) {
+    *status = kError;
+    return false;
+  }
+  *status = kNoError;
+  return result;
+}
+
+int UniLibBase::RegexMatcher::Start(int* status) const {
+  return Start(/*group_idx=*/0, status);
+}
+
+int UniLibBase::RegexMatcher::Start(int group_idx, int* status) const {
+  UErrorCode icu_status = U_ZERO_ERROR;
+  const int utf16_index = matcher_->start(group_idx, icu_status);
+  if (U_FAILURE(icu_status)) {
+    *status = kError;
+    return kError;
+  }
+  *status = kNoError;
+
+  // If the group didn't participate in the match the index is -1.
+  if (utf16_index == -1) {
+    return -1;
+  }
+  return ToCodepointIndex(utf16_index);
+}
+
+int UniLibBase::RegexMatcher::End(int* status) const {
+  return End(/*group_idx=*/0, status);
+}
+
+int UniLibBase::RegexMatcher::End(int group_idx, int* status) const {
+  UErrorCode icu_status = U_ZERO_ERROR;
+  const int utf16_index = matcher_->end(group_idx, icu_status);
+  if (U_FAILURE(icu_status)) {
+    *status = kError;
+    return kError;
+  }
+  *status = kNoError;
+
+  // If the group didn't participate in the match the index is -1.
+  if (utf16_index == -1) {
+    return -1;
+  }
+  return ToCodepointIndex(utf16_index);
+}
+
+UnicodeText UniLibBase::RegexMatcher::Group(int* status) const {
+  return Group(/*group_idx=*/0, status);
+}
+
+UnicodeText UniLibBase::RegexMatcher::Group(int group_idx, int* status) const {
+  UErrorCode icu_status = U_ZERO_ERROR;
+  // Empty when the group did not participate in the match, the participation
+  // can be checked by checking if Start() == -1.
+  const icu::UnicodeString result = matcher_->group(group_idx, icu_status);
+  if (U_FAILURE(icu_status)) {
+    *status = kError;
+    return UTF8ToUnicodeText("", /*do_copy=*/false);
+  }
+  *status = kNoError;
+  return ToUnicodeText(result);
+}
+
+constexpr int UniLibBase::BreakIterator::kDone;
+
+UniLibBase::BreakIterator::BreakIterator(const UnicodeText& text)
+    : text_(ToIcuString(text)), last_break_index_(0), last_unicode_index_(0) {
+  UErrorCode status = U_ZERO_ERROR;
+  iterator_.reset(
+      icu::BreakIterator::createWordInstance(icu::Locale::getUS(), status));
+  if (U_FAILURE(status)) {
+    TC3_LOG(ERROR) << "Could not create break iterator: "
+                   << u_errorName(status);
+    iterator_.reset();
+    return;
+  }
+  iterator_->setText(text_);
+}
+
+int UniLibBase::BreakIterator::Next() {
+  if (iterator_ == nullptr) {
+    return BreakIterator::kDone;
+  }
+  const int break_index = iterator_->next();
+  if (break_index == icu::BreakIterator::DONE) {
+    return BreakIterator::kDone;
+  }
+
+  last_unicode_index_ +=
+      text_.countChar32(last_break_index_, break_index - last_break_index_);
+  last_break_index_ = break_index;
+  return last_unicode_index_;
+}
+
+std::unique_ptr<UniLibBase::BreakIterator> UniLibBase::CreateBreakIterator(
+    const UnicodeText& text) const {
+  return std::unique_ptr<UniLibBase::BreakIterator>(
+      new UniLibBase::BreakIterator(text));
+}
+
+}  // namespace libtextclassifier3
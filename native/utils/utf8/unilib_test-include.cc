@@ -319,6 +319,34 @@ TEST_F(UniLibTest, RegexGroupsEmptyResult) {
   EXPECT_EQ(status, UniLib::RegexMatcher::kNoError);
 }
 
+TEST_F(UniLibTest, RegexOffsetsAfterSupplementaryCodepoints) {
+  const UnicodeText regex_pattern =
+      UTF8ToUnicodeText("([a-z]+)(😋*)", /*do_copy=*/false);
+  std::unique_ptr<UniLib::RegexPattern> pattern =
+      unilib_->CreateRegexPattern(regex_pattern);
+  int status;
+  std::unique_ptr<UniLib::RegexMatcher> matcher = pattern->Matcher(
+      UTF8ToUnicodeText("😋ab😋😋 😋cd ef😋", /*do_copy=*/false));
+
+  EXPECT_TRUE(matcher->Find(&status));
+  EXPECT_EQ(matcher->End(&status), 5);
+  EXPECT_EQ(matcher->Start(&status), 1);
+  EXPECT_EQ(matcher->Start(2, &status), 3);
+  EXPECT_EQ(matcher->Group(2, &status).ToUTF8String(), "😋😋");
+
+  EXPECT_TRUE(matcher->Find(&status));
+  EXPECT_EQ(matcher->Start(&status), 7);
+  EXPECT_EQ(matcher->End(&status), 9);
+
+  EXPECT_TRUE(matcher->Find(&status));
+  EXPECT_EQ(matcher->Start(&status), 10);
+  EXPECT_EQ(matcher->End(1, &status), 12);
+  EXPECT_EQ(matcher->End(&status), 13);
+  EXPECT_EQ(status, UniLib::RegexMatcher::kNoError);
+
+  EXPECT_FALSE(matcher->Find(&status));
+}
+
 TEST_F(UniLibTest, BreakIterator) {
   const UnicodeText text = UTF8ToUnicodeText("some text", /*do_copy=*/false);
   std::unique_ptr<UniLib::BreakIterator> iterator =